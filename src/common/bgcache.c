@@ -0,0 +1,406 @@
+/**
+ * Copyright (C) Generations Linux <bugs@softcraft.org>
+ * All Rights Reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <utime.h>
+#include <unistd.h>
+
+#include "gould.h"
+#include "bgcache.h"
+#include "sha1.h"
+#include "util.h"
+
+extern const char *Program;	/* see, gpanel.c and possibly others */
+
+/*
+* Private data structures.
+*
+* A cache entry is a BgCacheHeader followed by rowstride * height bytes
+* of pixels, so a hit is a single mmap() wrapped by a GdkPixbuf.
+*/
+typedef struct _BgCacheHeader BgCacheHeader;
+typedef struct _BgCacheEntry  BgCacheEntry;
+
+struct _BgCacheHeader
+{
+  char    magic[4];		/* BGCACHE_MAGIC */
+  guint32 version;		/* BGCACHE_VERSION */
+  guint32 width;
+  guint32 height;
+  guint32 rowstride;
+  guint32 channels;		/* 3 (RGB) or 4 (RGBA) */
+};
+
+struct _BgCacheEntry
+{
+  gchar  *path;
+  off_t   size;
+  time_t  stamp;		/* last use, see bgcache_touch() */
+};
+
+static gchar *folder_ = NULL;	/* see, bgcache_set_folder() */
+
+/*
+* (private) bgcache_folder - $XDG_CACHE_HOME/gould/backgrounds
+*
+* First reached from the main loop or a slideshow worker, whichever
+* comes first, hence g_once_init_enter().
+*/
+static const gchar *
+bgcache_folder (void)
+{
+  static gsize once = 0;
+
+  if (g_once_init_enter (&once)) {
+    if (folder_ == NULL) {
+      folder_ = g_build_filename (g_get_user_cache_dir(), BGCACHE_FOLDER, NULL);
+      g_mkdir_with_parents (folder_, 0700);
+    }
+    g_once_init_leave (&once, 1);
+  }
+  return folder_;
+} /* </bgcache_folder> */
+
+/*
+* bgcache_set_folder - keep the cache in folder, before any other call
+*/
+void
+bgcache_set_folder (const gchar *folder)
+{
+  g_free (folder_);
+  folder_ = g_strdup (folder);
+  g_mkdir_with_parents (folder_, 0755);
+} /* </bgcache_set_folder> */
+
+/*
+* (private) bgcache_filename - cache file for (source, mtime, size, mode)
+*/
+static gchar *
+bgcache_filename (const char *pathname, time_t mtime,
+                  gint width, gint height, BackgroundMode mode)
+{
+  unsigned char digest[SHA1_DIGEST_SIZE];
+  char name[SHA1_STRING_SIZE + 1];
+  gchar *key = g_strdup_printf ("%s:%ld:%dx%d:%d", pathname, (long)mtime,
+                                width, height, mode);
+  int idx;
+
+  SHA1 (digest, key, strlen(key));
+  g_free (key);
+
+  for (idx = 0; idx < SHA1_DIGEST_SIZE; idx++)
+    sprintf(&name[2 * idx], "%02x", digest[idx]);
+
+  return g_build_filename (bgcache_folder (), name, NULL);
+} /* </bgcache_filename> */
+
+/*
+* (private) bgcache_unmap - GdkPixbufDestroyNotify for mapped pixels
+*/
+static void
+bgcache_unmap (guchar *pixels, gpointer length)
+{
+  munmap (pixels - sizeof(BgCacheHeader), GPOINTER_TO_SIZE (length));
+} /* </bgcache_unmap> */
+
+/*
+* (private) bgcache_load - map a cache file, NULL when missing or stale
+*/
+static GdkPixbuf *
+bgcache_load (const gchar *file, gint width, gint height)
+{
+  GdkPixbuf *pixbuf = NULL;
+  BgCacheHeader *header;
+  struct stat info;
+  void *data;
+  int fd;
+
+  if ((fd = open(file, O_RDONLY | O_CLOEXEC)) < 0)
+    return NULL;
+
+  if (fstat(fd, &info) != 0 || info.st_size < sizeof(BgCacheHeader)) {
+    close(fd);
+    return NULL;
+  }
+
+  data = mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+
+  if (data == MAP_FAILED)
+    return NULL;
+
+  header = (BgCacheHeader *)data;
+
+  if (memcmp(header->magic, BGCACHE_MAGIC, 4) == 0 &&
+      header->version == BGCACHE_VERSION &&
+      header->width == width && header->height == height &&
+      (header->channels == 3 || header->channels == 4) &&
+      info.st_size == sizeof(BgCacheHeader) +
+                      (off_t)header->rowstride * header->height) {
+
+    pixbuf = gdk_pixbuf_new_from_data ((guchar *)data + sizeof(BgCacheHeader),
+                                       GDK_COLORSPACE_RGB,
+                                       header->channels == 4, 8,
+                                       width, height, header->rowstride,
+                                       (GdkPixbufDestroyNotify)bgcache_unmap,
+                                       GSIZE_TO_POINTER (info.st_size));
+  }
+
+  if (pixbuf == NULL) {		/* stale or corrupt entry */
+    munmap(data, info.st_size);
+    unlink(file);
+  }
+  else {
+    utime(file, NULL);		/* mark as recently used */
+  }
+  return pixbuf;
+} /* </bgcache_load> */
+
+/*
+* (private) bgcache_store - write pixbuf to the cache, atomically
+*/
+static bool
+bgcache_store (const gchar *file, GdkPixbuf *pixbuf)
+{
+  BgCacheHeader header;
+  gchar *partial;
+  bool vote = false;
+  FILE *stream;
+
+  memcpy(header.magic, BGCACHE_MAGIC, 4);
+  header.version   = BGCACHE_VERSION;
+  header.width     = gdk_pixbuf_get_width (pixbuf);
+  header.height    = gdk_pixbuf_get_height (pixbuf);
+  header.rowstride = gdk_pixbuf_get_rowstride (pixbuf);
+  header.channels  = gdk_pixbuf_get_n_channels (pixbuf);
+
+  partial = g_strdup_printf ("%s.%d", file, getpid());
+
+  if ((stream = fopen(partial, "w"))) {
+    size_t length = (size_t)header.rowstride * header.height;
+
+    vote = fwrite(&header, sizeof(BgCacheHeader), 1, stream) == 1 &&
+           fwrite(gdk_pixbuf_get_pixels (pixbuf), length, 1, stream) == 1;
+
+    if (fclose(stream) != 0)
+      vote = false;
+
+    if (vote)
+      vote = rename(partial, file) == 0;
+
+    if (!vote)
+      unlink(partial);
+  }
+  g_free (partial);
+
+  return vote;
+} /* </bgcache_store> */
+
+/*
+* (private) bgcache_compare - order entries by last use, oldest first
+*/
+static gint
+bgcache_compare (gconstpointer a, gconstpointer b)
+{
+  const BgCacheEntry *one = a;
+  const BgCacheEntry *two = b;
+
+  return (one->stamp < two->stamp) ? -1 : (one->stamp > two->stamp);
+} /* </bgcache_compare> */
+
+/*
+* bgcache_evict - remove least recently used entries until under limit
+*/
+void
+bgcache_evict (gsize limit)
+{
+  GDir *dir = g_dir_open (bgcache_folder (), 0, NULL);
+  GList *iter, *list = NULL;
+  gsize total = 0;
+  const gchar *name;
+
+  if (dir == NULL)
+    return;
+
+  while ((name = g_dir_read_name (dir))) {
+    gchar *path = g_build_filename (bgcache_folder (), name, NULL);
+    struct stat info;
+
+    if (stat(path, &info) == 0 && S_ISREG(info.st_mode)) {
+      BgCacheEntry *entry = g_new (BgCacheEntry, 1);
+
+      entry->path  = path;
+      entry->size  = info.st_size;
+      entry->stamp = info.st_mtime;
+      total += info.st_size;
+
+      list = g_list_prepend (list, entry);
+    }
+    else {
+      g_free (path);
+    }
+  }
+  g_dir_close (dir);
+
+  list = g_list_sort (list, bgcache_compare);
+
+  for (iter = list; iter != NULL; iter = iter->next) {
+    BgCacheEntry *entry = iter->data;
+
+    if (total > limit && unlink(entry->path) == 0) {
+      vdebug (2, "bgcache_evict %s (%ld bytes)\n", entry->path,
+                  (long)entry->size);
+      total -= entry->size;
+    }
+    g_free (entry->path);
+    g_free (entry);
+  }
+  g_list_free (list);
+} /* </bgcache_evict> */
+
+/*
+* bgcache_render - scale image to (width, height) according to mode
+*/
+GdkPixbuf *
+bgcache_render (GdkPixbuf *image, gint width, gint height,
+                BackgroundMode mode)
+{
+  gint xsize = gdk_pixbuf_get_width (image);
+  gint ysize = gdk_pixbuf_get_height (image);
+  GdkPixbuf *pixbuf;
+
+  if (mode == BACKGROUND_SCALED) {
+    if (xsize == width && ysize == height)
+      return g_object_ref (image);
+
+    return gdk_pixbuf_scale_simple (image, width, height, GDK_INTERP_BILINEAR);
+  }
+
+  pixbuf = gdk_pixbuf_new (GDK_COLORSPACE_RGB, FALSE, 8, width, height);
+  gdk_pixbuf_fill (pixbuf, 0x000000ff);
+
+  if (mode == BACKGROUND_ZOOMED) {
+    double factor = MAX((double)width / xsize, (double)height / ysize);
+    double xoff = (width  - xsize * factor) / 2;
+    double yoff = (height - ysize * factor) / 2;
+
+    gdk_pixbuf_composite (image, pixbuf, 0, 0, width, height,
+                          xoff, yoff, factor, factor,
+                          GDK_INTERP_BILINEAR, 255);
+  }
+  else {			/* BACKGROUND_CENTERED */
+    gint xdst = MAX((width - xsize) / 2, 0);
+    gint ydst = MAX((height - ysize) / 2, 0);
+    gint xsrc = MAX((xsize - width) / 2, 0);
+    gint ysrc = MAX((ysize - height) / 2, 0);
+
+    gdk_pixbuf_composite (image, pixbuf, xdst, ydst,
+                          MIN(xsize, width), MIN(ysize, height),
+                          xdst - xsrc, ydst - ysrc, 1.0, 1.0,
+                          GDK_INTERP_NEAREST, 255);
+  }
+  return pixbuf;
+} /* </bgcache_render> */
+
+/*
+* bgcache_lookup - background for pathname at (width, height) in the given
+* mode when cached, otherwise NULL
+*/
+GdkPixbuf *
+bgcache_lookup (const char *pathname, gint width, gint height,
+                BackgroundMode mode)
+{
+  GdkPixbuf *pixbuf;
+  struct stat info;
+  gchar *file;
+
+  if (pathname == NULL || stat(pathname, &info) != 0)
+    return NULL;
+
+  file = bgcache_filename (pathname, info.st_mtime, width, height, mode);
+  pixbuf = bgcache_load (file, width, height);
+  g_free (file);
+
+  vdebug (2, "bgcache_lookup %s => %s\n", pathname, (pixbuf) ? "hit" : "miss");
+  return pixbuf;
+} /* </bgcache_lookup> */
+
+/*
+* bgcache_save - store pixbuf, pathname rendered in the given mode at the
+* size of pixbuf. Safe to call from a worker thread once the cache folder
+* is known, see bgcache_lookup() and bgcache_set_folder().
+*/
+bool
+bgcache_save (const char *pathname, GdkPixbuf *pixbuf, BackgroundMode mode)
+{
+  struct stat info;
+  bool vote = false;
+  gchar *file;
+
+  if (pathname == NULL || stat(pathname, &info) != 0)
+    return false;
+
+  file = bgcache_filename (pathname, info.st_mtime,
+                           gdk_pixbuf_get_width (pixbuf),
+                           gdk_pixbuf_get_height (pixbuf), mode);
+
+  if ((vote = bgcache_store (file, pixbuf)))
+    bgcache_evict (BGCACHE_LIMIT);
+
+  g_free (file);
+  return vote;
+} /* </bgcache_save> */
+
+/*
+* bgcache_pixbuf - return the background for pathname already rendered
+* at (width, height) in the given mode. A cache hit maps the stored pixels
+* without decoding or scaling; a miss renders and stores them.
+*/
+GdkPixbuf *
+bgcache_pixbuf (const char *pathname, gint width, gint height,
+                BackgroundMode mode)
+{
+  GdkPixbuf *image, *pixbuf;
+  GError *error = NULL;
+  struct stat info;
+
+  if (pathname == NULL || stat(pathname, &info) != 0)
+    return NULL;
+
+  if ((pixbuf = bgcache_lookup (pathname, width, height, mode)) != NULL)
+    return pixbuf;
+
+  if ((image = gdk_pixbuf_new_from_file (pathname, &error)) == NULL) {
+    g_printerr("%s: %s\n", Program, error->message);
+    g_error_free (error);
+    return NULL;
+  }
+
+  pixbuf = bgcache_render (image, width, height, mode);
+  g_object_unref (image);
+
+  bgcache_save (pathname, pixbuf, mode);
+  return pixbuf;
+} /* </bgcache_pixbuf> */
@@ -0,0 +1,69 @@
+/**
+ * Copyright (C) Generations Linux <bugs@softcraft.org>
+ * All Rights Reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef BGCACHE_H
+#define BGCACHE_H
+
+#include <stdbool.h>
+#include <gtk/gtk.h>
+
+#define BGCACHE_FOLDER  "gould/backgrounds"	/* under $XDG_CACHE_HOME */
+#define BGCACHE_LIMIT   (128 * 1024 * 1024)	/* bytes kept on disk */
+#define BGCACHE_MAGIC   "GBGC"
+#define BGCACHE_VERSION 1
+
+G_BEGIN_DECLS
+
+/**
+ * Public data structures.
+ */
+typedef enum _BackgroundMode BackgroundMode;
+
+enum _BackgroundMode
+{
+  BACKGROUND_SCALED,		/* stretch to the screen size */
+  BACKGROUND_ZOOMED,		/* keep aspect ratio, crop to fill */
+  BACKGROUND_CENTERED		/* unscaled, centered on black */
+};
+
+/**
+ * Public methods (bgcache.c) exported in the implementation.
+ */
+GdkPixbuf *bgcache_pixbuf (const char *pathname,
+                           gint width, gint height,
+                           BackgroundMode mode);
+
+GdkPixbuf *bgcache_lookup (const char *pathname,
+                           gint width, gint height,
+                           BackgroundMode mode);
+
+GdkPixbuf *bgcache_render (GdkPixbuf *image,
+                           gint width, gint height,
+                           BackgroundMode mode);
+
+bool bgcache_save (const char *pathname, GdkPixbuf *pixbuf,
+                   BackgroundMode mode);
+
+void bgcache_set_folder (const gchar *folder);
+
+void bgcache_evict (gsize limit);
+
+G_END_DECLS
+
+#endif /* </BGCACHE_H> */
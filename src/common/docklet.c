@@ -145,37 +145,32 @@ docklet_refresh (GtkWidget *canvas, GdkEventExpose *event, Docklet *instance)
 } /* </docklet_refresh> */
 
 /*
- * docklet_render
+ * docklet_render - compose icon and text client side (cairo image surface)
  */
 GdkPixbuf *
 docklet_render (Docklet *instance, GdkPixbuf *pixbuf)
 {
   const gchar *text = instance->text;
   GtkWidget *widget = instance->window;
-  GdkWindow *window = gdk_get_default_root_window ();
 
   PangoLayout *layout = gtk_widget_create_pango_layout (widget, _(text));
-  GdkColormap *colormap = gdk_colormap_get_system ();
+  cairo_surface_t *surface;
+  cairo_t *cr;
 
   gint width  = instance->width;
   gint height = instance->height;
 
-  GdkGC     *gc;	/* GDK Graphic Context used for drawing */
-  GdkColor  black;
-  GdkColor  white;
+  GdkColor  black = { 0, 0x0000, 0x0000, 0x0000 };
+  GdkColor  white = { 0, 0xffff, 0xffff, 0xffff };
   GdkColor  *fg;
   GdkColor  *bg;
 
-  GdkPixmap *pixmap;
   GdkPixbuf *render;
 
   gint xsize, ysize;
   gint xpos, ypos;
   int wrap;
 
-  gdk_color_black (colormap, &black);
-  gdk_color_white (colormap, &white);
-
   fg = (instance->fg) ? instance->fg : &white;
   bg = (instance->bg) ? instance->bg : NULL;
 
@@ -204,21 +199,18 @@ docklet_render (Docklet *instance, GdkPixbuf *pixbuf)
     xpos = 0;
   }
 
-  /* Create a pixmap for the drawing area. */
-  gc = gdk_gc_new (window);
+  /* Draw off screen, transparent unless there is a background color. */
+  surface = cairo_image_surface_create (CAIRO_FORMAT_ARGB32, width, height);
+  cr = cairo_create (surface);
 
   if (bg != NULL) {
-    gdk_gc_set_foreground (gc, bg);
-    pixmap = gdk_pixmap_new (window, width, height, -1);
-    gdk_draw_rectangle (pixmap, gc, TRUE, 0, 0, width, height);
-  }
-  else {
-    render = xpm_pixbuf_scale (ICON_BLANK, width, height, NULL);
-    gdk_pixbuf_render_pixmap_and_mask (render, &pixmap, NULL, 255);
+    gdk_cairo_set_source_color (cr, bg);
+    cairo_paint (cr);
   }
 
   /* Draw the instance->icon pixbuf passed. */
-  draw_pixbuf (pixmap, pixbuf, gc, xpos, 0);
+  gdk_cairo_set_source_pixbuf (cr, pixbuf, xpos, 0);
+  cairo_paint (cr);
 
   /* Draw the instance->text. */
   if (instance->place == GTK_ORIENTATION_VERTICAL) {
@@ -235,30 +227,33 @@ docklet_render (Docklet *instance, GdkPixbuf *pixbuf)
   pango_layout_set_width (layout, wrap * PANGO_SCALE);
   pango_layout_set_wrap (layout, PANGO_WRAP_WORD_CHAR);
 
-  gdk_draw_layout_with_colors (pixmap, gc, xpos, ypos, layout, fg, bg);
-  if (instance->shadow) /* Draw the text with a drop shadow. */
-    gdk_draw_layout_with_colors (pixmap, gc, xpos+1, ypos+1,layout, &black, bg);
+  gdk_cairo_set_source_color (cr, fg);
+  cairo_move_to (cr, xpos, ypos);
+  pango_cairo_show_layout (cr, layout);
+
+  if (instance->shadow) { /* Draw the text with a drop shadow. */
+    gdk_cairo_set_source_color (cr, &black);
+    cairo_move_to (cr, xpos+1, ypos+1);
+    pango_cairo_show_layout (cr, layout);
+  }
 
   g_object_unref (layout);
-  g_object_unref (gc);
+  cairo_destroy (cr);
 
-  /* Convert drawable to a pixbuf. */
-  render = gdk_pixbuf_get_from_drawable(NULL, pixmap, colormap,
-                                        0, 0, 0, 0, width, height);
-  g_object_unref (pixmap);
+  /* No server round trip, the caller uploads the result once. */
+  render = pixbuf_new_from_surface (surface);
+  cairo_surface_destroy (surface);
 
   return render;
 } /* </docklet_render> */
 
 /*
- * docklet_layout - construct main window layout contents
+ * (private) docklet_compose - icon scaled to size, with text when given
  */
-GdkPixbuf *
-docklet_layout (Docklet *instance, gint *xsize, gint *ysize)
+static GdkPixbuf *
+docklet_compose (Docklet *instance)
 {
-  GdkBitmap *mask;
   GdkPixbuf *pixbuf;
-  GdkPixmap *pixmap;
 
   gint width  = instance->width;
   gint height = instance->height;
@@ -273,6 +268,18 @@ docklet_layout (Docklet *instance, gint *xsize, gint *ysize)
     g_object_unref (pixbuf);
     pixbuf = render;
   }
+  return pixbuf;
+} /* </docklet_compose> */
+
+/*
+ * docklet_layout - construct main window layout contents
+ */
+GdkPixbuf *
+docklet_layout (Docklet *instance, gint *xsize, gint *ysize)
+{
+  GdkBitmap *mask;
+  GdkPixbuf *pixbuf = docklet_compose (instance);
+  GdkPixmap *pixmap;
 
   /* Dimensions may have changed, consult resulting pixbuf. */
   *xsize = gdk_pixbuf_get_width (pixbuf);
@@ -280,7 +287,7 @@ docklet_layout (Docklet *instance, gint *xsize, gint *ysize)
 
   /* Shape drawable for a transparent look. */
   if (instance->visa == GTK_VISIBILITY_NONE) {
-    gdk_pixbuf_render_pixmap_and_mask (pixbuf, &pixmap, &mask, 255);
+    gdk_pixbuf_render_pixmap_and_mask (pixbuf, &pixmap, &mask, 1);
     if (mask == NULL) mask = create_mask_from_pixmap (pixmap, *xsize, *ysize);
     gtk_widget_shape_combine_mask (instance->window, mask, 0, 0);
   }
@@ -386,6 +393,446 @@ docklet_new (GdkWindowTypeHint hint,
   return instance;
 } /* </docklet_new> */
 
+/*
+ * Docklet canvas, all docklets drawn client side on one desktop window.
+ *
+ * (private) docklet_canvas_bounds - docklet rectangle on the canvas
+ * (private) docklet_canvas_paint - draw docklets overlapping region
+ * (private) docklet_canvas_damage - clear and redraw region
+ * (private) docklet_canvas_reshape - accept input only over docklets
+ */
+static void
+docklet_canvas_bounds (Docklet *instance, GdkRectangle *area)
+{
+  area->x = instance->xpos;
+  area->y = instance->ypos;
+  area->width  = instance->width;
+  area->height = instance->height;
+} /* </docklet_canvas_bounds> */
+
+static void
+docklet_canvas_paint (DockletCanvas *canvas, GdkRegion *region)
+{
+  GtkWidget *widget = canvas->window;
+  GdkColor *color = &widget->style->base[GTK_STATE_SELECTED];
+  GdkRectangle area;
+  GList *iter;
+  cairo_t *cr;
+
+  if (widget->window == NULL)	/* not realized (yet) */
+    return;
+
+  cr = gdk_cairo_create (widget->window);
+  gdk_cairo_region (cr, region);
+  cairo_clip (cr);
+
+  for (iter = canvas->docklets; iter != NULL; iter = iter->next) {
+    Docklet *instance = iter->data;
+
+    docklet_canvas_bounds (instance, &area);
+
+    if (gdk_region_rect_in (region, &area) == GDK_OVERLAP_RECTANGLE_OUT)
+      continue;
+
+    gdk_cairo_set_source_pixbuf (cr, instance->render, area.x, area.y);
+    cairo_paint (cr);
+
+    if (instance == canvas->selected) {
+      cairo_set_source_rgba (cr, color->red / 65535.0,
+                                 color->green / 65535.0,
+                                 color->blue / 65535.0, 0.35);
+      gdk_cairo_rectangle (cr, &area);
+      cairo_fill (cr);
+    }
+  }
+  cairo_destroy (cr);
+} /* </docklet_canvas_paint> */
+
+static void
+docklet_canvas_damage (DockletCanvas *canvas, GdkRegion *region)
+{
+  GdkWindow *window = canvas->window->window;
+  GdkRectangle *rects;
+  gint count, idx;
+
+  if (window == NULL)
+    return;
+
+  /* Restore the (parent relative) background, then paint over it. */
+  gdk_region_get_rectangles (region, &rects, &count);
+
+  for (idx = 0; idx < count; idx++)
+    gdk_window_clear_area (window, rects[idx].x, rects[idx].y,
+                                   rects[idx].width, rects[idx].height);
+  g_free (rects);
+
+  docklet_canvas_paint (canvas, region);
+} /* </docklet_canvas_damage> */
+
+static void
+docklet_canvas_reshape (DockletCanvas *canvas)
+{
+  GdkRegion *region = gdk_region_new ();
+  GdkRectangle area;
+  GList *iter;
+
+  for (iter = canvas->docklets; iter != NULL; iter = iter->next) {
+    docklet_canvas_bounds (iter->data, &area);
+    gdk_region_union_with_rect (region, &area);
+  }
+
+  /* Clicks elsewhere go through to the root window. */
+  if (canvas->window->window != NULL)
+    gdk_window_input_shape_combine_region (canvas->window->window,
+                                           region, 0, 0);
+  gdk_region_destroy (region);
+} /* </docklet_canvas_reshape> */
+
+/*
+ * (private) docklet_canvas_redraw - clear and redraw one docklet
+ * (private) docklet_canvas_pick - topmost docklet painted at (x, y)
+ * (private) docklet_canvas_select - move the selection highlight
+ */
+static void
+docklet_canvas_redraw (DockletCanvas *canvas, Docklet *instance)
+{
+  GdkRectangle area;
+  GdkRegion *region;
+
+  docklet_canvas_bounds (instance, &area);
+  region = gdk_region_rectangle (&area);
+  docklet_canvas_damage (canvas, region);
+  gdk_region_destroy (region);
+} /* </docklet_canvas_redraw> */
+
+static Docklet *
+docklet_canvas_pick (DockletCanvas *canvas, gint x, gint y)
+{
+  GList *iter;
+
+  for (iter = g_list_last (canvas->docklets); iter; iter = iter->prev) {
+    Docklet *instance = iter->data;
+    GdkPixbuf *pixbuf = instance->render;
+    gint u = x - instance->xpos;
+    gint v = y - instance->ypos;
+
+    if (u < 0 || u >= gdk_pixbuf_get_width (pixbuf) ||
+        v < 0 || v >= gdk_pixbuf_get_height (pixbuf))
+      continue;
+
+    /* Transparent pixels belong to whatever lies beneath. */
+    if (gdk_pixbuf_get_has_alpha (pixbuf)) {
+      guchar *pixel = gdk_pixbuf_get_pixels (pixbuf) +
+                      v * gdk_pixbuf_get_rowstride (pixbuf) +
+                      u * gdk_pixbuf_get_n_channels (pixbuf);
+
+      if (pixel[3] == 0)
+        continue;
+    }
+    return instance;
+  }
+  return NULL;
+} /* </docklet_canvas_pick> */
+
+static void
+docklet_canvas_select (DockletCanvas *canvas, Docklet *instance)
+{
+  Docklet *previous = canvas->selected;
+
+  if (previous != instance) {
+    canvas->selected = instance;
+
+    if (previous != NULL)
+      docklet_canvas_redraw (canvas, previous);
+
+    if (instance != NULL)
+      docklet_canvas_redraw (canvas, instance);
+  }
+} /* </docklet_canvas_select> */
+
+/*
+ * docklet_canvas_button - handler for button-press/release-event
+ * docklet_canvas_motion - handler for motion-notify-event
+ * docklet_canvas_expose - handler for expose-event
+ */
+static bool
+docklet_canvas_button (GtkWidget *widget,
+                       GdkEventButton *event,
+                       DockletCanvas *canvas)
+{
+  Docklet *instance;
+  bool fire = true;	/* invoke (or not) instance->agent */
+
+  if (event->type == GDK_BUTTON_RELEASE) {
+    if ((instance = canvas->dragged) != NULL) {
+      canvas->dragged = NULL;
+
+      /* Report the new position as a window move would. */
+      if (instance->moved && instance->agent) {
+        GdkEvent *moved = gdk_event_new (GDK_CONFIGURE);
+
+        moved->configure.window = g_object_ref (widget->window);
+        moved->configure.x = instance->xpos;
+        moved->configure.y = instance->ypos;
+        moved->configure.width  = instance->width;
+        moved->configure.height = instance->height;
+
+        instance->datum->event = moved;
+        (*instance->agent) (instance->datum);
+        gdk_event_free (moved);
+      }
+      instance->moved = false;
+    }
+    return true;
+  }
+
+  instance = docklet_canvas_pick (canvas, event->x, event->y);
+  docklet_canvas_select (canvas, instance);
+
+  if (instance == NULL)
+    return true;
+
+  if (event->button == 1) {		/* left button: move and drag */
+    if (event->type == GDK_BUTTON_PRESS) {
+      canvas->docklets = g_list_remove (canvas->docklets, instance);
+      canvas->docklets = g_list_append (canvas->docklets, instance);
+      docklet_canvas_redraw (canvas, instance);	/* raised on top */
+
+      canvas->dragged = instance;
+      canvas->xdrag = event->x - instance->xpos;
+      canvas->ydrag = event->y - instance->ypos;
+      instance->moved = false;
+      fire = false;
+    }
+  }
+
+  if (fire && instance->agent &&
+      (event->type == GDK_BUTTON_PRESS || event->type == GDK_2BUTTON_PRESS)) {
+    instance->datum->event = (GdkEvent *)event;
+    (*instance->agent) (instance->datum);
+  }
+  return true;
+} /* </docklet_canvas_button> */
+
+static bool
+docklet_canvas_motion (GtkWidget *widget,
+                       GdkEventMotion *event,
+                       DockletCanvas *canvas)
+{
+  Docklet *instance = canvas->dragged;
+  GdkRectangle area;
+  GdkRegion *region;
+  gint x, y;
+
+  if (instance == NULL)
+    return false;
+
+  if (event->is_hint)
+    gdk_window_get_pointer (widget->window, &x, &y, NULL);
+  else {
+    x = event->x;
+    y = event->y;
+  }
+
+  /* Damage only where the docklet was and where it is now. */
+  docklet_canvas_bounds (instance, &area);
+  region = gdk_region_rectangle (&area);
+
+  instance->xpos = x - canvas->xdrag;
+  instance->ypos = y - canvas->ydrag;
+  instance->moved = true;
+
+  docklet_canvas_bounds (instance, &area);
+  gdk_region_union_with_rect (region, &area);
+  docklet_canvas_damage (canvas, region);
+  gdk_region_destroy (region);
+
+  docklet_canvas_reshape (canvas);
+  return true;
+} /* </docklet_canvas_motion> */
+
+static bool
+docklet_canvas_expose (GtkWidget *widget,
+                       GdkEventExpose *event,
+                       DockletCanvas *canvas)
+{
+  /* The server already cleared the exposed area to the background. */
+  docklet_canvas_paint (canvas, event->region);
+  return true;
+} /* </docklet_canvas_expose> */
+
+/*
+ * docklet_canvas_new - one desktop window shared by docklets
+ */
+DockletCanvas *
+docklet_canvas_new (void)
+{
+  DockletCanvas *canvas = g_new0 (DockletCanvas, 1);
+  GtkWidget *widget = sticky_window_new (GDK_WINDOW_TYPE_HINT_DESKTOP,
+                                         gdk_screen_width (),
+                                         gdk_screen_height (), 0, 0);
+
+  gtk_window_set_keep_below (GTK_WINDOW (widget), TRUE);
+  gtk_widget_set_app_paintable (widget, TRUE);
+  gtk_widget_set_double_buffered (widget, FALSE);
+  gtk_widget_add_events (widget, GDK_BUTTON_PRESS_MASK |
+                                 GDK_BUTTON_RELEASE_MASK |
+                                 GDK_BUTTON1_MOTION_MASK |
+                                 GDK_POINTER_MOTION_HINT_MASK);
+
+  g_signal_connect (G_OBJECT (widget), "button-press-event",
+                    G_CALLBACK (docklet_canvas_button), canvas);
+
+  g_signal_connect (G_OBJECT (widget), "button-release-event",
+                    G_CALLBACK (docklet_canvas_button), canvas);
+
+  g_signal_connect (G_OBJECT (widget), "motion-notify-event",
+                    G_CALLBACK (docklet_canvas_motion), canvas);
+
+  g_signal_connect (G_OBJECT (widget), "expose-event",
+                    G_CALLBACK (docklet_canvas_expose), canvas);
+
+  /* See through to the root window background. */
+  gtk_widget_realize (widget);
+  gdk_window_set_back_pixmap (widget->window, NULL, TRUE);
+
+  canvas->window = widget;
+  docklet_canvas_reshape (canvas);
+
+  return canvas;
+} /* </docklet_canvas_new> */
+
+/*
+ * docklet_canvas_refresh - redraw everything, ex. after a background change
+ */
+void
+docklet_canvas_refresh (DockletCanvas *canvas)
+{
+  GdkWindow *window = canvas->window->window;
+
+  if (window != NULL)
+    gdk_window_clear_area_e (window, 0, 0, gdk_screen_width (),
+                                           gdk_screen_height ());
+} /* </docklet_canvas_refresh> */
+
+/*
+ * docklet_canvas_add - constructor for a docklet drawn on canvas
+ */
+Docklet *
+docklet_canvas_add (DockletCanvas *canvas,
+                    gint width, gint height,
+                    gint xpos,  gint ypos,
+                    GtkOrientation place,
+                    const gchar *icon,
+                    const gchar *text,
+                    const gchar *font,
+                    GdkColor *bg,
+                    GdkColor *fg,
+                    bool shadow)
+{
+  Docklet *instance = gtk_type_new (DOCKLET_TYPE);
+
+  /* Save position, dimensions and other key data. */
+  instance->canvas = canvas;
+  instance->window = canvas->window;
+  instance->height = height;
+  instance->width  = width;
+  instance->place  = place;
+  instance->visa   = GTK_VISIBILITY_NONE;
+  instance->xpos   = xpos;
+  instance->ypos   = ypos;
+  instance->icon   = icon;
+  instance->text   = text;
+  instance->font   = font;
+  instance->bg     = bg;
+  instance->fg     = fg;
+  instance->shadow = shadow;
+
+  /* No window of its own: render once, painted by the canvas. */
+  instance->render = docklet_compose (instance);
+  instance->width  = gdk_pixbuf_get_width (instance->render);
+  instance->height = gdk_pixbuf_get_height (instance->render);
+
+  canvas->docklets = g_list_append (canvas->docklets, instance);
+  docklet_canvas_reshape (canvas);
+
+  return instance;
+} /* </docklet_canvas_add> */
+
+/*
+ * docklet_show - make visible, either the docklet window or canvas area
+ */
+void
+docklet_show (Docklet *instance)
+{
+  gtk_widget_show (instance->window);	/* canvas window, when shared */
+
+  if (instance->canvas != NULL)
+    docklet_canvas_redraw (instance->canvas, instance);
+} /* </docklet_show> */
+
+/*
+ * docklet_destroy - remove from screen display and release
+ */
+void
+docklet_destroy (Docklet *instance)
+{
+  DockletCanvas *canvas = instance->canvas;
+
+  if (canvas != NULL) {
+    GdkRectangle area;
+    GdkRegion *region;
+
+    canvas->docklets = g_list_remove (canvas->docklets, instance);
+
+    if (canvas->selected == instance)
+      canvas->selected = NULL;
+
+    if (canvas->dragged == instance)
+      canvas->dragged = NULL;
+
+    docklet_canvas_bounds (instance, &area);
+    region = gdk_region_rectangle (&area);
+    docklet_canvas_damage (canvas, region);
+    gdk_region_destroy (region);
+
+    docklet_canvas_reshape (canvas);
+  }
+  else {
+    gtk_widget_destroy (instance->window);
+  }
+
+  g_object_unref (instance->render);
+  instance->render = NULL;
+
+  g_object_ref_sink (instance);
+  g_object_unref (instance);
+} /* </docklet_destroy> */
+
+/*
+ * docklet_canvas_destroy - destroy the canvas window and docklets left on it
+ */
+void
+docklet_canvas_destroy (DockletCanvas *canvas)
+{
+  GList *iter;
+
+  /* The window goes away with them, no need to damage it for each one. */
+  for (iter = canvas->docklets; iter != NULL; iter = iter->next) {
+    Docklet *instance = iter->data;
+
+    g_object_unref (instance->render);
+    instance->render = NULL;
+
+    g_object_ref_sink (instance);
+    g_object_unref (instance);
+  }
+  g_list_free (canvas->docklets);
+
+  gtk_widget_destroy (canvas->window);
+  g_free (canvas);
+} /* </docklet_canvas_destroy> */
+
 /*
  * docklet_update
  */
@@ -395,8 +842,16 @@ docklet_update (Docklet *instance, const gchar *icon, const gchar *text)
   GdkBitmap *mask;
   GdkPixmap *pixmap;
   GdkPixbuf *pixbuf = NULL;
+  GdkRegion *region = NULL;
+  GdkRectangle area;
   gint width, height;
 
+  /* Remember where the docklet was drawn on a shared canvas. */
+  if (instance->canvas != NULL) {
+    docklet_canvas_bounds (instance, &area);
+    region = gdk_region_rectangle (&area);
+  }
+
   instance->icon = icon;	/* potentially a different icon */
   instance->text = text;	/* potentially different text */
 
@@ -425,6 +880,22 @@ docklet_update (Docklet *instance, const gchar *icon, const gchar *text)
   width  = gdk_pixbuf_get_width (pixbuf);
   height = gdk_pixbuf_get_height (pixbuf);
 
+  if (instance->canvas != NULL) {
+    instance->width  = width;
+    instance->height = height;
+
+    g_object_unref (instance->render);
+    instance->render = pixbuf;
+
+    docklet_canvas_bounds (instance, &area);
+    gdk_region_union_with_rect (region, &area);
+    docklet_canvas_damage (instance->canvas, region);
+    gdk_region_destroy (region);
+
+    docklet_canvas_reshape (instance->canvas);
+    return;
+  }
+
   if (width != instance->width || height != instance->height) {
     instance->width  = width;
     instance->height = height;
@@ -433,7 +904,7 @@ docklet_update (Docklet *instance, const gchar *icon, const gchar *text)
 
   /* Shape drawable for a transparent look. */
   if (instance->visa == GTK_VISIBILITY_NONE) {
-    gdk_pixbuf_render_pixmap_and_mask (pixbuf, &pixmap, &mask, 255);
+    gdk_pixbuf_render_pixmap_and_mask (pixbuf, &pixmap, &mask, 1);
     if(mask == NULL) mask = create_mask_from_pixmap (pixmap, width, height);
     gtk_widget_shape_combine_mask (instance->window, mask, 0, 0);
   }
@@ -466,5 +937,8 @@ docklet_set_callback (Docklet *instance, GtkFunction callback, gpointer data)
 void
 docklet_set_cursor (Docklet *instance, GdkCursorType cursor)
 {
+  if (instance->layout == NULL)		/* drawn on a shared canvas */
+    return;
+
   gdk_window_set_cursor (instance->layout->window, gdk_cursor_new (cursor));
 } /* </docklet_set_cursor> */
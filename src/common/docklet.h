@@ -33,6 +33,7 @@ G_BEGIN_DECLS
            (G_TYPE_CHECK_INSTANCE_CAST (obj, DOCKLET_TYPE, Docklet))
 
 typedef struct _Docklet       Docklet;
+typedef struct _DockletCanvas DockletCanvas;
 typedef struct _DockletClass  DockletClass;
 typedef struct _DockletDatum  DockletDatum;
 
@@ -43,6 +44,8 @@ struct _Docklet
   GtkFunction agent;    /* user defined callback */
   DockletDatum *datum;	/* information passed to the user defined callback */
 
+  DockletCanvas *canvas; /* shared canvas, NULL => window of its own */
+
   GtkWidget *window;	/* application window instance */
   GtkWidget *layout;	/* application window internal layout */
   GtkWidget *inside;	/* application window internals */
@@ -70,6 +73,17 @@ struct _Docklet
   bool shadow;
 };
 
+struct _DockletCanvas
+{
+  GtkWidget *window;	/* one desktop window for all docklets */
+  GList *docklets;	/* stacking order, bottom first */
+
+  Docklet *selected;	/* highlighted docklet, if any */
+  Docklet *dragged;	/* docklet being moved, if any */
+
+  gint xdrag, ydrag;	/* pointer offset inside the dragged docklet */
+};
+
 struct _DockletClass
 {
   GtkObjectClass parent; /* DockletClass inherits from GtkObjectClass */
@@ -97,6 +111,26 @@ Docklet *docklet_new (GdkWindowTypeHint hint,
                       GdkColor *fg,
                       bool shadow);
 
+DockletCanvas *docklet_canvas_new (void);
+void docklet_canvas_refresh (DockletCanvas *canvas);
+void docklet_canvas_destroy (DockletCanvas *canvas);
+
+Docklet *docklet_canvas_add (DockletCanvas *canvas,
+                             gint width, gint height,
+                             gint xpos, gint ypos,
+                             GtkOrientation place,
+                             const gchar *icon,
+                             const gchar *text,
+                             const gchar *font,
+                             GdkColor *bg,
+                             GdkColor *fg,
+                             bool shadow);
+
+GdkPixbuf *docklet_render (Docklet *instance, GdkPixbuf *pixbuf);
+
+void docklet_show (Docklet *instance);
+void docklet_destroy (Docklet *instance);
+
 void docklet_update (Docklet *instance, const gchar *icon, const gchar *text);
 void docklet_set_cursor (Docklet *instance, GdkCursorType cursor);
 
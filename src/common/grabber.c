@@ -23,6 +23,133 @@
 #include "gould.h"
 #include "grabber.h"
 
+#define GRAB_BAND_ROWS    64	/* minimum rows handed to a worker */
+#define GRAB_MAX_WORKERS  8	/* upper bound on conversion threads */
+
+/*
+ * (private) ximage_to_pixbuf conversion state shared by the workers
+ */
+typedef struct _ConvertBand ConvertBand;
+
+struct _ConvertBand
+{
+  XImage *ximage;		/* source image (read only) */
+  guchar *pixels;		/* destination GdkPixbuf pixels */
+  gint    rowstride;		/* destination rowstride */
+
+  gint    rshift, gshift, bshift;	/* channel position in the pixel */
+  gulong  rmask,  gmask,  bmask;	/* channel masks from the visual */
+  gint    rbits,  gbits,  bbits;	/* width in bits of each channel */
+  bool    direct;		/* all channels are 8 bits wide */
+
+  gint    first, last;		/* row band [first, last) */
+};
+
+/*
+ * (private) count the trailing zero and set bits of a channel mask
+ */
+static void
+mask_layout(gulong mask, gint *shift, gint *bits)
+{
+  *shift = *bits = 0;
+
+  if (mask != 0) {
+    while ((mask & 1) == 0) {
+      mask >>= 1;
+      (*shift)++;
+    }
+    while (mask & 1) {
+      mask >>= 1;
+      (*bits)++;
+    }
+  }
+} /* </mask_layout> */
+
+/*
+ * (private) scale a channel of nbits to the 0..255 range
+ */
+static inline guchar
+channel_scale(gulong value, gint nbits)
+{
+  if (nbits >= 8)
+    return (guchar)(value >> (nbits - 8));
+
+  return (guchar)((value * 255) / ((1 << nbits) - 1));
+} /* </channel_scale> */
+
+/*
+ * (private) convert the rows of one band, runs on a worker thread
+ */
+static gpointer
+convert_band(ConvertBand *band)
+{
+  XImage *ximage = band->ximage;
+  gint bytes = ximage->bits_per_pixel / 8;
+  bool msb = (ximage->byte_order == MSBFirst);
+  gint x, y;
+
+  for (y = band->first; y < band->last; y++) {
+    const guchar *src = (guchar *)ximage->data + y * ximage->bytes_per_line;
+    guchar *dst = band->pixels + y * band->rowstride;
+    gulong pixel;
+
+    if (bytes == 4 && band->direct) {		/* 32 bpp TrueColor */
+      for (x = 0; x < ximage->width; x++, src += 4, dst += 3) {
+        pixel = (msb) ? ((gulong)src[0] << 24) | (src[1] << 16) |
+                        (src[2] << 8) | src[3]
+                      : ((gulong)src[3] << 24) | (src[2] << 16) |
+                        (src[1] << 8) | src[0];
+
+        dst[0] = (pixel >> band->rshift) & 0xff;
+        dst[1] = (pixel >> band->gshift) & 0xff;
+        dst[2] = (pixel >> band->bshift) & 0xff;
+      }
+    }
+    else if (bytes == 3 && band->direct) {	/* packed 24 bpp TrueColor */
+      for (x = 0; x < ximage->width; x++, src += 3, dst += 3) {
+        pixel = (msb) ? (src[0] << 16) | (src[1] << 8) | src[2]
+                      : (src[2] << 16) | (src[1] << 8) | src[0];
+
+        dst[0] = (pixel >> band->rshift) & 0xff;
+        dst[1] = (pixel >> band->gshift) & 0xff;
+        dst[2] = (pixel >> band->bshift) & 0xff;
+      }
+    }
+    else {					/* any other TrueColor layout */
+      for (x = 0; x < ximage->width; x++, dst += 3) {
+        pixel = XGetPixel(ximage, x, y);
+
+        dst[0] = channel_scale((pixel & band->rmask) >> band->rshift,
+                               band->rbits);
+        dst[1] = channel_scale((pixel & band->gmask) >> band->gshift,
+                               band->gbits);
+        dst[2] = channel_scale((pixel & band->bmask) >> band->bshift,
+                               band->bbits);
+      }
+    }
+  }
+  return NULL;
+} /* </convert_band> */
+
+/*
+ * (private) number of worker threads to use for an image of height rows
+ */
+static gint
+convert_workers(gint height)
+{
+  long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+  gint count = height / GRAB_BAND_ROWS;
+
+  if (!g_thread_supported ())
+    return 1;
+
+  if (ncpu < 1) ncpu = 1;
+  if (count > ncpu) count = ncpu;
+  if (count > GRAB_MAX_WORKERS) count = GRAB_MAX_WORKERS;
+
+  return (count < 1) ? 1 : count;
+} /* </convert_workers> */
+
 /*
  * (private) Create a Pixmap from an XImage
  */
@@ -194,6 +321,88 @@ grab_rectangle(Display *display, Window root, XRectangle *xrect)
   return 0;
 } /* </grab_rectagle> */
 
+/*
+ * ximage_to_pixbuf converts a ZPixmap TrueColor XImage into a GdkPixbuf,
+ * splitting the rows into bands converted in parallel.  Returns NULL when
+ * the image layout is not supported, the caller should then fall back on
+ * gdk_pixbuf_get_from_drawable().  DirectColor is not supported, as its
+ * channels index a colormap rather than hold intensities.
+ */
+GdkPixbuf *
+ximage_to_pixbuf(XImage *ximage, Visual *visual)
+{
+  GThread *worker[GRAB_MAX_WORKERS];
+  ConvertBand band[GRAB_MAX_WORKERS];
+  ConvertBand layout;
+  GdkPixbuf *pixbuf;
+  gint count, rows, idx;
+
+  if (ximage == NULL || ximage->format != ZPixmap)
+    return NULL;
+
+  if (visual != NULL && visual->class != TrueColor)
+    return NULL;
+
+  if (ximage->bits_per_pixel != 16 && ximage->bits_per_pixel != 24 &&
+      ximage->bits_per_pixel != 32)
+    return NULL;
+
+  memset(&layout, 0, sizeof(ConvertBand));
+
+  layout.rmask = (visual) ? visual->red_mask   : ximage->red_mask;
+  layout.gmask = (visual) ? visual->green_mask : ximage->green_mask;
+  layout.bmask = (visual) ? visual->blue_mask  : ximage->blue_mask;
+
+  if (layout.rmask == 0 || layout.gmask == 0 || layout.bmask == 0)
+    return NULL;
+
+  mask_layout(layout.rmask, &layout.rshift, &layout.rbits);
+  mask_layout(layout.gmask, &layout.gshift, &layout.gbits);
+  mask_layout(layout.bmask, &layout.bshift, &layout.bbits);
+
+  layout.direct = (layout.rbits == 8 && layout.gbits == 8 &&
+                   layout.bbits == 8);
+
+  pixbuf = gdk_pixbuf_new (GDK_COLORSPACE_RGB, FALSE, 8,
+                           ximage->width, ximage->height);
+  if (pixbuf == NULL)
+    return NULL;
+
+  layout.ximage    = ximage;
+  layout.pixels    = gdk_pixbuf_get_pixels (pixbuf);
+  layout.rowstride = gdk_pixbuf_get_rowstride (pixbuf);
+
+  count = convert_workers(ximage->height);
+  rows  = (ximage->height + count - 1) / count;
+
+  for (idx = 0; idx < count; idx++) {
+    band[idx] = layout;
+    band[idx].first = idx * rows;
+    band[idx].last  = MIN(band[idx].first + rows, ximage->height);
+    worker[idx] = NULL;
+
+    if (idx > 0) {		/* band zero runs on the calling thread */
+#if GLIB_CHECK_VERSION(2,32,0)
+      worker[idx] = g_thread_try_new ("grabber",
+                                      (GThreadFunc)convert_band,
+                                      &band[idx], NULL);
+#else
+      worker[idx] = g_thread_create ((GThreadFunc)convert_band,
+                                     &band[idx], TRUE, NULL);
+#endif
+      if (worker[idx] == NULL)	/* could not spawn, do it ourselves */
+        convert_band(&band[idx]);
+    }
+  }
+  convert_band(&band[0]);
+
+  for (idx = 1; idx < count; idx++)
+    if (worker[idx] != NULL)
+      g_thread_join (worker[idx]);
+
+  return pixbuf;
+} /* </ximage_to_pixbuf> */
+
 /*
  * window/screen screenshot returns pixbuf
  */
@@ -201,6 +410,9 @@ GdkPixbuf *
 grab_pixbuf(Window xid, XRectangle *xrect)
 {
   GdkWindow *window;
+  GdkPixbuf *pixbuf;
+  XImage *ximage;
+  Visual *visual;
   gint x = 0, y = 0;
   gint width, height;
 	
@@ -222,6 +434,9 @@ grab_pixbuf(Window xid, XRectangle *xrect)
     gint xpos, ypos;
     window = gdk_window_foreign_new (xid);
 
+    if (window == NULL)		/* destroyed meanwhile */
+      return NULL;
+
     gdk_drawable_get_size (window, &width, &height);
     gdk_window_get_origin (window, &xpos, &ypos);
 
@@ -242,8 +457,40 @@ grab_pixbuf(Window xid, XRectangle *xrect)
     if (ypos + height > gdk_screen_height ())
       height = gdk_screen_height () - ypos;
   }
-  return gdk_pixbuf_get_from_drawable (NULL, window, NULL,
-                                       x, y, 0, 0, width, height);
+  /* convert client side when the visual layout is supported */
+  if (width > 0 && height > 0) {
+    Display *display = GDK_WINDOW_XDISPLAY (window);
+    XWindowAttributes xwa;
+    int error;
+
+    /* a foreign window may be unmapped or destroyed at any moment */
+    ximage = NULL;
+    gdk_error_trap_push ();
+
+    if (XGetWindowAttributes(display, GDK_WINDOW_XID (window), &xwa)) {
+      visual = xwa.visual;
+      ximage = XGetImage(display, GDK_WINDOW_XID (window), x, y,
+                         width, height, AllPlanes, ZPixmap);
+    }
+    error = gdk_error_trap_pop ();
+
+    if (ximage != NULL) {
+      pixbuf = (error) ? NULL : ximage_to_pixbuf(ximage, visual);
+      XDestroyImage(ximage);
+
+      if (pixbuf != NULL)
+        return pixbuf;
+    }
+  }
+
+  gdk_error_trap_push ();
+  pixbuf = gdk_pixbuf_get_from_drawable (NULL, window, NULL,
+                                         x, y, 0, 0, width, height);
+  if (gdk_error_trap_pop () && pixbuf != NULL) {
+    g_object_unref (pixbuf);
+    pixbuf = NULL;
+  }
+  return pixbuf;
 } /* </grab_pixbuf> */
 
 /*
@@ -294,7 +541,9 @@ capture(gint mode, bool decorations)
 
     case GRAB_WINDOW:
       xwin = grab_window(display, root);
-      
+
+      gdk_error_trap_push ();	/* xwin may go away under us */
+
       if (XGetWindowAttributes(display, xwin, &xwa)) {
         int absx, absy;
         Window ign;
@@ -322,6 +571,8 @@ capture(gint mode, bool decorations)
           rect.y = absy;
         }
       }
+      gdk_error_trap_pop ();
+
       pixbuf = grab_pixbuf(xwin, &rect);
       break;
 
@@ -43,6 +43,7 @@ Window  grab_window(Display *display, Window root);
 int     grab_rectangle(Display *display, Window root, XRectangle *xrect);
 
 GdkPixbuf *grab_pixbuf(Window xid, XRectangle *xrect);
+GdkPixbuf *ximage_to_pixbuf(XImage *ximage, Visual *visual);
 GdkPixbuf *capture(gint mode, bool decorations);
 
 void grab_pointer_sleep (unsigned int seconds);
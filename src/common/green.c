@@ -265,7 +265,17 @@ static void
 green_update_background_pixmap (Green *green)
 {
   if (green->priv->update[XROOTPMAP_ID]) {
+    Pixmap pixmap = get_window_pixmap (green->priv->xroot); /* id only */
+
     green->priv->update[XROOTPMAP_ID] = FALSE;
+
+    if (pixmap != green->priv->backdrop) {
+      green->priv->backdrop = pixmap;
+
+      g_signal_emit (G_OBJECT (green),
+                     signals_[BACKGROUND_CHANGED],
+                     0);
+    }
   }
 } /* </green_update_background_pixmap> */
 
@@ -812,14 +822,7 @@ green_get_root_window (Green *green)
 Pixmap
 green_get_background_pixmap (Green *green)
 {
-  GreenPrivate *priv = green->priv;
-
-#if 0 /* should not set workspace background to root window pixmap */
-  if (priv->backdrop == None)
-    priv->backdrop = get_window_pixmap (priv->xroot);
-#endif
-
-  return priv->backdrop;
+  return green->priv->backdrop;	/* see green_update_background_pixmap */
 } /* </green_get_background_pixmap> */
 
 /*
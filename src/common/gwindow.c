@@ -19,9 +19,12 @@
 
 #include "util.h"
 #include "gould.h"
+#include "bgcache.h"
 #include "grabber.h"
 #include "gwindow.h"
+#include "iconpack.h"
 #include "xpmglyphs.h"
+#include "xutil.h"
 
 #include <X11/Xatom.h>
 #include <X11/Xutil.h>
@@ -173,6 +176,10 @@ pixbuf_new_from_file_scaled (const gchar *file, gint width, gint height)
   GdkPixbuf *render = NULL;
   GdkPixbuf *pixbuf;
 
+  /* Installed icons at the usual sizes are pre-rendered, no decoding. */
+  if ((pixbuf = iconpack_file_scaled (file, width, height)) != NULL)
+    return pixbuf;
+
   if (file != NULL && g_file_test(file, G_FILE_TEST_EXISTS)) {
     GError *error  = NULL;
     render = gdk_pixbuf_new_from_file(file, &error);
@@ -203,6 +210,48 @@ pixbuf_new_from_path_scaled (GList *paths, const gchar *icon,
   return pixbuf_new_from_file_scaled (file, width, height);
 } /* </pixbuf_new_from_path_scaled> */
 
+/*
+* pixbuf_new_from_surface - GdkPixbuf copy of a cairo ARGB32 image surface
+*/
+GdkPixbuf *
+pixbuf_new_from_surface (cairo_surface_t *surface)
+{
+  gint width  = cairo_image_surface_get_width (surface);
+  gint height = cairo_image_surface_get_height (surface);
+  gint stride = cairo_image_surface_get_stride (surface);
+  GdkPixbuf *pixbuf = gdk_pixbuf_new (GDK_COLORSPACE_RGB, TRUE, 8,
+                                      width, height);
+  gint rowstride = gdk_pixbuf_get_rowstride (pixbuf);
+  guchar *pixels = gdk_pixbuf_get_pixels (pixbuf);
+  guchar *data;
+  gint x, y;
+
+  cairo_surface_flush (surface);
+  data = cairo_image_surface_get_data (surface);
+
+  for (y = 0; y < height; y++) {
+    guint32 *src = (guint32 *)(data + y * stride);
+    guchar  *dst = pixels + y * rowstride;
+
+    for (x = 0; x < width; x++, dst += 4) {
+      guint32 argb  = src[x];
+      guint   alpha = argb >> 24;
+
+      /* cairo pixels are premultiplied, GdkPixbuf pixels are not */
+      if (alpha == 0) {
+        dst[0] = dst[1] = dst[2] = 0;
+      }
+      else {
+        dst[0] = (((argb >> 16) & 0xff) * 255 + alpha / 2) / alpha;
+        dst[1] = (((argb >>  8) & 0xff) * 255 + alpha / 2) / alpha;
+        dst[2] = (( argb        & 0xff) * 255 + alpha / 2) / alpha;
+      }
+      dst[3] = alpha;
+    }
+  }
+  return pixbuf;
+} /* </pixbuf_new_from_surface> */
+
 /*
 * pixbuf_scale - scale a GdkPixbuf to given width and height
 */
@@ -268,6 +317,104 @@ redraw_pixbuf (GtkWidget *canvas, GdkPixbuf *image)
   return vote;
 } /* </redraw_pixbuf> */
 
+/*
+* (private) root_thumbnail_data - ROOTPMAP_THUMB property data for image
+*/
+static gulong *
+root_thumbnail_data (GdkPixbuf *image, Pixmap xpixmap, int *count)
+{
+  gint width  = gdk_pixbuf_get_width (image);
+  gint height = gdk_pixbuf_get_height (image);
+  gint cols = MIN(width, ROOTPMAP_THUMB_WIDTH);
+  gint rows = CLAMP(height * cols / width, 1, ROOTPMAP_THUMB_WIDTH - 1);
+  GdkPixbuf *thumb = gdk_pixbuf_scale_simple (image, cols, rows,
+                                              GDK_INTERP_BILINEAR);
+  gint channels  = gdk_pixbuf_get_n_channels (thumb);
+  gint rowstride = gdk_pixbuf_get_rowstride (thumb);
+  guchar *pixels = gdk_pixbuf_get_pixels (thumb);
+  gulong *data = g_new (gulong, 3 + cols * rows);
+  gulong *scan = data + 3;
+  gint x, y;
+
+  data[0] = xpixmap;
+  data[1] = cols;
+  data[2] = rows;
+
+  for (y = 0; y < rows; y++) {
+    guchar *pix = pixels + y * rowstride;
+
+    for (x = 0; x < cols; x++, pix += channels)
+      *scan++ = ((channels == 4) ? (gulong)pix[3] << 24 : 0xff000000UL) |
+                (pix[0] << 16) | (pix[1] << 8) | pix[2];
+  }
+  g_object_unref (thumb);
+
+  *count = 3 + cols * rows;
+  return data;
+} /* </root_thumbnail_data> */
+
+/*
+* (private) set_root_pixmap - publish pixmap as _XROOTPMAP_ID, ESETROOT_PMAP_ID
+*
+* The copy is made on a separate connection left in RetainPermanent mode
+* so the pixmap outlives this process, as pagers and terminals expect.
+* A small copy of image goes along in ROOTPMAP_THUMB, keyed by the pixmap
+* id, so pagers need not read the whole pixmap back.
+*/
+static void
+set_root_pixmap (GdkWindow *window, GdkPixmap *pixmap, GdkPixbuf *image,
+                 gint width, gint height)
+{
+  Display *display = XOpenDisplay (DisplayString (GDK_WINDOW_XDISPLAY (window)));
+  Window root = GDK_WINDOW_XID (window);
+  Atom xrootpmap, esetroot, thumbnail, type;
+  unsigned long length, after;
+  unsigned char *data;
+  gulong *thumb;
+  Pixmap xpixmap;
+  int format, count;
+  GC gc;
+
+  if (display == NULL)
+    return;
+
+  xrootpmap = XInternAtom (display, "_XROOTPMAP_ID", False);
+  esetroot  = XInternAtom (display, "ESETROOT_PMAP_ID", False);
+  thumbnail = XInternAtom (display, ROOTPMAP_THUMB, False);
+
+  /* Release the pixmap retained by a previous setter, if any. */
+  if (XGetWindowProperty (display, root, esetroot, 0L, 1L, False, XA_PIXMAP,
+                          &type, &format, &length, &after, &data) == Success) {
+    if (type == XA_PIXMAP && format == 32 && length == 1)
+      XKillClient (display, *((Pixmap *)data));
+
+    if (data) XFree (data);
+  }
+
+  gdk_flush ();			/* pixmap must exist server side */
+
+  xpixmap = XCreatePixmap (display, root, width, height,
+                           gdk_drawable_get_depth (pixmap));
+  gc = XCreateGC (display, xpixmap, 0, NULL);
+  XCopyArea (display, GDK_PIXMAP_XID (pixmap), xpixmap, gc,
+             0, 0, width, height, 0, 0);
+  XFreeGC (display, gc);
+
+  /* thumbnail first, pagers react to the _XROOTPMAP_ID change */
+  thumb = root_thumbnail_data (image, xpixmap, &count);
+  XChangeProperty (display, root, thumbnail, XA_CARDINAL, 32, PropModeReplace,
+                   (unsigned char *)thumb, count);
+  g_free (thumb);
+
+  XChangeProperty (display, root, xrootpmap, XA_PIXMAP, 32, PropModeReplace,
+                   (unsigned char *)&xpixmap, 1);
+  XChangeProperty (display, root, esetroot, XA_PIXMAP, 32, PropModeReplace,
+                   (unsigned char *)&xpixmap, 1);
+
+  XSetCloseDownMode (display, RetainPermanent);
+  XCloseDisplay (display);
+} /* </set_root_pixmap> */
+
 /*
 * set_background_pixbuf - set background pixmap of window using pixbuf
 */
@@ -291,14 +438,21 @@ set_background_pixbuf (GdkWindow *window, GdkPixbuf *pixbuf)
   if (width != xres || height != yres)
     image = pixbuf_scale (pixbuf, xres, yres);
   else
-    image = pixbuf;
+    image = g_object_ref (pixbuf);
 
   /* Create pixmap at window size and render image */
-  pixmap = gdk_pixmap_new (window, xres, yres, gdk_visual_get_best_depth());
-  gdk_pixbuf_render_pixmap_and_mask (image, &pixmap, NULL, 255);
+  pixmap = gdk_pixmap_new (window, xres, yres, -1);
+  gdk_draw_pixbuf (pixmap, NULL, image, 0, 0, 0, 0, xres, yres,
+                   GDK_RGB_DITHER_NONE, 0, 0);
 
   /* Set background pixmap on window */
   gdk_window_set_back_pixmap (window, pixmap, FALSE);
+
+  if (window == gdk_get_default_root_window ())
+    set_root_pixmap (window, pixmap, image, xres, yres);
+
+  g_object_unref (image);
+
   g_object_unref (pixmap);
 
   gdk_window_clear (window);   /* clear window to effect change */
@@ -325,6 +479,8 @@ set_background (GdkWindow *window, const gchar *pathname)
     gdk_window_clear (window);  /* clear window to effect change */
   }
   else {
+    GdkPixbuf *pixbuf;
+    gint xres, yres;
     gchar *command = g_strdup_printf (
     "gconftool -t string -s /desktop/gnome/background/picture_filename \"%s\"",
                                                                pathname);
@@ -332,11 +488,21 @@ set_background (GdkWindow *window, const gchar *pathname)
     system_command (command);
     g_free (command);
 
-    /* unique to Generations Linux xorg-x11-core >= 3.0 */
-    command = g_strdup_printf ("xsetbg %s", pathname);
-    //DEBUG g_spawn_command_line_async(command, &error);
-    system_command (command);
-    g_free (command);
+    /* pre-scaled pixels from the cache, see bgcache.c */
+    gdk_window_get_size (window, &xres, &yres);
+    pixbuf = bgcache_pixbuf (pathname, xres, yres, BACKGROUND_SCALED);
+
+    if (pixbuf) {
+      set_background_pixbuf (window, pixbuf);
+      g_object_unref (pixbuf);
+    }
+    else {
+      /* unique to Generations Linux xorg-x11-core >= 3.0 */
+      command = g_strdup_printf ("xsetbg %s", pathname);
+      //DEBUG g_spawn_command_line_async(command, &error);
+      system_command (command);
+      g_free (command);
+    }
   }
 
   return error;
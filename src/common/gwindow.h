@@ -53,6 +53,7 @@ GdkPixbuf *pixbuf_new_from_file_scaled (const gchar *file,
 GdkPixbuf *pixbuf_new_from_path_scaled (GList *paths, const gchar *file,
                                         guint width, guint height);
 
+GdkPixbuf *pixbuf_new_from_surface (cairo_surface_t *surface);
 GdkPixbuf *pixbuf_scale (GdkPixbuf *pixbuf, gint width, gint height);
 
 bool redraw_pixbuf (GtkWidget *canvas, GdkPixbuf *pixbuf);
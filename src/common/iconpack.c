@@ -0,0 +1,217 @@
+/**
+ * Copyright (C) Generations Linux <bugs@softcraft.org>
+ * All Rights Reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "iconpack.h"
+
+/*
+* Private data structures.
+*
+* The bundle is mapped once and kept for the life of the process, each
+* GdkPixbuf handed out wraps its pixels without a copy. The mapping is
+* private and writable so a caller drawing into a pixbuf gets its own
+* copy-on-write page instead of a fault.
+*/
+static struct {
+  guchar *data;			/* mapped bundle */
+  gsize   length;
+  bool    tried;		/* default locations looked up once */
+} iconpack_ = { NULL, 0, false };
+
+static const char *IconPackPath[] = {
+  "/usr/local/share/gould/" ICONPACK_FILE,
+  "/usr/share/gould/" ICONPACK_FILE,
+  NULL
+};
+
+/*
+* iconpack_compare - order entries by (name, size), see bsearch(3)
+*/
+gint
+iconpack_compare (gconstpointer a, gconstpointer b)
+{
+  const IconPackEntry *one = a;
+  const IconPackEntry *two = b;
+  int diff = strncmp(one->name, two->name, ICONPACK_NAMELEN);
+
+  if (diff == 0)
+    diff = (one->size < two->size) ? -1 : (one->size > two->size);
+
+  return diff;
+} /* </iconpack_compare> */
+
+/*
+* iconpack_open - map the icon bundle, NULL pathname => default locations
+*/
+bool
+iconpack_open (const char *pathname)
+{
+  IconPackHeader *header;
+  struct stat info;
+  void *data;
+  int fd;
+
+  if (iconpack_.data != NULL)
+    return true;
+
+  if (pathname == NULL) {
+    if (iconpack_.tried)
+      return false;
+
+    iconpack_.tried = true;
+
+    for (int idx = 0; IconPackPath[idx] != NULL; idx++)
+      if (access(IconPackPath[idx], R_OK) == 0) {
+        pathname = IconPackPath[idx];
+        break;
+      }
+
+    if (pathname == NULL)
+      return false;
+  }
+
+  if ((fd = open(pathname, O_RDONLY | O_CLOEXEC)) < 0)
+    return false;
+
+  if (fstat(fd, &info) != 0 || info.st_size < sizeof(IconPackHeader)) {
+    close(fd);
+    return false;
+  }
+
+  data = mmap(NULL, info.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+  close(fd);
+
+  if (data == MAP_FAILED)
+    return false;
+
+  header = (IconPackHeader *)data;
+
+  if (memcmp(header->magic, ICONPACK_MAGIC, 4) != 0 ||
+      header->version != ICONPACK_VERSION ||
+      info.st_size < sizeof(IconPackHeader) +
+                     (off_t)header->count * sizeof(IconPackEntry)) {
+    g_printerr("%s: invalid icon bundle\n", pathname);
+    munmap(data, info.st_size);
+    return false;
+  }
+
+  iconpack_.data   = data;
+  iconpack_.length = info.st_size;
+
+  return true;
+} /* </iconpack_open> */
+
+/*
+* (private) iconpack_entry - index entry for (name, size), NULL if absent
+*/
+static const IconPackEntry *
+iconpack_entry (const char *name, gint size)
+{
+  const IconPackHeader *header;
+  const IconPackEntry *entry;
+  IconPackEntry key;
+
+  if (name == NULL || strlen(name) >= ICONPACK_NAMELEN || size < 0)
+    return NULL;
+
+  if (!iconpack_open (NULL))
+    return NULL;
+
+  memset(&key, 0, sizeof(key));
+  strcpy(key.name, name);
+  key.size = size;
+
+  header = (const IconPackHeader *)iconpack_.data;
+  entry  = bsearch(&key, header + 1, header->count, sizeof(IconPackEntry),
+                   iconpack_compare);
+
+  if (entry != NULL &&
+      (gsize)entry->offset + (gsize)entry->rowstride * entry->height >
+      iconpack_.length)
+    return NULL;
+
+  return entry;
+} /* </iconpack_entry> */
+
+/*
+* (private) iconpack_wrap - GdkPixbuf over the mapped pixels, no copy
+*/
+static GdkPixbuf *
+iconpack_wrap (const IconPackEntry *entry)
+{
+  return gdk_pixbuf_new_from_data (iconpack_.data + entry->offset,
+                                   GDK_COLORSPACE_RGB, TRUE, 8,
+                                   entry->width, entry->height,
+                                   entry->rowstride, NULL, NULL);
+} /* </iconpack_wrap> */
+
+/*
+* iconpack_pixbuf - GdkPixbuf over the bundled pixels of name at size
+*/
+GdkPixbuf *
+iconpack_pixbuf (const char *name, gint size)
+{
+  const IconPackEntry *entry = iconpack_entry (name, size);
+  return (entry) ? iconpack_wrap (entry) : NULL;
+} /* </iconpack_pixbuf> */
+
+/*
+* iconpack_file_scaled - bundled pixbuf for an installed icon file
+*
+* Only square sizes the bundle was built with are served, and only for
+* files in the folder it mirrors, still the size they were at build time.
+*/
+GdkPixbuf *
+iconpack_file_scaled (const char *file, gint width, gint height)
+{
+  const IconPackHeader *header;
+  const IconPackEntry *entry;
+  const char *name;
+  struct stat info;
+  gsize length;
+
+  if (file == NULL || width <= 0 || width != height)
+    return NULL;
+
+  if (!iconpack_open (NULL))
+    return NULL;
+
+  header = (const IconPackHeader *)iconpack_.data;
+  length = strnlen(header->folder, sizeof(header->folder));
+
+  if ((name = strrchr(file, '/')) == NULL || name - file != length ||
+      strncmp(file, header->folder, length) != 0)
+    return NULL;
+
+  if ((entry = iconpack_entry (name + 1, width)) == NULL)
+    return NULL;
+
+  if (stat(file, &info) != 0 || info.st_size != entry->bytes)
+    return NULL;		/* replaced since the bundle was built */
+
+  return iconpack_wrap (entry);
+} /* </iconpack_file_scaled> */
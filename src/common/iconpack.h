@@ -0,0 +1,76 @@
+/**
+ * Copyright (C) Generations Linux <bugs@softcraft.org>
+ * All Rights Reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef ICONPACK_H
+#define ICONPACK_H
+
+#include <stdbool.h>
+#include <gtk/gtk.h>
+
+#define ICONPACK_FILE    "gould.iconpack"	/* under $(datadir)/gould */
+#define ICONPACK_MAGIC   "GICP"
+#define ICONPACK_VERSION 1
+#define ICONPACK_NAMELEN 48
+#define ICONPACK_ALIGN   16			/* pixel rows start aligned */
+
+G_BEGIN_DECLS
+
+/**
+ * Public data structures.
+ *
+ * An icon bundle is an IconPackHeader, header->count IconPackEntry records
+ * sorted by (name, size), then RGBA pixels (GdkPixbuf layout) for each
+ * entry at entry->offset from the start of the file.
+ */
+typedef struct _IconPackHeader IconPackHeader;
+typedef struct _IconPackEntry  IconPackEntry;
+
+struct _IconPackHeader
+{
+  char    magic[4];		/* ICONPACK_MAGIC */
+  guint32 version;		/* ICONPACK_VERSION */
+  guint32 count;		/* number of IconPackEntry records */
+  guint32 reserved;
+  char    folder[256];		/* installed icons folder, ex. pixmaps */
+};
+
+struct _IconPackEntry
+{
+  char    name[ICONPACK_NAMELEN]; /* file basename, ex. "launch.png" */
+  guint32 size;			/* rendered size, 0 => natural size */
+  guint32 width;
+  guint32 height;
+  guint32 rowstride;
+  guint32 offset;		/* pixels offset in the bundle */
+  guint32 bytes;		/* source file size, changed => stale */
+};
+
+/**
+ * Public methods (iconpack.c) exported in the implementation.
+ */
+bool iconpack_open (const char *pathname);
+
+GdkPixbuf *iconpack_pixbuf (const char *name, gint size);
+GdkPixbuf *iconpack_file_scaled (const char *file, gint width, gint height);
+
+gint iconpack_compare (gconstpointer a, gconstpointer b);
+
+G_END_DECLS
+
+#endif /* </ICONPACK_H> */
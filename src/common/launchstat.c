@@ -0,0 +1,284 @@
+/**
+ * Copyright (C) Generations Linux <bugs@softcraft.org>
+ * All Rights Reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "gould.h"
+#include "launchstat.h"
+#include "util.h"
+
+/*
+* Private data structures.
+*
+* The store is a key file, one group per application:
+*
+*   [xterm]
+*   histogram=0;0;0;0;0;3;9;1;0;0;0;0;
+*   total=6211		sum of latencies, milliseconds
+*   min=312
+*   max=1490
+*   lost=1		launches without a window
+*
+* Records go to the copy in memory, written out whole at most once per
+* LAUNCHSTAT_FLUSH seconds by a main loop timeout, and by launchstat_flush.
+*/
+typedef struct _LaunchStat LaunchStat;
+
+struct _LaunchStat
+{
+  gint histogram[LAUNCHSTAT_BUCKETS];
+  gint64 total;
+  gint min, max;
+  gint lost;
+  gint count;			/* sum of histogram */
+};
+
+static GKeyFile *store_ = NULL;	/* loaded on the first record */
+static guint flush_ = 0;	/* pending write, g_timeout_add_seconds */
+
+/*
+* (private) launchstat_path - $XDG_CACHE_HOME/gould/launch.stats
+*/
+static gchar *
+launchstat_path (void)
+{
+  gchar *path = g_build_filename (g_get_user_cache_dir (), LAUNCHSTAT_FILE,
+                                  NULL);
+  gchar *folder = g_path_get_dirname (path);
+
+  g_mkdir_with_parents (folder, 0700);
+  g_free (folder);
+
+  return path;
+} /* </launchstat_path> */
+
+/*
+* (private) launchstat_get - LaunchStat of application in store
+*/
+static void
+launchstat_get (GKeyFile *store, const gchar *application, LaunchStat *stat)
+{
+  gsize length = 0;
+  gint *saved;
+  int bucket;
+
+  memset(stat, 0, sizeof(LaunchStat));
+
+  if ((saved = g_key_file_get_integer_list (store, application, "histogram",
+                                            &length, NULL)) != NULL) {
+    memcpy(stat->histogram, saved, MIN(length, LAUNCHSTAT_BUCKETS) *
+                                   sizeof(gint));
+    g_free (saved);
+  }
+
+  for (bucket = 0; bucket < LAUNCHSTAT_BUCKETS; bucket++)
+    stat->count += stat->histogram[bucket];
+
+  stat->total = g_key_file_get_int64 (store, application, "total", NULL);
+  stat->min   = g_key_file_get_integer (store, application, "min", NULL);
+  stat->max   = g_key_file_get_integer (store, application, "max", NULL);
+  stat->lost  = g_key_file_get_integer (store, application, "lost", NULL);
+} /* </launchstat_get> */
+
+/*
+* (private) launchstat_percentile - bucket holding the fraction of launches
+*/
+static int
+launchstat_percentile (LaunchStat *stat, double fraction)
+{
+  gint rank = (gint)(stat->count * fraction + 0.5);
+  gint seen = 0;
+  int bucket;
+
+  for (bucket = 0; bucket < LAUNCHSTAT_BUCKETS - 1; bucket++)
+    if ((seen += stat->histogram[bucket]) >= MAX(rank, 1))
+      break;
+
+  return bucket;
+} /* </launchstat_percentile> */
+
+/*
+* (private) launchstat_label - "<bound" or ">=bound" of bucket
+*/
+static const gchar *
+launchstat_label (int bucket, gchar *label, gsize size)
+{
+  glong bound = launchstat_bound (bucket);
+
+  if (bound < 0)
+    snprintf(label, size, ">=%ld", launchstat_bound (bucket - 1));
+  else
+    snprintf(label, size, "<%ld", bound);
+
+  return label;
+} /* </launchstat_label> */
+
+/*
+* launchstat_bound - upper bound of bucket in milliseconds, -1 if open
+*/
+glong
+launchstat_bound (int bucket)
+{
+  return (bucket < LAUNCHSTAT_BUCKETS - 1) ? (glong)LAUNCHSTAT_FLOOR << bucket
+                                           : -1;
+} /* </launchstat_bound> */
+
+/*
+* (private) launchstat_timeout - write the store once records settled
+*/
+static gboolean
+launchstat_timeout (gpointer data)
+{
+  flush_ = 0;
+  launchstat_flush ();
+  return FALSE;
+} /* </launchstat_timeout> */
+
+/*
+* launchstat_flush - write pending records, TRUE when nothing is lost
+*/
+bool
+launchstat_flush (void)
+{
+  gchar *path, *data;
+  gsize length;
+  bool vote;
+
+  if (flush_ > 0) {
+    g_source_remove (flush_);
+    flush_ = 0;
+  }
+  else if (store_ == NULL)
+    return true;
+
+  path = launchstat_path ();
+  data = g_key_file_to_data (store_, &length, NULL);
+  vote = g_file_set_contents (path, data, length, NULL);
+
+  vdebug (2, "%s => %s\n", __func__, (vote) ? path : "not saved");
+
+  g_free (path);
+  g_free (data);
+
+  return vote;
+} /* </launchstat_flush> */
+
+/*
+* launchstat_record - add a latency in milliseconds, < 0 => no window
+*/
+void
+launchstat_record (const char *application, glong latency)
+{
+  gchar *group = g_strdelimit (g_strdup (application), "[]\n", '_');
+  LaunchStat stat;
+
+  if (store_ == NULL) {
+    gchar *path = launchstat_path ();
+
+    store_ = g_key_file_new ();
+    g_key_file_load_from_file (store_, path, G_KEY_FILE_NONE, NULL);
+    g_free (path);
+  }
+  launchstat_get (store_, group, &stat);
+
+  if (latency < 0)
+    g_key_file_set_integer (store_, group, "lost", stat.lost + 1);
+  else {
+    int bucket;
+
+    for (bucket = 0; bucket < LAUNCHSTAT_BUCKETS - 1; bucket++)
+      if (latency < launchstat_bound (bucket))
+        break;
+
+    stat.histogram[bucket]++;
+
+    if (stat.count == 0 || latency < stat.min) stat.min = latency;
+    if (latency > stat.max) stat.max = latency;
+
+    g_key_file_set_integer_list (store_, group, "histogram",
+                                 stat.histogram, LAUNCHSTAT_BUCKETS);
+    g_key_file_set_int64 (store_, group, "total", stat.total + latency);
+    g_key_file_set_integer (store_, group, "min", stat.min);
+    g_key_file_set_integer (store_, group, "max", stat.max);
+  }
+
+  if (flush_ == 0)
+    flush_ = g_timeout_add_seconds (LAUNCHSTAT_FLUSH, launchstat_timeout,
+                                    NULL);
+
+  vdebug (2, "%s %s %ld ms\n", __func__, group, latency);
+  g_free (group);
+} /* </launchstat_record> */
+
+/*
+* launchstat_dump - print the histogram of every application
+*/
+void
+launchstat_dump (FILE *stream)
+{
+  GKeyFile *store = g_key_file_new ();
+  gchar *path = launchstat_path ();
+  gchar **groups, **scan;
+  gchar p50[16], p90[16];
+
+  launchstat_flush ();		/* this process's own records first */
+
+  if (!g_key_file_load_from_file (store, path, G_KEY_FILE_NONE, NULL)) {
+    fprintf(stream, "%s: no launches recorded\n", path);
+    g_key_file_free (store);
+    g_free (path);
+    return;
+  }
+
+  fprintf(stream, "%-20s %6s %6s %7s %7s %7s %8s %8s\n", "application",
+          "count", "lost", "min", "mean", "max", "p50", "p90");
+
+  groups = g_key_file_get_groups (store, NULL);
+
+  for (scan = groups; *scan != NULL; scan++) {
+    LaunchStat stat;
+    int bucket;
+
+    launchstat_get (store, *scan, &stat);
+
+    if (stat.count == 0) {
+      fprintf(stream, "%-20s %6d %6d\n", *scan, 0, stat.lost);
+      continue;
+    }
+
+    fprintf(stream, "%-20s %6d %6d %7d %7ld %7d %8s %8s\n", *scan,
+            stat.count, stat.lost, stat.min, (long)(stat.total / stat.count),
+            stat.max,
+            launchstat_label (launchstat_percentile (&stat, 0.5), p50, 16),
+            launchstat_label (launchstat_percentile (&stat, 0.9), p90, 16));
+
+    fprintf(stream, "   ");
+    for (bucket = 0; bucket < LAUNCHSTAT_BUCKETS; bucket++)
+      if (stat.histogram[bucket] > 0)
+        fprintf(stream, " %s:%d",
+                launchstat_label (bucket, p50, 16), stat.histogram[bucket]);
+    fprintf(stream, "\n");
+  }
+
+  g_strfreev (groups);
+  g_key_file_free (store);
+  g_free (path);
+} /* </launchstat_dump> */
@@ -0,0 +1,49 @@
+/**
+ * Copyright (C) Generations Linux <bugs@softcraft.org>
+ * All Rights Reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef LAUNCHSTAT_H
+#define LAUNCHSTAT_H
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <glib.h>
+
+#define LAUNCHSTAT_FILE    "gould/launch.stats"	/* under $XDG_CACHE_HOME */
+#define LAUNCHSTAT_FLOOR   16	/* milliseconds, bound of the first bucket */
+#define LAUNCHSTAT_BUCKETS 12	/* doubling bounds, the last is open ended */
+#define LAUNCHSTAT_FLUSH   30	/* seconds records wait in memory, at most */
+
+G_BEGIN_DECLS
+
+/**
+ * Public methods (launchstat.c) exported in the implementation.
+ *
+ * Each application has a histogram of click to window latencies, bucket
+ * i counting launches under LAUNCHSTAT_FLOOR << i milliseconds, and the
+ * number of launches whose window was never seen.
+ */
+void launchstat_record (const char *application, glong latency);
+bool launchstat_flush (void);
+void launchstat_dump (FILE *stream);
+
+glong launchstat_bound (int bucket);
+
+G_END_DECLS
+
+#endif /* </LAUNCHSTAT_H> */
@@ -19,13 +19,23 @@
 
 #include "gould.h"
 #include "module.h"
+#include "util.h"
 
 #include <signal.h>
 #include <unistd.h>
 
+extern const char *Program;	/* see, gpanel.c and possibly others */
+
 /*
 * Data structures used by implementation.
 */
+struct _modulus_task
+{
+  Modulus *applet;
+  GThread *thread;		/* NULL => prepared on the calling thread */
+  gdouble elapsed;		/* seconds spent in module_prepare */
+};
+
 static char *placement_[] = {
   "NONE",
   "SCREEN",
@@ -36,26 +46,50 @@ static char *placement_[] = {
 };
 
 /*
- * module_load
+ * (private) module_detach - g_module_close a module left out by module_init
+ *
+ * The name may point into the module, it is interned first. Handlers of
+ * the settings widget would too, so the widget is destroyed beforehand.
  */
-Modulus *
-module_load (const gchar *file, guint spaces, gpointer data)
+static void
+module_detach (Modulus *applet)
 {
-  Modulus *applet = NULL;
-  GModule *module = g_module_open (file, G_MODULE_BIND_MASK);
+  if (applet->name)
+    applet->name = g_intern_string (applet->name);
+
+  if (applet->settings) {
+    g_object_ref_sink (applet->settings);
+    gtk_widget_destroy (applet->settings);
+    g_object_unref (applet->settings);
+    applet->settings = NULL;
+  }
 
-  if (module) {
-    gpointer module_init, module_open, module_close;
-    applet = g_new0 (Modulus, 1);
+  g_module_close (applet->module);
+  applet->module = NULL;
+  applet->module_init = NULL;
+} /* </module_detach> */
 
-    /* Mandatory symbols of a struct _modulus */
-    if (!g_module_symbol(module, "module_init", &module_init)) {
-      g_warning("Error loading module: %s\n", file);
-      g_return_val_if_reached(NULL);
-    }
+/*
+ * (private) module_attach - dlopen file and run its module_init
+ */
+static bool
+module_attach (Modulus *applet, const gchar *file, guint spaces)
+{
+  GTimer *timer = g_timer_new ();
+  gpointer module_init, module_open, module_close, module_prepare;
+  GModule *module = g_module_open (file, G_MODULE_BIND_MASK);
+  gdouble loaded = g_timer_elapsed (timer, NULL);
+  bool vote = false;
 
-    applet->data = data;		/* must be set before module_init */
+  if (module == NULL)
+    g_warning(g_module_error());
+  else if (!g_module_symbol(module, "module_init", &module_init)) {
+    g_warning("Error loading module: %s\n", file);  /* mandatory symbol */
+    g_module_close (module);
+  }
+  else {
     applet->module = module;		/* save struct _GModule */
+    applet->file = g_intern_string (file);
 
     applet->module_init = module_init;
     applet->module_init (applet);	/* initialize plugin module */
@@ -66,15 +100,37 @@ module_load (const gchar *file, guint spaces, gpointer data)
 
       if (g_module_symbol(module, "module_close", &module_close))
         applet->module_close = module_close;
+
+      if (g_module_symbol(module, "module_prepare", &module_prepare))
+        applet->module_prepare = module_prepare;
+
+      vote = true;
     }
-    else {
-      g_free (applet);
-      applet = NULL;
-    }
+    vdebug (1, "%s %s: dlopen %.2f ms, module_init %.2f ms\n", Program,
+            (applet->name) ? applet->name : file, loaded * 1000,
+            (g_timer_elapsed (timer, NULL) - loaded) * 1000);
+
+    if (!vote)
+      module_detach (applet);
   }
-  else {
-    g_warning(g_module_error());
-    g_return_val_if_reached(NULL);
+  g_timer_destroy (timer);
+
+  return vote;
+} /* </module_attach> */
+
+/*
+ * module_load
+ */
+Modulus *
+module_load (const gchar *file, guint spaces, gpointer data)
+{
+  Modulus *applet = g_new0 (Modulus, 1);
+
+  applet->data = data;			/* must be set before module_init */
+
+  if (!module_attach (applet, file, spaces)) {
+    g_free (applet);
+    applet = NULL;
   }
   return applet;
 } /* module_load */
@@ -125,6 +181,81 @@ module_place_convert_enum (ModulusPlace idx)
   return placement_[idx];
 } /* </module_place_convert_enum> */
 
+/*
+ * (private) moduli_prepare_worker - GThreadFunc running module_prepare
+ */
+static gpointer
+moduli_prepare_worker (ModulusTask *task)
+{
+  GTimer *timer = g_timer_new ();
+
+  task->applet->module_prepare (task->applet);
+  task->elapsed = g_timer_elapsed (timer, NULL);
+  g_timer_destroy (timer);
+
+  return task;
+} /* </moduli_prepare_worker> */
+
+/*
+ * moduli_prepare - start module_prepare of each module on its own thread
+ *
+ * The caller may go on with other main thread work, then must call
+ * moduli_prepare_wait() before any module_open.
+ */
+GList *
+moduli_prepare (GList *moduli)
+{
+  GList *iter, *tasks = NULL;
+
+  for (iter = moduli; iter != NULL; iter = iter->next) {
+    Modulus *applet = (Modulus *)iter->data;
+    ModulusTask *task;
+
+    if (applet->module_prepare == NULL)
+      continue;
+
+    task = g_new0 (ModulusTask, 1);
+    task->applet = applet;
+
+#if GLIB_CHECK_VERSION(2,32,0)
+    task->thread = g_thread_try_new (applet->name,
+                                     (GThreadFunc)moduli_prepare_worker,
+                                     task, NULL);
+#else
+    if (g_thread_supported ())
+      task->thread = g_thread_create ((GThreadFunc)moduli_prepare_worker,
+                                      task, TRUE, NULL);
+#endif
+    if (task->thread == NULL)	/* no threads, prepare in place */
+      moduli_prepare_worker (task);
+
+    tasks = g_list_append (tasks, task);
+  }
+  return tasks;
+} /* </moduli_prepare> */
+
+/*
+ * moduli_prepare_wait - join moduli_prepare() threads, trace their time
+ */
+void
+moduli_prepare_wait (GList *tasks)
+{
+  GList *iter;
+
+  for (iter = tasks; iter != NULL; iter = iter->next) {
+    ModulusTask *task = (ModulusTask *)iter->data;
+
+    if (task->thread)
+      g_thread_join (task->thread);
+
+    vdebug (1, "%s %s: module_prepare %.2f ms (%s thread)\n", Program,
+            task->applet->name, task->elapsed * 1000,
+            (task->thread) ? "worker" : "main");
+    g_free (task);
+  }
+  g_list_free (tasks);
+} /* </moduli_prepare_wait> */
+
 /*
  * moduli_remove
  */
@@ -140,7 +271,180 @@ moduli_remove (GList *moduli, Modulus *applet)
 } /* </moduli_remove> */
 
 /*
- * moduli_space loads all modules from given path (and space(s))
+ * (private) moduli_manifest - module metadata, one group per file
+ */
+static GKeyFile *manifest_ = NULL;
+static bool manifest_changed_ = false;
+
+static GKeyFile *
+moduli_manifest (void)
+{
+  if (manifest_ == NULL) {
+    gchar *file = g_build_filename (g_get_user_cache_dir (),
+                                    MODULI_MANIFEST, NULL);
+
+    manifest_ = g_key_file_new ();
+    g_key_file_load_from_file (manifest_, file, G_KEY_FILE_NONE, NULL);
+    g_free (file);
+  }
+  return manifest_;
+} /* </moduli_manifest> */
+
+/*
+ * (private) moduli_manifest_stamp - identifies the module file contents
+ */
+static gchar *
+moduli_manifest_stamp (struct stat *info)
+{
+  return g_strdup_printf ("%ld:%ld", (long)info->st_mtime,
+                                     (long)info->st_size);
+} /* </moduli_manifest_stamp> */
+
+/*
+ * (private) moduli_manifest_boot - identifies the current boot
+ *
+ * A module that leaves itself out in module_init (ex. battery without a
+ * battery) is recorded for the current boot only: hardware may change.
+ */
+static const gchar *
+moduli_manifest_boot (void)
+{
+  static gchar *boot = NULL;
+
+  if (boot == NULL) {
+    if (g_file_get_contents ("/proc/sys/kernel/random/boot_id",
+                             &boot, NULL, NULL))
+      g_strstrip (boot);
+    else
+      boot = g_strdup ("");
+  }
+  return boot;
+} /* </moduli_manifest_boot> */
+
+/*
+ * (private) moduli_manifest_read - Modulus for file without loading it
+ *
+ * Only name, place and space are known until module_realize(). Sets
+ * known when the manifest entry is current, even if it gives no Modulus
+ * (not in spaces, or left out this boot).
+ */
+static Modulus *
+moduli_manifest_read (const gchar *file, struct stat *info,
+                      guint spaces, gpointer data, bool *known)
+{
+  GKeyFile *manifest = moduli_manifest ();
+  gchar *stamp = moduli_manifest_stamp (info);
+  gchar *cached = g_key_file_get_string (manifest, file, "stamp", NULL);
+  gchar *boot = g_key_file_get_string (manifest, file, "boot", NULL);
+  Modulus *applet = NULL;
+
+  *known = cached && strcmp(cached, stamp) == 0 &&
+           (boot == NULL || strcmp(boot, moduli_manifest_boot ()) == 0);
+
+  if (*known) {
+    gchar *name  = g_key_file_get_string (manifest, file, "name", NULL);
+    gchar *place = g_key_file_get_string (manifest, file, "place", NULL);
+    guint space  = g_key_file_get_integer (manifest, file, "space", NULL);
+
+    if (name && place && (space & spaces)) {
+      applet = g_new0 (Modulus, 1);
+      applet->data  = data;
+      applet->file  = g_intern_string (file);
+      applet->name  = g_intern_string (name);
+      applet->place = module_place_convert_string (place);
+      applet->space = space;
+    }
+    g_free (name);
+    g_free (place);
+  }
+  g_free (cached);
+  g_free (stamp);
+  g_free (boot);
+
+  return applet;
+} /* </moduli_manifest_read> */
+
+/*
+ * (private) moduli_manifest_write - record a module once module_init ran
+ *
+ * A space of 0 means module_init left the module out, see above.
+ */
+static void
+moduli_manifest_write (Modulus *applet, struct stat *info)
+{
+  GKeyFile *manifest = moduli_manifest ();
+  gchar *stamp = moduli_manifest_stamp (info);
+
+  g_key_file_remove_group (manifest, applet->file, NULL);
+  g_key_file_set_string (manifest, applet->file, "stamp", stamp);
+  g_key_file_set_string (manifest, applet->file, "name",
+                         (applet->name) ? applet->name : "");
+  g_key_file_set_string (manifest, applet->file, "place",
+                         module_place_convert_enum (applet->place));
+  g_key_file_set_integer (manifest, applet->file, "space", applet->space);
+
+  if (applet->space == 0)
+    g_key_file_set_string (manifest, applet->file, "boot",
+                           moduli_manifest_boot ());
+  g_free (stamp);
+
+  manifest_changed_ = true;
+} /* </moduli_manifest_write> */
+
+/*
+ * (private) moduli_manifest_save
+ */
+static void
+moduli_manifest_save (void)
+{
+  gchar *file = g_build_filename (g_get_user_cache_dir (),
+                                  MODULI_MANIFEST, NULL);
+  gchar *folder = g_path_get_dirname (file);
+  gchar *content = g_key_file_to_data (manifest_, NULL, NULL);
+
+  g_mkdir_with_parents (folder, 0700);
+
+  if (g_file_set_contents (file, content, -1, NULL))
+    manifest_changed_ = false;
+
+  g_free (content);
+  g_free (folder);
+  g_free (file);
+} /* </moduli_manifest_save> */
+
+/*
+ * module_realize - load a module known so far only from its manifest
+ *
+ * The enable flag is left as the caller had it (see, applets_loadable).
+ * Returns false when the module cannot be loaded or, once initialized,
+ * no longer belongs in the spaces mask (ex. battery without a battery),
+ * which the manifest then records.
+ */
+bool
+module_realize (Modulus *applet, guint spaces)
+{
+  bool enable = applet->enable;
+  struct stat info;
+  bool vote;
+
+  if (applet->module != NULL || applet->file == NULL)
+    return true;			/* loaded already, or builtin */
+
+  vote = module_attach (applet, applet->file, spaces);
+  applet->enable = enable;
+
+  if (!vote && applet->space == 0 && stat(applet->file, &info) == 0) {
+    moduli_manifest_write (applet, &info);
+    moduli_manifest_save ();
+  }
+  return vote;
+} /* </module_realize> */
+
+/*
+ * moduli_space lists all modules from given path (and space(s))
+ *
+ * A module described by an up to date manifest entry is not loaded,
+ * see module_realize(). Others are loaded once to record the entry.
  */
 GList *
 moduli_space (GList *moduli, const gchar *path, guint spaces, gpointer data)
@@ -154,50 +458,73 @@ moduli_space (GList *moduli, const gchar *path, guint spaces, gpointer data)
     int count = scandir(path, &names, NULL, alphasort);
     char file[FILENAME_MAX];
     char *name, *scan;
+    bool known;
     int idx;
 
     for (idx = 0; idx < count; idx++) {
       name = names[idx]->d_name;
+      scan = strrchr(name, '.');
 
-      if (name[0] == '.' || strcmp(strrchr(name, '.'), ".so"))
+      if (name[0] == '.' || scan == NULL || strcmp(scan, ".so"))
         continue;
-      
+
+      sprintf(file, "%s/%s", path, name);
+
+      if (lstat(file, &current) != 0)	/* should not happen */
+        continue;
+
       strcpy(file, name);	/* isolate file name without extension */
       scan = strrchr(file, '.');
       *scan = (char)0;
 
       /*
-       * See if a module with the same name is already loaded.
+       * See if a module with the same name is already listed.
        */
       if ((applet = module_search(moduli, file)) != NULL) {
-        sprintf(file, "%s/%s", path, name);
-
-        if (lstat(file, &current) != 0)	/* should not happen */
+        if (lstat(applet->file, &loaded) != 0)
           continue;
 
-        if (lstat(g_module_name(applet->module), &loaded) != 0)
-          continue;
+        if (loaded.st_mtime > current.st_mtime)
+          continue;	/* previously listed module more current */
+      }
 
-        if (loaded.st_mtime > current.st_mtime) {
-          continue;	/* previously loaded module more current */
-        }
+      sprintf(file, "%s/%s", path, name);
+
+      modulus = moduli_manifest_read (file, &current, spaces, data, &known);
+
+      if (!known) {	/* load once, record even when left out */
+        modulus = g_new0 (Modulus, 1);
+        modulus->data = data;
+
+        if (module_attach (modulus, file, spaces))
+          moduli_manifest_write (modulus, &current);
         else {
-          if ((modulus = module_load(file, spaces, data)) != NULL)
-            moduli_remove(moduli, applet);
-          else
-            continue;	/* stick with previously loaded module */
+          if (modulus->file != NULL)	/* module_init ran */
+            moduli_manifest_write (modulus, &current);
+
+          g_free (modulus);
+          modulus = NULL;
         }
       }
-      else {
-        sprintf(file, "%s/%s", path, name);
-        modulus = module_load(file, spaces, data);
-      }
 
       if (modulus) { /* NULL if not found or not in spaces mask */
+        if (applet)
+          moduli = moduli_remove(moduli, applet);
+
         moduli = g_list_append (moduli, modulus);
       }
     }
+
+    for (idx = 0; idx < count; idx++)
+      free(names[idx]);
+
+    if (count >= 0)
+      free(names);
   }
+
+  if (manifest_changed_)
+    moduli_manifest_save ();
+
   return moduli;
 } /* </moduli_space> */
 
@@ -40,8 +40,12 @@ G_BEGIN_DECLS
 #define MODULI_SPACE_ANCHOR   0x0300
 #define MODULI_SPACE_START    0x0500
 
+/* Module metadata kept between runs, see moduli_space() */
+#define MODULI_MANIFEST "gould/modules.manifest"  /* under $XDG_CACHE_HOME */
+
 /* Data structures */
 typedef struct _modulus        Modulus;
+typedef struct _modulus_task   ModulusTask;
 typedef enum   _modulus_place  ModulusPlace;
 
 enum _modulus_place {
@@ -76,15 +80,29 @@ struct _modulus
 
   gpointer data;		/* usually assigned to program global */
   bool enable;			/* [internal] governs how to enable */
+
+  /* appended, existing modules keep their field offsets */
+  const gchar *file;		/* [internal] shared object, see module_realize */
+
+  /*
+   * [optional] blocking I/O (sysfs, /proc, device probes) between
+   * module_init and module_open. Runs on a worker thread, in parallel
+   * with other modules: no GTK/GDK calls, module private state only.
+   */
+  void (*module_prepare)(Modulus *self);
 };
 
 /* Methods exported by implementation */
 Modulus *module_load(const gchar *file, guint space, gpointer data);
+bool module_realize(Modulus *applet, guint space);
 Modulus *module_search(GList *moduli, const gchar *name);
 
 ModulusPlace module_place_convert_string (const char *string);
 const char  *module_place_convert_enum (ModulusPlace idx);
 
+GList *moduli_prepare(GList *moduli);
+void moduli_prepare_wait(GList *tasks);
+
 GList *moduli_remove(GList *moduli, Modulus *applet);
 GList *moduli_space(GList *moduli,
                     const gchar *path,
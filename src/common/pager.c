@@ -943,10 +943,16 @@ pager_get_background (Pager *pager, int width, int height)
   }
 
   if ((backdrop = green_get_background_pixmap (priv->green)) != None) {
-    pixmap = gdk_pixmap_foreign_new (backdrop);
-    pixbuf = gdk_pixbuf_get_from_drawable (NULL, pixmap,
-                                           colormap_from_pixmap (pixmap),
-                                           0, 0, 0, 0, -1, -1);
+    /* Prefer the thumbnail published along with the pixmap, see gwindow.c */
+    pixbuf = get_window_pixmap_thumbnail (green_get_root_window (priv->green),
+                                          backdrop);
+    if (pixbuf == NULL) {
+      pixmap = gdk_pixmap_foreign_new (backdrop);
+      pixbuf = gdk_pixbuf_get_from_drawable (NULL, pixmap,
+                                             colormap_from_pixmap (pixmap),
+                                             0, 0, 0, 0, -1, -1);
+      g_object_unref (pixmap);
+    }
     if (pixbuf) {
       priv->backdrop = gdk_pixbuf_scale_simple (pixbuf, width, height,
                                                 GDK_INTERP_BILINEAR);
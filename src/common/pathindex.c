@@ -0,0 +1,489 @@
+/**
+ * Copyright (C) Generations Linux <bugs@softcraft.org>
+ * All Rights Reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/inotify.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "pathindex.h"
+#include "util.h"
+
+#define PATH_INDEX_EVENTS (IN_CREATE | IN_DELETE | IN_MOVED_FROM | \
+                           IN_MOVED_TO | IN_DELETE_SELF | IN_MOVE_SELF | \
+                           IN_ONLYDIR)
+
+/*
+* Private data structures.
+*/
+typedef struct _PathDir PathDir;
+
+struct _PathDir
+{
+  gchar *dirname;
+  GHashTable *names;		/* entry name => interned full pathname */
+
+  ino_t inode;			/* 0 => directory did not exist */
+  struct timespec mtime;	/* as of the last scan */
+
+  int watch;			/* inotify watch descriptor, -1 => none */
+  bool dirty;			/* rescan before the next lookup */
+};
+
+struct _PathIndex
+{
+  GList   *list;		/* search path, as given */
+  PathDir *dirs;		/* one for each list member, same order */
+  guint    count;
+
+  int    inotify;		/* -1 => mtime checks only */
+  guint  watch;			/* main loop source draining inotify */
+  time_t checked;		/* last mtime sweep (monotonic seconds) */
+
+  gchar *cache;			/* persistent copy of the lists, or NULL */
+  bool   unsaved;		/* lists changed since the cache was written */
+
+  gulong lookups;		/* path_index_lookup() calls */
+  gulong probes;		/* stat calls path_finder() would have made */
+  gulong stats;			/* stat calls actually made */
+  gulong scans;			/* directory (re)scans */
+};
+
+/*
+* (private) path_index_clock - monotonic seconds
+*/
+static time_t
+path_index_clock (void)
+{
+  struct timespec now;
+
+  clock_gettime (CLOCK_MONOTONIC, &now);
+  return now.tv_sec;
+} /* </path_index_clock> */
+
+/*
+* (private) path_dir_insert - add name to the directory entries
+*
+* Pathnames are interned so the pointers path_index_lookup() hands out
+* stay valid across rescans, as callers keep them (ex. docklet icons).
+*/
+static void
+path_dir_insert (PathDir *dir, const char *name)
+{
+  gchar *pathname = g_build_filename (dir->dirname, name, NULL);
+
+  g_hash_table_insert (dir->names, g_strdup (name),
+                       (gpointer)g_intern_string (pathname));
+  g_free (pathname);
+} /* </path_dir_insert> */
+
+/*
+* (private) path_dir_scan - list a directory, replacing previous entries
+*/
+static void
+path_dir_scan (PathIndex *index, PathDir *dir)
+{
+  struct dirent *entry;
+  struct stat info;
+  DIR *stream;
+
+  g_hash_table_remove_all (dir->names);
+  dir->dirty = false;
+  index->scans++;
+  index->stats++;
+
+  /* Stat before reading, a change during readdir() is seen next time. */
+  if (stat(dir->dirname, &info) != 0 || !S_ISDIR(info.st_mode)) {
+    dir->inode = 0;
+    return;
+  }
+
+  dir->inode = info.st_ino;
+  dir->mtime = info.st_mtim;
+  index->unsaved = true;
+
+  if (index->inotify >= 0 && dir->watch < 0)
+    dir->watch = inotify_add_watch (index->inotify, dir->dirname,
+                                    PATH_INDEX_EVENTS);
+
+  if ((stream = opendir(dir->dirname)) == NULL)
+    return;
+
+  while ((entry = readdir(stream)) != NULL) {
+    if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0)
+      continue;
+
+    path_dir_insert (dir, entry->d_name);
+  }
+  closedir(stream);
+
+  vdebug (3, "%s %s => %u entries\n", __func__, dir->dirname,
+          g_hash_table_size (dir->names));
+} /* </path_dir_scan> */
+
+/*
+* (private) path_index_notified - mark directories inotify reported changed
+*
+* Runs from the main loop when the inotify descriptor is readable, so
+* lookups do not pay a read() each; the rescan waits for the next one.
+*/
+static gboolean
+path_index_notified (GIOChannel *channel, GIOCondition condition,
+                     gpointer data)
+{
+  PathIndex *index = data;
+  char buffer[4096] __attribute__ ((aligned(__alignof__(struct inotify_event))));
+  ssize_t length;
+
+  while ((length = read(index->inotify, buffer, sizeof(buffer))) > 0) {
+    char *scan = buffer;
+
+    while (scan < buffer + length) {
+      struct inotify_event *event = (struct inotify_event *)scan;
+
+      for (guint idx = 0; idx < index->count; idx++) {
+        PathDir *dir = &index->dirs[idx];
+
+        if (dir->watch == event->wd) {
+          if (event->mask & IN_IGNORED)	/* directory gone, watch removed */
+            dir->watch = -1;
+
+          dir->dirty = true;
+        }
+      }
+      scan += sizeof(struct inotify_event) + event->len;
+    }
+  }
+  return TRUE;
+} /* </path_index_notified> */
+
+/*
+* (private) path_index_save - write the directory lists to the cache file
+*
+* The format is line oriented: a record "D <inode> <sec> <nsec> <dirname>"
+* for each directory, followed by one entry name per line. Names holding
+* a newline are left out, they are found by the next rescan instead.
+*/
+static void
+path_index_save (PathIndex *index)
+{
+  gchar *partial = g_strdup_printf ("%s.%d", index->cache, getpid());
+  gchar *folder = g_path_get_dirname (index->cache);
+  bool vote = false;
+  FILE *stream;
+
+  g_mkdir_with_parents (folder, 0700);
+  g_free (folder);
+
+  if ((stream = fopen(partial, "w"))) {
+    fprintf(stream, "%s\n", PATH_INDEX_MAGIC);
+
+    for (guint idx = 0; idx < index->count; idx++) {
+      PathDir *dir = &index->dirs[idx];
+      GHashTableIter iter;
+      gpointer name;
+
+      if (dir->inode == 0 || dir->dirty)
+        continue;
+
+      fprintf(stream, "D %lu %ld %ld %s\n", (unsigned long)dir->inode,
+              (long)dir->mtime.tv_sec, (long)dir->mtime.tv_nsec,
+              dir->dirname);
+
+      g_hash_table_iter_init (&iter, dir->names);
+
+      while (g_hash_table_iter_next (&iter, &name, NULL))
+        if (strchr(name, '\n') == NULL)
+          fprintf(stream, "%s\n", (const char *)name);
+    }
+    vote = (fclose(stream) == 0) && rename(partial, index->cache) == 0;
+
+    if (!vote)
+      unlink(partial);
+  }
+  g_free (partial);
+
+  index->unsaved = !vote;
+  vdebug (2, "%s %s => %s\n", __func__, index->cache, vote ? "ok" : "failed");
+} /* </path_index_save> */
+
+/*
+* (private) path_index_load - fill unchanged directories from the cache file
+*/
+static void
+path_index_load (PathIndex *index)
+{
+  gchar **lines, *content;
+  PathDir *dir = NULL;
+
+  if (!g_file_get_contents (index->cache, &content, NULL, NULL))
+    return;
+
+  lines = g_strsplit (content, "\n", -1);
+  g_free (content);
+
+  if (lines[0] == NULL || strcmp(lines[0], PATH_INDEX_MAGIC) != 0) {
+    g_strfreev (lines);
+    return;
+  }
+
+  for (gchar **line = &lines[1]; *line != NULL; line++) {
+    unsigned long inode;
+    long sec, nsec;
+    int offset = 0;
+
+    if (**line == '\0')
+      continue;
+
+    if (sscanf(*line, "D %lu %ld %ld %n", &inode, &sec, &nsec, &offset) == 3
+        && offset > 0) {
+      const char *dirname = *line + offset;
+      struct stat info;
+
+      dir = NULL;
+
+      for (guint idx = 0; idx < index->count; idx++)
+        if (index->dirs[idx].dirty &&
+            strcmp(index->dirs[idx].dirname, dirname) == 0) {
+          dir = &index->dirs[idx];
+          break;
+        }
+
+      if (dir == NULL)		/* no longer on the search path */
+        continue;
+
+      index->stats++;
+
+      if (stat(dirname, &info) != 0 || !S_ISDIR(info.st_mode) ||
+          info.st_ino != inode ||
+          info.st_mtim.tv_sec != sec || info.st_mtim.tv_nsec != nsec) {
+        dir = NULL;		/* stale, path_dir_scan() it */
+        continue;
+      }
+
+      dir->inode = info.st_ino;
+      dir->mtime = info.st_mtim;
+      dir->dirty = false;
+
+      if (index->inotify >= 0)
+        dir->watch = inotify_add_watch (index->inotify, dir->dirname,
+                                        PATH_INDEX_EVENTS);
+    }
+    else if (dir != NULL) {
+      path_dir_insert (dir, *line);
+    }
+  }
+  g_strfreev (lines);
+} /* </path_index_load> */
+
+/*
+* (private) path_index_validate - rescan directories known to have changed
+*/
+static void
+path_index_validate (PathIndex *index)
+{
+  time_t now = path_index_clock ();
+
+  /* Network file systems do not report changes, compare mtimes too. */
+  if (now - index->checked >= PATH_INDEX_RECHECK) {
+    index->checked = now;
+
+    for (guint idx = 0; idx < index->count; idx++) {
+      PathDir *dir = &index->dirs[idx];
+      struct stat info;
+
+      if (dir->dirty)
+        continue;
+
+      index->stats++;
+
+      if (stat(dir->dirname, &info) != 0)
+        dir->dirty = (dir->inode != 0);
+      else
+        dir->dirty = info.st_ino != dir->inode ||
+                     info.st_mtim.tv_sec  != dir->mtime.tv_sec ||
+                     info.st_mtim.tv_nsec != dir->mtime.tv_nsec;
+    }
+  }
+
+  for (guint idx = 0; idx < index->count; idx++)
+    if (index->dirs[idx].dirty)
+      path_dir_scan (index, &index->dirs[idx]);
+
+  if (index->cache && index->unsaved)
+    path_index_save (index);
+} /* </path_index_validate> */
+
+/*
+* (private) path_index_create - allocate an index, directories unscanned
+*/
+static PathIndex *
+path_index_create (GList *dirs)
+{
+  PathIndex *index = g_new0 (PathIndex, 1);
+  GList *iter;
+  guint idx = 0;
+
+  index->list    = dirs;
+  index->count   = g_list_length (dirs);
+  index->dirs    = g_new0 (PathDir, index->count);
+  index->inotify = inotify_init1 (IN_NONBLOCK | IN_CLOEXEC);
+  index->checked = path_index_clock ();
+
+  if (index->inotify >= 0) {
+    GIOChannel *channel = g_io_channel_unix_new (index->inotify);
+
+    index->watch = g_io_add_watch (channel, G_IO_IN, path_index_notified,
+                                   index);
+    g_io_channel_unref (channel);
+  }
+
+  for (iter = dirs; iter != NULL; iter = iter->next, idx++) {
+    PathDir *dir = &index->dirs[idx];
+
+    dir->dirname = g_strdup ((const char *)iter->data);
+    dir->names   = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                          g_free, NULL);
+    dir->watch   = -1;
+    dir->dirty   = true;
+  }
+  return index;
+} /* </path_index_create> */
+
+/*
+* path_index_new - index the directories of a search path
+*/
+PathIndex *
+path_index_new (GList *dirs)
+{
+  PathIndex *index = path_index_create (dirs);
+
+  for (guint idx = 0; idx < index->count; idx++)
+    path_dir_scan (index, &index->dirs[idx]);
+
+  return index;
+} /* </path_index_new> */
+
+/*
+* path_index_new_cached - path_index_new() backed by a cache file
+*
+* Directories whose inode and mtime match the cache file record are
+* filled from it, so an unchanged search path costs one stat() per
+* directory and a single read. The cache file is rewritten whenever
+* a directory has to be (re)scanned.
+*/
+PathIndex *
+path_index_new_cached (GList *dirs, const char *cache)
+{
+  PathIndex *index = path_index_create (dirs);
+
+  index->cache = g_strdup (cache);
+  path_index_load (index);
+
+  for (guint idx = 0; idx < index->count; idx++)
+    if (index->dirs[idx].dirty)
+      path_dir_scan (index, &index->dirs[idx]);
+
+  if (index->unsaved)
+    path_index_save (index);
+
+  return index;
+} /* </path_index_new_cached> */
+
+/*
+* path_index_free - destructor
+*/
+void
+path_index_free (PathIndex *index)
+{
+  for (guint idx = 0; idx < index->count; idx++) {
+    g_hash_table_destroy (index->dirs[idx].names);
+    g_free (index->dirs[idx].dirname);
+  }
+
+  if (index->watch) g_source_remove (index->watch);
+
+  if (index->inotify >= 0)
+    close(index->inotify);
+
+  g_free (index->cache);
+  g_free (index->dirs);
+  g_free (index);
+} /* </path_index_free> */
+
+/*
+* path_index_lookup - pathname of the first name found, like path_finder()
+*/
+const char *
+path_index_lookup (PathIndex *index, const char *name)
+{
+  if (index == NULL || name == NULL)
+    return NULL;
+
+  /* Relative names with a directory part are not in the index. */
+  if (strchr(name, '/') != NULL) {
+    index->stats += index->count;
+    return path_finder (index->list, name);
+  }
+
+  path_index_validate (index);
+  index->lookups++;
+
+  for (guint idx = 0; idx < index->count; idx++) {
+    const char *pathname = g_hash_table_lookup (index->dirs[idx].names, name);
+
+    index->probes++;
+
+    if (pathname != NULL)
+      return pathname;
+  }
+  return NULL;
+} /* </path_index_lookup> */
+
+/*
+* path_index_counts - stat calls made and path_finder() would have made
+*/
+void
+path_index_counts (PathIndex *index, gulong *stats, gulong *probes,
+                                     gulong *scans)
+{
+  if (stats)  *stats  = (index) ? index->stats : 0;
+  if (probes) *probes = (index) ? index->probes : 0;
+  if (scans)  *scans  = (index) ? index->scans : 0;
+} /* </path_index_counts> */
+
+/*
+* path_index_report - lookups and stat calls, versus path_finder()
+*/
+void
+path_index_report (PathIndex *index, const char *caption)
+{
+  if (index == NULL)
+    return;
+
+  vdebug (1, "%s: %lu lookups, %lu stat calls, %lu scans "
+             "(path_finder: %lu stat calls)\n", caption,
+             index->lookups, index->stats, index->scans, index->probes);
+} /* </path_index_report> */
@@ -0,0 +1,58 @@
+/**
+ * Copyright (C) Generations Linux <bugs@softcraft.org>
+ * All Rights Reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef PATHINDEX_H
+#define PATHINDEX_H
+
+#include <stdbool.h>
+#include <glib.h>
+
+#define PATH_INDEX_RECHECK 2	/* seconds between directory mtime checks */
+#define PATH_INDEX_MAGIC   "GPIC 1"	/* first line of a cache file */
+
+G_BEGIN_DECLS
+
+/**
+ * Public data structures.
+ *
+ * A PathIndex lists each directory of a search path once and answers
+ * path_finder() style lookups from memory. Directories are rescanned
+ * when inotify reports a change, drained from the default main loop,
+ * or their mtime differs (for network file systems inotify does not
+ * see), checked at most every PATH_INDEX_RECHECK seconds. Pathnames
+ * returned by lookups are interned and remain valid for the life of
+ * the program.
+ */
+typedef struct _PathIndex PathIndex;
+
+/**
+ * Public methods (pathindex.c) exported in the implementation.
+ */
+PathIndex *path_index_new (GList *dirs);
+PathIndex *path_index_new_cached (GList *dirs, const char *cache);
+void path_index_free (PathIndex *index);
+
+const char *path_index_lookup (PathIndex *index, const char *name);
+void path_index_counts (PathIndex *index, gulong *stats, gulong *probes,
+                                          gulong *scans);
+void path_index_report (PathIndex *index, const char *caption);
+
+G_END_DECLS
+
+#endif /* </PATHINDEX_H> */
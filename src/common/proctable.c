@@ -0,0 +1,346 @@
+/**
+ * Copyright (C) Generations Linux <bugs@softcraft.org>
+ * All Rights Reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "proctable.h"
+#include "util.h"
+
+/*
+* Private data structures.
+*/
+struct _ProcessTable
+{
+  gint    refs;			/* see proctable_unref() */
+  int     dirfd;		/* proc root for openat(), -1 => unreadable */
+  GArray *entries;		/* ProcessEntry, ascending pid */
+  glong   stamp;		/* monotonic milliseconds of the scan */
+};
+
+G_LOCK_DEFINE_STATIC (proctable_shared);
+static ProcessTable *shared_ = NULL;	/* see proctable_snapshot() */
+
+/*
+* (private) proctable_clock - monotonic milliseconds
+*/
+static glong
+proctable_clock (void)
+{
+  struct timespec now;
+
+  clock_gettime (CLOCK_MONOTONIC, &now);
+  return now.tv_sec * 1000 + now.tv_nsec / 1000000;
+} /* </proctable_clock> */
+
+/*
+* (private) proctable_compare - order entries by pid
+*/
+static gint
+proctable_compare (gconstpointer a, gconstpointer b)
+{
+  const ProcessEntry *one = a;
+  const ProcessEntry *two = b;
+
+  return (one->pid < two->pid) ? -1 : (one->pid > two->pid);
+} /* </proctable_compare> */
+
+/*
+* (private) proctable_stat - fill entry from <pid>/stat, one openat()
+*/
+static bool
+proctable_stat (int dirfd, const char *pid, ProcessEntry *entry)
+{
+  char buffer[1024];
+  char path[32];
+  char *start, *end, state;
+  int ppid, group, session;
+  struct stat info;
+  ssize_t length;
+  int fd, size;
+
+  snprintf(path, sizeof(path), "%s/stat", pid);
+
+  if ((fd = openat(dirfd, path, O_RDONLY | O_CLOEXEC)) < 0)
+    return false;
+
+  length = read(fd, buffer, sizeof(buffer) - 1);
+
+  if (fstat(fd, &info) != 0)	/* owner is the effective user */
+    length = -1;
+
+  close(fd);
+
+  if (length <= 0)
+    return false;
+
+  buffer[length] = (char)0;
+
+  /* pid (comm) state ppid pgrp session ..., comm itself may hold ')' */
+  if ((start = strchr(buffer, '(')) == NULL ||
+      (end = strrchr(buffer, ')')) == NULL || end < start)
+    return false;
+
+  if (sscanf(end + 1, " %c %d %d %d", &state, &ppid, &group, &session) != 4)
+    return false;
+
+  size = MIN(end - start - 1, PROCTABLE_COMM);
+  memcpy(entry->name, start + 1, size);
+  entry->name[size] = (char)0;
+
+  entry->pid      = atoi(pid);
+  entry->ppid     = ppid;
+  entry->session  = session;
+  entry->uid      = info.st_uid;
+  entry->exe      = NULL;
+  entry->resolved = false;
+
+  return true;
+} /* </proctable_stat> */
+
+/*
+* proctable_new - scan the process entries under root (NULL => /proc)
+*/
+ProcessTable *
+proctable_new (const char *root)
+{
+  ProcessTable *table = g_new0 (ProcessTable, 1);
+  struct dirent *item;
+  DIR *dir = NULL;
+  int fd;
+
+  if (root == NULL)
+    root = PROCTABLE_ROOT;
+
+  table->refs    = 1;
+  table->entries = g_array_new (FALSE, FALSE, sizeof(ProcessEntry));
+  table->stamp   = proctable_clock ();
+  table->dirfd   = open(root, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+
+  /* fdopendir() takes its descriptor, dirfd is kept for proctable_exe() */
+  if (table->dirfd >= 0 && (fd = fcntl(table->dirfd, F_DUPFD_CLOEXEC, 0)) >= 0)
+    if ((dir = fdopendir(fd)) == NULL)
+      close(fd);
+
+  if (dir == NULL) {
+    vdebug (1, "proctable_new %s: cannot read\n", root);
+    return table;
+  }
+
+  while ((item = readdir(dir)) != NULL) {
+    ProcessEntry entry;
+
+    if (!g_ascii_isdigit (item->d_name[0]))
+      continue;
+
+    if (proctable_stat (table->dirfd, item->d_name, &entry))
+      g_array_append_val (table->entries, entry);
+  }
+  closedir(dir);
+
+  g_array_sort (table->entries, proctable_compare);
+
+  vdebug (3, "proctable_new %s => %u processes\n", root, table->entries->len);
+  return table;
+} /* </proctable_new> */
+
+/*
+* proctable_snapshot - shared table of PROCTABLE_ROOT, PROCTABLE_TTL fresh
+*
+* Lookups made close together (ex. killall of several programs) share
+* one scan. The table must be released with proctable_unref().
+*/
+ProcessTable *
+proctable_snapshot (void)
+{
+  ProcessTable *table;
+
+  G_LOCK (proctable_shared);
+
+  if (shared_ == NULL || proctable_clock () - shared_->stamp > PROCTABLE_TTL) {
+    proctable_unref (shared_);
+    shared_ = proctable_new (PROCTABLE_ROOT);
+  }
+  table = shared_;
+  g_atomic_int_inc (&table->refs);
+
+  G_UNLOCK (proctable_shared);
+  return table;
+} /* </proctable_snapshot> */
+
+/*
+* proctable_unref - release a table from proctable_new() or _snapshot()
+*/
+void
+proctable_unref (ProcessTable *table)
+{
+  guint idx;
+
+  if (table == NULL || !g_atomic_int_dec_and_test (&table->refs))
+    return;
+
+  for (idx = 0; idx < table->entries->len; idx++)
+    g_free (g_array_index (table->entries, ProcessEntry, idx).exe);
+
+  g_array_free (table->entries, TRUE);
+
+  if (table->dirfd >= 0)
+    close(table->dirfd);
+
+  g_free (table);
+} /* </proctable_unref> */
+
+/*
+* proctable_lookup - entry of pid, or NULL
+*/
+const ProcessEntry *
+proctable_lookup (ProcessTable *table, pid_t pid)
+{
+  gint low = 0, high = (gint)table->entries->len - 1;
+
+  while (low <= high) {
+    gint mid = (low + high) / 2;
+    ProcessEntry *entry = &g_array_index (table->entries, ProcessEntry, mid);
+
+    if (entry->pid == pid)
+      return entry;
+
+    if (entry->pid < pid)
+      low = mid + 1;
+    else
+      high = mid - 1;
+  }
+  return NULL;
+} /* </proctable_lookup> */
+
+/*
+* proctable_exe - executable path of entry, NULL when not permitted
+*/
+const char *
+proctable_exe (ProcessTable *table, const ProcessEntry *entry)
+{
+  ProcessEntry *process = (ProcessEntry *)entry;
+
+  G_LOCK (proctable_shared);	/* snapshots are shared between threads */
+
+  if (!process->resolved && table->dirfd >= 0) {
+    char target[FILENAME_MAX];
+    char path[32];
+    ssize_t length;
+
+    snprintf(path, sizeof(path), "%d/exe", process->pid);
+
+    if ((length = readlinkat(table->dirfd, path, target, sizeof(target) - 1)) > 0) {
+      target[length] = (char)0;
+
+      if (g_str_has_suffix (target, " (deleted)"))	/* replaced on disk */
+        target[length - strlen(" (deleted)")] = (char)0;
+
+      process->exe = g_strdup (target);
+    }
+  }
+  process->resolved = true;
+
+  G_UNLOCK (proctable_shared);
+  return process->exe;
+} /* </proctable_exe> */
+
+/*
+* proctable_find_name - processes named name, as pidof(8) (a name with
+* a slash is looked up as an executable path)
+*/
+GList *
+proctable_find_name (ProcessTable *table, const char *name)
+{
+  size_t size = MIN(strlen(name), PROCTABLE_COMM);
+  GList *list = NULL;
+  guint idx;
+
+  if (strchr(name, '/'))
+    return proctable_find_exe (table, name);
+
+  for (idx = 0; idx < table->entries->len; idx++) {
+    ProcessEntry *entry = &g_array_index (table->entries, ProcessEntry, idx);
+
+    /* comm holds the first PROCTABLE_COMM characters of longer names */
+    if (strncmp(entry->name, name, size) == 0 && entry->name[size] == (char)0)
+      list = g_list_prepend (list, entry);
+  }
+  return g_list_reverse (list);
+} /* </proctable_find_name> */
+
+/*
+* proctable_find_exe - processes running the executable path
+*/
+GList *
+proctable_find_exe (ProcessTable *table, const char *path)
+{
+  GList *list = NULL;
+  guint idx;
+
+  for (idx = 0; idx < table->entries->len; idx++) {
+    ProcessEntry *entry = &g_array_index (table->entries, ProcessEntry, idx);
+    const char *exe;
+
+    if ((exe = proctable_exe (table, entry)) && strcmp(exe, path) == 0)
+      list = g_list_prepend (list, entry);
+  }
+  return g_list_reverse (list);
+} /* </proctable_find_exe> */
+
+/*
+* proctable_find_session - processes of the session
+* proctable_find_uid - processes of the user
+*/
+GList *
+proctable_find_session (ProcessTable *table, pid_t session)
+{
+  GList *list = NULL;
+  guint idx;
+
+  for (idx = 0; idx < table->entries->len; idx++) {
+    ProcessEntry *entry = &g_array_index (table->entries, ProcessEntry, idx);
+
+    if (entry->session == session)
+      list = g_list_prepend (list, entry);
+  }
+  return g_list_reverse (list);
+} /* </proctable_find_session> */
+
+GList *
+proctable_find_uid (ProcessTable *table, uid_t uid)
+{
+  GList *list = NULL;
+  guint idx;
+
+  for (idx = 0; idx < table->entries->len; idx++) {
+    ProcessEntry *entry = &g_array_index (table->entries, ProcessEntry, idx);
+
+    if (entry->uid == uid)
+      list = g_list_prepend (list, entry);
+  }
+  return g_list_reverse (list);
+} /* </proctable_find_uid> */
@@ -0,0 +1,74 @@
+/**
+ * Copyright (C) Generations Linux <bugs@softcraft.org>
+ * All Rights Reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef PROCTABLE_H
+#define PROCTABLE_H
+
+#include <stdbool.h>
+#include <sys/types.h>
+#include <glib.h>
+
+#define PROCTABLE_ROOT "/proc"
+#define PROCTABLE_TTL  250	/* milliseconds a shared snapshot is reused */
+#define PROCTABLE_COMM 15	/* longest comm name, see TASK_COMM_LEN */
+
+G_BEGIN_DECLS
+
+/**
+ * Public data structures.
+ *
+ * A ProcessTable is a snapshot of the process entries under a proc root,
+ * read with one openat() of <pid>/stat per process. The executable path
+ * is read only for lookups that need it, once per entry. Lookups return
+ * a GList of ProcessEntry owned by the table, free only the list.
+ */
+typedef struct _ProcessEntry ProcessEntry;
+typedef struct _ProcessTable ProcessTable;
+
+struct _ProcessEntry
+{
+  pid_t pid;
+  pid_t ppid;			/* parent process */
+  pid_t session;		/* session ID, see setsid(2) */
+  uid_t uid;			/* effective user, owner of <pid>/stat */
+
+  char name[PROCTABLE_COMM + 1]; /* comm, see prctl(PR_SET_NAME) */
+
+  gchar *exe;			/* <pid>/exe target, see proctable_exe() */
+  bool resolved;		/* exe was read (it may still be NULL) */
+};
+
+/**
+ * Public methods (proctable.c) exported in the implementation.
+ */
+ProcessTable *proctable_new (const char *root);
+ProcessTable *proctable_snapshot (void);
+void proctable_unref (ProcessTable *table);
+
+const ProcessEntry *proctable_lookup (ProcessTable *table, pid_t pid);
+const char *proctable_exe (ProcessTable *table, const ProcessEntry *entry);
+
+GList *proctable_find_name (ProcessTable *table, const char *name);
+GList *proctable_find_exe (ProcessTable *table, const char *path);
+GList *proctable_find_session (ProcessTable *table, pid_t session);
+GList *proctable_find_uid (ProcessTable *table, uid_t uid);
+
+G_END_DECLS
+
+#endif /* </PROCTABLE_H> */
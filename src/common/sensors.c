@@ -0,0 +1,313 @@
+/**
+ * Copyright (C) Generations Linux <bugs@softcraft.org>
+ * All Rights Reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "sensors.h"
+#include "util.h"
+
+extern const char *Program;	/* (public) published program name */
+
+/*
+ * sensor_step - change in display units worth showing
+ * sensor_unit
+ */
+gint
+sensor_step (SensorKind kind)
+{
+  return (kind == SENSOR_TEMPERATURE) ? 1 : (kind == SENSOR_FAN) ? 50 : 100;
+} /* </sensor_step> */
+
+const gchar *
+sensor_unit (SensorKind kind)
+{
+  return (kind == SENSOR_TEMPERATURE) ? "\302\260C" :
+         (kind == SENSOR_FAN) ? "rpm" : "MHz";
+} /* </sensor_unit> */
+
+/*
+ * sensor_read - one pread() of the input, pushed on the ring
+ */
+gboolean
+sensor_read (SensorInput *input)
+{
+  char buffer[32];
+  ssize_t length = pread(input->fd, buffer, sizeof(buffer) - 1, 0);
+  long raw;
+
+  if (length <= 0)
+    return FALSE;
+
+  buffer[length] = (char)0;
+  raw = atol(buffer);
+
+  input->value = (input->kind == SENSOR_FAN) ? raw : raw / 1000;
+
+  if (input->value > input->peak)
+    input->peak = input->value;
+
+  input->ring[(input->head + input->count) % SENSOR_SAMPLES] = input->value;
+
+  if (input->count < SENSOR_SAMPLES)
+    input->count++;
+  else
+    input->head = (input->head + 1) % SENSOR_SAMPLES;
+
+  return TRUE;
+} /* </sensor_read> */
+
+/*
+ * (private) sensor_input_new - open pathname, NULL when it does not read
+ */
+static SensorInput *
+sensor_input_new (SensorKind kind, const gchar *label, const gchar *pathname)
+{
+  SensorInput *input;
+  int fd = open(pathname, O_RDONLY | O_CLOEXEC);
+
+  if (fd < 0)
+    return NULL;
+
+  input = g_new0 (SensorInput, 1);
+  input->kind  = kind;
+  input->label = g_strdup (label);
+  input->fd    = fd;
+
+  if (!sensor_read (input)) {	/* some hwmon inputs always fail (EIO) */
+    close(fd);
+    g_free (input->label);
+    g_free (input);
+    return NULL;
+  }
+  input->band = input->value / sensor_step (kind);
+
+  vdebug (2, "sensor %s => %s (%d %s)\n", label, pathname,
+              input->value, sensor_unit (kind));
+  return input;
+} /* </sensor_input_new> */
+
+/*
+ * sensor_input_free
+ */
+void
+sensor_input_free (SensorInput *input)
+{
+  close(input->fd);
+  g_free (input->label);
+  g_free (input);
+} /* </sensor_input_free> */
+
+/*
+ * (private) sensor_compare - order inputs by kind, then label
+ */
+static gint
+sensor_compare (gconstpointer a, gconstpointer b)
+{
+  const SensorInput *one = a;
+  const SensorInput *two = b;
+
+  if (one->kind != two->kind)
+    return one->kind - two->kind;
+
+  return strcmp(one->label, two->label);
+} /* </sensor_compare> */
+
+/*
+ * (private) sensor_attribute - first line of a sysfs attribute, or NULL
+ */
+static gchar *
+sensor_attribute (const gchar *folder, const gchar *name)
+{
+  gchar *file = g_build_filename (folder, name, NULL);
+  gchar *text = NULL;
+
+  if (g_file_get_contents (file, &text, NULL, NULL))
+    g_strchomp (text);
+
+  g_free (file);
+  return text;
+} /* </sensor_attribute> */
+
+/*
+ * (private) sensor_discover_hwmon - temp*_input and fan*_input files
+ */
+static GList *
+sensor_discover_hwmon (GList *list, const gchar *root, GHashTable *names)
+{
+  gchar *classdir = g_build_filename (root, "class/hwmon", NULL);
+  GDir *dir = g_dir_open (classdir, 0, NULL);
+  const gchar *device;
+
+  while (dir && (device = g_dir_read_name (dir))) {
+    gchar *folder = g_build_filename (classdir, device, NULL);
+    gchar *chip = sensor_attribute (folder, "name");
+    GDir *attributes = g_dir_open (folder, 0, NULL);
+    const gchar *name;
+
+    if (chip == NULL)
+      chip = g_strdup (device);
+
+    g_hash_table_insert (names, g_strdup (chip), GINT_TO_POINTER(1));
+
+    while (attributes && (name = g_dir_read_name (attributes))) {
+      SensorKind kind;
+      SensorInput *input;
+      gchar *file, *label, *text, *prefix;
+
+      if (!g_str_has_suffix (name, "_input"))
+        continue;
+
+      if (strncmp(name, "temp", 4) == 0)
+        kind = SENSOR_TEMPERATURE;
+      else if (strncmp(name, "fan", 3) == 0)
+        kind = SENSOR_FAN;
+      else
+        continue;
+
+      /* temp1_input => temp1_label, when present, else "chip temp1" */
+      prefix = g_strndup (name, strlen(name) - strlen("_input"));
+      label  = g_strdup_printf ("%s_label", prefix);
+
+      if ((text = sensor_attribute (folder, label)) != NULL) {
+        g_free (label);
+        label = g_strdup_printf ("%s %s", chip, text);
+        g_free (text);
+      }
+      else {
+        g_free (label);
+        label = g_strdup_printf ("%s %s", chip, prefix);
+      }
+
+      file = g_build_filename (folder, name, NULL);
+
+      if ((input = sensor_input_new (kind, label, file)) != NULL)
+        list = g_list_prepend (list, input);
+
+      g_free (prefix);
+      g_free (label);
+      g_free (file);
+    }
+    if (attributes)
+      g_dir_close (attributes);
+
+    g_free (chip);
+    g_free (folder);
+  }
+  if (dir)
+    g_dir_close (dir);
+
+  g_free (classdir);
+  return list;
+} /* </sensor_discover_hwmon> */
+
+/*
+ * (private) sensor_discover_thermal - thermal zone temp files not seen as hwmon
+ */
+static GList *
+sensor_discover_thermal (GList *list, const gchar *root, GHashTable *names)
+{
+  gchar *classdir = g_build_filename (root, "class/thermal", NULL);
+  GDir *dir = g_dir_open (classdir, 0, NULL);
+  const gchar *zone;
+
+  while (dir && (zone = g_dir_read_name (dir))) {
+    gchar *folder, *type, *file;
+    SensorInput *input;
+
+    if (strncmp(zone, "thermal_zone", 12) != 0)
+      continue;
+
+    folder = g_build_filename (classdir, zone, NULL);
+    type = sensor_attribute (folder, "type");
+
+    /* Most zones are also registered as hwmon devices (ex. acpitz). */
+    if (type == NULL || g_hash_table_lookup (names, type) == NULL) {
+      file = g_build_filename (folder, "temp", NULL);
+
+      if ((input = sensor_input_new (SENSOR_TEMPERATURE,
+                                     (type) ? type : zone, file)) != NULL)
+        list = g_list_prepend (list, input);
+
+      g_free (file);
+    }
+    g_free (type);
+    g_free (folder);
+  }
+  if (dir)
+    g_dir_close (dir);
+
+  g_free (classdir);
+  return list;
+} /* </sensor_discover_thermal> */
+
+/*
+ * (private) sensor_discover_cpufreq - scaling_cur_freq of every cpu
+ */
+static GList *
+sensor_discover_cpufreq (GList *list, const gchar *root)
+{
+  gchar *cpudir = g_build_filename (root, "devices/system/cpu", NULL);
+  GDir *dir = g_dir_open (cpudir, 0, NULL);
+  const gchar *cpu;
+
+  while (dir && (cpu = g_dir_read_name (dir))) {
+    SensorInput *input;
+    gchar *file;
+
+    if (strncmp(cpu, "cpu", 3) != 0 || !g_ascii_isdigit (cpu[3]))
+      continue;
+
+    file = g_build_filename (cpudir, cpu, "cpufreq/scaling_cur_freq", NULL);
+
+    if ((input = sensor_input_new (SENSOR_FREQUENCY, cpu, file)) != NULL)
+      list = g_list_prepend (list, input);
+
+    g_free (file);
+  }
+  if (dir)
+    g_dir_close (dir);
+
+  g_free (cpudir);
+  return list;
+} /* </sensor_discover_cpufreq> */
+
+/*
+ * sensor_discover - find and open every input under root, once
+ */
+GList *
+sensor_discover (const gchar *root)
+{
+  GHashTable *names = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                             g_free, NULL);
+  GList *list = NULL;
+
+  list = sensor_discover_hwmon (list, root, names);
+  list = sensor_discover_thermal (list, root, names);
+  list = sensor_discover_cpufreq (list, root);
+
+  g_hash_table_destroy (names);
+
+  vdebug (1, "%s sensor: %d input(s) under %s\n", Program,
+              g_list_length (list), root);
+
+  return g_list_sort (list, sensor_compare);
+} /* </sensor_discover> */
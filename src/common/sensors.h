@@ -0,0 +1,72 @@
+/**
+ * Copyright (C) Generations Linux <bugs@softcraft.org>
+ * All Rights Reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef SENSORS_H
+#define SENSORS_H
+
+#include <glib.h>
+
+#define SENSOR_SAMPLES 32	/* ring buffer length, one sample per read */
+
+G_BEGIN_DECLS
+
+/**
+ * Public data structures.
+ *
+ * Inputs are found once under a sysfs root (hwmon temperatures and fans,
+ * thermal zones hwmon does not list, cpufreq clocks), kept open and read
+ * again with one pread() each. The root is "/sys" but for tests.
+ */
+typedef struct _SensorInput SensorInput;
+
+typedef enum
+{
+  SENSOR_TEMPERATURE,		/* millidegree Celsius => degree */
+  SENSOR_FAN,			/* revolutions per minute */
+  SENSOR_FREQUENCY		/* kHz => MHz */
+} SensorKind;
+
+struct _SensorInput
+{
+  SensorKind kind;
+  gchar *label;			/* ex. "coretemp temp1", "acpitz", "cpu0" */
+  int fd;			/* *_input file, read with pread() */
+
+  gint value;			/* latest reading in display units */
+  gint band;			/* value / step, when last shown */
+  gint peak;			/* largest reading, scale of fans and clocks */
+
+  gint ring[SENSOR_SAMPLES];	/* sparkline samples, oldest at head */
+  guint head;
+  guint count;
+};
+
+/**
+ * Public methods (sensors.c) exported in the implementation.
+ */
+GList *sensor_discover (const gchar *root);
+gboolean sensor_read (SensorInput *input);
+void sensor_input_free (SensorInput *input);
+
+gint sensor_step (SensorKind kind);
+const gchar *sensor_unit (SensorKind kind);
+
+G_END_DECLS
+
+#endif /* </SENSORS_H> */
@@ -0,0 +1,358 @@
+/**
+ * Copyright (C) Generations Linux <bugs@softcraft.org>
+ * All Rights Reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <linux/netlink.h>
+
+#include "sysevent.h"
+
+#define MOUNTINFO_FIELDS 64	/* optional tags included */
+
+/*
+* Private data structures.
+*/
+typedef struct _MountEntry MountEntry;
+
+struct _MountEntry
+{
+  gpointer item;		/* MountTable added(), NULL => none */
+  bool seen;			/* listed by the latest update */
+};
+
+/*
+* uevent_socket - non blocking socket receiving kernel uevents, or -1
+*/
+int
+uevent_socket (void)
+{
+  struct sockaddr_nl address;
+  int sock = socket(AF_NETLINK, SOCK_DGRAM | SOCK_CLOEXEC | SOCK_NONBLOCK,
+                    NETLINK_KOBJECT_UEVENT);
+
+  memset(&address, 0, sizeof(address));
+  address.nl_family = AF_NETLINK;
+  address.nl_groups = 1;	/* kernel uevents */
+
+  if (sock >= 0 &&
+      bind(sock, (struct sockaddr *)&address, sizeof(address)) < 0) {
+    close(sock);
+    sock = -1;
+  }
+  return sock;
+} /* </uevent_socket> */
+
+/*
+* uevent_value - value of key in a uevent packet, NULL when absent
+*/
+const char *
+uevent_value (const char *packet, gsize length, const char *key)
+{
+  const char *scan = packet;
+  gsize size = strlen(key);
+
+  /* The first string is the "action@devpath" header, not a pair. */
+  for (scan += strnlen(scan, length) + 1; scan < packet + length;
+       scan += strnlen(scan, packet + length - scan) + 1)
+    if (strncmp(scan, key, size) == 0 && scan[size] == '=')
+      return scan + size + 1;
+
+  return NULL;
+} /* </uevent_value> */
+
+/*
+* (private) mountinfo_unescape - decode octal escapes (ex. \040), in place
+*/
+static char *
+mountinfo_unescape (char *field)
+{
+  char *scan, *mark = field;
+
+  for (scan = field; *scan; scan++, mark++)
+    if (scan[0] == '\\' && g_ascii_isdigit(scan[1]) &&
+        g_ascii_isdigit(scan[2]) && g_ascii_isdigit(scan[3])) {
+      *mark = (scan[1] - '0') << 6 | (scan[2] - '0') << 3 | (scan[3] - '0');
+      scan += 3;
+    }
+    else {
+      *mark = *scan;
+    }
+
+  *mark = (char)0;
+  return field;
+} /* </mountinfo_unescape> */
+
+/*
+* mountinfo_parse - source and mount point of a mountinfo line, in place
+*
+* ID PARENT MAJ:MIN ROOT MOUNTPOINT OPTIONS [TAGS..] - FSTYPE SOURCE ..
+* Returns false when the line does not have that layout.
+*/
+bool
+mountinfo_parse (char *line, char **source, char **mountpoint)
+{
+  char *field[MOUNTINFO_FIELDS];
+  char *token, *state;
+  int count = 0;
+
+  for (token = strtok_r(line, " ", &state);
+       token != NULL && count < MOUNTINFO_FIELDS;
+       token = strtok_r(NULL, " ", &state))
+    field[count++] = token;
+
+  for (int idx = 6; idx + 2 < count; idx++)
+    if (strcmp(field[idx], "-") == 0) {
+      *mountpoint = mountinfo_unescape (field[4]);
+      *source = mountinfo_unescape (field[idx + 2]);
+      return true;
+    }
+
+  return false;
+} /* </mountinfo_parse> */
+
+/*
+* mount_table_new - empty MountTable
+* mount_table_free - removed() every item, free the table
+*/
+MountTable *
+mount_table_new (MountProbe probe, MountAdded added, MountRemoved removed,
+                 gpointer data)
+{
+  MountTable *table = g_new0 (MountTable, 1);
+
+  table->mounts  = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                          g_free, g_free);
+  table->capable = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                          g_free, NULL);
+  table->probe   = probe;
+  table->added   = added;
+  table->removed = removed;
+  table->data    = data;
+
+  return table;
+} /* </mount_table_new> */
+
+void
+mount_table_free (MountTable *table)
+{
+  GHashTableIter iter;
+  MountEntry *entry;
+
+  g_hash_table_iter_init (&iter, table->mounts);
+
+  while (g_hash_table_iter_next (&iter, NULL, (gpointer *)&entry))
+    if (entry->item)
+      table->removed (entry->item, table->data);
+
+  g_hash_table_destroy (table->mounts);
+  g_hash_table_destroy (table->capable);
+  g_free (table);
+} /* </mount_table_free> */
+
+/*
+* mount_table_update - apply a mountinfo text, returns items added + removed
+*
+* Mounts seen before keep their item; only new mounts are handed to
+* added(), and the items of vanished mounts to removed().
+*/
+guint
+mount_table_update (MountTable *table, const char *mountinfo)
+{
+  gchar **lines = g_strsplit (mountinfo, "\n", -1);
+  GHashTableIter iter;
+  MountEntry *entry;
+  guint changes = 0;
+  gchar **line;
+
+  for (line = lines; *line != NULL; line++) {
+    char *fsname, *mntdir;
+    gchar *key;
+
+    if (!mountinfo_parse (*line, &fsname, &mntdir))
+      continue;
+
+    key = g_strdup_printf ("%s %s", fsname, mntdir);
+
+    if ((entry = g_hash_table_lookup (table->mounts, key)) != NULL) {
+      entry->seen = true;
+      g_free (key);
+    }
+    else {
+      entry = g_new0 (MountEntry, 1);
+      entry->item = table->added (table, fsname, mntdir, table->data);
+      entry->seen = true;
+
+      if (entry->item)
+        changes++;
+
+      g_hash_table_insert (table->mounts, key, entry);
+    }
+  }
+  g_strfreev (lines);
+
+  /* Forget mounts no longer listed, ready the others for the next update. */
+  g_hash_table_iter_init (&iter, table->mounts);
+
+  while (g_hash_table_iter_next (&iter, NULL, (gpointer *)&entry))
+    if (entry->seen)
+      entry->seen = false;
+    else {
+      if (entry->item) {
+        table->removed (entry->item, table->data);
+        changes++;
+      }
+      g_hash_table_iter_remove (&iter);
+    }
+
+  return changes;
+} /* </mount_table_update> */
+
+/*
+* mount_table_capability - probe() of fsname, remembered
+*/
+guint
+mount_table_capability (MountTable *table, const char *fsname)
+{
+  gpointer word = g_hash_table_lookup (table->capable, fsname);
+
+  if (word == NULL) {
+    word = GUINT_TO_POINTER (table->probe (fsname) + 1);
+    g_hash_table_insert (table->capable, g_strdup (fsname), word);
+  }
+  return GPOINTER_TO_UINT (word) - 1;
+} /* </mount_table_capability> */
+
+/*
+* mount_table_uevent - true when the packet is about a block device
+*
+* Its capability is probed again, the device may have changed. The
+* packet is NUL terminated at length, as recv() into a larger buffer.
+*/
+bool
+mount_table_uevent (MountTable *table, const char *packet, gsize length)
+{
+  const char *subsystem = uevent_value (packet, length, "SUBSYSTEM");
+  const char *devname = uevent_value (packet, length, "DEVNAME");
+
+  if (subsystem == NULL || strcmp(subsystem, "block") != 0)
+    return false;
+
+  if (devname) {
+    gchar *fsname = g_strdup_printf ("/dev/%s", devname);
+
+    g_hash_table_remove (table->capable, fsname);
+    g_free (fsname);
+  }
+  return true;
+} /* </mount_table_uevent> */
+
+/*
+* power_supply_state - every attribute of <supply>/uevent from one pread()
+*
+* Fields not listed are left as they were. Returns false without a
+* POWER_SUPPLY_STATUS line.
+*/
+bool
+power_supply_state (int uevent, PowerSupply *supply)
+{
+  char buffer[4096];
+  ssize_t length = pread(uevent, buffer, sizeof(buffer) - 1, 0);
+  bool status = false;
+  char *line, *next;
+
+  if (length <= 0)
+    return false;
+
+  buffer[length] = (char)0;
+
+  /* older kernel versions used "energy_*" instead of "charge_*" */
+  for (line = buffer; line != NULL && *line; line = next) {
+    if ((next = strchr(line, '\n')) != NULL)
+      *next++ = (char)0;
+
+    if (strncmp(line, "POWER_SUPPLY_STATUS=", 20) == 0) {
+      supply->discharging = (strncasecmp(&line[20], "discharging", 11) == 0);
+      status = true;
+    }
+    else if (strncmp(line, "POWER_SUPPLY_CHARGE_NOW=", 24) == 0 ||
+             strncmp(line, "POWER_SUPPLY_ENERGY_NOW=", 24) == 0)
+      supply->remaining = atol(&line[24]);
+    else if (strncmp(line, "POWER_SUPPLY_CHARGE_FULL=", 25) == 0 ||
+             strncmp(line, "POWER_SUPPLY_ENERGY_FULL=", 25) == 0)
+      supply->capacity = atol(&line[25]);
+  }
+  return status;
+} /* </power_supply_state> */
+
+/*
+* (private) power_supply_line - first line of folder/name, false if none
+*/
+static bool
+power_supply_line (const char *folder, const char *name, char *line,
+                   int size)
+{
+  char pathname[FILENAME_MAX];
+  FILE *stream;
+
+  snprintf(pathname, sizeof(pathname), "%s/%s", folder, name);
+
+  if ((stream = fopen(pathname, "r")) == NULL)
+    return false;
+
+  if (fgets(line, size, stream) == NULL)
+    line[0] = (char)0;
+
+  fclose(stream);
+  return true;
+} /* </power_supply_line> */
+
+/*
+* power_supply_read - the supply of a sysfs folder, false if it has none
+*
+* From the uevent descriptor when open (see, power_supply_state), else
+* one attribute file each.
+*/
+bool
+power_supply_read (const char *folder, int uevent, PowerSupply *supply)
+{
+  char line[80];
+
+  if (uevent >= 0 && power_supply_state (uevent, supply))
+    return true;
+
+  if (!power_supply_line (folder, "status", line, sizeof(line)))
+    return false;
+
+  supply->discharging = (strncasecmp(line, "discharging", 11) == 0);
+
+  /* older kernel versions used "energy_*" instead of "charge_*" */
+  if (power_supply_line (folder, "charge_now", line, sizeof(line)) ||
+      power_supply_line (folder, "energy_now", line, sizeof(line)))
+    supply->remaining = atol(line);
+
+  if (power_supply_line (folder, "charge_full", line, sizeof(line)) ||
+      power_supply_line (folder, "energy_full", line, sizeof(line)))
+    supply->capacity = atol(line);
+
+  return true;
+} /* </power_supply_read> */
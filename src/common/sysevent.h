@@ -0,0 +1,92 @@
+/**
+ * Copyright (C) Generations Linux <bugs@softcraft.org>
+ * All Rights Reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef SYSEVENT_H
+#define SYSEVENT_H
+
+#include <stdbool.h>
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/**
+ * Public data structures.
+ */
+typedef struct _PowerSupply PowerSupply;
+
+struct _PowerSupply
+{
+  bool discharging;
+  long remaining;		/* charge (or energy) now */
+  long capacity;		/* charge (or energy) when full */
+};
+
+typedef struct _MountTable MountTable;
+
+typedef guint (*MountProbe) (const char *fsname);
+typedef gpointer (*MountAdded) (MountTable *table, const char *fsname,
+                                const char *mntdir, gpointer data);
+typedef void (*MountRemoved) (gpointer item, gpointer data);
+
+struct _MountTable
+{
+  GHashTable *mounts;		/* "fsname mntdir" => MountEntry */
+  GHashTable *capable;		/* fsname => probe() + 1 */
+
+  MountProbe probe;		/* get_device_capability(), or a fake */
+  MountAdded added;		/* item of a new mount, NULL => none */
+  MountRemoved removed;		/* item of a mount gone */
+  gpointer data;		/* of added and removed */
+};
+
+/**
+ * Public methods (sysevent.c) exported in the implementation.
+ *
+ * Kernel change notifications: packets of the NETLINK_KOBJECT_UEVENT
+ * socket, "action@devpath" then NUL separated KEY=value pairs, and the
+ * lines of /proc/self/mountinfo read again when it flags a (u)mount,
+ * and the uevent attribute file of a power supply, kept open and read
+ * again with one pread() when its uevents arrive.
+ */
+int uevent_socket (void);
+const char *uevent_value (const char *packet, gsize length, const char *key);
+
+bool power_supply_state (int uevent, PowerSupply *supply);
+bool power_supply_read (const char *folder, int uevent, PowerSupply *supply);
+
+bool mountinfo_parse (char *line, char **source, char **mountpoint);
+
+/**
+ * A MountTable keeps the mounts of the last mountinfo text: an update
+ * calls added for mounts not listed before and removed for the items of
+ * mounts no longer listed, and returns how many items came and went (0
+ * for an unchanged table). Capabilities are probed once per device,
+ * until a block uevent names it.
+ */
+MountTable *mount_table_new (MountProbe probe, MountAdded added,
+                             MountRemoved removed, gpointer data);
+void mount_table_free (MountTable *table);
+
+guint mount_table_update (MountTable *table, const char *mountinfo);
+guint mount_table_capability (MountTable *table, const char *fsname);
+bool mount_table_uevent (MountTable *table, const char *packet, gsize length);
+
+G_END_DECLS
+
+#endif /* </SYSEVENT_H> */
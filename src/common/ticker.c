@@ -0,0 +1,282 @@
+/**
+ * Copyright (C) Generations Linux <bugs@softcraft.org>
+ * All Rights Reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <sys/time.h>
+
+#include "ticker.h"
+#include "util.h"
+
+/*
+* Private data structures.
+*/
+typedef struct _Ticker Ticker;
+
+struct _Ticker
+{
+  guint id;
+  guint cadence;		/* seconds between calls */
+  gint64 due;			/* wall clock second of the next call */
+
+  GSourceFunc callback;
+  gpointer data;
+
+  bool removed;			/* ticker_remove() during dispatch */
+};
+
+static struct
+{
+  GList *tickers;
+  guint  serial;		/* last ticker id handed out */
+  guint  source;		/* GLib timeout of the next wakeup, 0 => none */
+  bool   dispatching;
+
+  GQueue *recent;		/* wakeup seconds, within the last minute */
+  gulong  wakeups;		/* wakeups since the first ticker */
+} ticker_;
+
+/*
+* (private) ticker_clock - wall clock milliseconds
+*/
+static gint64
+ticker_clock (void)
+{
+  struct timeval now;
+
+  gettimeofday (&now, NULL);
+  return (gint64)now.tv_sec * 1000 + now.tv_usec / 1000;
+} /* </ticker_clock> */
+
+/*
+* (private) ticker_align - next multiple of cadence seconds after now
+*/
+static gint64
+ticker_align (guint cadence, gint64 now)
+{
+  gint64 seconds = now / 1000;
+
+  return (seconds / cadence + 1) * cadence;
+} /* </ticker_align> */
+
+/*
+* (private) ticker_find
+*/
+static Ticker *
+ticker_find (guint id)
+{
+  GList *iter;
+
+  for (iter = ticker_.tickers; iter != NULL; iter = iter->next)
+    if (((Ticker *)iter->data)->id == id)
+      return (Ticker *)iter->data;
+
+  return NULL;
+} /* </ticker_find> */
+
+/*
+* (private) ticker_sweep - free tickers removed during dispatch
+*/
+static void
+ticker_sweep (void)
+{
+  GList *iter = ticker_.tickers;
+
+  while (iter != NULL) {
+    Ticker *ticker = (Ticker *)iter->data;
+    GList *next = iter->next;
+
+    if (ticker->removed) {
+      ticker_.tickers = g_list_delete_link (ticker_.tickers, iter);
+      g_free (ticker);
+    }
+    iter = next;
+  }
+} /* </ticker_sweep> */
+
+/*
+* (private) ticker_forget - drop wakeups older than a minute
+*/
+static void
+ticker_forget (guint now)
+{
+  while (!g_queue_is_empty (ticker_.recent) &&
+         now - GPOINTER_TO_UINT (g_queue_peek_head (ticker_.recent)) >= 60)
+    g_queue_pop_head (ticker_.recent);
+} /* </ticker_forget> */
+
+static gboolean ticker_dispatch (gpointer unused);
+
+/*
+* (private) ticker_schedule - one timeout for the earliest due ticker
+*/
+static void
+ticker_schedule (void)
+{
+  gint64 due = G_MAXINT64;
+  gint64 delay;
+  GList *iter;
+
+  if (ticker_.dispatching)	/* ticker_dispatch() reschedules */
+    return;
+
+  if (ticker_.source) {
+    g_source_remove (ticker_.source);
+    ticker_.source = 0;
+  }
+
+  for (iter = ticker_.tickers; iter != NULL; iter = iter->next) {
+    Ticker *ticker = (Ticker *)iter->data;
+
+    if (!ticker->removed && ticker->due < due)
+      due = ticker->due;
+  }
+
+  if (due == G_MAXINT64)
+    return;
+
+  delay = due * 1000 + TICKER_SLACK - ticker_clock ();
+  ticker_.source = g_timeout_add (MAX(delay, 0), ticker_dispatch, NULL);
+} /* </ticker_schedule> */
+
+/*
+* (private) ticker_dispatch - call back every ticker due
+*/
+static gboolean
+ticker_dispatch (gpointer unused)
+{
+  gint64 now = ticker_clock ();
+  GList *iter;
+
+  ticker_.source = 0;
+  ticker_.wakeups++;
+
+  if (ticker_.recent == NULL)
+    ticker_.recent = g_queue_new ();
+
+  ticker_forget ((guint)(now / 1000));
+  g_queue_push_tail (ticker_.recent, GUINT_TO_POINTER ((guint)(now / 1000)));
+  ticker_.dispatching = true;
+
+  for (iter = ticker_.tickers; iter != NULL; iter = iter->next) {
+    Ticker *ticker = (Ticker *)iter->data;
+
+    if (ticker->removed)
+      continue;
+
+    if (ticker->due * 1000 > now) {
+      /* Not due, unless the wall clock was set back meanwhile. */
+      if (ticker->due - now / 1000 > ticker->cadence)
+        ticker->due = ticker_align (ticker->cadence, now);
+      continue;
+    }
+
+    ticker->due = ticker_align (ticker->cadence, now);
+
+    if (!ticker->callback (ticker->data))
+      ticker->removed = true;
+  }
+  ticker_.dispatching = false;
+
+  ticker_sweep ();
+  ticker_schedule ();
+
+  vdebug (3, "%s %u wakeups/minute\n", __func__,
+          g_queue_get_length (ticker_.recent));
+  return FALSE;
+} /* </ticker_dispatch> */
+
+/*
+* ticker_add - call back every cadence seconds, aligned to the wall clock
+*/
+guint
+ticker_add (guint cadence, GSourceFunc callback, gpointer data)
+{
+  Ticker *ticker;
+
+  g_return_val_if_fail (cadence > 0 && callback != NULL, 0);
+
+  ticker = g_new0 (Ticker, 1);
+  ticker->id       = ++ticker_.serial;
+  ticker->cadence  = cadence;
+  ticker->due      = ticker_align (cadence, ticker_clock ());
+  ticker->callback = callback;
+  ticker->data     = data;
+
+  ticker_.tickers = g_list_append (ticker_.tickers, ticker);
+  ticker_schedule ();
+
+  vdebug (2, "%s id => %u, cadence => %us\n", __func__, ticker->id, cadence);
+  return ticker->id;
+} /* </ticker_add> */
+
+/*
+* ticker_set_cadence - change the cadence, realigned from now
+*/
+void
+ticker_set_cadence (guint id, guint cadence)
+{
+  Ticker *ticker = ticker_find (id);
+
+  if (ticker == NULL || cadence == 0 || ticker->cadence == cadence)
+    return;
+
+  ticker->cadence = cadence;
+  ticker->due = ticker_align (cadence, ticker_clock ());
+  ticker_schedule ();
+} /* </ticker_set_cadence> */
+
+/*
+* ticker_remove
+*/
+void
+ticker_remove (guint id)
+{
+  Ticker *ticker = ticker_find (id);
+
+  if (ticker == NULL)
+    return;
+
+  ticker->removed = true;
+
+  if (!ticker_.dispatching) {
+    ticker_sweep ();
+    ticker_schedule ();
+  }
+} /* </ticker_remove> */
+
+/*
+* ticker_wakeups_per_minute - timeouts dispatched in the last 60 seconds
+*/
+guint
+ticker_wakeups_per_minute (void)
+{
+  if (ticker_.recent == NULL)
+    return 0;
+
+  ticker_forget ((guint)(ticker_clock () / 1000));
+  return g_queue_get_length (ticker_.recent);
+} /* </ticker_wakeups_per_minute> */
+
+/*
+* ticker_wakeups - timeouts dispatched since the first ticker_add()
+*/
+gulong
+ticker_wakeups (void)
+{
+  return ticker_.wakeups;
+} /* </ticker_wakeups> */
@@ -0,0 +1,48 @@
+/**
+ * Copyright (C) Generations Linux <bugs@softcraft.org>
+ * All Rights Reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef TICKER_H
+#define TICKER_H
+
+#include <stdbool.h>
+#include <glib.h>
+
+#define TICKER_MINUTE 60	/* cadence of wall clock minute boundaries */
+#define TICKER_SLACK  25	/* milliseconds past the aligned second */
+
+G_BEGIN_DECLS
+
+/**
+ * Public methods (ticker.c) exported in the implementation.
+ *
+ * A ticker calls back every cadence seconds, on wall clock multiples of
+ * the cadence (a TICKER_MINUTE ticker runs at hh:mm:00), so tickers of
+ * all modules share one GLib timeout and wake the process together.
+ * The callback returns FALSE to remove the ticker, as a GSourceFunc.
+ */
+guint ticker_add (guint cadence, GSourceFunc callback, gpointer data);
+void ticker_set_cadence (guint id, guint cadence);
+void ticker_remove (guint id);
+
+guint ticker_wakeups_per_minute (void);
+gulong ticker_wakeups (void);
+
+G_END_DECLS
+
+#endif /* </TICKER_H> */
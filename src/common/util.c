@@ -28,10 +28,19 @@
 #include <unistd.h>
 #include <fcntl.h>
 #include <pwd.h>
+#include <spawn.h>
+#include <errno.h>
+#include <signal.h>
+#include <sys/syscall.h>
 
 #include "gould.h"
+#include "proctable.h"
 #include "util.h"
 
+#ifndef CLOSE_RANGE_CLOEXEC
+#define CLOSE_RANGE_CLOEXEC (1U << 2)	/* see, linux/close_range.h */
+#endif
+
 
 /*
 * Private data structures.
@@ -671,111 +680,168 @@ get_hostname(char *hostname, int len, bool full)
 
 /*
 * get_process_id - get {program} PID or -1, if not running  
+*
+* The oldest instance other than ourselves, as the pidof(8) answer was
+* read; only the first word of a command line is the program name.
 */
 pid_t
 get_process_id(const char *program)
 {
-  pid_t instance = -1;
+  ProcessTable *table = proctable_snapshot ();
+  pid_t instance = -1, self = getpid();
+  gchar *name = g_strndup (program, strcspn(program, " \t"));
+  GList *iter, *list = proctable_find_name (table, name);
 
-  char answer[MAX_COMMAND];
-  char command[MAX_COMMAND];
-  FILE *stream;
+  for (iter = list; iter != NULL; iter = iter->next) {
+    const ProcessEntry *entry = iter->data;
 
-  sprintf(command, "pidof %s", program);
-  stream = popen(command, "r");
+    if (entry->pid != self && (instance < 0 || entry->pid < instance))
+      instance = entry->pid;
+  }
+  g_list_free (list);
+  g_free (name);
 
-  if (stream) {
-    const char delim[2] = " ";
+  proctable_unref (table);
+  return instance;
+} /* </get_process_id> */
 
-    char *master, *token;
-    char self[MAX_STAMP];		  /* exclude self */
-    int mark;
+/* glibc 2.34 closes the descriptors itself, see launch() */
+#ifdef __GLIBC_PREREQ
+#if __GLIBC_PREREQ(2,34)
+#define LAUNCH_CLOSEFROM
+#endif
+#endif
 
-    fgets(answer, MAX_COMMAND, stream);	  /* answer maybe a list */
-    answer[strlen(answer) - 1] = (char)0; /* chomp newline */
+#ifndef LAUNCH_CLOSEFROM
+/*
+* (private) launch_sweep - mark descriptors above stderr close-on-exec
+*/
+static void
+launch_sweep(void)
+{
+  struct dirent *entry;
+  DIR *dir;
 
-    sprintf(self, "%d", getpid());
-    mark = strlen(self);
+#ifdef SYS_close_range
+  if (syscall(SYS_close_range, STDERR_FILENO + 1, ~0U, CLOSE_RANGE_CLOEXEC) == 0)
+    return;
+#endif
 
-    if (strncmp(answer, self, mark) == 0)
-      master = strtok(&answer[mark+1], delim);
-    else
-      master = strtok(answer, delim);
+  if ((dir = opendir("/proc/self/fd")) != NULL) {
+    int self = dirfd(dir);
 
-    if (master != NULL) {
-      for (token = master; token != NULL; ) {
-        if ((token = strtok(NULL, delim)) != NULL) {
-          if(strcmp(token, self) != 0) master = token;
-        }
-      }
-      instance = strtoul(master, NULL, 10);
+    while ((entry = readdir(dir)) != NULL) {
+      int fd = atoi(entry->d_name);
+
+      if (fd > STDERR_FILENO && fd != self)
+        fcntl(fd, F_SETFD, fcntl(fd, F_GETFD) | FD_CLOEXEC);
     }
-    fclose (stream);
+    closedir(dir);
   }
-  return instance;
-} /* </get_process_id> */
+} /* </launch_sweep> */
+#endif
 
 /*
-* system_command - execute system command
+* (private) launch_environ - environment of launched programs
 */
-pid_t
-system_command(const char *command)
+static char **
+launch_environ(void)
 {
-  pid_t pid;
+  const char *path = "PATH=/bin:/sbin:/usr/bin:/usr/bin/X11:/usr/local/bin";
+  GPtrArray *envp = g_ptr_array_new ();
+  char **scan;
 
-  if ((pid = fork()) < 0) {
-    perror("system_command: fork() failed.");
-    return -1;
-  }
+  for (scan = environ; *scan != NULL; scan++)
+    if (strncmp(*scan, "PATH=", 5) != 0)
+      g_ptr_array_add (envp, g_strdup (*scan));
+
+  g_ptr_array_add (envp, g_strdup (path));
+  g_ptr_array_add (envp, NULL);
+
+  return (char **)g_ptr_array_free (envp, FALSE);
+} /* </launch_environ> */
+
+/*
+* (private) launch - posix_spawn(3) argv in a session of its own
+*
+* glibc runs posix_spawn with clone(CLONE_VM|CLONE_VFORK), so the cost
+* does not grow with our heap the way fork() page table copies do. The
+* child gets an empty signal mask, default dispositions, and no file
+* descriptors but stdin, stdout and stderr.
+*/
+static pid_t
+launch(const char *path, char *const argv[])
+{
+  posix_spawn_file_actions_t actions;
+  posix_spawnattr_t attr;
+  short flags = POSIX_SPAWN_SETSIGMASK | POSIX_SPAWN_SETSIGDEF;
+  char **envp = launch_environ ();
+  sigset_t mask;
+  pid_t pid;
+  int status;
 
-  if (pid == 0) {		/* child process */
-    const char *path  = "/bin:/sbin:/usr/bin:/usr/bin/X11:/usr/local/bin";
-    const char *shell = "/bin/sh";
+  posix_spawn_file_actions_init(&actions);
+#ifdef LAUNCH_CLOSEFROM
+  posix_spawn_file_actions_addclosefrom_np(&actions, STDERR_FILENO + 1);
+#else
+  launch_sweep();
+#endif
 
-    char searchpath[MAX_COMMAND];
-    char *argv[4];
+  posix_spawnattr_init(&attr);
+
+  sigemptyset(&mask);		/* gsession blocks SIGCHLD */
+  posix_spawnattr_setsigmask(&attr, &mask);
+
+  sigaddset(&mask, SIGHUP);	/* ignored by gsession */
+  sigaddset(&mask, SIGINT);
+  sigaddset(&mask, SIGQUIT);
+  sigaddset(&mask, SIGPIPE);
+  sigaddset(&mask, SIGCHLD);
+  sigaddset(&mask, SIGCONT);
+  sigaddset(&mask, SIGTTIN);
+  sigaddset(&mask, SIGTTOU);
+  posix_spawnattr_setsigdefault(&attr, &mask);
+
+#ifdef POSIX_SPAWN_SETSID
+  flags |= POSIX_SPAWN_SETSID;
+#else
+  flags |= POSIX_SPAWN_SETPGROUP;	/* process group of its own */
+  posix_spawnattr_setpgroup(&attr, 0);
+#endif
+  posix_spawnattr_setflags(&attr, flags);
 
-    argv[0] = "sh";
-    argv[1] = "-c";
-    argv[2] = command;
-    argv[3] = 0;
+  status = posix_spawn(&pid, path, &actions, &attr, argv, envp);
 
-    sprintf(searchpath, "PATH=%s", path);
-    putenv(searchpath);
+  posix_spawnattr_destroy(&attr);
+  posix_spawn_file_actions_destroy(&actions);
+  g_strfreev (envp);
 
-    setsid();
-    execve(shell, argv, environ);
-    exit(127);
+  if (status != 0) {
+    errno = status;
+    perror("launch: posix_spawn() failed.");
+    return -1;
   }
   return pid;
+} /* </launch> */
+
+/*
+* system_command - execute system command
+*/
+pid_t
+system_command(const char *command)
+{
+  char *argv[] = { "sh", "-c", (char *)command, NULL };
+  return launch("/bin/sh", argv);
 } /* </system_command> */
 
 /*
-* spawn forks child process
+* spawn starts command in a child process
 */
 pid_t
 spawn (const char* command)
 {
-  pid_t pid = fork();
-
-  if (pid < 0) {
-    perror("spawn: fork() failed.");
-    return -1;
-  }
-
-  if (pid == 0) {	/* child process */
-    const char *path  = "/bin:/sbin:/usr/bin:/usr/bin/X11:/usr/local/bin";
-    const char *shell = "/bin/sh";
-
-    char searchpath[MAX_COMMAND];
-    sprintf(searchpath, "PATH=%s", path);
-    putenv(searchpath);
-
-    setsid();
-    execlp(shell, shell, "-f", "-c", command, NULL);
-    exit(0);
-  }
-  return pid;
+  char *argv[] = { "/bin/sh", "-f", "-c", (char *)command, NULL };
+  return launch("/bin/sh", argv);
 } /* </spawn> */
 
 /*
@@ -784,46 +850,44 @@ spawn (const char* command)
 char *
 get_process_name(pid_t pid)
 {
-  FILE *stream;
-  char command[MAX_LABEL], *name = NULL;
+  ProcessTable *table = proctable_snapshot ();
+  const ProcessEntry *entry = proctable_lookup (table, pid);
   static char answer[MAX_LABEL];
+  char *name = NULL;
 
-  sprintf(command, "ps -p %d -o comm=", pid);
-  stream = popen(command, "r");
-
-  if (stream) {
-    fgets(answer, MAX_LABEL, stream);
-    answer[strlen(answer) - 1] = (char)0; // chomp newline
-    if(strlen(answer) > 0) name = answer;
-    pclose(stream);
+  if (entry != NULL) {
+    g_strlcpy (answer, entry->name, MAX_LABEL);
+    name = answer;
   }
+  proctable_unref (table);
   return name;
 } /* </get_process_name> */
 
 /*
-* pidof - find process ID by name
+* pidof - find process ID by name, space separated list newest first
 */
 char *
 pidof(const char *program)
 {
-  char command[MAX_COMMAND];
   static char answer[MAX_COMMAND];
 
+  ProcessTable *table = proctable_snapshot ();
+  GList *iter, *list = proctable_find_name (table, program);
   char *pidlist = NULL;
-  FILE *stream;
+  int length = 0;
 
-  sprintf(command, "pidof %s", program);
-  stream = popen(command, "r");
+  for (iter = g_list_last (list); iter != NULL; iter = iter->prev) {
+    const ProcessEntry *entry = iter->data;
 
-  if (stream) {
-    fgets(answer, MAX_COMMAND, stream);
+    if (length + MAX_STAMP >= MAX_COMMAND)
+      break;
 
-    if (strlen(answer) > 0) {
-      answer[strlen(answer) - 1] = (char)0;	/* chomp newline */
-      pidlist = answer;
-    }
-    fclose(stream);
+    length += sprintf(&answer[length], (length) ? " %d" : "%d", entry->pid);
+    pidlist = answer;
   }
+  g_list_free (list);
+
+  proctable_unref (table);
   return pidlist;
 } /* </pidof> */
 
@@ -833,21 +897,21 @@ pidof(const char *program)
 int
 killall(const char *program, int signum)
 {
-  char *pidlist = pidof (program);
-  pid_t pid, self = getpid();
+  ProcessTable *table = proctable_snapshot ();
+  GList *iter, *list = proctable_find_name (table, program);
+  pid_t self = getpid();
   int killed = 0;
 
-  if (pidlist) {
-    const char delim[2] = " ";
-    char *token = strtok(pidlist, delim);
+  for (iter = list; iter != NULL; iter = iter->next) {
+    const ProcessEntry *entry = iter->data;
 
-    while (token != NULL) {
-      if ((pid = atoi(token)) != self) { /* will not kill {self} */
-        if(kill(pid, signum) == 0) ++killed;
-      }
-      token = strtok(NULL, delim);
+    if (entry->pid != self) {		/* will not kill {self} */
+      if(kill(entry->pid, signum) == 0) ++killed;
     }
   }
+  g_list_free (list);
+
+  proctable_unref (table);
   return killed;
 } /* </killall> */
 
@@ -93,88 +93,89 @@
 #include "icons/workspace.xpm"
 
 #include "gould.h"
+#include "iconpack.h"
 #include "xpmglyphs.h"
 
 static IconCatalog xpmglyph[] = {
-  { ICON_APPLY,		apply_xpm,	NULL },
-  { ICON_AUDIO,		audio_xpm,	NULL },
-  { ICON_BACK,		back_xpm,	NULL },
-  { ICON_BLANK,		blank_xpm,	NULL },
-  { ICON_BROKEN,	broken_xpm,	NULL },
-  { ICON_BULB,		bulb_xpm,	NULL },
-  { ICON_CAMERA,	camera_xpm,	NULL },
-  { ICON_CANCEL,	cancel_xpm,	NULL },
-  { ICON_CANCEL_PRINT,	cancel_xpm,	NULL },
-  { ICON_CANCEL_SAVE,	cancel_xpm,	NULL },
-  { ICON_CHOOSER,	chooser_xpm,	NULL },
-  { ICON_CLOSE,		close_xpm,	NULL },
-  { ICON_CUT,		cut_xpm,	NULL },
-  { ICON_DELETE,	delete_xpm,	NULL },
-  { ICON_DIRS,		dirs_xpm,	NULL },
-  { ICON_DONE,		done_xpm,	NULL },
-  { ICON_DOWN,		down_xpm,	NULL },
-  { ICON_ECLIPSE,	eclipse_xpm,	NULL },
-  { ICON_ERROR,		error_xpm,	NULL },
-  { ICON_EXEC,		exec_xpm,	NULL },
-  { ICON_EXIT,		exit_xpm,	NULL },
-  { ICON_EXPAND,	expand_xpm,	NULL },
-  { ICON_FILE,		file_xpm,	NULL },
-  { ICON_FOLDER,	folder_xpm,	NULL },
-  { ICON_FORWARD,	forward_xpm,	NULL },
-  { ICON_GENESIS,	genesis_xpm,	NULL },
-  { ICON_HALT,		exit_xpm,	NULL },
-  { ICON_HARDISK,	hardisk_xpm,	NULL },
-  { ICON_HELP,		help_xpm,	NULL },
-  { ICON_HIDDEN,	hidden_xpm,	NULL },
-  { ICON_HOME,		home_xpm,	NULL },
-  { ICON_ICONS,		icons_xpm,	NULL },
-  { ICON_IMAGE,		image_xpm,	NULL },
-  { ICON_INFO,		info_xpm,	NULL },
-  { ICON_ITEM,		item_xpm,	NULL },
-  { ICON_JAVA,		java_xpm,	NULL },
-  { ICON_LOCK,		lock_xpm,	NULL },
-  { ICON_LOGO,		logo_xpm,	NULL },
-  { ICON_LOGOUT,	logout_xpm,	NULL },
-  { ICON_MAXIMIZE,	maximize_xpm,	NULL },
-  { ICON_MINIMIZE,	minimize_xpm,	NULL },
-  { ICON_MENU,		menu_xpm,	NULL },
-  { ICON_OPEN,		open_xpm,	NULL },
-  { ICON_PACKAGE,	package_xpm,	NULL },
-  { ICON_PAINT,		paint_xpm,	NULL },
-  { ICON_PAPER,		paper_xpm,	NULL },
-  { ICON_PASTE,		paste_xpm,	NULL },
-  { ICON_PDF,		pdf_xpm,	NULL },
-  { ICON_POSTSCRIPT,	postscript_xpm,	NULL },
-  { ICON_PRINT,		print_xpm,	NULL },
-  { ICON_PRINTER,	printer_xpm,	NULL },
-  { ICON_QUESTION,	question_xpm,	NULL },
-  { ICON_QUIT,		close_xpm,	NULL },
-  { ICON_RDESKTOP,	rdesktop_xpm,	NULL },
-  { ICON_REBOOT,	reboot_xpm,	NULL },
-  { ICON_RECORD,	record_xpm,	NULL },
-  { ICON_REMOTE,	remote_xpm,	NULL },
-  { ICON_RESIZE,	resize_xpm,	NULL },
-  { ICON_RESTORE,	restore_xpm,	NULL },
-  { ICON_SAVE,		save_xpm,	NULL },
-  { ICON_SAVE_AS,	save_xpm,	NULL },
-  { ICON_SCREENSAVER,	screensaver_xpm,NULL },
-  { ICON_SETTING,	setting_xpm,	NULL },
-  { ICON_SMILE,		smile_xpm,	NULL },
-  { ICON_SNAPSHOT,	snapshot_xpm,	NULL },
-  { ICON_START,		start_xpm,	NULL },
-  { ICON_SUSPEND,	suspend_xpm,	NULL },
-  { ICON_SYMLINK,	symlink_xpm,	NULL },
-  { ICON_THUMBNAIL,	thumbnail_xpm,	NULL },
-  { ICON_TITLE,		title_xpm,	NULL },
-  { ICON_UP,		uparrow_xpm,	NULL },
-  { ICON_USBDRIVE,	usbdrive_xpm,	NULL },
-  { ICON_VIDEO,		video_xpm,	NULL },
-  { ICON_VISIBLE,	visible_xpm,	NULL },
-  { ICON_VSPACER,	vspacer_xpm,	NULL },
-  { ICON_WARNING,	warning_xpm,	NULL },
-  { ICON_WELCOME,	welcome_xpm,	NULL },
-  { ICON_WALLPAPER,	wallpaper_xpm,	NULL },
-  { ICON_WORKSPACE,	workspace_xpm,	NULL }
+  { ICON_APPLY,		apply_xpm,	NULL,	"apply.xpm" },
+  { ICON_AUDIO,		audio_xpm,	NULL,	"audio.xpm" },
+  { ICON_BACK,		back_xpm,	NULL,	"back.xpm" },
+  { ICON_BLANK,		blank_xpm,	NULL,	"blank.xpm" },
+  { ICON_BROKEN,	broken_xpm,	NULL,	"broken.xpm" },
+  { ICON_BULB,		bulb_xpm,	NULL,	"bulb.xpm" },
+  { ICON_CAMERA,	camera_xpm,	NULL,	"camera.xpm" },
+  { ICON_CANCEL,	cancel_xpm,	NULL,	"cancel.xpm" },
+  { ICON_CANCEL_PRINT,	cancel_xpm,	NULL,	"cancel.xpm" },
+  { ICON_CANCEL_SAVE,	cancel_xpm,	NULL,	"cancel.xpm" },
+  { ICON_CHOOSER,	chooser_xpm,	NULL,	"chooser.xpm" },
+  { ICON_CLOSE,		close_xpm,	NULL,	"close.xpm" },
+  { ICON_CUT,		cut_xpm,	NULL,	"cut.xpm" },
+  { ICON_DELETE,	delete_xpm,	NULL,	"delete.xpm" },
+  { ICON_DIRS,		dirs_xpm,	NULL,	"dirs.xpm" },
+  { ICON_DONE,		done_xpm,	NULL,	"done.xpm" },
+  { ICON_DOWN,		down_xpm,	NULL,	"down.xpm" },
+  { ICON_ECLIPSE,	eclipse_xpm,	NULL,	"eclipse.xpm" },
+  { ICON_ERROR,		error_xpm,	NULL,	"error.xpm" },
+  { ICON_EXEC,		exec_xpm,	NULL,	"exec.xpm" },
+  { ICON_EXIT,		exit_xpm,	NULL,	"exit.xpm" },
+  { ICON_EXPAND,	expand_xpm,	NULL,	"expand.xpm" },
+  { ICON_FILE,		file_xpm,	NULL,	"file.xpm" },
+  { ICON_FOLDER,	folder_xpm,	NULL,	"folder.xpm" },
+  { ICON_FORWARD,	forward_xpm,	NULL,	"forward.xpm" },
+  { ICON_GENESIS,	genesis_xpm,	NULL,	"genesis.xpm" },
+  { ICON_HALT,		exit_xpm,	NULL,	"exit.xpm" },
+  { ICON_HARDISK,	hardisk_xpm,	NULL,	"hardisk.xpm" },
+  { ICON_HELP,		help_xpm,	NULL,	"help.xpm" },
+  { ICON_HIDDEN,	hidden_xpm,	NULL,	"hidden.xpm" },
+  { ICON_HOME,		home_xpm,	NULL,	"home.xpm" },
+  { ICON_ICONS,		icons_xpm,	NULL,	"icons.xpm" },
+  { ICON_IMAGE,		image_xpm,	NULL,	"image.xpm" },
+  { ICON_INFO,		info_xpm,	NULL,	"info.xpm" },
+  { ICON_ITEM,		item_xpm,	NULL,	"item.xpm" },
+  { ICON_JAVA,		java_xpm,	NULL,	"java.xpm" },
+  { ICON_LOCK,		lock_xpm,	NULL,	"lock.xpm" },
+  { ICON_LOGO,		logo_xpm,	NULL,	"logo.xpm" },
+  { ICON_LOGOUT,	logout_xpm,	NULL,	"logout.xpm" },
+  { ICON_MAXIMIZE,	maximize_xpm,	NULL,	"maximize.xpm" },
+  { ICON_MINIMIZE,	minimize_xpm,	NULL,	"minimize.xpm" },
+  { ICON_MENU,		menu_xpm,	NULL,	"menu.xpm" },
+  { ICON_OPEN,		open_xpm,	NULL,	"open.xpm" },
+  { ICON_PACKAGE,	package_xpm,	NULL,	"package.xpm" },
+  { ICON_PAINT,		paint_xpm,	NULL,	"paint.xpm" },
+  { ICON_PAPER,		paper_xpm,	NULL,	"paper.xpm" },
+  { ICON_PASTE,		paste_xpm,	NULL,	"paste.xpm" },
+  { ICON_PDF,		pdf_xpm,	NULL,	"pdf.xpm" },
+  { ICON_POSTSCRIPT,	postscript_xpm,	NULL,	"postscript.xpm" },
+  { ICON_PRINT,		print_xpm,	NULL,	"print.xpm" },
+  { ICON_PRINTER,	printer_xpm,	NULL,	"printer.xpm" },
+  { ICON_QUESTION,	question_xpm,	NULL,	"question.xpm" },
+  { ICON_QUIT,		close_xpm,	NULL,	"close.xpm" },
+  { ICON_RDESKTOP,	rdesktop_xpm,	NULL,	"rdesktop.xpm" },
+  { ICON_REBOOT,	reboot_xpm,	NULL,	"reboot.xpm" },
+  { ICON_RECORD,	record_xpm,	NULL,	"record.xpm" },
+  { ICON_REMOTE,	remote_xpm,	NULL,	"remote.xpm" },
+  { ICON_RESIZE,	resize_xpm,	NULL,	"resize.xpm" },
+  { ICON_RESTORE,	restore_xpm,	NULL,	"restore.xpm" },
+  { ICON_SAVE,		save_xpm,	NULL,	"save.xpm" },
+  { ICON_SAVE_AS,	save_xpm,	NULL,	"save.xpm" },
+  { ICON_SCREENSAVER,	screensaver_xpm,NULL,	"screensaver.xpm" },
+  { ICON_SETTING,	setting_xpm,	NULL,	"setting.xpm" },
+  { ICON_SMILE,		smile_xpm,	NULL,	"smile.xpm" },
+  { ICON_SNAPSHOT,	snapshot_xpm,	NULL,	"snapshot.xpm" },
+  { ICON_START,		start_xpm,	NULL,	"start.xpm" },
+  { ICON_SUSPEND,	suspend_xpm,	NULL,	"suspend.xpm" },
+  { ICON_SYMLINK,	symlink_xpm,	NULL,	"symlink.xpm" },
+  { ICON_THUMBNAIL,	thumbnail_xpm,	NULL,	"thumbnail.xpm" },
+  { ICON_TITLE,		title_xpm,	NULL,	"title.xpm" },
+  { ICON_UP,		uparrow_xpm,	NULL,	"uparrow.xpm" },
+  { ICON_USBDRIVE,	usbdrive_xpm,	NULL,	"usbdrive.xpm" },
+  { ICON_VIDEO,		video_xpm,	NULL,	"video.xpm" },
+  { ICON_VISIBLE,	visible_xpm,	NULL,	"visible.xpm" },
+  { ICON_VSPACER,	vspacer_xpm,	NULL,	"vspacer.xpm" },
+  { ICON_WARNING,	warning_xpm,	NULL,	"warning.xpm" },
+  { ICON_WELCOME,	welcome_xpm,	NULL,	"welcome.xpm" },
+  { ICON_WALLPAPER,	wallpaper_xpm,	NULL,	"wallpaper.xpm" },
+  { ICON_WORKSPACE,	workspace_xpm,	NULL,	"workspace.xpm" }
 };
 
 /*
@@ -198,36 +199,117 @@ xpm_icon(IconIndex index, GdkBitmap **mask, GdkColor *backdrop)
 } /* </xpm_icon> */
 
 /*
-* xpm_pixbuf produce a GdkPixbuf using given IconIndex
+* Glyph pixbuf cache, (index, size, backdrop) => GdkPixbuf decoded client
+* side. Built lazily; a repeated request is a lookup and a reference, no
+* X traffic. Used from the main thread only, like the rest of GTK.
 */
-GdkPixbuf *
-xpm_pixbuf(IconIndex index, GdkColor *backdrop)
+static GHashTable *glyphcache_ = NULL;
+
+/*
+* (private) xpm_glyph_decode - XPM data flattened over the backdrop color
+*
+* A size > 0 is only served pre-rendered from the icon bundle, NULL when
+* it is not there; size 0 (natural size) falls back to the XPM data.
+*/
+static GdkPixbuf *
+xpm_glyph_decode (IconIndex index, gint size, const GdkColor *color)
 {
-  GdkBitmap *mask = NULL;
-  GdkPixmap *pixmap;
+  GdkPixbuf *image, *pixbuf;
   gint width, height;
 
-  pixmap = xpm_icon(index, &mask, backdrop);
-  gdk_drawable_get_size(pixmap, &width, &height);
+  /* Pre-rendered in the icon bundle, else parse the XPM data. */
+  if ((image = iconpack_pixbuf (xpmglyph[index].name, size)) == NULL) {
+    if (size > 0)
+      return NULL;
+
+    image = gdk_pixbuf_new_from_xpm_data ((const char **)xpmglyph[index].data);
+  }
+
+  if (image == NULL)
+    return NULL;
+
+  width  = gdk_pixbuf_get_width (image);
+  height = gdk_pixbuf_get_height (image);
+
+  /* Transparent pixels take the backdrop, as the server pixmap did. */
+  pixbuf = gdk_pixbuf_new (GDK_COLORSPACE_RGB, FALSE, 8, width, height);
+  gdk_pixbuf_fill (pixbuf, (guint32)(color->red   >> 8) << 24 |
+                           (guint32)(color->green >> 8) << 16 |
+                           (guint32)(color->blue  >> 8) << 8 | 0xff);
+
+  gdk_pixbuf_composite (image, pixbuf, 0, 0, width, height,
+                        0, 0, 1.0, 1.0, GDK_INTERP_NEAREST, 255);
+  g_object_unref (image);
+
+  return pixbuf;
+} /* </xpm_glyph_decode> */
 
-  return gdk_pixbuf_get_from_drawable(NULL, pixmap,
-                                      gtk_widget_get_default_colormap(),
-                                      0, 0, 0, 0, width, height);
+/*
+* (private) xpm_glyph - cached glyph, width and height <= 0 => natural size
+*/
+static GdkPixbuf *
+xpm_glyph (IconIndex index, gint width, gint height, GdkColor *backdrop)
+{
+  GtkStyle  *style = gtk_widget_get_default_style();
+  GdkColor  *color = (backdrop) ? backdrop : &style->bg[GTK_STATE_NORMAL];
+  GdkPixbuf *pixbuf;
+  gchar key[48];
+
+  if (glyphcache_ == NULL)
+    glyphcache_ = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                         g_free, g_object_unref);
+
+  if (width <= 0 && height <= 0)
+    width = height = -1;
+
+  sprintf(key, "%d:%dx%d:%04x%04x%04x", index, width, height,
+                color->red, color->green, color->blue);
+
+  if ((pixbuf = g_hash_table_lookup (glyphcache_, key)) == NULL) {
+    if (width > 0 || height > 0) {
+      /* Bundled at the sizes the panel is configured for, else scaled. */
+      if (width == height)
+        pixbuf = xpm_glyph_decode (index, width, color);
+
+      if (pixbuf == NULL) {
+        GdkPixbuf *image = xpm_glyph (index, -1, -1, color);
+
+        if (image == NULL)
+          return NULL;
+
+        pixbuf = gdk_pixbuf_scale_simple (image, width, height,
+                                          GDK_INTERP_BILINEAR);
+        g_object_unref (image);
+      }
+    }
+    else {
+      pixbuf = xpm_glyph_decode (index, 0, color);
+    }
+
+    if (pixbuf == NULL)
+      return NULL;
+
+    g_hash_table_insert (glyphcache_, g_strdup (key), pixbuf);
+  }
+  return g_object_ref (pixbuf);
+} /* </xpm_glyph> */
+
+/*
+* xpm_pixbuf produce a GdkPixbuf using given IconIndex
+*
+* The pixbuf is shared with the glyph cache: callers may unref it,
+* but must not draw into it.
+*/
+GdkPixbuf *
+xpm_pixbuf(IconIndex index, GdkColor *backdrop)
+{
+  return xpm_glyph (index, -1, -1, backdrop);
 } /* </xpm_pixbuf> */
 
 GdkPixbuf *
 xpm_pixbuf_scale(IconIndex index, gint width, gint height, GdkColor *backdrop)
 {
-  GdkPixbuf *render = xpm_pixbuf (index, backdrop);
-
-  if (width > 0 || height > 0) {
-    GdkPixbuf *pixbuf = gdk_pixbuf_scale_simple (render, width, height,
-                                                   GDK_INTERP_BILINEAR);
-    g_object_unref (render);
-
-    return pixbuf;
-  }
-  return render;
+  return xpm_glyph (index, width, height, backdrop);
 } /* </xpm_pixbuf_scale> */
 
 /*
@@ -116,6 +116,7 @@ typedef struct {
   IconIndex   index;
   char      **data;
   GdkPixmap  *pixmap;
+  const char *name;	/* icons/{name}, see iconpack.h */
 } IconCatalog;
 
 
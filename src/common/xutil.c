@@ -100,13 +100,13 @@ static GHashTable *atoms_ = NULL;
 
 /*
 * initialize_properties needs to be called once to initialize X properties
-* xintern is a wrapper for XInternAtom
+* xintern is a wrapper for XInternAtom, remembering atoms by name
 */
 static inline Atom
 xintern (Display *display, const char *name)
 {
   Atom atom = XInternAtom(display, name, False);
-  g_hash_table_insert (atoms_, GUINT_TO_POINTER (atom), (gpointer)name);
+  g_hash_table_insert (atoms_, g_strdup (name), GSIZE_TO_POINTER (atom));
   return atom;
 } /* </xintern> */
 
@@ -114,7 +114,7 @@ static void
 initialize_properties (Display *dpy)
 {
   if (atoms_ == NULL)			/* sanity check */
-    atoms_ = g_hash_table_new (NULL, NULL);
+    atoms_ = g_hash_table_new (g_str_hash, g_str_equal);
 
   _WM_CLASS                     = xintern(dpy, "WM_CLASS");
 
@@ -176,7 +176,7 @@ initialize_properties (Display *dpy)
   _NET_WORKAREA                 = xintern(dpy, "_NET_WORKAREA");
 
   _UTF8_STRING                  = xintern(dpy, "UTF8_STRING");
-  _XROOTPMAP_ID                 = xintern(dpy, "XROOTPMAP_ID");
+  _XROOTPMAP_ID                 = xintern(dpy, "_XROOTPMAP_ID");
 } /* </initialize_properties> */
 
 /*
@@ -463,17 +463,17 @@ WindowTaskbarFilter (Window xid, int desktop)
 Atom
 get_atom_property (const char *name)
 {
-  Atom atom, prop;
+  gpointer atom;
 
   if (initialize_) {
     initialize_properties (gdk_display);
     initialize_ = false;
   }
 
-  atom = g_hash_table_lookup (atoms_, name);
-  prop = (prop != NULL) ? prop : xintern (gdk_display, name);
+  if ((atom = g_hash_table_lookup (atoms_, name)) != NULL)
+    return (Atom)GPOINTER_TO_SIZE (atom);
 
-  return prop;
+  return xintern (gdk_display, name);
 } /* </get_atom_property> */
 
 /*
@@ -730,6 +730,38 @@ get_window_pixmap (Window xid)
   return pixmap;
 } /* </get_window_pixmap> */
 
+/*
+* get_window_pixmap_thumbnail - small copy of pixmap published by its setter
+*
+* Returns NULL unless the ROOTPMAP_THUMB property describes pixmap, the
+* caller should then fall back on reading back the pixmap itself.
+*/
+GdkPixbuf *
+get_window_pixmap_thumbnail (Window xid, Pixmap pixmap)
+{
+  GdkPixbuf *value = NULL;
+  gulong *data;
+  int count;
+
+  data = get_xprop_atom (xid, get_atom_property (ROOTPMAP_THUMB),
+                         XA_CARDINAL, &count);
+  if (data) {
+    if (count > 3 && data[0] == pixmap &&
+        data[1] > 0 && data[2] > 0 && count == 3 + data[1] * data[2]) {
+      int cols = data[1];
+      int rows = data[2];
+      guchar *pix = argbdata_to_pixdata (data + 3, cols * rows);
+
+      if (pix)
+        value = gdk_pixbuf_new_from_data (pix, GDK_COLORSPACE_RGB, TRUE,
+                                          8, cols, rows, cols * 4,
+                                          free_pixels, NULL);
+    }
+    XFree (data);
+  }
+  return value;
+} /* </get_window_pixmap_thumbnail> */
+
 /*
 * get_window_class - obtain the given window application class group
 */
@@ -28,6 +28,10 @@
 
 #define X_MAXBYTES 65536  /* XGetWindowProperty long_length parameter */
 
+/* Root background thumbnail: CARDINAL[] { pixmap, width, height, ARGB... } */
+#define ROOTPMAP_THUMB       "_GOULD_ROOTPMAP_THUMB"
+#define ROOTPMAP_THUMB_WIDTH 256
+
 G_BEGIN_DECLS
 /*
 * Data structures declaration.
@@ -129,6 +133,7 @@ const gchar *get_window_icon_name (Window xid);
 const gchar *get_window_name (Window xid);
 
 Pixmap get_window_pixmap (Window xid);
+GdkPixbuf *get_window_pixmap_thumbnail (Window xid, Pixmap pixmap);
 
 bool get_window_state (Window xid, XWindowState *xws);
 bool get_window_type (Window xid, XWindowType *xwt);
@@ -69,6 +69,7 @@ struct _DesktopItem {
 };
 
 struct _DesktopSettings {
+  DockletCanvas *canvas;	/* shared canvas, <desktop canvas="yes"> */
   GtkWidget *preview;		/* shortcut preview pane */
   GlobalPanel *panel;		/* GlobalPanel instance */
   GHashTable *filehash;		/* GKeyFile(s) hash table */
@@ -435,9 +436,7 @@ desktop_settings_apply(GtkWidget *button, GlobalPanel *panel)
     if (desktop_shortcut_remove (desktop->node) == true) {
       if(docklet == NULL) docklet = desktop->node->widget; /* beware: hack */
 
-      gtk_widget_destroy (docklet->window);  /* remove from screen display */
-      g_object_ref_sink (docklet);	     /* clean-up memory */
-      g_object_unref (docklet);
+      docklet_destroy (docklet);	/* remove from screen display */
 
       saveconfig (panel);  /* coup d'tat */
     }
@@ -1234,7 +1233,7 @@ desktop_sync_with_desktop_folder(GlobalPanel *panel)
 					       xpos, ypos, iconpath,
 					       entry->name, font,
 					       NULL, NULL, false);
-      gtk_widget_show (docklet->window);
+      docklet_show (docklet);
 
       changes += 1;
     }
@@ -1274,6 +1273,7 @@ desktop_config(GlobalPanel *panel, bool once)
   gchar *name;
 
   gchar *init  = configuration_attrib(node, "init");
+  gchar *layer = configuration_attrib(node, "canvas");
   gchar *value = configuration_attrib(node, "iconsize");
 
   /* Prefer the iconsize for <desktop> */
@@ -1286,6 +1286,17 @@ desktop_config(GlobalPanel *panel, bool once)
   if (once) {
     desktop_populate_filehash (panel);
     settings_.nodehash = g_hash_table_new (g_str_hash, g_str_equal);
+
+    /* Draw all shortcuts on one desktop window, instead of one each. */
+    if (layer && strcasecmp(layer, "yes") == 0) {
+      settings_.canvas = docklet_canvas_new ();
+
+      if (panel->green)
+        g_signal_connect_swapped (G_OBJECT (panel->green),
+                                  "background-changed",
+                                  G_CALLBACK (docklet_canvas_refresh),
+                                  settings_.canvas);
+    }
   }
 
   for (; node != mark && node != NULL; node = node->next) {
@@ -1345,7 +1356,7 @@ desktop_config(GlobalPanel *panel, bool once)
 						   xpos, ypos, icon,
 						   name, font, NULL,
 						   NULL, false);
-          gtk_widget_show (docklet->window);
+          docklet_show (docklet);
 
           vdebug(2, "%s name => %s, icon => %s, sha1 => %s, node => 0x%lx\n",
 			__func__, name, icon, ident, node);
@@ -1363,7 +1374,8 @@ desktop_config(GlobalPanel *panel, bool once)
 
     if (init) {			/* init before g_file_monitor_directory */
       desktop->init = init;
-      gpanel_dispatch (panel->session, init);
+      gpanel_dispatch_async (panel->session, init,
+                             _SIGALRM_GRACETIME * 1000, NULL, NULL);
     }
     desktop->step  = step;	/* used to position next shortcut */
     panel->desktop = desktop;
@@ -1406,19 +1418,30 @@ desktop_shortcut_new(GlobalPanel *panel,
 		     GdkColor *fg,
 		     bool shadow)
 {
-  Docklet *docklet = docklet_new (GDK_WINDOW_TYPE_HINT_NORMAL,
+  Docklet *docklet;
+
+  if (settings_.canvas)
+    docklet = docklet_canvas_add (settings_.canvas,
                                   width, height, xpos, ypos,
                                   GTK_ORIENTATION_VERTICAL,
-                                  GTK_VISIBILITY_NONE,
                                   icon, text, font,
                                   bg, fg, shadow);
+  else {
+    docklet = docklet_new (GDK_WINDOW_TYPE_HINT_NORMAL,
+                           width, height, xpos, ypos,
+                           GTK_ORIENTATION_VERTICAL,
+                           GTK_VISIBILITY_NONE,
+                           icon, text, font,
+                           bg, fg, shadow);
+
+    gtk_window_set_keep_below (GTK_WINDOW(docklet->window), TRUE);
+  }
 
   docklet->editable = settings_.editable; /* should be configurable? */
   node->widget = docklet;		  /* mutual reference */
   node->data   = panel;			  /* class reflection */
 
   docklet_set_callback (docklet, (gpointer)desktop_shortcut_callback, node);
-  gtk_window_set_keep_below (GTK_WINDOW(docklet->window), TRUE);
 
   return docklet;
 } /* </desktop_shortcut_new> */
@@ -1484,7 +1507,7 @@ desktop_shortcut_create(GlobalPanel *panel, const char *ident)
 					   xpos, ypos, iconpath,
 					   name, font, NULL, NULL,
 					   false);
-  gtk_widget_show (docklet->window);
+  docklet_show (docklet);
 
   return true;
 } /* </desktop_shortcut_create> */
@@ -1527,69 +1550,9 @@ desktop_shortcut_remove(ConfigurationNode *node)
 GdkPixbuf *
 desktop_shortcut_render (GdkPixbuf *piximg, const char *label)
 {
-  const char *font = DesktopFont[settings_.fontsel];
-
-  GtkWidget *canvas = settings_.preview;
-  GdkWindow *gdkwindow = gtk_widget_get_window (canvas);
-  GdkColormap *colormap = gdk_colormap_get_system ();
-  GdkGC *gc = gdk_gc_new (gdkwindow);
-
-  PangoFontDescription *fontdesc = pango_font_description_from_string (font);
-  PangoLayout *layout = gtk_widget_create_pango_layout (canvas, label);
-
-  GdkPixmap *pixmap;
-  GdkPixbuf *render;	/* resulting pixbuf */
-
-  GdkColor black, white;
-  GdkColor *bg = NULL;  /* transparent */
-  GdkColor *fg;
-
-  gint16 iconsize = gdk_pixbuf_get_width (piximg);
-  gint16 wrap = 3 * iconsize / 2;
-  gint width, height;
-  gint xsize, ysize;
-  gint xpos, ypos;
-
-  /* Set font according to the PangoFontDescription. */
-  pango_layout_set_font_description (layout, fontdesc);
-  pango_font_description_free (fontdesc);
-
-  /* Obtain the pixel width and height of the text. */
-  pango_layout_get_pixel_size (layout, &xsize, &ysize);
-
-  pango_layout_set_width (layout, wrap * PANGO_SCALE);
-  pango_layout_set_wrap (layout, PANGO_WRAP_WORD_CHAR);
-
-  xpos = (xsize > iconsize) ? (xsize-iconsize) / 2 : -1;
-  width = (xsize > iconsize) ? xsize : iconsize;
-  height = iconsize + ysize;
-
-  /* Create a pixmap for the drawing area. */
-  render = xpm_pixbuf_scale (ICON_BLANK, width, height, NULL);
-  gdk_pixbuf_render_pixmap_and_mask (render, &pixmap, NULL, 255);
-
-  /* Draw the image pixbuf passed. */
-  gdk_draw_pixbuf (pixmap, gc, piximg, 0, 0,
-		   xpos, 0, -1, -1, GDK_RGB_DITHER_NORMAL, 0 , 0);
-
-  /* Draw the label text passed. */
-  gdk_color_black (colormap, &black);
-  gdk_color_white (colormap, &white);
-  fg = &white;
-
-  xpos = (iconsize > xsize) ? (iconsize-xsize) / 2 : -1;
-  ypos = iconsize;
-
-  gdk_draw_layout_with_colors (pixmap, gc, xpos, ypos, layout, fg, bg);
-  //gdk_draw_layout (pixmap, gc, xpos, ypos, layout);
-
-  /* Convert drawable to a pixbuf. */
-  render = gdk_pixbuf_get_from_drawable(NULL, pixmap, colormap,
-                                        0, 0, 0, 0, -1, -1);
-  g_object_unref (pixmap);
-  g_object_unref (gc);
-
-  return render;
+  return gpanel_shortcut_render (settings_.preview,
+                                 DesktopFont[settings_.fontsel],
+                                 piximg, label);
 } /* </desktop_shortcut_render> */
 
 /*
@@ -0,0 +1,640 @@
+/**
+ * Copyright (C) Generations Linux <bugs@softcraft.org>
+ * All Rights Reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "gould.h"      /* common package declarations */
+#include "gpanel.h"
+#include "gsession.h"
+
+#include <fcntl.h>
+#include <poll.h>
+#include <errno.h>
+#include <signal.h>
+#include <time.h>
+
+extern const char *Program;	/* see, gpanel.c */
+
+/*
+* Private data structures.
+*
+* Requests wait in one queue, in the order sent, until gsession answers
+* with the same id. Only requests no byte of which reached gsession are
+* resent after a reconnect, or spawned here when gsession is gone.
+*/
+typedef struct _DispatchRequest DispatchRequest;
+typedef struct _DispatchWait    DispatchWait;
+
+struct _DispatchRequest
+{
+  guint32 id;
+  gchar *command;
+  GString *frame;		/* SessionFrame and command, as written */
+
+  GpanelDispatchReply callback;	/* NULL => fire and forget */
+  gpointer data;
+
+  guint timer;			/* per request timeout source */
+  gboolean sent;		/* all of frame was written */
+  gboolean expired;		/* answered -1, reply no longer awaited */
+};
+
+struct _DispatchWait		/* see, gpanel_dispatch() */
+{
+  gboolean done;
+  pid_t pid;
+};
+
+static struct
+{
+  int fd;			/* framed gsession connection, -1 => none */
+  guint watch;			/* G_IO_IN source */
+  guint writer;			/* G_IO_OUT source while output is pending */
+
+  GQueue *pending;		/* DispatchRequest, in id order */
+  gsize offset;			/* bytes written of the first unsent request */
+
+  gchar input[sizeof(SessionFrame) + _GSESSION_MESSAGE_MAX];
+  gsize inlen;
+
+  guint32 serial;		/* last request id */
+} dispatch_ = { -1 };
+
+static struct			/* see, gpanel_dispatch_urgent() */
+{
+  char frame[sizeof(SessionFrame) + _GSESSION_MESSAGE_MAX];
+  size_t length;		/* 0 => nothing prepared */
+  char *argv[5];		/* the same command, without gsession */
+} urgent_;
+
+static gboolean dispatch_input (GIOChannel *, GIOCondition, gpointer);
+static gboolean dispatch_output (GIOChannel *, GIOCondition, gpointer);
+
+/*
+* (private) dispatch_clock - monotonic milliseconds
+*/
+static glong
+dispatch_clock (void)
+{
+  struct timespec now;
+
+  clock_gettime (CLOCK_MONOTONIC, &now);
+  return now.tv_sec * 1000 + now.tv_nsec / 1000000;
+} /* </dispatch_clock> */
+
+/*
+* (private) dispatch_finish - report pid, release the request
+*/
+static void
+dispatch_finish (DispatchRequest *request, pid_t pid)
+{
+  vdebug(2, "%s: [%u] %s => %d\n", __func__, request->id,
+			request->command, pid);
+
+  if (request->timer)
+    g_source_remove (request->timer);
+
+  if (request->callback)
+    request->callback (pid, request->data);
+
+  g_string_free (request->frame, TRUE);
+  g_free (request->command);
+  g_free (request);
+} /* </dispatch_finish> */
+
+/*
+* (private) dispatch_find - pending request of id, or NULL
+*/
+static DispatchRequest *
+dispatch_find (guint32 id)
+{
+  GList *iter;
+
+  for (iter = dispatch_.pending->head; iter != NULL; iter = iter->next)
+    if (((DispatchRequest *)iter->data)->id == id)
+      return iter->data;
+
+  return NULL;
+} /* </dispatch_find> */
+
+/*
+* (private) dispatch_connect - framed connection to gsession
+*
+* The first call adopts stream, the connection made at start up, which
+* has not spoken yet. Later ones, after gsession went away, reconnect.
+*/
+static gboolean
+dispatch_connect (int stream)
+{
+  struct sockaddr_un address;
+  GIOChannel *channel;
+  static gboolean adopted = FALSE;
+
+  if (dispatch_.fd >= 0)
+    return TRUE;
+
+  if (!adopted && stream >= 0)
+    dispatch_.fd = stream;
+  else {
+    int fd = socket(PF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+
+    memset(&address, 0, sizeof(struct sockaddr_un));
+    address.sun_family = AF_UNIX;
+    snprintf(address.sun_path, UNIX_PATH_MAX, "%s", _GSESSION);
+
+    if (fd >= 0 && connect(fd, (struct sockaddr *)&address,
+                           sizeof(struct sockaddr_un)) < 0) {
+      vdebug(1, "%s: connect %s, errno => %d\n", __func__, _GSESSION, errno);
+      close(fd);
+      fd = -1;
+    }
+    dispatch_.fd = fd;
+  }
+  adopted = TRUE;
+
+  if (dispatch_.fd < 0)
+    return FALSE;
+
+  fcntl(dispatch_.fd, F_SETFL, fcntl(dispatch_.fd, F_GETFL) | O_NONBLOCK);
+  dispatch_.inlen  = 0;
+  dispatch_.offset = 0;
+
+  channel = g_io_channel_unix_new (dispatch_.fd);
+  dispatch_.watch = g_io_add_watch (channel, G_IO_IN | G_IO_HUP | G_IO_ERR,
+                                    dispatch_input, NULL);
+  g_io_channel_unref (channel);
+
+  return TRUE;
+} /* </dispatch_connect> */
+
+/*
+* (private) dispatch_flush - write unsent requests, as the socket allows
+*/
+static gboolean
+dispatch_flush (void)
+{
+  GList *iter, *next;
+
+  for (iter = dispatch_.pending->head; iter != NULL; iter = next) {
+    DispatchRequest *request = iter->data;
+    ssize_t nbytes;
+
+    next = iter->next;
+
+    if (request->sent)
+      continue;
+
+    nbytes = send(dispatch_.fd, request->frame->str + dispatch_.offset,
+                  request->frame->len - dispatch_.offset, MSG_NOSIGNAL);
+
+    if (nbytes < 0) {
+      if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+        return FALSE;
+      nbytes = 0;
+    }
+
+    if ((dispatch_.offset += nbytes) < request->frame->len) {
+      if (dispatch_.writer == 0) {
+        GIOChannel *channel = g_io_channel_unix_new (dispatch_.fd);
+        dispatch_.writer = g_io_add_watch (channel, G_IO_OUT,
+                                           dispatch_output, NULL);
+        g_io_channel_unref (channel);
+      }
+      return TRUE;
+    }
+    request->sent = TRUE;
+    dispatch_.offset = 0;
+
+    if (request->expired) {	/* was written only to keep the stream whole */
+      g_queue_delete_link (dispatch_.pending, iter);
+      dispatch_finish (request, -1);
+    }
+  }
+  return TRUE;
+} /* </dispatch_flush> */
+
+/*
+* (private) dispatch_close - drop the connection and its watches
+*/
+static void
+dispatch_close (void)
+{
+  if (dispatch_.watch) g_source_remove (dispatch_.watch);
+  if (dispatch_.writer) g_source_remove (dispatch_.writer);
+  close(dispatch_.fd);
+
+  dispatch_.watch  = 0;
+  dispatch_.writer = 0;
+  dispatch_.fd = -1;
+} /* </dispatch_close> */
+
+/*
+* (private) dispatch_abandon - answer what the lost connection carried
+*
+* Requests gsession may have seen are answered with -1 rather than run
+* twice. The others stay for a new connection, unless local, when they
+* are spawned here.
+*/
+static void
+dispatch_abandon (gboolean local)
+{
+  gboolean partial = (dispatch_.offset > 0);
+  GList *iter, *next;
+
+  for (iter = dispatch_.pending->head; iter != NULL; iter = next) {
+    DispatchRequest *request = iter->data;
+    gboolean sent = request->sent;
+    next = iter->next;
+
+    if (sent || partial || request->expired) {
+      g_queue_delete_link (dispatch_.pending, iter);
+      dispatch_finish (request, -1);
+    }
+    else if (local) {
+      g_queue_delete_link (dispatch_.pending, iter);
+      dispatch_finish (request, spawn (request->command));
+    }
+    if (!sent)			/* only the first unsent may be partial */
+      partial = FALSE;
+  }
+  dispatch_.offset = 0;
+} /* </dispatch_abandon> */
+
+/*
+* (private) dispatch_disconnect - connection lost, reconnect or spawn here
+*/
+static void
+dispatch_disconnect (void)
+{
+  vdebug(1, "%s: lost %s connection\n", Program, _GSESSION);
+
+  dispatch_close ();
+  dispatch_abandon (FALSE);
+
+  if (g_queue_is_empty (dispatch_.pending))
+    return;
+
+  if (dispatch_connect (-1)) {
+    if (dispatch_flush ())
+      return;
+
+    vdebug(1, "%s: lost %s connection again\n", Program, _GSESSION);
+    dispatch_close ();		/* what it took is answered -1 */
+  }
+  dispatch_abandon (TRUE);	/* gsession is gone */
+} /* </dispatch_disconnect> */
+
+/*
+* (private) dispatch_read - read and answer every complete reply
+*/
+static gboolean
+dispatch_read (void)
+{
+  ssize_t nbytes;
+
+  while ((nbytes = read(dispatch_.fd, dispatch_.input + dispatch_.inlen,
+                        sizeof(dispatch_.input) - dispatch_.inlen)) > 0) {
+    dispatch_.inlen += nbytes;
+
+    while (dispatch_.inlen >= sizeof(SessionFrame)) {
+      DispatchRequest *request;
+      char reply[MAX_COMMAND];
+      SessionFrame frame;
+      gsize size;
+
+      memcpy(&frame, dispatch_.input, sizeof(SessionFrame));
+
+      if (memcmp(frame.magic, _GSESSION_MAGIC, sizeof(frame.magic)) != 0 ||
+          frame.length > _GSESSION_MESSAGE_MAX)
+        return FALSE;
+
+      if (dispatch_.inlen < sizeof(SessionFrame) + frame.length)
+        break;
+
+      size = MIN(frame.length, MAX_COMMAND - 1);
+      memcpy(reply, dispatch_.input + sizeof(SessionFrame), size);
+      reply[size] = (char)0;
+      size = sizeof(SessionFrame) + frame.length;
+
+      memmove(dispatch_.input, dispatch_.input + size, dispatch_.inlen - size);
+      dispatch_.inlen -= size;
+
+      if ((request = dispatch_find (frame.id)) != NULL) {
+        g_queue_remove (dispatch_.pending, request);
+        dispatch_finish (request, atoi(reply));
+      }
+    }
+  }
+  return (nbytes < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR));
+} /* </dispatch_read> */
+
+/*
+* (private) dispatch_input - G_IO_IN, G_IO_HUP watch
+* (private) dispatch_output - G_IO_OUT watch while a request is partial
+*/
+static gboolean
+dispatch_input (GIOChannel *channel, GIOCondition condition, gpointer data)
+{
+  if ((condition & G_IO_IN) && dispatch_read ())
+    return TRUE;
+
+  dispatch_.watch = 0;		/* this source is removed on return */
+  dispatch_disconnect ();
+  return FALSE;
+} /* </dispatch_input> */
+
+static gboolean
+dispatch_output (GIOChannel *channel, GIOCondition condition, gpointer data)
+{
+  dispatch_.writer = 0;		/* dispatch_flush() adds it back if needed */
+
+  if (!dispatch_flush ())
+    dispatch_disconnect ();
+
+  return FALSE;
+} /* </dispatch_output> */
+
+/*
+* (private) dispatch_expire - request timeout, without signals
+*
+* A request not yet started is spawned here, as gpanel always did when
+* gsession did not answer in time; otherwise the caller gets -1 and a
+* late reply is ignored. A request written whole is dropped now, its
+* reply may never come; one written in part stays until the rest is.
+*/
+static gboolean
+dispatch_expire (DispatchRequest *request)
+{
+  gboolean started = request->sent ||
+       (dispatch_.offset > 0 && request == g_queue_peek_head (dispatch_.pending));
+
+  vdebug(1, "%s: [%u] %s timed out\n", __func__, request->id, request->command);
+  request->timer = 0;
+
+  if (started) {
+    if (request->callback)
+      request->callback (-1, request->data);
+
+    request->callback = NULL;
+    request->expired  = TRUE;
+
+    if (request->sent) {
+      g_queue_remove (dispatch_.pending, request);
+      dispatch_finish (request, -1);
+    }
+  }
+  else {
+    g_queue_remove (dispatch_.pending, request);
+    dispatch_finish (request, spawn (request->command));
+  }
+  return FALSE;
+} /* </dispatch_expire> */
+
+/*
+* gpanel_dispatch_async - send command to gsession, callback with its pid
+*
+* The callback gets the pid, or -1 when gsession failed to answer within
+* timeout milliseconds. Without a session (stream < 0) the command is
+* spawned here and the callback runs before returning.
+*/
+guint
+gpanel_dispatch_async (int stream, const char *command, guint timeout,
+                       GpanelDispatchReply callback, gpointer data)
+{
+  DispatchRequest *request;
+  SessionFrame frame;
+  guint id;
+
+  if (dispatch_.pending == NULL)
+    dispatch_.pending = g_queue_new ();
+
+  if (strlen(command) > _GSESSION_MESSAGE_MAX || !dispatch_connect (stream)) {
+    pid_t pid = spawn (command);
+    if(callback) callback (pid, data);
+    return 0;
+  }
+
+  request = g_new0 (DispatchRequest, 1);
+  request->id       = id = ++dispatch_.serial;
+  request->command  = g_strdup (command);
+  request->callback = callback;
+  request->data     = data;
+
+  memcpy(frame.magic, _GSESSION_MAGIC, sizeof(frame.magic));
+  frame.id     = request->id;
+  frame.length = strlen(command);
+
+  request->frame = g_string_new_len ((gchar *)&frame, sizeof(SessionFrame));
+  g_string_append_len (request->frame, command, frame.length);
+
+  request->timer = g_timeout_add (timeout, (GSourceFunc)dispatch_expire,
+                                  request);
+  g_queue_push_tail (dispatch_.pending, request);
+
+  vdebug(2, "%s: [%u] %s\n", __func__, request->id, command);
+
+  if (!dispatch_flush ())
+    dispatch_disconnect ();	/* may finish request */
+
+  return id;
+} /* </gpanel_dispatch_async> */
+
+/*
+* gpanel_dispatch_queued - requests not answered yet
+* gpanel_dispatch_blocked - whether output waits for gsession to read
+*/
+guint
+gpanel_dispatch_queued (void)
+{
+  return (dispatch_.pending) ? g_queue_get_length (dispatch_.pending) : 0;
+} /* </gpanel_dispatch_queued> */
+
+gboolean
+gpanel_dispatch_blocked (void)
+{
+  return dispatch_.writer != 0;
+} /* </gpanel_dispatch_blocked> */
+
+/*
+* gpanel_dispatch - dispatch request using session socket stream
+*
+* Synchronous wrapper of gpanel_dispatch_async(), waiting in poll(2) on
+* the connection for at most _SIGALRM_GRACETIME seconds. Other replies
+* arriving meanwhile are delivered to their callbacks.
+*/
+static void
+dispatch_wake (pid_t pid, DispatchWait *wait)
+{
+  wait->done = TRUE;
+  wait->pid  = pid;
+} /* </dispatch_wake> */
+
+pid_t
+gpanel_dispatch(int stream, const char *command)
+{
+  DispatchWait wait = { FALSE, -1 };
+  glong deadline = dispatch_clock () + _SIGALRM_GRACETIME * 1000;
+  guint id;
+
+  vdebug(2, "%s: stream => %d, command => %s\n", __func__, stream, command);
+
+  id = gpanel_dispatch_async (stream, command, _SIGALRM_GRACETIME * 1000,
+                              (GpanelDispatchReply)dispatch_wake, &wait);
+
+  while (!wait.done) {
+    glong remaining = deadline - dispatch_clock ();
+    DispatchRequest *request = dispatch_find (id);
+    struct pollfd fds;
+
+    if (request == NULL)		/* answered through a disconnect */
+      break;
+
+    if (remaining <= 0) {
+      g_source_remove (request->timer);
+      dispatch_expire (request);
+      break;
+    }
+
+    fds.fd = dispatch_.fd;
+    fds.events = POLLIN | ((dispatch_.writer) ? POLLOUT : 0);
+
+    if (poll(&fds, 1, remaining) > 0) {
+      if ((fds.revents & POLLOUT) && !dispatch_flush ())
+        dispatch_disconnect ();
+      else if ((fds.revents & (POLLIN | POLLHUP | POLLERR)) && !dispatch_read ())
+        dispatch_disconnect ();
+    }
+  }
+  return wait.pid;
+} /* </gpanel_dispatch> */
+
+/*
+* gpanel_dispatch_prepare - build the request gpanel_dispatch_urgent() sends
+*/
+gboolean
+gpanel_dispatch_prepare (const char *command)
+{
+  SessionFrame frame;
+
+  if (strlen(command) > _GSESSION_MESSAGE_MAX)
+    return FALSE;
+
+  memcpy(frame.magic, _GSESSION_MAGIC, sizeof(frame.magic));
+  frame.id     = 0;			/* never a gpanel_dispatch_async() id */
+  frame.length = strlen(command);
+
+  memcpy(urgent_.frame, &frame, sizeof(SessionFrame));
+  memcpy(urgent_.frame + sizeof(SessionFrame), command, frame.length);
+  urgent_.length = sizeof(SessionFrame) + frame.length;
+
+  g_free (urgent_.argv[3]);
+  urgent_.argv[0] = "/bin/sh";
+  urgent_.argv[1] = "-f";
+  urgent_.argv[2] = "-c";
+  urgent_.argv[3] = g_strdup (command);
+  urgent_.argv[4] = NULL;
+
+  return TRUE;
+} /* </gpanel_dispatch_prepare> */
+
+/*
+* (private) dispatch_urgent_reply - pid gsession answers on fd, or -1
+*/
+static pid_t
+dispatch_urgent_reply (int fd)
+{
+  char reply[sizeof(SessionFrame) + 16];
+  struct pollfd fds = { .fd = fd, .events = POLLIN };
+  size_t have = 0, want = sizeof(SessionFrame), idx;
+  SessionFrame frame;
+  pid_t pid = 0;
+  ssize_t nbytes;
+
+  while (have < want && poll(&fds, 1, _SIGALRM_GRACETIME * 1000) > 0 &&
+         (nbytes = read(fd, reply + have, sizeof(reply) - have)) > 0) {
+    have += nbytes;
+
+    if (have >= sizeof(SessionFrame)) {
+      memcpy(&frame, reply, sizeof(SessionFrame));
+      want = sizeof(SessionFrame) + MIN(frame.length,
+                                        sizeof(reply) - sizeof(SessionFrame));
+    }
+  }
+
+  if (have < want || want == sizeof(SessionFrame) ||
+      memcmp(frame.magic, _GSESSION_MAGIC, sizeof(frame.magic)) != 0)
+    return -1;
+
+  for (idx = sizeof(SessionFrame); idx < want; idx++) {	/* no atoi() here */
+    if (reply[idx] < '0' || reply[idx] > '9')
+      break;
+    pid = pid * 10 + (reply[idx] - '0');
+  }
+  return (pid > 0) ? pid : -1;
+} /* </dispatch_urgent_reply> */
+
+/*
+* gpanel_dispatch_urgent - send the prepared request, from a signal handler
+*
+* Async-signal-safe: a connection of its own to gsession, so the stream
+* the interrupted main loop may be halfway through writing is left
+* alone, and only socket(2), connect(2), write(2), poll(2), read(2) and,
+* without gsession, fork(2) and execv(2). Nothing is allocated.
+*/
+pid_t
+gpanel_dispatch_urgent (int stream)
+{
+  struct sockaddr_un address;
+  sigset_t mask;
+  pid_t pid;
+  int fd;
+
+  if (urgent_.length == 0)		/* gpanel_dispatch_prepare() not called */
+    return -1;
+
+  if (stream >= 0 && (fd = socket(PF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0)) >= 0) {
+    size_t written = 0;
+    ssize_t nbytes = 0;
+
+    memset(&address, 0, sizeof(struct sockaddr_un));
+    address.sun_family = AF_UNIX;
+    strncpy(address.sun_path, _GSESSION, UNIX_PATH_MAX - 1);
+
+    if (connect(fd, (struct sockaddr *)&address,
+                sizeof(struct sockaddr_un)) == 0)
+      while (written < urgent_.length &&
+             (nbytes = write(fd, urgent_.frame + written,
+                             urgent_.length - written)) > 0)
+        written += nbytes;
+
+    if (written == urgent_.length) {
+      pid = dispatch_urgent_reply (fd);
+      close(fd);
+      return pid;
+    }
+    close(fd);
+  }
+
+  if ((pid = fork()) == 0) {		/* gsession is gone, spawn here */
+    sigemptyset(&mask);			/* the handler blocked its signal */
+    sigprocmask(SIG_SETMASK, &mask, NULL);
+    setsid();
+    execv(urgent_.argv[0], urgent_.argv);
+    _exit(127);
+  }
+  return pid;
+} /* </gpanel_dispatch_urgent> */
@@ -20,6 +20,7 @@
 #include "gould.h"		/* common package declarations */
 #include "gpanel.h"
 #include "gsession.h"
+#include "launchstat.h"
 #include "screensaver.h"
 
 #include <sysexits.h>		/* exit status codes for system programs */
@@ -39,10 +40,11 @@ const char *Description =
 "  a central part of gould (http://www.softcraft.org/gould)." ;
 
 const char *Usage =
-"usage: %s [-v | -h | -p <name> [-s]\n"
+"usage: %s [-v | -h | -l | -p <name> [-s]\n"
 "\n"
 "\t-v print version information\n"
 "\t-h print help usage (what you are reading)\n"
+"\t-l print launch latency histograms\n"
 "\n"
 "\t-p <name> use process <name> instead of `%s'\n"
 "\t-s silent => no splash at startup\n"
@@ -159,14 +161,168 @@ check_configuration_version(GlobalPanel *panel, SchemaVersion *version)
 } /* </check_configuration_version> */
 
 /*
- * icon_path_finder wrapper for path_finder()
+ * icon_path_finder - resolve an icon name from the icons index
+ *
+ * Names without an extension are tried with each of IconExtensions,
+ * in order, the same way a theme lookup would.
  */
 const char *
 icon_path_finder(PanelIcons *icons, const char *name)
 {
-  return path_finder (icons->path, name);
+  static const char *IconExtensions[] = { ".png", ".svg", ".xpm", NULL };
+  const char *pathname;
+
+  if (name == NULL)
+    return NULL;
+
+  if (icons->index == NULL)
+    return path_finder (icons->path, name);
+
+  if ((pathname = path_index_lookup (icons->index, name)) == NULL &&
+      strchr(name, '.') == NULL) {
+    for (int idx = 0; IconExtensions[idx] != NULL; idx++) {
+      gchar *file = g_strconcat (name, IconExtensions[idx], NULL);
+
+      pathname = path_index_lookup (icons->index, file);
+      g_free (file);
+
+      if (pathname != NULL)
+        break;
+    }
+  }
+  return pathname;
 } /* </icon_path_finder> */
 
+typedef struct {
+  gchar *folder;	/* <base>/<theme>/<directory> */
+  int distance;		/* from the size wanted, G_MAXINT => unknown */
+  int order;		/* position in Directories */
+} IconThemeDir;
+
+/*
+ * (private) icon_theme_nearest - qsort order of IconThemeDir, nearest first
+ */
+static int
+icon_theme_nearest (const void *one, const void *two)
+{
+  const IconThemeDir *a = one, *b = two;
+
+  if (a->distance != b->distance)
+    return (a->distance < b->distance) ? -1 : 1;
+
+  return a->order - b->order;
+} /* </icon_theme_nearest> */
+
+/*
+ * (private) icon_theme_subdirs - append theme Directories, nearest size first
+ *
+ * Icons live in the subfolders index.theme lists under Directories, each
+ * also a group giving the Size of its icons. Lookups stop at the first
+ * match, so folders closest to the size wanted go first.
+ */
+static GList *
+icon_theme_subdirs (GList *path, GKeyFile *spec, const char *folder, int size)
+{
+  gchar **dirs;
+  gsize count, found = 0;
+  IconThemeDir *subdirs;
+
+  dirs = g_key_file_get_string_list (spec, "Icon Theme", "Directories",
+                                     &count, NULL);
+  if (dirs == NULL)
+    return path;
+
+  subdirs = g_new0 (IconThemeDir, count + 1);
+
+  for (gsize idx = 0; idx < count; idx++) {
+    const gchar *name = g_strstrip (dirs[idx]);
+    gchar *subdir = g_build_filename (folder, name, NULL);
+    int nominal = g_key_file_get_integer (spec, name, "Size", NULL);
+
+    if (*name == '\0' || !g_file_test (subdir, G_FILE_TEST_IS_DIR)) {
+      g_free (subdir);
+      continue;
+    }
+    subdirs[found].folder = subdir;
+    subdirs[found].distance = (nominal > 0) ? ABS(nominal - size) : G_MAXINT;
+    subdirs[found].order = idx;
+    found++;
+  }
+  qsort (subdirs, found, sizeof(IconThemeDir), icon_theme_nearest);
+
+  for (gsize idx = 0; idx < found; idx++)
+    path = g_list_append (path, subdirs[idx].folder);
+
+  g_free (subdirs);
+  g_strfreev (dirs);
+
+  return path;
+} /* </icon_theme_subdirs> */
+
+/*
+ * (private) icon_theme_inherit - append theme under base, then its parents
+ */
+static GList *
+icon_theme_inherit (GList *path, const char *base, const char *theme,
+                    int size, int depth)
+{
+  gchar *folder = g_build_filename (base, theme, NULL);
+  gchar *index  = g_build_filename (folder, "index.theme", NULL);
+  GKeyFile *spec;
+  gchar **inherits;
+
+  if (depth > 8 || !g_file_test (folder, G_FILE_TEST_IS_DIR) ||
+      g_list_find_custom (path, folder, (GCompareFunc)strcmp) != NULL) {
+    g_free (folder);
+    g_free (index);
+    return path;
+  }
+  path = g_list_append (path, folder);
+
+  spec = g_key_file_new ();
+
+  if (g_key_file_load_from_file (spec, index, G_KEY_FILE_NONE, NULL)) {
+    path = icon_theme_subdirs (path, spec, folder, size);
+
+    inherits = g_key_file_get_string_list (spec, "Icon Theme", "Inherits",
+                                           NULL, NULL);
+    if (inherits != NULL) {
+      for (int idx = 0; inherits[idx] != NULL; idx++)
+        path = icon_theme_inherit (path, base, g_strstrip (inherits[idx]),
+                                   size, depth + 1);
+
+      g_strfreev (inherits);
+    }
+  }
+  g_key_file_free (spec);
+  g_free (index);
+
+  return path;
+} /* </icon_theme_inherit> */
+
+/*
+ * (private) icon_theme_path - search path with the theme folders in front
+ *
+ * For each directory of the icons path, <directory>/<theme>, the theme
+ * Directories and the themes it Inherits (see, index.theme) are searched
+ * before it.
+ */
+static GList *
+icon_theme_path (GList *dirs, const char *theme, int size)
+{
+  GList *iter, *path = NULL;
+
+  for (iter = dirs; iter != NULL; iter = iter->next) {
+    if (theme != NULL)
+      path = icon_theme_inherit (path, iter->data, theme, size, 0);
+
+    path = g_list_append (path, iter->data);
+  }
+  g_list_free (dirs);
+
+  return path;
+} /* </icon_theme_path> */
+
 /*
 * (protected) start_menu_open
 */
@@ -310,6 +466,7 @@ panel_config_settings(GlobalPanel *panel)
 
   char *member = strtok((char *)searchpath, delim);
   char attrib[UNIX_PATH_MAX];
+  gchar *cache;
 
   //gchar *attrib = g_strdup_printf ("%s:%s", Program, _SCREENSAVER_COMMAND);
   sprintf(attrib, "%s:%s", Program, _SCREENSAVER_COMMAND);
@@ -332,13 +489,20 @@ panel_config_settings(GlobalPanel *panel)
     member = strtok(NULL, delim);
   }
 
+  /* Commands are looked up in memory, see path_index_lookup() */
+  if (panel->execs) path_index_free (panel->execs);
+  panel->execs = path_index_new (panel->path);
+
   /* Configuration for the icons. */
   icons->path  = NULL;
+  icons->theme = NULL;
   icons->size  = 22;
 
   if ((chain = configuration_find (config, "icons")) != NULL) {
     gchar *value;
 
+    icons->theme = configuration_attrib (chain, "theme");
+
     if ((item = configuration_find (chain, "size")) != NULL)
       icons->size = atoi(item->element);
 
@@ -365,6 +529,13 @@ panel_config_settings(GlobalPanel *panel)
     icons->path = g_list_append (icons->path, "/usr/share/pixmaps");
   }
 
+  /* Read each icon folder once, from the cache file when unchanged. */
+  icons->path = icon_theme_path (icons->path, icons->theme, icons->size);
+
+  cache = g_build_filename (g_get_user_cache_dir (), ICONS_CACHE, NULL);
+  icons->index = path_index_new_cached (icons->path, cache);
+  g_free (cache);
+
   /* Configuration of remaining settings. */
   panel->indent = 0;			 /* default indents at each end */
   panel->margin = 0;			 /* default margins at each end */
@@ -401,11 +572,11 @@ static void
 panel_quicklaunch(GtkWidget *widget, Modulus *applet)
 {
   GlobalPanel *panel = applet->data;
-  const gchar *command = path_finder(panel->path, applet->label);
+  const gchar *command = path_index_lookup(panel->execs, applet->label);
 
   if (command) {
     vdebug(2, "%s: command => %s\n", __func__, command);
-    gpanel_dispatch (panel->session, command);
+    gpanel_launch (panel, command);
   }
   else
     gpanel_dialog(100, 100, ICON_WARNING, "[%s]%s: %s.",
@@ -606,55 +777,35 @@ applets_loadable(GlobalPanel *panel, guint space)
 } /* </applets_loadable> */
 
 /*
-* dispatch_timeout - intervene gtk_widget_show() unresponsive
-*/
-const char *_command;	/* dispatch command */
-
-void
-gpanel_dispatch_timeout (int signum)
-{
-  vdebug(1, "%s alarm(%d) expired.. SIGKILL %s\n", __func__,
-			_SIGALRM_GRACETIME, _GSESSION_TASKBAR);
-  spawn (_command);
-} /* </gpanel_dispatch_timeout> */
-
-/*
-* gpanel_dispatch - dispatch request using session socket stream
+* (private) applets_realize - load the enabled modules known by manifest
 */
-pid_t
-gpanel_dispatch(int stream, const char *command)
+static void
+applets_realize(GlobalPanel *panel)
 {
-  pid_t pid;
-  vdebug(2, "%s: stream => %d, command => %s\n", __func__, stream, command);
+  GList *iter = panel->moduli;
+  Modulus *applet;
 
-  if (stream < 0)	/* stream socket must be > 0 */ 
-    pid = spawn (command);
-  else {
-    int  nbytes;
-    char reply[UNIX_PATH_MAX];
+  while (iter != NULL) {
+    applet = (Modulus *)iter->data;
+    iter = iter->next;
 
-    _command = command;
-    signal (SIGALRM, gpanel_dispatch_timeout);
-    alarm (_SIGALRM_GRACETIME);
-    write(stream, command, strlen(command));
-    nbytes = read(stream, reply, UNIX_PATH_MAX);
-    reply[nbytes] = 0;
-    pid = atoi(reply);
-    alarm (0);	/* disarm alarm() */
+    if (!module_realize (applet, MODULI_SPACE_ALL))
+      panel->moduli = moduli_remove (panel->moduli, applet);
+    else if (applet->place == 0 && (applet->space & MODULI_SPACE_TASKBAR))
+      applet->place = PLACE_END;
   }
-  return pid;
-} /* </gpanel_dispatch> */
+} /* </applets_realize> */
 
 /*
 * gpanel_respawn - gpanel_dispatch(_self_ silently[-s command line option])
+*
+* Called from signal handlers: the request is built ahead of time, see
+* gpanel_instance(), and sent by the async-signal-safe dispatcher.
 */
 pid_t
 gpanel_respawn(int stream, int seconds)
 {
-  static char command[UNIX_PATH_MAX];
-  sprintf(command, "%s -s", path_finder(gpanel_->path, Program));
-  vdebug(2, "%s: command => %s\n", __func__, command);
-  pid_t instance = gpanel_dispatch (stream, command);
+  pid_t instance = gpanel_dispatch_urgent (stream);
   if(seconds > 0) sleep(seconds);
 
   return instance;
@@ -725,7 +876,13 @@ gpanel_interface(GlobalPanel *panel)
   }
 
   if (once) {			/* one time initialization */
-    settings_initialize (panel);
+    GList *prepare;
+
+    applets_realize (panel);	/* before settings need applet->settings */
+    prepare = moduli_prepare (panel->moduli);
+
+    settings_initialize (panel); /* meanwhile, module_prepare threads run */
+    moduli_prepare_wait (prepare);
     once = false;
   }
 
@@ -911,6 +1068,8 @@ panel_loader(GlobalPanel *panel)
 void
 gpanel_instance(GlobalPanel *panel)
 {
+  gchar *command;
+
   memset(panel, 0, sizeof(GlobalPanel));
   gpanel_ = panel;		/* save GlobalPanel data structure */
 
@@ -918,6 +1077,13 @@ gpanel_instance(GlobalPanel *panel)
     printf("%s: %s.", Program, _("cannot find configuration file"));
     _exit (EX_CONFIG);		/* configuration file disappeared */
   }
+  setbg_slideshow (panel);	/* see, wallpaper.c */
+
+  /* how to respawn, built now for the signal handlers */
+  command = g_strdup_printf ("%s -s", path_index_lookup (panel->execs, Program));
+  vdebug(2, "%s: respawn command => %s\n", __func__, command);
+  gpanel_dispatch_prepare (command);
+  g_free (command);
 
   if (debug > 1) {
     pid_t pid = gpanel_dispatch (panel->session, _GET_SESSION_PID);
@@ -1123,7 +1289,7 @@ main(int argc, char *argv[])
   if(genviron && strstr(genviron, "no-splash") != NULL) _silent = true;
   if(gmonitor && strcasecmp(gmonitor, "yes") == 0) _monitor = true;
      
-  while ((opt = getopt (argc, argv, "d:hvacnp:so")) != -1) {
+  while ((opt = getopt (argc, argv, "d:hlvacnp:so")) != -1) {
 /* while ((opt = getopt_long (argc, argv, opts, longopts, NULL)) != -1) */
     switch (opt) {
       case 'd':
@@ -1136,6 +1302,11 @@ main(int argc, char *argv[])
         printf(Usage, Program, Program, Program);
         _exit (status);
 
+      case 'l':
+        launchstat_dump (stdout);
+        fflush (stdout);
+        _exit (status);
+
       case 'v':
         printf("<!-- %s %s %s\n -->\n", Program, Release, Description);
         _exit (status);
@@ -1186,12 +1357,16 @@ main(int argc, char *argv[])
   if(alias) prctl(PR_SET_NAME, (unsigned long)alias, 0, 0, 0);
   if(grespawn && strcasecmp(grespawn, "no") == 0) _persistent = false;
 
+#if GLIB_CHECK_VERSION(2,32,0) == 0
+  if (!g_thread_supported ()) g_thread_init (NULL);
+#endif
   gtk_init (&argc, &argv);	/* initialization of the GTK */
   apply_gtk_theme (CONFIG_FILE);
 
   apply_signal_responder();
   gpanel_instance (&memory);	/* GlobalPanel initialization */
   gtk_main ();			/* main event loop */
+  launchstat_flush ();		/* records still held in memory */
 
   return status;
 } /* </main> */
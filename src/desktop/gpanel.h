@@ -27,6 +27,10 @@
 #include "xmlconfig.h"
 #include "systray.h"
 #include "module.h"
+#include "pathindex.h"
+#include "sensors.h"
+#include "sysevent.h"
+#include "ticker.h"
 #include "util.h"
 
 #include <signal.h>
@@ -36,6 +40,11 @@
 #define SCHEMA_VERSION_CODE   SCHEMA_VERSION(1,2,0)
 #define SCHEMA_VERSION_STRING "1.2"
 
+#define ICONS_CACHE "gould/icons.cache"	/* under $XDG_CACHE_HOME */
+
+#define LAUNCH_TIMEOUT  60	/* seconds waiting for a launched window */
+#define LAUNCH_ANCESTRY 8	/* parents searched for a launched pid */
+
 G_BEGIN_DECLS
 
 /* Configuration and Desktop shortcut actions. */
@@ -101,6 +110,7 @@ struct _GlobalPanel
   GList *moduli;		/* plugin modules list */
   GList *notice;		/* alert notices list */
   GList *path;			/* PATH environment */
+  PathIndex *execs;		/* panel->path directories indexed */
 
   Systray   *systray;		/* system tray manager */
   GtkWidget *backdrop;		/* ghost backdrop window */
@@ -161,6 +171,7 @@ struct _PanelIcons
 {
   GList *path;			/* list of directory paths to search */
   const char *theme;		/* optional themes sub-directory */
+  PathIndex *index;		/* name => pathname, see icon_path_finder() */
   guint size;			/* width and height of each icon */
 };
 
@@ -248,6 +259,7 @@ void settings_set_agents (PanelSetting *settings,
                           GtkFunction close_cb);
 
 GtkWidget *setbg_settings_new (Modulus *applet, GlobalPanel *panel);
+bool setbg_slideshow (GlobalPanel *panel);
 GtkWidget *screensaver_settings_new (Modulus *applet, GlobalPanel *panel);
 GtkWidget *shutdown_dialog_new (GlobalPanel *panel);
 
@@ -258,6 +270,23 @@ pid_t session_request (int stream, const char *command);
 pid_t spawn_selected (ConfigurationNode *node, GlobalPanel *panel);
 pid_t gpanel_dispatch (int stream, const char *command);
 
+typedef void (*GpanelDispatchReply) (pid_t pid, gpointer data);
+
+guint gpanel_dispatch_async (int stream, const char *command, guint timeout,
+                             GpanelDispatchReply callback, gpointer data);
+
+gboolean gpanel_dispatch_prepare (const char *command);
+pid_t gpanel_dispatch_urgent (int stream);
+
+guint gpanel_dispatch_queued (void);		/* see, tests/test-dispatch.c */
+gboolean gpanel_dispatch_blocked (void);
+
+void gpanel_launch (GlobalPanel *panel, const char *command);
+guint gpanel_launch_pending (void);		/* see, tests/test-launch.c */
+
+GdkPixbuf *gpanel_shortcut_render (GtkWidget *canvas, const char *font,
+                                   GdkPixbuf *piximg, const char *label);
+
 void gpanel_dialog(gint xpos, gint ypos, IconIndex icon, const gchar* fmt, ...);
 gint spawn_dialog(gint xpos, gint ypos, IconIndex icon, const gchar* fmt, ...);
 
@@ -35,10 +35,15 @@
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <sys/wait.h>
+#include <sys/epoll.h>
+#include <sys/signalfd.h>
+#include <sys/syscall.h>
 #include <libgen.h>	/* definitions for pattern matching functions */
 #include <unistd.h>
 #include <fcntl.h>
+#include <poll.h>
 #include <time.h>
+#include <errno.h>
 
 const char *Program = "gsession";
 const char *Release = "1.2.2";
@@ -73,16 +78,21 @@ int _stream = -1;	/* stream socket descriptor */
 pid_t _master  = 0;	/* singleton process ID */
 pid_t _backend = 0;	/* backend process ID */
 pid_t _monitor = 0;	/* monitor process ID */
+int _channel = -1;	/* backend <=> monitor requests, see session_monitor_ask() */
+
+typedef struct _SessionClient SessionClient;	/* see, session_serve() */
 
 /**
 * prototypes (forward method declarations)
 */
-int acknowledge(int connection);
+int acknowledge(SessionClient *client, uint32_t id, char *request, int nbytes);
 int open_stream_socket(const char *sockname);
+void session_serve(int listener);
 
 pid_t session_spawn(const int idx, bool async);
 pid_t session_respawn(const int idx);
 
+bool session_monitor_ask(SessionClient *client, uint32_t id, char *request);
 void session_monitor_request(char *request);
 void signal_responder(int signum);
 
@@ -181,7 +191,6 @@ session_graceful(int signum, ...)
 int
 session_backend(const char *name)
 {
-  int connection;       /* connection stream socket */
   pid_t pid = fork();
 
   if (pid < 0) {
@@ -207,17 +216,273 @@ session_backend(const char *name)
   close(STDOUT_FILENO);
   close(STDERR_FILENO);
 
-  for ( ;; ) {		/* gsession main loop */
-    if ((connection = accept(_stream, 0, 0)) < 0)
-      perror("accept connection on socket");
-    else {
-      while (acknowledge (connection) > 0) ;
-      close(connection);
-    }
-  }
+  session_serve(_stream);	/* gsession main loop */
   return 0;
 } /* </session_backend> */
 
+/*
+* (private) session_clock - monotonic milliseconds
+* (private) session_pidfd - pidfd_open(2), -1 when the kernel has none
+*/
+static long
+session_clock(void)
+{
+  struct timespec now;
+
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return now.tv_sec * 1000 + now.tv_nsec / 1000000;
+} /* </session_clock> */
+
+static int
+session_pidfd(pid_t pid)
+{
+#ifdef SYS_pidfd_open
+  if (pid > 0)
+    return syscall(SYS_pidfd_open, pid, 0);
+#endif
+  return -1;
+} /* </session_pidfd> */
+
+/*
+* session_watch - start supervising monitor_[idx].process
+*/
+static void
+session_watch(const int idx)
+{
+  SessionMonitor *entry = &monitor_[idx];
+
+  if (entry->pidfd >= 0)
+    close(entry->pidfd);
+
+  entry->pidfd   = session_pidfd(entry->process);
+  entry->started = session_clock();
+  entry->respawn = 0;
+
+  sessionlog_stamp(2, "[%s] pid => %d watched (%s)\n",
+			session_monitor_tag(idx), entry->process,
+			(entry->pidfd >= 0) ? "pidfd" : "SIGCHLD");
+} /* </session_watch> */
+
+/*
+* session_exited - schedule the respawn of monitor_[idx] with backoff
+*
+* The first exit after a stable run respawns right away, each following
+* one waits twice as long; after _RESPAWN_CRASH_LIMIT exits in a row the
+* program is disabled until enabled again by request.
+*/
+static void
+session_exited(const int idx)
+{
+  SessionMonitor *entry = &monitor_[idx];
+  long now = session_clock();
+  long delay = 0;
+
+  sessionlog_stamp(1, "[%s] pid => %d exited\n",
+			session_monitor_tag(idx), entry->process);
+
+  if (entry->pidfd >= 0)
+    close(entry->pidfd);
+
+  entry->pidfd   = -1;
+  entry->process = 0;
+
+  if (now - entry->started >= _RESPAWN_STABLE * 1000)
+    entry->failures = 0;
+
+  if (++entry->failures > _RESPAWN_CRASH_LIMIT) {
+    sessionlog_stamp(1, "[%s] exited %d times in a row, not respawned\n",
+			session_monitor_tag(idx), entry->failures - 1);
+    entry->enabled = false;
+    entry->respawn = 0;
+    return;
+  }
+
+  if (entry->failures > 1) {
+    delay = (long)_RESPAWN_BACKOFF << (entry->failures - 2);
+    if(delay > _RESPAWN_BACKOFF_MAX) delay = _RESPAWN_BACKOFF_MAX;
+  }
+  entry->respawn = now + delay;
+} /* </session_exited> */
+
+/*
+* session_reap - collect exited children, SIGCHLD through the signalfd
+*/
+static void
+session_reap(void)
+{
+  pid_t pid;
+  int idx;
+
+  while ((pid = waitpid(-1, NULL, WNOHANG)) > 0) {
+    for (idx = 0; idx < SessionMonitorCount; idx++)
+      if (monitor_[idx].process == pid) {
+        session_exited(idx);
+        break;
+      }
+  }
+} /* </session_reap> */
+
+/*
+* session_revive - respawn monitor_[idx], or adopt a {TASKBAR} running
+*/
+static void
+session_revive(const int idx)
+{
+  SessionMonitor *entry = &monitor_[idx];
+
+  if (idx == _TASKBAR) {	/* {TASKBAR} special case */
+    pid_t tid = get_process_id (_GSESSION_TASKBAR);
+
+    if (tid > 0) {		/* process was not started by SessionMonitor */
+      sessionlog_stamp(1, "change [%s] pid => %d\n",
+			session_monitor_tag(idx), tid);
+      entry->process = tid;
+      session_watch(idx);
+      return;
+    }
+  }
+
+  if (session_respawn(idx) > 0)
+    session_watch(idx);
+  else {
+    entry->process = 0;
+    session_exited(idx);
+  }
+} /* </session_revive> */
+
+/*
+* session_answer - answer the _GSESSION_SERVICE requests the backend passed
+*
+* Each request comes after the backend's tag, sent back with the reply.
+*/
+static void
+session_answer(int channel)
+{
+  char message[sizeof(uint32_t) + MAX_COMMAND];
+  char *request = message + sizeof(uint32_t);
+  ssize_t nbytes;
+
+  while ((nbytes = recv(channel, message, sizeof(message) - 1,
+                        MSG_DONTWAIT)) > 0) {
+    if (nbytes <= sizeof(uint32_t))
+      continue;
+
+    message[nbytes] = 0;
+    session_monitor_request (request);
+    send(channel, message, sizeof(uint32_t) + strlen(request), MSG_NOSIGNAL);
+  }
+} /* </session_answer> */
+
+/*
+* session_supervise - one event loop for every SessionMonitor process
+*
+* Exits are noticed as they happen: a pidfd per process when the kernel
+* has pidfd_open(2), otherwise SIGCHLD through a signalfd (processes not
+* our children are then checked every _monitor_seconds_interval).
+* Requests from the backend arrive on _channel, see session_monitor_ask().
+*/
+static void
+session_supervise(int signals, bool gmonitor)
+{
+  struct pollfd fds[SessionMonitorCount + 2];
+  int owner[SessionMonitorCount + 2];
+
+  long ping = session_clock() + _monitor_seconds_interval * 1000;
+  int idx, nfds, timeout;
+
+  for ( ;; ) {
+    long now = session_clock();
+
+    fds[0].fd = signals;
+    fds[0].events = POLLIN;
+    fds[1].fd = _channel;	/* ignored once negative */
+    fds[1].events = POLLIN;
+    nfds = 2;
+    timeout = -1;
+
+    for (idx = 0; idx < SessionMonitorCount; idx++) {
+      SessionMonitor *entry = &monitor_[idx];
+      long due;
+
+      if (!entry->enabled)
+        continue;
+
+      if (entry->process == 0 && entry->respawn > 0 && entry->respawn <= now)
+        session_revive(idx);
+
+      if (entry->pidfd >= 0) {
+        fds[nfds].fd = entry->pidfd;
+        fds[nfds].events = POLLIN;
+        owner[nfds++] = idx;
+        continue;
+      }
+
+      if (entry->process == 0 && entry->respawn > 0)
+        due = entry->respawn - now;
+      else if (entry->process > 0 && kill(entry->process, 0) != 0 &&
+               errno == ESRCH) {
+        session_exited(idx);	/* no pidfd, not a child */
+        due = entry->respawn - now;
+      }
+      else if (entry->process > 0)
+        due = _monitor_seconds_interval * 1000;
+      else
+        continue;
+
+      if (timeout < 0 || due < timeout)
+        timeout = (due > 0) ? due : 0;
+    }
+
+    if (gmonitor) {	/* acknowledgement expected */
+      if (now >= ping) {
+        if(monitor_[_TASKBAR].process > 0)
+          kill(monitor_[_TASKBAR].process, SIGUSR3);
+
+        ping = now + _monitor_seconds_interval * 1000;
+      }
+      if (timeout < 0 || ping - now < timeout)
+        timeout = ping - now;
+    }
+
+    if (poll(fds, nfds, timeout) < 0) {
+      if (errno != EINTR) {
+        perror("session_supervise: poll() failed.");
+        sleep (_monitor_seconds_interval);
+      }
+      continue;
+    }
+
+    if (fds[0].revents & POLLIN) {
+      struct signalfd_siginfo info;
+
+      while (read(signals, &info, sizeof(info)) == sizeof(info))
+        if (info.ssi_signo == SIGUSR3)
+          sessionlog_stamp(3, "%s acknowledges\n", _GSESSION_TASKBAR);
+
+      session_reap();
+    }
+
+    for (idx = 2; idx < nfds; idx++) {
+      SessionMonitor *entry = &monitor_[owner[idx]];
+
+      /* skip when session_reap() already handled the exit */
+      if ((fds[idx].revents & POLLIN) && entry->pidfd == fds[idx].fd) {
+        waitpid(entry->process, NULL, WNOHANG);
+        session_exited(owner[idx]);
+      }
+    }
+
+    /* last, requests may spawn and watch (new pidfds) */
+    if (fds[1].revents & POLLIN)
+      session_answer(_channel);
+
+    if (fds[1].revents & (POLLHUP | POLLERR)) {	/* backend is gone */
+      close(_channel);
+      _channel = -1;
+    }
+  }
+} /* </session_supervise> */
+
 /*
 * gsession monitor process thread
 */
@@ -229,10 +494,17 @@ session_monitor(const char *name)
   const char *grespawn = getenv("GOULD_RESPAWN");
 
   int idx;		/* SessionMonitor monitor_[] index */
-  char procfile[MAX_LABEL];
-  pid_t pid = fork();
+  int signals;		/* signalfd for SIGCHLD and SIGUSR3 */
+  int channel[2];	/* backend => monitor requests */
+  sigset_t mask;
+  pid_t pid;
 
-  if (pid < 0) {
+  if (socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, channel) < 0) {
+    perror("session_monitor: socketpair() failed.");
+    _exit (EX_OSERR);
+  }
+
+  if ((pid = fork()) < 0) {
     perror("session_monitor: fork() failed.");
     _exit (EX_OSERR);
   }
@@ -244,10 +516,14 @@ session_monitor(const char *name)
   }
 
   if (pid > 0) {	/* not in spawned process */
+    close(channel[1]);
+    _channel = channel[0];	/* inherited by session_backend() */
     _monitor = pid;
     sessionlog_stamp(1, "[%s] pid => %d\n", name, pid);
     return pid;
   }
+  close(channel[0]);
+  _channel = channel[1];
 
   if (setsid() < 0) {	/* set new session */
     perror("session_monitor: setsid() failed.");
@@ -255,9 +531,21 @@ session_monitor(const char *name)
   }
   prctl(PR_SET_NAME, (unsigned long)name, 0, 0);
 
+  /* SIGCHLD and SIGUSR3 are read from a signalfd, not signal_responder */
+  sigemptyset(&mask);
+  sigaddset(&mask, SIGCHLD);
+  sigaddset(&mask, SIGUSR3);
+  sigprocmask(SIG_BLOCK, &mask, NULL);
+
+  if ((signals = signalfd(-1, &mask, SFD_NONBLOCK | SFD_CLOEXEC)) < 0) {
+    perror("session_monitor: signalfd() failed.");
+    _exit (EX_OSERR);
+  }
+
   /* {WINDOWMANAGER}, {SCREENSAVER}, {LAUNCHER}, {TASKBAR} */
   for (idx = 0; idx < SessionMonitorCount; idx++) {
     monitor_[idx].enabled = (monitor_[idx].program) ? true : false;
+    monitor_[idx].pidfd = -1;
   }
   if (grespawn && strcasecmp(grespawn, "no") == 0) {
     sessionlog_stamp(1, "[%s] {TASKBAR} => false\n", name);
@@ -267,50 +555,20 @@ session_monitor(const char *name)
   for (idx = 0; idx < SessionMonitorCount; idx++) {
     if (monitor_[idx].enabled) {  // may be turned off by request later on
       pid = session_spawn(idx, false);
-      monitor_[idx].process = pid;
+      monitor_[idx].process = (pid > 0) ? pid : 0;
+
+      if (pid > 0)
+        session_watch(idx);
+      else
+        session_exited(idx);
     }
   }
 
-  /* if needed: session_spawn(_TASKBAR, async => true) */
-  sprintf(procfile, "/proc/%d", monitor_[_TASKBAR].process);
-  if(access(procfile, R_OK) != 0) session_spawn(_TASKBAR, true);
-
   close(STDIN_FILENO);	/* close stdin. stdout and stderr */
   close(STDOUT_FILENO);
   close(STDERR_FILENO);
 
-  /* regularly check SessionMonitor monitor_[].process */
-  for ( ;; ) {
-    sleep (_monitor_seconds_interval);
-
-    for (idx = 0; idx < SessionMonitorCount; idx++) {
-      if (monitor_[idx].enabled) {
-        sprintf(procfile, "/proc/%d", monitor_[idx].process);
-
-        if (idx == _TASKBAR) {	/* {TASKBAR} special case */
-          pid_t tid = get_process_id (_GSESSION_TASKBAR);
-
-          if (tid > 0 && tid != monitor_[idx].process) {
-             /* process was not started by SessionMonitor */
-             sessionlog_stamp(1, "change [%s] pid => %d\n",
-					session_monitor_tag(idx), tid);
-            monitor_[idx].process = tid;
-            sleep (_monitor_seconds_interval);
-	    continue;
-          }
-        }
-
-        if (access(procfile, R_OK) != 0) {
-          sessionlog_stamp(1, "[%s] pid => missing\n",
-				session_monitor_tag (idx));
-          session_respawn (idx);
-        }
-      }
-    }
-    if (gmonitor) {	/* acknowledgement expected */
-      kill(monitor_[_TASKBAR].process, SIGUSR3);
-    }
-  }
+  session_supervise(signals, gmonitor);
   return 0;
 } /* </session_monitor> */
 
@@ -320,6 +578,9 @@ session_monitor(const char *name)
 * {_GSESSION_SERVICE} # b{_GSESSION_SERVICE_CALL} style request
 *                     ^ ^  0 => disable, 1 => enable
 *                     ` {_WINDOWMANAGER,_SCREENSAVER,_LAUNCHER,_TASKBAR}
+*
+* Enabling gives a program disabled after _RESPAWN_CRASH_LIMIT exits a
+* fresh start: no failures counted, respawned now and watched again.
 */
 void
 session_monitor_request(char *request)
@@ -327,13 +588,20 @@ session_monitor_request(char *request)
   int mark = strlen(_GSESSION_SERVICE);
   int idx = (request[mark+1] - '0');
 
+  if (idx < 0 || idx >= SessionMonitorCount) {
+    strcpy(request, "\n");
+    return;
+  }
   monitor_[idx].enabled = (request[mark+3] == '1') ? true : false;
 
   sessionlog_stamp(1, "[%s] enabled => %s\n", session_monitor_tag(idx),
 				(monitor_[idx].enabled) ? "true" : "false");
 
   if (monitor_[idx].enabled) {
-    if(monitor_[idx].process == 0) session_respawn (idx);
+    monitor_[idx].failures = 0;
+    monitor_[idx].respawn  = 0;
+
+    if(monitor_[idx].process == 0) session_revive (idx);
     sprintf(request, "%d\n", monitor_[idx].process);
   }
   else {
@@ -384,7 +652,6 @@ session_respawn(const int idx)
   if (monitor_[idx].program) {
     putenv (_monitor_environ);
     pid = session_spawn(idx, false);
-    sleep (_monitor_seconds_interval);
     monitor_[idx].process = pid;
   }
   else
@@ -394,54 +661,506 @@ session_respawn(const int idx)
 } /* </session_respawn> */
 
 /*
-* acknowledge - socket stream request delivery
+* acknowledge - answer one request, the reply is written over request
+*
+* Returns the reply length, or -1 when the monitor answers client later.
 */
 int
-acknowledge(int connection)
+acknowledge(SessionClient *client, uint32_t id, char *request, int nbytes)
 {
   static char *sfmt = "pidof %s::%s => %d\n";
 
   int mark = strlen(_GSESSION_SERVICE); // 0123456789012345
 					// =:gsession # b:=
-  char request[MAX_COMMAND];
-
   pid_t pid = getpid(); // main process |_GSESSION_BACKEND |_GSESSION_MONITOR
-  int nbytes;
-
-  memset(request, 0, MAX_COMMAND);
-  nbytes = read(connection, request, MAX_COMMAND);
-
-  if (nbytes < 0)
-    perror("reading request from stream socket");
-  else if (nbytes > 0) {
-    request[nbytes] = 0;	// chomp request to nbytes read
-
-    if (strcmp(request, _GET_SESSION_PID) == 0) {
-      if (pid == _master)	// _GSESSION_MANAGER main process
-        sessionlog_stamp(1, "pidof %s => %d\n", Program, pid);
-      else {
-        if (pid == _monitor)	// _GSESSION_MONITOR process thread
-          sessionlog_stamp(1, sfmt, Program, _GSESSION_MONITOR, pid);
-        else
-          sessionlog_stamp(1, sfmt, Program, _GSESSION_BACKEND, pid);
-      }
-      sprintf(request, "%d\n", pid);
-    }
-    else if (strncmp(request, _GSESSION_SERVICE, mark) == 0) {
-      if (pid == _monitor)
-        session_monitor_request (request);
+
+  request[nbytes] = 0;	// chomp request to nbytes read
+
+  if (strcmp(request, _GET_SESSION_PID) == 0) {
+    if (pid == _master)	// _GSESSION_MANAGER main process
+      sessionlog_stamp(1, "pidof %s => %d\n", Program, pid);
+    else {
+      if (pid == _monitor)	// _GSESSION_MONITOR process thread
+        sessionlog_stamp(1, sfmt, Program, _GSESSION_MONITOR, pid);
       else
-        strcpy(request, "\n");
-    }
-    else {  // spawn( request )
-      sessionlog_stamp(1, "spawn( %s )\n", request);
-      sprintf(request, "%d\n", spawn( request ));
+        sessionlog_stamp(1, sfmt, Program, _GSESSION_BACKEND, pid);
     }
-    write (connection, request, strlen(request));
+    sprintf(request, "%d\n", pid);
   }
-  return nbytes;
+  else if (strncmp(request, _GSESSION_SERVICE, mark) == 0) {
+    if (session_monitor_ask (client, id, request))
+      return -1;		/* answered by _GSESSION_MONITOR */
+
+    strcpy(request, "\n");
+  }
+  else {  // spawn( request )
+    sessionlog_stamp(1, "spawn( %s )\n", request);
+    sprintf(request, "%d\n", spawn( request ));
+  }
+  return strlen(request);
 } /* </acknowledge> */
 
+/*
+* Session stream clients, see session_serve()
+*/
+struct _SessionClient
+{
+  int  fd;
+  bool framed;			/* SessionFrame messages, else text */
+  bool known;			/* framed was decided on the first byte */
+
+  char   input[sizeof(SessionFrame) + _GSESSION_MESSAGE_MAX + 1];
+  size_t inlen;
+
+  char  *output;		/* replies not yet written */
+  size_t outlen;
+  size_t outsize;
+
+  uint32_t events;		/* epoll events registered */
+
+  int  waiting;			/* requests the monitor has yet to answer */
+  bool closing;			/* input ended, closed once answered */
+};
+
+/*
+* _GSESSION_SERVICE requests passed to the monitor, oldest first. All wait
+* the same _monitor_seconds_interval, so the first is the first due.
+*/
+typedef struct _SessionPending SessionPending;
+
+struct _SessionPending
+{
+  SessionClient *client;	/* NULL once the client is closed */
+  uint32_t id;			/* frame id the reply echoes */
+  uint32_t tag;			/* of the request on _channel */
+  long deadline;		/* session_clock() when "\n" is answered */
+
+  SessionPending *next;
+};
+
+static SessionPending *pending_ = NULL;
+static SessionPending **pending_end_ = &pending_;
+
+/*
+* (private) session_client_queue - append reply bytes to the output
+*/
+static void
+session_client_queue(SessionClient *client, const void *data, size_t size)
+{
+  if (client->outlen + size > client->outsize) {
+    client->outsize = 2 * (client->outlen + size);
+    client->output  = realloc(client->output, client->outsize);
+  }
+  memcpy(client->output + client->outlen, data, size);
+  client->outlen += size;
+} /* </session_client_queue> */
+
+/*
+* (private) session_client_flush - write what the socket takes now
+*
+* MSG_NOSIGNAL: a client gone with replies pending must not SIGPIPE us.
+*/
+static bool
+session_client_flush(SessionClient *client)
+{
+  while (client->outlen > 0) {
+    ssize_t nbytes = send(client->fd, client->output, client->outlen,
+                          MSG_NOSIGNAL);
+
+    if (nbytes < 0)
+      return (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR);
+
+    memmove(client->output, client->output + nbytes, client->outlen - nbytes);
+    client->outlen -= nbytes;
+  }
+  return true;
+} /* </session_client_flush> */
+
+/*
+* (private) session_client_answer - queue a reply of the monitor
+*/
+static void
+session_client_answer(SessionClient *client, uint32_t id, const char *reply)
+{
+  SessionFrame frame = { .id = id, .length = strlen(reply) };
+
+  if (client->framed) {
+    memcpy(frame.magic, _GSESSION_MAGIC, sizeof(frame.magic));
+    session_client_queue(client, &frame, sizeof(SessionFrame));
+  }
+  session_client_queue(client, reply, frame.length);
+} /* </session_client_answer> */
+
+/*
+* (private) session_client_ready - more input may be read
+*
+* Not with _GSESSION_BACKLOG_MAX reply bytes queued, nor while a text
+* client waits on the monitor: its replies have no id to order them.
+*/
+static bool
+session_client_ready(SessionClient *client)
+{
+  if (client->closing || client->outlen >= _GSESSION_BACKLOG_MAX)
+    return false;
+
+  return (client->framed || client->waiting == 0);
+} /* </session_client_ready> */
+
+/*
+* (private) session_client_parse - answer every complete request buffered
+*/
+static bool
+session_client_parse(SessionClient *client)
+{
+  char request[_GSESSION_MESSAGE_MAX + MAX_COMMAND];
+
+  if (!client->known && client->inlen > 0) {
+    client->framed = (client->input[0] == _GSESSION_MAGIC[0]);
+    client->known  = true;
+  }
+
+  if (!client->framed) {	/* original protocol: one read, one request */
+    int nbytes;
+
+    memcpy(request, client->input, client->inlen);
+    nbytes = acknowledge(client, 0, request, client->inlen);
+    client->inlen = 0;
+
+    if (nbytes >= 0)
+      session_client_queue(client, request, nbytes);
+    return true;
+  }
+
+  while (client->inlen >= sizeof(SessionFrame)) {
+    SessionFrame frame;
+    size_t size;
+    int nbytes;
+
+    memcpy(&frame, client->input, sizeof(SessionFrame));
+
+    if (memcmp(frame.magic, _GSESSION_MAGIC, sizeof(frame.magic)) != 0 ||
+        frame.length > _GSESSION_MESSAGE_MAX) {
+      sessionlog_stamp(1, "[%s] client %d: bad frame, closed\n",
+			_GSESSION_BACKEND, client->fd);
+      return false;
+    }
+
+    if (client->inlen < (size = sizeof(SessionFrame) + frame.length))
+      break;			/* partial payload, wait for more */
+
+    memcpy(request, client->input + sizeof(SessionFrame), frame.length);
+    nbytes = acknowledge(client, frame.id, request, frame.length);
+
+    if (nbytes >= 0) {
+      frame.length = nbytes;
+      session_client_queue(client, &frame, sizeof(SessionFrame));
+      session_client_queue(client, request, frame.length);
+    }
+
+    memmove(client->input, client->input + size, client->inlen - size);
+    client->inlen -= size;
+  }
+  return true;
+} /* </session_client_parse> */
+
+/*
+* (private) session_client_read - read and answer until the socket is dry
+*/
+static bool
+session_client_read(SessionClient *client)
+{
+  while (session_client_ready(client)) {
+    size_t space = sizeof(client->input) - 1 - client->inlen;
+    ssize_t nbytes = read(client->fd, client->input + client->inlen, space);
+
+    if (nbytes == 0)		/* client closed the connection */
+      return false;
+
+    if (nbytes < 0)
+      return (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR);
+
+    client->inlen += nbytes;
+
+    if (!session_client_parse(client))
+      return false;
+  }
+  return true;
+} /* </session_client_read> */
+
+/*
+* (private) session_client_close
+*/
+static void
+session_client_close(int epoll, SessionClient *client)
+{
+  SessionPending *entry;
+
+  for (entry = pending_; entry != NULL; entry = entry->next)
+    if (entry->client == client)
+      entry->client = NULL;	/* its reply is dropped */
+
+  epoll_ctl(epoll, EPOLL_CTL_DEL, client->fd, NULL);
+  close(client->fd);
+  free(client->output);
+  free(client);
+} /* </session_client_close> */
+
+/*
+* (private) session_client_events - wait for input, or output to drain
+*
+* A client with _GSESSION_BACKLOG_MAX reply bytes queued is not read
+* until it reads its replies, so no client can make gsession block.
+* EPOLLRDHUP goes with EPOLLIN: a throttled client that half-closes
+* would report it on every epoll_wait() with nothing for us to do. The
+* end of input is read once its replies drain.
+*/
+static void
+session_client_events(int epoll, SessionClient *client)
+{
+  struct epoll_event event;
+
+  event.events = 0;
+  event.data.ptr = client;
+
+  if (session_client_ready(client))
+    event.events |= EPOLLIN | EPOLLRDHUP;
+
+  if (client->outlen > 0)
+    event.events |= EPOLLOUT;
+
+  if (event.events != client->events) {
+    epoll_ctl(epoll, EPOLL_CTL_MOD, client->fd, &event);
+    client->events = event.events;
+  }
+} /* </session_client_events> */
+
+/*
+* (private) session_client_settle - write replies, close once all are out
+*/
+static void
+session_client_settle(int epoll, SessionClient *client)
+{
+  if (!session_client_flush(client) ||
+      (client->closing && client->waiting == 0))
+    session_client_close(epoll, client);
+  else
+    session_client_events(epoll, client);
+} /* </session_client_settle> */
+
+/*
+* session_monitor_ask - pass a _GSESSION_SERVICE request to the monitor
+*
+* monitor_[] is kept by the monitor process. The request goes out tagged
+* on _channel, and session_serve() goes on serving other clients: the
+* reply is queued for client when its tag comes back, or "\n" after
+* _monitor_seconds_interval. FALSE when the request could not be passed.
+*/
+bool
+session_monitor_ask(SessionClient *client, uint32_t id, char *request)
+{
+  static uint32_t tag = 0;
+
+  char message[sizeof(uint32_t) + MAX_COMMAND];
+  size_t length = strlen(request);
+  SessionPending *entry;
+
+  if (_channel < 0 || length >= MAX_COMMAND)
+    return false;
+
+  tag++;
+  memcpy(message, &tag, sizeof(tag));
+  memcpy(message + sizeof(tag), request, length);
+
+  if (send(_channel, message, sizeof(tag) + length,
+           MSG_DONTWAIT | MSG_NOSIGNAL) < 0) {
+    sessionlog_stamp(1, "[%s] %s unreachable\n", _GSESSION_BACKEND,
+			_GSESSION_MONITOR);
+    return false;
+  }
+
+  entry = calloc(1, sizeof(SessionPending));
+  entry->client = client;
+  entry->id = id;
+  entry->tag = tag;
+  entry->deadline = session_clock() + _monitor_seconds_interval * 1000;
+
+  *pending_end_ = entry;
+  pending_end_ = &entry->next;
+  client->waiting++;
+
+  return true;
+} /* </session_monitor_ask> */
+
+/*
+* (private) session_monitor_answer - reply to the pending request at link
+*/
+static void
+session_monitor_answer(int epoll, SessionPending **link, const char *reply)
+{
+  SessionPending *entry = *link;
+
+  if ((*link = entry->next) == NULL)
+    pending_end_ = link;
+
+  if (entry->client != NULL) {
+    entry->client->waiting--;
+    session_client_answer(entry->client, entry->id, reply);
+    session_client_settle(epoll, entry->client);
+  }
+  free(entry);
+} /* </session_monitor_answer> */
+
+/*
+* (private) session_monitor_reply - answer what the monitor replied
+*/
+static void
+session_monitor_reply(int epoll)
+{
+  char message[sizeof(uint32_t) + MAX_COMMAND];
+  ssize_t nbytes;
+
+  while ((nbytes = recv(_channel, message, sizeof(message) - 1,
+                        MSG_DONTWAIT)) > 0) {
+    SessionPending **link = &pending_;
+    uint32_t tag;
+
+    if (nbytes < sizeof(tag))
+      continue;
+
+    memcpy(&tag, message, sizeof(tag));
+    message[nbytes] = 0;
+
+    while (*link != NULL && (*link)->tag != tag)
+      link = &(*link)->next;
+
+    if (*link != NULL)		/* else it came after its deadline */
+      session_monitor_answer(epoll, link, message + sizeof(tag));
+  }
+
+  if (nbytes == 0 || (errno != EAGAIN && errno != EINTR)) {
+    sessionlog_stamp(1, "[%s] %s is gone\n", _GSESSION_BACKEND,
+			_GSESSION_MONITOR);
+    epoll_ctl(epoll, EPOLL_CTL_DEL, _channel, NULL);
+    close(_channel);
+    _channel = -1;		/* requests now answered "\n" at once */
+  }
+} /* </session_monitor_reply> */
+
+/*
+* (private) session_monitor_expire - answer "\n" past the deadline
+*
+* Returns the epoll_wait() timeout until the next deadline, -1 if none.
+*/
+static int
+session_monitor_expire(int epoll)
+{
+  long now = session_clock();
+
+  while (pending_ != NULL && pending_->deadline <= now) {
+    sessionlog_stamp(1, "[%s] no reply from %s\n", _GSESSION_BACKEND,
+			_GSESSION_MONITOR);
+    session_monitor_answer(epoll, &pending_, "\n");
+  }
+  return (pending_ != NULL) ? pending_->deadline - now : -1;
+} /* </session_monitor_expire> */
+
+/*
+* session_serve - answer every client from one epoll(7) loop
+*
+* Replies of the monitor are answered after the other events, so no
+* client closed by session_client_settle() is left in events[].
+*/
+void
+session_serve(int listener)
+{
+  static int listening, signaling, answering;	/* epoll tags */
+
+  struct epoll_event event, events[32];
+  sigset_t mask;
+  int epoll, signals, idx, count, timeout = -1;
+  bool replies;
+
+  /* SIGCHLD of spawned programs is read here, not in signal_responder */
+  sigemptyset(&mask);
+  sigaddset(&mask, SIGCHLD);
+  sigprocmask(SIG_BLOCK, &mask, NULL);
+
+  signals = signalfd(-1, &mask, SFD_NONBLOCK | SFD_CLOEXEC);
+  epoll = epoll_create1(EPOLL_CLOEXEC);
+
+  if (epoll < 0 || signals < 0) {
+    perror("session_serve: epoll_create1() or signalfd() failed.");
+    _exit (EX_OSERR);
+  }
+  fcntl(listener, F_SETFL, fcntl(listener, F_GETFL) | O_NONBLOCK);
+
+  event.events = EPOLLIN;
+  event.data.ptr = &listening;
+  epoll_ctl(epoll, EPOLL_CTL_ADD, listener, &event);
+
+  event.data.ptr = &signaling;
+  epoll_ctl(epoll, EPOLL_CTL_ADD, signals, &event);
+
+  if (_channel >= 0) {
+    event.data.ptr = &answering;
+    epoll_ctl(epoll, EPOLL_CTL_ADD, _channel, &event);
+  }
+
+  for ( ;; ) {
+    if ((count = epoll_wait(epoll, events, 32, timeout)) < 0) {
+      if (errno != EINTR) perror("session_serve: epoll_wait() failed.");
+      count = 0;
+    }
+    replies = false;
+
+    for (idx = 0; idx < count; idx++) {
+      SessionClient *client = events[idx].data.ptr;
+      int connection;
+
+      if (events[idx].data.ptr == &listening) {
+        while ((connection = accept4(listener, 0, 0,
+                                     SOCK_NONBLOCK | SOCK_CLOEXEC)) >= 0) {
+          client = calloc(1, sizeof(SessionClient));
+          client->fd = connection;
+          client->events = event.events = EPOLLIN | EPOLLRDHUP;
+          event.data.ptr = client;
+          epoll_ctl(epoll, EPOLL_CTL_ADD, connection, &event);
+        }
+        continue;
+      }
+
+      if (events[idx].data.ptr == &signaling) {
+        struct signalfd_siginfo info;
+
+        while (read(signals, &info, sizeof(info)) == sizeof(info)) ;
+        while (waitpid(-1, NULL, WNOHANG) > 0) ;
+        continue;
+      }
+
+      if (events[idx].data.ptr == &answering) {
+        replies = true;
+        continue;
+      }
+
+      /* end of input, or a bad frame: close once the monitor answered */
+      if ((events[idx].events & EPOLLIN) && !session_client_read(client))
+        client->closing = true;
+
+      if (events[idx].events & (EPOLLERR | EPOLLHUP)) {
+        session_client_flush(client);	/* best effort, then close */
+        session_client_close(epoll, client);
+        continue;
+      }
+      session_client_settle(epoll, client);
+    }
+
+    if (replies)
+      session_monitor_reply(epoll);
+
+    timeout = session_monitor_expire(epoll);
+  }
+} /* </session_serve> */
+
 /*
 * open_stream_socket - open communication stream socket
 */
@@ -467,7 +1186,7 @@ open_stream_socket(const char *sockname)
     return 1;
   }
 
-  if (listen(_stream, 5)) {
+  if (listen(_stream, SOMAXCONN)) {
     perror("listen stream socket");
     return 1;
   }
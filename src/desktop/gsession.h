@@ -29,6 +29,11 @@
 /* special request - get gsession main process ID */
 #define _GET_SESSION_PID "=:_gsession_:="
 
+/* framed messages, see SessionFrame */
+#define _GSESSION_MAGIC       "\0GS1"	/* NUL first, never a text request */
+#define _GSESSION_MESSAGE_MAX 1024	/* longest request or reply payload */
+#define _GSESSION_BACKLOG_MAX 65536	/* reply bytes queued before reading stops */
+
 #define _GSESSION_MANAGER  "gsession"	/* gsession master process */
 #define _GSESSION_MONITOR  "monitor"	/* gsession monitor process */
 #define _GSESSION_BACKEND  "backend"	/* gsession backend process */
@@ -40,6 +45,11 @@
 #define _TASKBAR	    3		/* SessionMonitor monitor_[3] */
 #define SessionMonitorCount 4
 
+#define _RESPAWN_BACKOFF    500		/* second restart delay, milliseconds */
+#define _RESPAWN_BACKOFF_MAX 60000	/* restart delay ceiling, milliseconds */
+#define _RESPAWN_STABLE     30		/* seconds up before failures reset */
+#define _RESPAWN_CRASH_LIMIT 5		/* exits in a row before giving up */
+
 #define _SIGALRM_GRACETIME  2		/* SIGALRM gracetime in seconds */
 #define _SIGTERM_GRACETIME  1		/* SIGTERM gracetime in seconds */
 
@@ -58,6 +68,28 @@ struct _SessionMonitor		/* array helper for process monitor */
   pid_t process;
   const char *program;
   bool enabled;
+
+  int pidfd;			/* pidfd_open(process), -1 => none */
+  int failures;			/* exits in a row without a stable run */
+  long started;			/* monotonic milliseconds at (re)spawn */
+  long respawn;			/* monotonic milliseconds due, 0 => none */
+};
+
+/*
+ * A client may keep its connection and send several framed requests
+ * before reading the replies, which come back in order with the same id.
+ * Connections whose first byte is not NUL speak the original protocol:
+ * each read is one text request, answered with one text reply.
+ */
+#include <stdint.h>
+
+typedef struct _SessionFrame SessionFrame;
+
+struct _SessionFrame		/* header of every framed message */
+{
+  char magic[4];		/* _GSESSION_MAGIC */
+  uint32_t id;			/* request ID, echoed by the reply */
+  uint32_t length;		/* payload bytes that follow */
 };
 
 #include <sys/socket.h>
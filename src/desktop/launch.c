@@ -0,0 +1,225 @@
+/**
+ * Copyright (C) Generations Linux <bugs@softcraft.org>
+ * All Rights Reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "gould.h"      /* common package declarations */
+#include "gpanel.h"
+#include "gsession.h"
+#include "launchstat.h"
+#include "proctable.h"
+
+extern const char *Program;	/* see, gpanel.c */
+
+/*
+* Private data structures.
+*
+* A launch is timed from the click until the first window of the program
+* started, or of a descendant of it, appears in _NET_CLIENT_LIST as seen
+* by the GREEN "window-opened" signal. The pid comes from gsession and
+* windows are matched on _NET_WM_PID.
+*/
+typedef struct _LaunchPending LaunchPending;
+
+struct _LaunchPending
+{
+  gchar *application;		/* program basename, see launchstat.c */
+
+  gint64 clicked;		/* g_get_monotonic_time() of the request */
+  gint64 spawned;		/* ... of the gsession answer */
+
+  pid_t pid;			/* 0 until gsession answers */
+  guint timer;			/* LAUNCH_TIMEOUT source */
+};
+
+static struct
+{
+  GList *pending;		/* LaunchPending, oldest first */
+  gulong handler;		/* "window-opened" handler */
+} launch_;
+
+/*
+* (private) launch_application - program basename of a command line
+*/
+static gchar *
+launch_application (const char *command)
+{
+  gchar **argv = NULL;
+  gchar *name = NULL;
+  int idx;
+
+  if (g_shell_parse_argv (command, NULL, &argv, NULL)) {
+    for (idx = 0; argv[idx] != NULL; idx++) {
+      if (strcmp(argv[idx], "env") == 0 ||		/* env VAR=value ... */
+          (argv[idx][0] != '/' && strchr(argv[idx], '=') != NULL))
+        continue;
+
+      name = g_path_get_basename (argv[idx]);
+      break;
+    }
+    g_strfreev (argv);
+  }
+  return (name) ? name : g_strdup (command);
+} /* </launch_application> */
+
+/*
+* (private) launch_forget - release a pending launch
+*/
+static void
+launch_forget (LaunchPending *launch)
+{
+  launch_.pending = g_list_remove (launch_.pending, launch);
+
+  if (launch->timer)
+    g_source_remove (launch->timer);
+
+  g_free (launch->application);
+  g_free (launch);
+} /* </launch_forget> */
+
+/*
+* (private) launch_expire - no window within LAUNCH_TIMEOUT seconds
+*
+* Counted as lost, as are programs handing their request over to an
+* instance already running.
+*/
+static gboolean
+launch_expire (LaunchPending *launch)
+{
+  vdebug(1, "%s: %s (pid => %d) no window\n", __func__,
+			launch->application, launch->pid);
+
+  launch->timer = 0;
+  launchstat_record (launch->application, -1);
+  launch_forget (launch);
+
+  return FALSE;
+} /* </launch_expire> */
+
+/*
+* (private) launch_spawned - GpanelDispatchReply, pid of the launch
+*/
+static void
+launch_spawned (pid_t pid, LaunchPending *launch)
+{
+  if (pid <= 0) {		/* not started, nothing to time */
+    launch_forget (launch);
+    return;
+  }
+
+  launch->pid = pid;
+  launch->spawned = g_get_monotonic_time ();
+
+  vdebug(2, "%s: %s (pid => %d) in %ld ms\n", __func__, launch->application,
+			pid, (long)(launch->spawned - launch->clicked) / 1000);
+} /* </launch_spawned> */
+
+/*
+* (private) launch_ancestry - pid and its ancestors, at most size of them
+*/
+static int
+launch_ancestry (pid_t pid, pid_t *ancestry, int size)
+{
+  ProcessTable *table = proctable_snapshot ();
+  const ProcessEntry *entry;
+  int count = 0;
+
+  ancestry[count++] = pid;
+
+  while (count < size && pid > 1 &&
+         (entry = proctable_lookup (table, pid)) != NULL)
+    ancestry[count++] = pid = entry->ppid;
+
+  proctable_unref (table);
+  return count;
+} /* </launch_ancestry> */
+
+/*
+* (private) launch_window_opened - GREEN "window-opened" handler
+*/
+static void
+launch_window_opened (Green *green, GreenWindow *window, gpointer data)
+{
+  pid_t ancestry[LAUNCH_ANCESTRY];
+  Window xid;
+  GList *iter;
+  pid_t pid;
+  int count, idx;
+
+  if (launch_.pending == NULL)
+    return;
+
+  xid = green_window_get_xid (window);
+
+  if ((pid = get_window_pid (xid)) <= 0)
+    return;
+
+  count = launch_ancestry (pid, ancestry, LAUNCH_ANCESTRY);
+
+  for (iter = launch_.pending; iter != NULL; iter = iter->next) {
+    LaunchPending *launch = iter->data;
+
+    if (launch->pid <= 0)
+      continue;
+
+    for (idx = 0; idx < count; idx++)
+      if (ancestry[idx] == launch->pid) {
+        glong latency = (g_get_monotonic_time () - launch->clicked) / 1000;
+
+        vdebug(1, "%s: %s window 0x%lx (pid => %d) in %ld ms\n", __func__,
+			launch->application, xid, pid, latency);
+
+        launchstat_record (launch->application, latency);
+        launch_forget (launch);
+        return;
+      }
+  }
+} /* </launch_window_opened> */
+
+/*
+* gpanel_launch - dispatch command, timing it until its first window
+*/
+void
+gpanel_launch (GlobalPanel *panel, const char *command)
+{
+  LaunchPending *launch = g_new0 (LaunchPending, 1);
+
+  if (launch_.handler == 0)
+    launch_.handler = g_signal_connect (G_OBJECT (panel->green),
+                                        "window-opened",
+                                        G_CALLBACK (launch_window_opened),
+                                        NULL);
+
+  launch->application = launch_application (command);
+  launch->clicked = g_get_monotonic_time ();
+  launch->timer = g_timeout_add_seconds (LAUNCH_TIMEOUT,
+                                         (GSourceFunc)launch_expire, launch);
+
+  launch_.pending = g_list_append (launch_.pending, launch);
+
+  gpanel_dispatch_async (panel->session, command, _SIGALRM_GRACETIME * 1000,
+                         (GpanelDispatchReply)launch_spawned, launch);
+} /* </gpanel_launch> */
+
+/*
+* gpanel_launch_pending - launches still waiting for their window
+*/
+guint
+gpanel_launch_pending (void)
+{
+  return g_list_length (launch_.pending);
+} /* </gpanel_launch_pending> */
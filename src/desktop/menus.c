@@ -35,6 +35,10 @@ extern const char *ConfigurationHeader, *Schema;        /* ... */
 /* Needed forward function declarations. */
 static void exit_cancel (GtkWidget *button, GlobalPanel *panel);
 
+GtkWidget *menu_element_config (ConfigurationNode *node,
+                                GlobalPanel *panel,
+                                gint iconsize);
+
 #ifdef NEVER
 /*
 * (private) shortcut_cb
@@ -352,7 +356,7 @@ item_check_access (ConfigurationNode *node, GlobalPanel *panel, gchar *attr)
       }
     }
     else {
-      const gchar *pathname = path_finder (panel->path, file);
+      const gchar *pathname = path_index_lookup (panel->execs, file);
 
       if (pathname != NULL) {
         size_t bytes = strlen(pathname) + strlen(args);
@@ -369,6 +373,9 @@ item_check_access (ConfigurationNode *node, GlobalPanel *panel, gchar *attr)
 
 /**
 * (protected) spawn_selected forks child process for selected application
+*
+* The request goes to gsession without waiting for its answer: returns 0
+* once dispatched, -1 when the command is not found.
 */
 pid_t
 spawn_selected (ConfigurationNode *node, GlobalPanel *panel)
@@ -378,7 +385,8 @@ spawn_selected (ConfigurationNode *node, GlobalPanel *panel)
 
   if (cmdline != NULL) {
     vdebug(2, "%s: cmdline => %s\n", __func__, cmdline);
-    pid = gpanel_dispatch (panel->session, cmdline);
+    gpanel_launch (panel, cmdline);
+    pid = 0;
   }
   else
     gpanel_dialog(100, 100, ICON_WARNING, "[%s]%s: %s.",
@@ -634,6 +642,204 @@ shutdown_dialog_new (GlobalPanel *panel)
   return dialog;
 } /* shutdown_dialog_new */
 
+/*
+* Start menu construction is lazy: a <submenu> is populated the first time
+* it is selected, icons are placeholders filled in from an idle callback,
+* and built submenus are kept in a cache bounded in bytes (the least
+* recently selected are emptied first, to be built again when needed).
+*/
+#define MENU_CACHE_LIMIT (2 * 1024 * 1024)  /* bytes of built submenus */
+#define MENU_ITEM_BYTES  1024		    /* estimate per menu item */
+#define MENU_ICON_BATCH  8		    /* icons loaded per idle call */
+
+typedef struct _MenuIcon    MenuIcon;
+typedef struct _MenuSubmenu MenuSubmenu;
+
+struct _MenuIcon
+{
+  GtkWidget *image;		/* placeholder GtkImage (referenced) */
+  gchar *file;			/* icon file, see icon_path_finder() */
+  gint size;
+};
+
+struct _MenuSubmenu
+{
+  ConfigurationNode *node;	/* <submenu> configuration */
+  GlobalPanel *panel;
+  GtkWidget *menu;		/* GtkMenu, empty until built */
+  gint16 iconsize;
+  gsize bytes;			/* estimate once built, 0 => not built */
+};
+
+static struct {
+  GQueue *icons;		/* MenuIcon waiting to be loaded */
+  guint idle;			/* menu_icon_idle() source */
+  GList *built;			/* MenuSubmenu, most recent first */
+  gsize bytes;			/* sum of built MenuSubmenu bytes */
+} menucache_ = { NULL, 0, NULL, 0 };
+
+/*
+* (private) menu_icon_idle - load a batch of queued menu icons
+*/
+static gboolean
+menu_icon_idle (gpointer data)
+{
+  for (int idx = 0; idx < MENU_ICON_BATCH; idx++) {
+    MenuIcon *job = g_queue_pop_head (menucache_.icons);
+
+    if (job == NULL) {
+      menucache_.idle = 0;
+      return FALSE;
+    }
+
+    /* The menu may have been destroyed in the meantime. */
+    if (gtk_widget_get_parent (job->image) != NULL) {
+      GdkPixbuf *pixbuf = pixbuf_new_from_file_scaled (job->file,
+                                                       job->size, job->size);
+      if (pixbuf != NULL) {
+        gtk_image_set_from_pixbuf (GTK_IMAGE (job->image), pixbuf);
+        g_object_unref (pixbuf);
+      }
+    }
+
+    g_object_unref (job->image);
+    g_free (job->file);
+    g_free (job);
+  }
+  return TRUE;
+} /* </menu_icon_idle> */
+
+/*
+* (private) menu_icon_new - placeholder image, the icon is loaded later
+*/
+static GtkWidget *
+menu_icon_new (const gchar *file, gint size)
+{
+  GtkWidget *image = gtk_image_new ();
+  MenuIcon *job = g_new (MenuIcon, 1);
+
+  gtk_widget_set_size_request (image, size, size);
+
+  job->image = g_object_ref (image);
+  job->file  = g_strdup (file);
+  job->size  = size;
+
+  if (menucache_.icons == NULL)
+    menucache_.icons = g_queue_new ();
+
+  g_queue_push_tail (menucache_.icons, job);
+
+  if (menucache_.idle == 0)
+    menucache_.idle = g_idle_add_full (G_PRIORITY_LOW, menu_icon_idle,
+                                       NULL, NULL);
+  return image;
+} /* </menu_icon_new> */
+
+/*
+* (private) menu_submenu_fill - append the elements of chain to options
+*/
+static guint
+menu_submenu_fill (GtkWidget *options, ConfigurationNode *chain,
+                   GlobalPanel *panel, gint16 iconsize)
+{
+  ConfigurationNode *node;
+  GtkWidget *item;
+  guint depth = chain->depth + 1;
+  guint count = 0;
+
+  for (node = chain->next; node != NULL; node = node->next) {
+    if (node->depth == depth && node->type != XML_READER_TYPE_END_ELEMENT) {
+      if ((item = menu_element_config (node, panel, iconsize)) != NULL) {
+        gtk_menu_shell_append (GTK_MENU_SHELL(options), item);
+        gtk_widget_show (item);
+        count++;
+      }
+    }
+    else if (node->depth == chain->depth)  /* same depth.. move on */
+      break;
+  }
+  return count;
+} /* </menu_submenu_fill> */
+
+/*
+* (private) menu_submenu_clear - empty a built submenu, leave the cache
+*/
+static void
+menu_submenu_clear (MenuSubmenu *submenu)
+{
+  menucache_.built  = g_list_remove (menucache_.built, submenu);
+  menucache_.bytes -= submenu->bytes;
+  submenu->bytes = 0;
+
+  /* Nested built submenus leave the cache as they are destroyed. */
+  gtk_container_foreach (GTK_CONTAINER (submenu->menu),
+                         (GtkCallback)gtk_widget_destroy, NULL);
+} /* </menu_submenu_clear> */
+
+/*
+* (private) menu_cache_trim - empty least recently used, keep those shown
+*/
+static void
+menu_cache_trim (void)
+{
+  bool trimmed = true;
+
+  while (menucache_.bytes > MENU_CACHE_LIMIT && trimmed) {
+    GList *iter;
+
+    trimmed = false;
+
+    for (iter = g_list_last (menucache_.built); iter; iter = iter->prev) {
+      MenuSubmenu *submenu = iter->data;
+
+      if (!GTK_WIDGET_MAPPED (submenu->menu)) {
+        vdebug (2, "%s %s (%lu bytes)\n", __func__,
+                configuration_attrib (submenu->node, "name"),
+                (unsigned long)submenu->bytes);
+
+        menu_submenu_clear (submenu);	/* may change menucache_.built */
+        trimmed = true;
+        break;
+      }
+    }
+  }
+} /* </menu_cache_trim> */
+
+/*
+* (private) menu_submenu_select - build on first use, else mark as recent
+* (private) menu_submenu_destroy - forget the submenu
+*/
+static void
+menu_submenu_select (GtkMenuItem *item, MenuSubmenu *submenu)
+{
+  if (submenu->bytes == 0) {
+    guint count = menu_submenu_fill (submenu->menu, submenu->node,
+                                     submenu->panel, submenu->iconsize);
+
+    submenu->bytes = MAX(count, 1) * (MENU_ITEM_BYTES +
+                              submenu->iconsize * submenu->iconsize * 4);
+
+    menucache_.built  = g_list_prepend (menucache_.built, submenu);
+    menucache_.bytes += submenu->bytes;
+
+    menu_cache_trim ();
+  }
+  else {
+    menucache_.built = g_list_remove (menucache_.built, submenu);
+    menucache_.built = g_list_prepend (menucache_.built, submenu);
+  }
+} /* </menu_submenu_select> */
+
+static void
+menu_submenu_destroy (GtkWidget *menu, MenuSubmenu *submenu)
+{
+  if (submenu->bytes > 0) {
+    menucache_.built  = g_list_remove (menucache_.built, submenu);
+    menucache_.bytes -= submenu->bytes;
+  }
+  g_free (submenu);
+} /* </menu_submenu_destroy> */
+
 /*
 * menu_header_config
 */
@@ -684,7 +890,7 @@ menu_header_config (ConfigurationNode *config, GlobalPanel *panel)
 
     if (icon != NULL)
       if ((name = icon_path_finder (icons, icon)) != NULL) {
-        GtkWidget *image = image_new_from_file_scaled (name, iconsize,iconsize);
+        GtkWidget *image = menu_icon_new (name, iconsize);
         gtk_image_menu_item_set_image (GTK_IMAGE_MENU_ITEM (item), image);
       }
   }
@@ -716,7 +922,7 @@ menu_item_config (ConfigurationNode *config, GlobalPanel *panel, gint iconsize)
 
   if (icon != NULL)
     if ((name = icon_path_finder (icons, icon)) != NULL) {
-      image = image_new_from_file_scaled (name, iconsize, iconsize);
+      image = menu_icon_new (name, iconsize);
       gtk_image_menu_item_set_image (GTK_IMAGE_MENU_ITEM (item), image);
     }
 
@@ -750,17 +956,30 @@ menu_element_config (ConfigurationNode *node, GlobalPanel *panel, gint iconsize)
     item = gtk_separator_menu_item_new();
   }
   else if (strcmp(node->element, "submenu") == 0) {
+    MenuSubmenu *lazy = g_new0 (MenuSubmenu, 1);
+
     name = configuration_attrib (node, "name");
     item = gtk_image_menu_item_new_with_label (_(name));
 
     if ((icon = configuration_attrib (node, "icon")) != NULL)
       if ((name = icon_path_finder (icons, icon)) != NULL) {
-        image = image_new_from_file_scaled (name, iconsize, iconsize);
+        image = menu_icon_new (name, iconsize);
         gtk_image_menu_item_set_image (GTK_IMAGE_MENU_ITEM (item), image);
       }
 
-    submenu = menu_submenu_config (node, panel, iconsize);
+    /* Populated when first selected, see menu_submenu_select() */
+    submenu = gtk_menu_new ();
     gtk_menu_item_set_submenu (GTK_MENU_ITEM (item), submenu);
+
+    lazy->node = node;
+    lazy->panel = panel;
+    lazy->menu = submenu;
+    lazy->iconsize = iconsize;
+
+    g_signal_connect (G_OBJECT (item), "select",
+                      G_CALLBACK (menu_submenu_select), lazy);
+    g_signal_connect (G_OBJECT (submenu), "destroy",
+                      G_CALLBACK (menu_submenu_destroy), lazy);
   }
   return item;
 } /* </menu_element_config> */
@@ -771,20 +990,9 @@ menu_element_config (ConfigurationNode *node, GlobalPanel *panel, gint iconsize)
 GtkWidget *
 menu_submenu_config (ConfigurationNode *chain, GlobalPanel *panel, gint16 iconsize)
 {
-  ConfigurationNode *node;
-  GtkWidget *item, *options = gtk_menu_new ();
-  guint depth = chain->depth + 1;
+  GtkWidget *options = gtk_menu_new ();
 
-  for (node = chain->next; node != NULL; node = node->next) {
-    if (node->depth == depth && node->type != XML_READER_TYPE_END_ELEMENT) {
-      if ((item = menu_element_config (node, panel, iconsize)) != NULL) {
-        gtk_menu_shell_append (GTK_MENU_SHELL(options), item);
-        gtk_widget_show (item);
-      }
-    }
-    else if (node->depth == chain->depth)  /* same depth.. move on */
-      break;
-  }
+  menu_submenu_fill (options, chain, panel, iconsize);
   return options;
 } /* </menu_submenu_config> */
 
@@ -816,6 +1024,9 @@ menu_options_config (ConfigurationNode *menu, GlobalPanel *panel, gint16 iconsiz
         gtk_widget_show (item);
       }
   }
+  path_index_report (panel->execs, __func__);
+  path_index_report (panel->icons->index, __func__);
+
   return options;
 } /* </menu_options_config> */
 
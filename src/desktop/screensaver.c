@@ -1328,7 +1328,7 @@ screensaver_get_setting(const char *buffer, const char *pattern)
 bool
 screensaver_module_init (Modulus *applet, GlobalPanel *panel)
 {
-  if (path_finder(panel->path, _SCREENSAVER_COMMAND) == NULL) {
+  if (path_index_lookup(panel->execs, _SCREENSAVER_COMMAND) == NULL) {
     /* TODO: warn that we did not find the screen saver application */
     return false;
   }
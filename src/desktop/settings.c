@@ -1385,8 +1385,13 @@ settings_menu_apply (Modulus *applet)
   else
     settings_menu_reconstruct (panel, menueditor_.cache, NULL);
 
-  /* We need to reconstruct the start menu options. */
-  taskbar->options = menu_options_config (menueditor_.cache, panel,
+  /* We need to reconstruct the start menu options. Submenus are built
+     when first selected, so use the nodes now in panel->config, and drop
+     the old menu (and its built submenus) with the old configuration. */
+  if (taskbar->options)
+    gtk_widget_destroy (taskbar->options);
+
+  taskbar->options = menu_options_config (cache, panel,
 						taskbar->iconsize);
   if (debug > 1)
     configuration_write (panel->config, ConfigurationHeader, stdout);
@@ -1685,7 +1690,8 @@ settings_menu_item (GtkTreeSelection *selection, GlobalPanel *panel)
 
     if (icon) {
       gtk_widget_set_sensitive (menueditor_.icon_hbox, TRUE);
-      image = image_new_from_path_scaled (panel->icons->path, icon, 22, 22);
+      image = image_new_from_file_scaled (icon_path_finder (panel->icons, icon),
+                                          22, 22);
     }
     else {
       gtk_widget_set_sensitive (menueditor_.icon_hbox, FALSE);
@@ -1853,7 +1859,8 @@ settings_menu_icon_change (GlobalPanel *panel)
   const gchar *icon = gtk_entry_get_text (GTK_ENTRY(chooser->name));
   GtkWidget *image;
 
-  image = image_new_from_path_scaled (panel->icons->path, icon, 22, 22);
+  image = image_new_from_file_scaled (icon_path_finder (panel->icons, icon),
+                                      22, 22);
   gtk_button_set_image (GTK_BUTTON(menueditor_.icon_button), image);
   gtk_widget_set_sensitive (GTK_WIDGET(menueditor_.view), FALSE);
   menueditor_.change_icon = TRUE;
@@ -2215,7 +2222,8 @@ settings_menu_new (Modulus *applet)
   gtk_widget_show (button);
 
   value = configuration_attrib (menu, "icon");
-  image = image_new_from_path_scaled (icons->path, value, 22, 22);
+  image = image_new_from_file_scaled (icon_path_finder (icons, value),
+                                      22, 22);
   gtk_container_add (GTK_CONTAINER (button), image);
   gtk_widget_show (image);
 
@@ -2335,8 +2343,8 @@ settings_menu_config (GlobalPanel *panel, ConfigurationNode *menu,
 
 
   /* Add the top level menu item. */
-  GdkPixbuf *pixbuf = pixbuf_new_from_path_scaled (panel->icons->path,
-                                                   icon, iconsize, iconsize);
+  const gchar *file = icon_path_finder (panel->icons, icon);
+  GdkPixbuf *pixbuf = pixbuf_new_from_file_scaled (file, iconsize, iconsize);
   gtk_tree_store_append (store, root, NULL);
 
   gtk_tree_store_set (store, root,
@@ -0,0 +1,86 @@
+/**
+ * Copyright (C) Generations Linux <bugs@softcraft.org>
+ * All Rights Reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "gould.h"      /* common package declarations */
+#include "gpanel.h"
+
+/*
+* gpanel_shortcut_render - compose a desktop shortcut icon and label
+*
+* The label is laid out for the canvas widget in font and drawn white on
+* a transparent client side image, so composing needs no server request.
+*/
+GdkPixbuf *
+gpanel_shortcut_render (GtkWidget *canvas, const char *font,
+                        GdkPixbuf *piximg, const char *label)
+{
+  PangoFontDescription *fontdesc = pango_font_description_from_string (font);
+  PangoLayout *layout = gtk_widget_create_pango_layout (canvas, label);
+
+  cairo_surface_t *surface;
+  cairo_t *cr;
+  GdkPixbuf *render;	/* resulting pixbuf */
+
+  GdkColor white = { 0, 0xffff, 0xffff, 0xffff };
+
+  gint16 iconsize = gdk_pixbuf_get_width (piximg);
+  gint16 wrap = 3 * iconsize / 2;
+  gint width, height;
+  gint xsize, ysize;
+  gint xpos, ypos;
+
+  /* Set font according to the PangoFontDescription. */
+  pango_layout_set_font_description (layout, fontdesc);
+  pango_font_description_free (fontdesc);
+
+  /* Obtain the pixel width and height of the text. */
+  pango_layout_get_pixel_size (layout, &xsize, &ysize);
+
+  pango_layout_set_width (layout, wrap * PANGO_SCALE);
+  pango_layout_set_wrap (layout, PANGO_WRAP_WORD_CHAR);
+
+  xpos = (xsize > iconsize) ? (xsize-iconsize) / 2 : -1;
+  width = (xsize > iconsize) ? xsize : iconsize;
+  height = iconsize + ysize;
+
+  /* Draw on a transparent client side image surface. */
+  surface = cairo_image_surface_create (CAIRO_FORMAT_ARGB32, width, height);
+  cr = cairo_create (surface);
+
+  /* Draw the image pixbuf passed. */
+  gdk_cairo_set_source_pixbuf (cr, piximg, xpos, 0);
+  cairo_paint (cr);
+
+  /* Draw the label text passed. */
+  xpos = (iconsize > xsize) ? (iconsize-xsize) / 2 : -1;
+  ypos = iconsize;
+
+  gdk_cairo_set_source_color (cr, &white);
+  cairo_move_to (cr, xpos, ypos);
+  pango_cairo_show_layout (cr, layout);
+
+  g_object_unref (layout);
+  cairo_destroy (cr);
+
+  /* Convert surface to a pixbuf. */
+  render = pixbuf_new_from_surface (surface);
+  cairo_surface_destroy (surface);
+
+  return render;
+} /* </gpanel_shortcut_render> */
@@ -155,8 +155,14 @@ taskbar_initialize (GlobalPanel *panel, GtkWidget *layout)
   for (iter = panel->moduli; iter != NULL; iter = iter->next) {
     applet = (Modulus *)iter->data;
 
-    if (applet->module_open)
+    if (applet->module_open) {
+      GTimer *timer = g_timer_new ();
+
       applet->module_open (applet);
+      vdebug (1, "%s %s: module_open %.2f ms\n", Program, applet->name,
+              g_timer_elapsed (timer, NULL) * 1000);
+      g_timer_destroy (timer);
+    }
 
     if (applet->widget) {
       if (applet->place == PLACE_CONTAINER)	/* tasklist module */
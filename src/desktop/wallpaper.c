@@ -19,9 +19,17 @@
 
 #include "gould.h"      /* common package declarations */
 #include "gpanel.h"
+#include "bgcache.h"
 #include "filechooser.h"
 #include "module.h"
 
+#include <sys/resource.h>
+
+#define SLIDESHOW_INTERVAL 300	/* default seconds between images */
+#define SLIDESHOW_FRAMES   8	/* crossfade frames per transition */
+#define SLIDESHOW_PERIOD   50	/* milliseconds between crossfade frames */
+#define SLIDESHOW_BUDGET   25	/* milliseconds of CPU allowed per frame */
+
 #ifndef get_current_dir_name
 extern char *get_current_dir_name(void);
 #endif
@@ -49,11 +57,45 @@ struct _WallpaperSettings {
   char resource[MAX_PATHNAME];	/* resource path ($HOME/.config/desktop) */
 };
 
+typedef struct _WallpaperSlideshow WallpaperSlideshow;
+
+struct _WallpaperSlideshow {
+  GList *images;		/* image files of the slideshow folder */
+  GList *cursor;		/* image being prepared or shown */
+
+  GdkPixbuf *current;		/* screen sized pixels being shown */
+  GdkPixbuf *next;		/* screen sized pixels of the next image */
+  GdkPixbuf *blend;		/* crossfade scratch pixels */
+
+  gint width, height;		/* root window dimensions */
+  guint interval;		/* seconds each image is shown */
+  guint frame;			/* crossfade frame, zero when idle */
+
+  bool busy;			/* worker thread is decoding */
+  bool due;			/* switch as soon as next is ready */
+
+  gdouble cpu;			/* CPU seconds spent on this transition */
+};
+
+typedef struct _SlideshowJob SlideshowJob;
+
+struct _SlideshowJob {		/* the worker's, until slideshow_ready() */
+  WallpaperSlideshow *slide;
+  GList *cursor;		/* image being decoded */
+
+  gchar *pathname;
+  gint width, height;
+
+  GdkPixbuf *pixbuf;		/* screen sized pixels, NULL => cannot load */
+  gdouble cpu;			/* CPU seconds of the worker */
+};
+
 /* Forward prototype declarations. */
 static void
 setbg_refresh (GtkWidget *canvas, GdkEventExpose *ev, gpointer data);
 
 static WallpaperSettings config_;  /* private global structure singleton */
+static WallpaperSlideshow slide_;  /* slideshow state singleton */
 
 /*
 * (private) set background callback
@@ -352,6 +394,282 @@ setbg_initialize (GlobalPanel *panel)
   return config;
 } /* </setbg_initialize> */
 
+/*
+* (private) slideshow_cputime - CPU seconds used by the calling thread
+*/
+static gdouble
+slideshow_cputime (void)
+{
+  struct rusage usage;
+
+#ifdef RUSAGE_THREAD
+  getrusage(RUSAGE_THREAD, &usage);
+#else
+  getrusage(RUSAGE_SELF, &usage);
+#endif
+  return usage.ru_utime.tv_sec + usage.ru_stime.tv_sec +
+        (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1e6;
+} /* </slideshow_cputime> */
+
+/* Forward prototype declarations. */
+static void slideshow_prepare (WallpaperSlideshow *slide);
+static void slideshow_switch (WallpaperSlideshow *slide);
+
+/*
+* (private) slideshow_ready - main loop side of slideshow_worker
+*
+* The worker touches nothing but its job, so the slideshow state is only
+* ever read and written here on the main loop.
+*/
+static gboolean
+slideshow_ready (SlideshowJob *job)
+{
+  WallpaperSlideshow *slide = job->slide;
+
+  slide->busy = false;
+  slide->cpu += job->cpu;
+
+  if (job->pixbuf == NULL) {	/* cannot load, skip to the next image */
+    slide->images = g_list_remove_link (slide->images, job->cursor);
+    g_free (job->cursor->data);
+    g_list_free_1 (job->cursor);
+
+    if (slide->cursor == job->cursor)
+      slide->cursor = NULL;
+
+    if (slide->images)
+      slideshow_prepare (slide);
+  }
+  else {
+    slide->next = job->pixbuf;
+
+    if (slide->due)
+      slideshow_switch (slide);
+  }
+
+  g_free (job->pathname);
+  g_free (job);
+
+  return FALSE;
+} /* </slideshow_ready> */
+
+/*
+* (private) slideshow_worker - decode and scale the next image
+*/
+static gpointer
+slideshow_worker (SlideshowJob *job)
+{
+  gdouble start = slideshow_cputime ();
+
+  job->pixbuf = bgcache_pixbuf (job->pathname, job->width, job->height,
+                                BACKGROUND_SCALED);
+  job->cpu = slideshow_cputime () - start;
+
+  g_idle_add ((GSourceFunc)slideshow_ready, job);
+  return NULL;
+} /* </slideshow_worker> */
+
+/*
+* (private) slideshow_prepare - start decoding the image after cursor
+*/
+static void
+slideshow_prepare (WallpaperSlideshow *slide)
+{
+  SlideshowJob *job;
+  GThread *worker;
+
+  if (slide->busy || slide->next != NULL || slide->images == NULL)
+    return;
+
+  slide->cursor = (slide->cursor && slide->cursor->next) ?
+                   slide->cursor->next : slide->images;
+  slide->busy = true;
+  slide->cpu  = 0;
+
+  job = g_new0 (SlideshowJob, 1);
+  job->slide    = slide;
+  job->cursor   = slide->cursor;
+  job->pathname = g_strdup (slide->cursor->data);
+  job->width    = slide->width;
+  job->height   = slide->height;
+
+#if GLIB_CHECK_VERSION(2,32,0)
+  if ((worker = g_thread_try_new ("slideshow", (GThreadFunc)slideshow_worker,
+                                  job, NULL)) != NULL)
+    g_thread_unref (worker);
+#else
+  worker = (g_thread_supported ()) ?
+            g_thread_create ((GThreadFunc)slideshow_worker, job, FALSE, NULL)
+          : NULL;
+#endif
+  if (worker == NULL)
+    slideshow_worker (job);	/* no threads, decode in place */
+} /* </slideshow_prepare> */
+
+/*
+* (private) slideshow_fade - draw one crossfade frame on the root window
+*
+* Frames that go over SLIDESHOW_BUDGET end the fade early, so a slow
+* machine gets a shorter transition rather than a busy CPU.
+*/
+static gboolean
+slideshow_fade (WallpaperSlideshow *slide)
+{
+  GdkWindow *root = gdk_get_default_root_window ();
+  gdouble start = slideshow_cputime ();
+  GdkPixbuf *pixbuf;
+
+  if (++slide->frame < SLIDESHOW_FRAMES) {
+    gint alpha = 255 * slide->frame / SLIDESHOW_FRAMES;
+
+    gdk_pixbuf_copy_area (slide->current, 0, 0, slide->width, slide->height,
+                          slide->blend, 0, 0);
+    gdk_pixbuf_composite (slide->next, slide->blend, 0, 0,
+                          slide->width, slide->height, 0, 0, 1.0, 1.0,
+                          GDK_INTERP_NEAREST, alpha);
+
+    gdk_draw_pixbuf (root, NULL, slide->blend, 0, 0, 0, 0,
+                     slide->width, slide->height,
+                     GDK_RGB_DITHER_NONE, 0, 0);
+    gdk_flush ();
+
+    slide->cpu += slideshow_cputime () - start;
+
+    if ((slideshow_cputime () - start) * 1000 < SLIDESHOW_BUDGET)
+      return TRUE;
+
+    vdebug (2, "slideshow frame %d over budget\n", slide->frame);
+  }
+
+  /* Final image: set the root pixmap, and _XROOTPMAP_ID, only once. */
+  set_background_pixbuf (root, slide->next);
+  slide->cpu += slideshow_cputime () - start;
+
+  vdebug (1, "slideshow %s => %d frames, cpu %.3fs\n",
+              (gchar *)slide->cursor->data, slide->frame, slide->cpu);
+
+  pixbuf = slide->current;
+  slide->current = slide->next;
+  slide->next = NULL;
+  slide->frame = 0;
+
+  if (pixbuf) g_object_unref (pixbuf);
+  if (slide->blend) {
+    g_object_unref (slide->blend);
+    slide->blend = NULL;
+  }
+
+  slideshow_prepare (slide);	/* well ahead of the next switch */
+  return FALSE;
+} /* </slideshow_fade> */
+
+/*
+* (private) slideshow_switch - show the prepared image
+*/
+static void
+slideshow_switch (WallpaperSlideshow *slide)
+{
+  slide->due = false;
+
+  if (slide->frame > 0)		/* still fading */
+    return;
+
+  if (slide->next == NULL) {	/* not ready, switch when it is */
+    slide->due = true;
+    slideshow_prepare (slide);
+    return;
+  }
+
+  if (slide->current != NULL &&
+      gdk_pixbuf_get_n_channels (slide->current) ==
+      gdk_pixbuf_get_n_channels (slide->next)) {
+    slide->blend = gdk_pixbuf_copy (slide->current);
+    g_timeout_add (SLIDESHOW_PERIOD, (GSourceFunc)slideshow_fade, slide);
+  }
+  else {
+    slide->frame = SLIDESHOW_FRAMES;
+    slideshow_fade (slide);
+  }
+} /* </slideshow_switch> */
+
+/*
+* (private) slideshow_timer - periodic image change
+*/
+static gboolean
+slideshow_timer (WallpaperSlideshow *slide)
+{
+  slideshow_switch (slide);
+  return TRUE;
+} /* </slideshow_timer> */
+
+/*
+* setbg_slideshow - start a slideshow when the resource file has
+* SLIDESHOW="<folder>" and optionally SLIDESHOW_INTERVAL=<seconds>
+*/
+bool
+setbg_slideshow (GlobalPanel *panel)
+{
+  WallpaperSlideshow *slide = &slide_;
+  char line[MAX_PATHNAME];
+  char *resource, *folder = NULL;
+  const char *name;
+  FILE *stream;
+  GDir *dir;
+
+  resource = g_strdup_printf ("%s/.config/desktop", g_get_home_dir ());
+
+  if ((stream = fopen(resource, "r")) == NULL) {
+    g_free (resource);
+    return false;
+  }
+  g_free (resource);
+
+  slide->interval = SLIDESHOW_INTERVAL;
+
+  while (fgets(line, MAX_PATHNAME, stream)) {
+    g_strstrip (line);
+
+    if (strncmp(line, "SLIDESHOW=", 10) == 0) {
+      g_free (folder);
+      folder = g_shell_unquote (&line[10], NULL);
+    }
+    else if (strncmp(line, "SLIDESHOW_INTERVAL=", 19) == 0) {
+      slide->interval = MAX(atoi(&line[19]), 1);
+    }
+  }
+  fclose(stream);
+
+  if (folder == NULL || (dir = g_dir_open (folder, 0, NULL)) == NULL) {
+    g_free (folder);
+    return false;
+  }
+
+  while ((name = g_dir_read_name (dir))) {
+    const char *ext = get_filename_ext (name);
+
+    if (ext && (strcasecmp(ext, "jpg") == 0 || strcasecmp(ext, "jpeg") == 0 ||
+                strcasecmp(ext, "png") == 0 || strcasecmp(ext, "svg") == 0 ||
+                strcasecmp(ext, "gif") == 0 || strcasecmp(ext, "bmp") == 0))
+      slide->images = g_list_prepend (slide->images,
+                                      g_build_filename (folder, name, NULL));
+  }
+  g_dir_close (dir);
+  g_free (folder);
+
+  if (slide->images == NULL)
+    return false;
+
+  slide->images = g_list_sort (slide->images, (GCompareFunc)strcmp);
+  gdk_drawable_get_size (gdk_get_default_root_window (),
+                         &slide->width, &slide->height);
+
+  slide->due = true;		/* show the first image once decoded */
+  slideshow_prepare (slide);
+
+  ticker_add (slide->interval, (GSourceFunc)slideshow_timer, slide);
+  return true;
+} /* </setbg_slideshow> */
+
 /*
 * setbg_settings_new provides the configuration page
 */
@@ -0,0 +1,132 @@
+/**
+ * Copyright (C) Generations Linux <bugs@softcraft.org>
+ * All Rights Reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "gould.h"
+#include "alsamixer.h"
+
+/**
+ * ALSA volume of the mixer module, without the user interface (see,
+ * tests/test-mixer.c).
+ *
+ * The mixer is opened once and stays open so that a slider drag costs
+ * one ioctl per hardware step and volume changes made by other programs
+ * reach the panel through the mixer poll descriptors.
+ */
+
+/*
+* alsamixer_open - open card and find its selem playback element
+*/
+gboolean
+alsamixer_open (AlsaMixer *mixer, const char *card, const char *selem)
+{
+  snd_mixer_selem_id_t *sid;
+  snd_mixer_t *handle;
+
+  memset(mixer, 0, sizeof(AlsaMixer));
+  mixer->raw = -1;
+
+  if (snd_mixer_open(&handle, 0) < 0)
+    return FALSE;
+
+  if (snd_mixer_attach(handle, card) < 0 ||
+      snd_mixer_selem_register(handle, NULL, NULL) < 0 ||
+      snd_mixer_load(handle) < 0) {
+    vdebug(1, "snd_mixer_load(%s) failed!\n", card);
+    snd_mixer_close(handle);
+    return FALSE;
+  }
+
+  snd_mixer_selem_id_alloca(&sid);
+  snd_mixer_selem_id_set_index(sid, 0);
+  snd_mixer_selem_id_set_name(sid, selem);
+
+  if ((mixer->master = snd_mixer_find_selem(handle, sid)) == NULL) {
+    vdebug(1, "snd_mixer_find_selem(%s) failed!\n", selem);
+    snd_mixer_close(handle);
+    return FALSE;
+  }
+  snd_mixer_selem_get_playback_volume_range(mixer->master,
+                                            &mixer->min, &mixer->max);
+  mixer->handle = handle;
+  return TRUE;
+} /* </alsamixer_open> */
+
+/*
+* alsamixer_set - write volume, unless it is the hardware step last seen
+*/
+gboolean
+alsamixer_set (AlsaMixer *mixer, gint volume)
+{
+  long raw;
+  int status;
+
+  if (mixer->master == NULL)
+    return FALSE;
+
+  /* Slider positions within the same hardware step are not written. */
+  raw = mixer->min + ((mixer->max - mixer->min) * volume + 50) / 100;
+
+  if (raw == mixer->raw)
+    return TRUE;
+
+  if ((status = snd_mixer_selem_set_playback_volume_all(mixer->master,
+                                                        raw)) < 0) {
+    vdebug(1, "snd_mixer_selem_set_playback_volume_all: %s\n",
+              snd_strerror(status));
+    return FALSE;
+  }
+  mixer->raw = raw;
+  return TRUE;
+} /* </alsamixer_set> */
+
+/*
+* alsamixer_sync - hardware volume changed by another program, else -1
+*/
+gint
+alsamixer_sync (AlsaMixer *mixer)
+{
+  long raw;
+
+  if (mixer->master == NULL || mixer->max <= mixer->min)
+    return -1;
+
+  if (snd_mixer_selem_get_playback_volume(mixer->master,
+                                          SND_MIXER_SCHN_FRONT_LEFT, &raw) < 0)
+    return -1;
+
+  if (raw == mixer->raw)	/* our own write or no change */
+    return -1;
+
+  mixer->raw = raw;
+  return ((raw - mixer->min) * 100 + (mixer->max - mixer->min) / 2) /
+         (mixer->max - mixer->min);
+} /* </alsamixer_sync> */
+
+/*
+* alsamixer_close
+*/
+void
+alsamixer_close (AlsaMixer *mixer)
+{
+  if (mixer->handle)
+    snd_mixer_close(mixer->handle);
+
+  mixer->handle = NULL;
+  mixer->master = NULL;
+} /* </alsamixer_close> */
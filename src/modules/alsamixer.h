@@ -0,0 +1,55 @@
+/**
+ * Copyright (C) Generations Linux <bugs@softcraft.org>
+ * All Rights Reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef ALSAMIXER_H
+#define ALSAMIXER_H
+
+#include <glib.h>
+#include <alsa/asoundlib.h>
+
+#define ALSAMIXER_CARD  "default"	/* mixer the panel controls */
+#define ALSAMIXER_SELEM "Master"	/* playback element of the card */
+
+G_BEGIN_DECLS
+
+typedef struct _AlsaMixer AlsaMixer;
+
+struct _AlsaMixer
+{
+  snd_mixer_t *handle;		/* ALSA mixer, open until alsamixer_close */
+  snd_mixer_elem_t *master;	/* playback element, NULL => none */
+  long min, max;		/* its playback volume range */
+  long raw;			/* last hardware value read or written */
+};
+
+/**
+ * Public methods (alsamixer.c) exported in the implementation.
+ *
+ * Volumes are percents. alsamixer_set writes only when the percent maps
+ * to another hardware step; alsamixer_sync returns the hardware volume
+ * when another program changed it, -1 otherwise (our own write or none).
+ */
+gboolean alsamixer_open (AlsaMixer *mixer, const char *card, const char *selem);
+gboolean alsamixer_set (AlsaMixer *mixer, gint volume);
+gint alsamixer_sync (AlsaMixer *mixer);
+void alsamixer_close (AlsaMixer *mixer);
+
+G_END_DECLS
+
+#endif /* </ALSAMIXER_H> */
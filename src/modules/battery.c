@@ -21,6 +21,9 @@
 #include "gpanel.h"
 #include "module.h"
 
+#include <fcntl.h>
+#include <sys/socket.h>
+
 #define BATTERY_FORMAT_MAX 80
 
 extern const char *Program;	/* see, gpanel.c */
@@ -31,7 +34,7 @@ const char *Release = "1.2.1";
 */
 typedef struct _BatteryConfig  BatteryConfig;
 typedef struct _BatteryPrivate BatteryPrivate;
-typedef struct _BatteryState   BatteryState;
+typedef PowerSupply            BatteryState;	/* see, sysevent.h */
 
 struct _BatteryConfig
 {
@@ -60,19 +63,23 @@ struct _BatteryPrivate
   GtkWidget *layout;		/* applet->widget layout */
 
   GtkTooltips *tooltips;
-};
+  guint ticker;			/* battery_monitor, see ticker_add() */
 
-struct _BatteryState
-{
-  gboolean discharging;
-  long     remaining;
-  long     capacity;
+  BatteryState state;		/* latest reading, see battery_update() */
+  gboolean known;		/* state has been read */
+  gboolean prepared;		/* first reading done, see module_prepare */
+
+  int uevent;			/* SYSBAT/uevent, read with pread() */
+  int uevents;			/* kernel uevent netlink socket */
+  guint watch;			/* GLib source watching uevents */
 };
 
 static BatteryPrivate local_;	/* private global structure singleton */
 
 static char *SYSBAT = "/sys/class/power_supply/BAT0";
 
+static void battery_schedule (BatteryConfig *config);
+
 
 /*
  * battery_configuration_read
@@ -163,6 +170,7 @@ battery_settings_apply (Modulus *applet)
 
   /* Save configuration to singleton settings cache. */
   memcpy(&local_.cache, config, sizeof(BatteryConfig));
+  battery_schedule (config);
 
   /* Show or hide pager widget according to user selection. */
   if (applet->enable) {
@@ -269,7 +277,6 @@ static gboolean
 get_battery_state (BatteryState *battery)
 {
   char line[FILENAME_MAX];
-  char node[FILENAME_MAX];
   char *state = NULL;
   FILE *stream;
 
@@ -278,38 +285,8 @@ get_battery_state (BatteryState *battery)
   battery->remaining   = 100;
   battery->capacity    = 100;
 
-  sprintf(node, "%s/status", SYSBAT);
-
-  if ((stream = fopen(node, "r")) != NULL) {
-    if (fgets(line, FILENAME_MAX, stream)) {
-      battery->discharging = (strncasecmp(line, "discharging", 11) == 0);
-    }
-    fclose(stream);
-
-    sprintf(node, "%s/charge_now", SYSBAT);
-    /* older kernel kernel versions used "energy_now" */
-    if ((stream = fopen(node, "r")) == NULL)
-      sprintf(node, "%s/energy_now", SYSBAT);
-
-    if ((stream = fopen(node, "r")) != NULL) {
-      if (fgets(line, FILENAME_MAX, stream)) {
-        battery->remaining = atol(line);
-      }
-      fclose(stream);
-    }
-
-    sprintf(node, "%s/charge_full", SYSBAT);
-    /* older kernel kernel versions used "energy_full" */
-    if ((stream = fopen(node, "r")) == NULL)
-      sprintf(node, "%s/energy_full", SYSBAT);
-
-    if ((stream = fopen(node, "r")) != NULL) {
-      if (fgets(line, FILENAME_MAX, stream)) {
-        battery->capacity = atol(line);
-      }
-      fclose(stream);
-    }
-    state = line;  /* we are in a good state */
+  if (power_supply_read (SYSBAT, local_.uevent, battery)) {
+    state = SYSBAT;  /* we are in a good state */
   }
   else if ((stream = fopen("/proc/acpi/battery/BAT0/state", "r")) != NULL) {
     while (fgets(line, FILENAME_MAX, stream)) {
@@ -348,35 +325,52 @@ get_battery_state (BatteryState *battery)
 } /* </get_battery_state> */
 
 /*
- * battery_refresh - refresh view of the canvas area (and tooltips)
+ * battery_refresh - refresh view of the canvas area
  */
 static void
 battery_refresh (GtkWidget *canvas, gpointer data)
 {
-  BatteryState battery;
-
-  if (get_battery_state (&battery)) {
-    char text[BATTERY_FORMAT_MAX];
-    guint level = 100.0 * battery.remaining / battery.capacity;
-
-    if (battery.discharging) {
-      sprintf(text, "%d%c %s", level, '%', _("discharging"));
+  if (local_.known) {
+    if (local_.state.discharging)
       redraw_pixbuf (canvas, local_.dischargingIcon);
-    }
-    else {
-      sprintf(text, "%d%c %s", level, '%', _("charging"));
+    else
       redraw_pixbuf (canvas, local_.chargingIcon);
-    }
-
-    gtk_tooltips_set_tip (local_.tooltips, local_.layout, text, NULL);
-    vdebug(2, "battery %s\n", text);
   }
 } /* </battery_refresh> */
 
+/*
+ * (private) battery_show - tooltip and icon for the latest reading
+ */
+static void
+battery_show (void)
+{
+  BatteryState *battery = &local_.state;
+  char text[BATTERY_FORMAT_MAX];
+  guint level = 100.0 * battery->remaining / battery->capacity;
+
+  sprintf(text, "%d%c %s", level, '%',
+          (battery->discharging) ? _("discharging") : _("charging"));
+
+  gtk_tooltips_set_tip (local_.tooltips, local_.layout, text, NULL);
+  gtk_widget_queue_draw (local_.canvas);
+  vdebug(2, "battery %s\n", text);
+} /* </battery_show> */
+
+/*
+ * (private) battery_update - read the battery state, update the view
+ */
+static gboolean
+battery_update (void)
+{
+  if ((local_.known = get_battery_state (&local_.state)))
+    battery_show ();
+
+  return local_.known;
+} /* </battery_update> */
+
 /*
  * (private) battery_command
  * (private) battery_monitor
- * (private) start_battery_monitor
  */
 static gboolean
 battery_command (gchar *command)
@@ -388,11 +382,11 @@ battery_command (gchar *command)
 static gboolean
 battery_monitor (BatteryConfig *config)
 {
-  BatteryState battery;
+  BatteryState *battery = &local_.state;
 
-  if (get_battery_state (&battery)) {
-    if (battery.discharging) {
-      guint level = 100.0 * battery.remaining / battery.capacity;
+  if (battery_update ()) {
+    if (battery->discharging) {
+      guint level = 100.0 * battery->remaining / battery->capacity;
 
       if (level < config->critical) {
         if (strlen(config->command) > 0)
@@ -405,22 +399,67 @@ battery_monitor (BatteryConfig *config)
         notice(NULL, ICON_WARNING, "%s: %s %d%c %s.", Program,
                _("battery level low"), level, '%', _("charge left"));
     }
-    battery_refresh (local_.canvas, NULL);
   }
 
   return (config->interval > 0);  /* FALSE => stop monitoring */
 } /* </battery_monitor> */
 
+/*
+ * (private) battery_uevent - power_supply change (AC plugged, unplugged)
+ */
 static gboolean
-start_battery_monitor (BatteryConfig *config)
+battery_uevent (GIOChannel *channel, GIOCondition condition, gpointer data)
 {
-  /* Set checking status every 'interval' minutes. */
-  g_timeout_add (1000 * 60 * config->interval,
-                 (GSourceFunc)battery_monitor,
-                 config);
+  char buffer[8192];
+  ssize_t length;
+  bool changed = false;
 
-  return FALSE;
-} /* </start_battery_monitor> */
+  while ((length = recv(local_.uevents, buffer, sizeof(buffer) - 1, 0)) > 0) {
+    char *scan;
+
+    buffer[length] = (char)0;
+
+    for (scan = buffer; scan < buffer + length; scan += strlen(scan) + 1)
+      if (strcmp(scan, "SUBSYSTEM=power_supply") == 0)
+        changed = true;
+  }
+
+  if (changed)
+    battery_update ();
+
+  return TRUE;
+} /* </battery_uevent> */
+
+/*
+ * (private) battery_watch - kernel uevent socket for power_supply changes
+ */
+static void
+battery_watch (void)
+{
+  if ((local_.uevents = uevent_socket ()) >= 0) {
+    GIOChannel *channel = g_io_channel_unix_new (local_.uevents);
+
+    local_.watch = g_io_add_watch (channel, G_IO_IN, battery_uevent, NULL);
+    g_io_channel_unref (channel);
+  }
+} /* </battery_watch> */
+
+/*
+ * (private) battery_schedule - check the battery every interval minutes
+ */
+static void
+battery_schedule (BatteryConfig *config)
+{
+  if (config->interval == 0) {
+    ticker_remove (local_.ticker);
+    local_.ticker = 0;
+  }
+  else if (local_.ticker)
+    ticker_set_cadence (local_.ticker, 60 * config->interval);
+  else
+    local_.ticker = ticker_add (60 * config->interval,
+                                (GSourceFunc)battery_monitor, config);
+} /* </battery_schedule> */
 
 /*
  * module_settings provides configuration pages
@@ -587,6 +626,7 @@ module_init (Modulus *applet)
 
   /* Initialize private data structure singleton. */
   memset(&local_, 0, sizeof (BatteryPrivate));
+  local_.uevent = local_.uevents = -1;
 
   local_.tooltips = gtk_tooltips_new();
   local_.config = config;
@@ -624,6 +664,21 @@ module_init (Modulus *applet)
 /*
  * Optional methods
  */
+
+/*
+ * module_prepare - open the uevent file and read it, off the main thread
+ */
+void
+module_prepare (Modulus *applet)
+{
+  char node[FILENAME_MAX];
+
+  sprintf(node, "%s/uevent", SYSBAT);
+  local_.uevent = open(node, O_RDONLY | O_CLOEXEC);
+  local_.known = get_battery_state (&local_.state);
+  local_.prepared = TRUE;
+} /* module_prepare */
+
 void
 module_open (Modulus *applet)
 {
@@ -636,6 +691,9 @@ module_open (Modulus *applet)
   guint size = icons->size;
   const gchar *icon;
 
+  if (!local_.prepared)		/* host without module_prepare support */
+    module_prepare (applet);
+
   icon = icon_path_finder (icons, "power.png");
   local_.chargingIcon = pixbuf_new_from_file_scaled (icon, size, size);
 
@@ -654,15 +712,19 @@ module_open (Modulus *applet)
   g_signal_connect (G_OBJECT (canvas), "expose_event",
                     G_CALLBACK (battery_refresh), NULL);
 
-  /* Start monitoring battery state. */
-  g_timeout_add (1000, (GSourceFunc)start_battery_monitor, config);
-  vdebug(2, "g_timeout_add 1000, start_battery_monitor\n");
-
+  /* Follow power_supply uevents; the charge level on the minute ticks. */
   applet->widget = layout;
+
+  battery_watch ();
+  if (local_.known) battery_show ();
+  battery_schedule (config);
 } /* module_open */
 
 void
 module_close (Modulus *applet)
 {
+  if (local_.watch) g_source_remove (local_.watch);
+  if (local_.uevents >= 0) close(local_.uevents);
+  if (local_.uevent >= 0) close(local_.uevent);
   gtk_widget_destroy (applet->widget);
 } /* module_close */
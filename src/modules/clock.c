@@ -55,6 +55,9 @@ struct _ClockPrivate
 
   GtkWidget *calendar;
   GtkWidget *preview;
+
+  guint ticker;			/* display update, see ticker_add() */
+  guint previewer;		/* settings preview update */
 };
 
 static ClockPrivate local_;	/* private global structure singleton */
@@ -150,6 +153,33 @@ show_time (Modulus *applet)
   return TRUE;
 } /* </show_time> */
 
+/*
+ * (private) clock_cadence - seconds between updates of a display format
+ */
+static guint
+clock_cadence (const gchar *format)
+{
+  static const char *seconds[] = { "%S", "%T", "%r", "%s", "%X", "%c", NULL };
+  int idx;
+
+  for (idx = 0; seconds[idx] != NULL; idx++)
+    if (strstr(format, seconds[idx]) != NULL)
+      return 1;
+
+  return TICKER_MINUTE;		/* wake only on minute boundaries */
+} /* </clock_cadence> */
+
+/*
+ * (private) clock_preview - show format on the settings page
+ */
+static void
+clock_preview (const gchar *format)
+{
+  local_.format = format;
+  ticker_set_cadence (local_.previewer, clock_cadence (format));
+  show_preview_time (local_.clock);
+} /* </clock_preview> */
+
 /*
  * calendar_new
  */
@@ -253,6 +283,8 @@ clock_settings_apply (Modulus *applet)
   /* Save configuration cache data. */
   local_.format = clock->format;
   local_.enable = applet->enable;
+
+  ticker_set_cadence (local_.ticker, clock_cadence (clock->format));
 } /* </clock_settings_apply> */
 
 static void
@@ -280,7 +312,7 @@ clock_settings_cancel (Modulus *applet)
   gtk_toggle_button_set_active(GTK_TOGGLE_BUTTON(local_.seconds_toggle), state);
 
   /* Restore previous settings. */
-  local_.format = clock->format;
+  clock_preview (clock->format);
   local_.enable = applet->enable;
 } /* </clock_settings_cancel> */
 
@@ -326,9 +358,9 @@ clock_24hour (GtkWidget *button, Modulus *applet)
                          NULL);
 
     if (local_.showseconds)
-      local_.format = (state) ? "%H:%M:%S" : "%I:%M:%S %p";
+      clock_preview ((state) ? "%H:%M:%S" : "%I:%M:%S %p");
     else
-      local_.format = (state) ? "%H:%M" : "%I:%M %p";
+      clock_preview ((state) ? "%H:%M" : "%I:%M %p");
 
     local_.show24hour = state;
   }
@@ -351,9 +383,9 @@ clock_seconds (GtkWidget *button, Modulus *applet)
                          NULL);
 
     if (state)
-      local_.format = (local_.show24hour) ? "%H:%M:%S" : "%I:%M:%S %p";
+      clock_preview ((local_.show24hour) ? "%H:%M:%S" : "%I:%M:%S %p");
     else
-      local_.format = (local_.show24hour) ? "%H:%M" : "%I:%M %p";
+      clock_preview ((local_.show24hour) ? "%H:%M" : "%I:%M %p");
 
     local_.showseconds = state;
   }
@@ -423,7 +455,8 @@ module_settings (Modulus *applet, GlobalPanel *panel)
   local_.preview = widget;
   gtk_widget_show (widget);
 
-  g_timeout_add (1000, (GSourceFunc)show_preview_time, clock);
+  local_.previewer = ticker_add (clock_cadence (local_.format),
+                                (GSourceFunc)show_preview_time, clock);
   show_preview_time (clock);
 
   /* Add option to display 24 hour instead of 12 hour time. */
@@ -534,8 +567,10 @@ module_open (Modulus *applet)
                                                   applet->enable);
   settings_save_enable (panel->settings, FALSE);
 
-  /* Set up timer to update the display every 1 second. */
-  g_timeout_add (1000, (GSourceFunc)show_time, applet);
+  /* Update the display every second, or minute when seconds are hidden. */
+  local_.ticker = ticker_add (clock_cadence (clock->format),
+                              (GSourceFunc)show_time, applet);
+  show_time (applet);
 } /* module_open */
 
 void
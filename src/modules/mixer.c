@@ -20,6 +20,7 @@
 #include "gould.h"
 #include "gpanel.h"
 #include "module.h"
+#include "alsamixer.h"
 
 #include <fcntl.h>
 #include <unistd.h>
@@ -61,6 +62,14 @@ struct _MixerPrivate
 
   GtkWidget *slider;		/* volume control slider window */
   int device;			/* device file descriptor */
+
+  AlsaMixer alsa;		/* ALSA mixer, open for the module lifetime */
+
+  guint *watches;		/* main loop sources on the mixer poll fds */
+  gint nwatches;
+
+  gboolean prepared;		/* mixer_alsa_open was tried */
+  gboolean syncing;		/* slider follows the hardware, do not write */
 };
 
 static MixerPrivate local_;	/* private global structure singleton */
@@ -68,39 +77,127 @@ static MixerPrivate local_;	/* private global structure singleton */
 
 /**
  * ALSA support [EXPRIMENTAL]
+ *
+ * The mixer is opened once (see, module_prepare) and stays open, see
+ * alsamixer.c for the volume itself.
 */
+static gboolean
+mixer_alsa_open (void)
+{
+  local_.prepared = TRUE;
+  return alsamixer_open (&local_.alsa, ALSAMIXER_CARD, ALSAMIXER_SELEM);
+} /* </mixer_alsa_open> */
+
 int SetAlsaMasterVolume(long volume)
 {
-  const char *card = "default";
-  const char *selem_name = "Master";
-
-  snd_mixer_t *handle;
-  snd_mixer_selem_id_t *sid;
-  int status = 0;
-
-  snd_mixer_open(&handle, 0);
-  snd_mixer_attach(handle, card);
-  snd_mixer_selem_register(handle, NULL, NULL);
-  snd_mixer_load(handle);
-
-  snd_mixer_selem_id_alloca(&sid);
-  snd_mixer_selem_id_set_index(sid, 0);
-  snd_mixer_selem_id_set_name(sid, selem_name);
-  snd_mixer_elem_t* elem = snd_mixer_find_selem(handle, sid);
-
-  if (elem) {
-    long min, max;
-    snd_mixer_selem_get_playback_volume_range(elem, &min, &max);
-    snd_mixer_selem_set_playback_volume_all(elem, volume * max / 100);
+  if (!local_.prepared)
+    mixer_alsa_open ();
+
+  return (alsamixer_set (&local_.alsa, volume)) ? 0 : 1;
+}
+
+/*
+ * (private) mixer_alsa_sync - make the slider follow the Master volume
+ */
+static void
+mixer_alsa_sync (void)
+{
+  gint volume = alsamixer_sync (&local_.alsa);
+
+  if (volume < 0)		/* our own write or no change */
+    return;
+
+  vdebug (2, "mixer_alsa_sync volume => %d\n", volume);
+  local_.cache.volume = volume;
+
+  if (local_.slider) {		/* updates the volume button icon as well */
+    local_.syncing = TRUE;
+    gtk_scale_button_set_value(GTK_SCALE_BUTTON(local_.slider), volume);
+    local_.syncing = FALSE;
   }
-  else {
-    vdebug(1, "snd_mixer_find_selem() failed!\n");
-    status = 1;
+} /* </mixer_alsa_sync> */
+
+/*
+ * (private) mixer_alsa_event - mixer poll descriptor is readable
+ */
+static gboolean
+mixer_alsa_event (GIOChannel *channel, GIOCondition condition, gpointer data)
+{
+  if (local_.alsa.handle == NULL)
+    return FALSE;
+
+  if (condition & (G_IO_ERR | G_IO_HUP | G_IO_NVAL)) {
+    vdebug(1, "%s: mixer poll descriptor closed\n", Program);
+    local_.watches[GPOINTER_TO_INT(data)] = 0;
+    return FALSE;
   }
 
-  snd_mixer_close(handle);
-  return status;
-}
+  snd_mixer_handle_events(local_.alsa.handle);
+  mixer_alsa_sync ();
+
+  return TRUE;
+} /* </mixer_alsa_event> */
+
+/*
+ * (private) mixer_alsa_watch - add the mixer poll descriptors to the main loop
+ */
+static void
+mixer_alsa_watch (void)
+{
+  struct pollfd *fds;
+  int count, idx;
+
+  if (local_.alsa.handle == NULL)
+    return;
+
+  if ((count = snd_mixer_poll_descriptors_count(local_.alsa.handle)) <= 0)
+    return;
+
+  fds = g_new0 (struct pollfd, count);
+  count = snd_mixer_poll_descriptors(local_.alsa.handle, fds, count);
+
+  local_.watches = g_new0 (guint, MAX(count, 1));
+  local_.nwatches = 0;
+
+  for (idx = 0; idx < count; idx++) {
+    GIOChannel *channel = g_io_channel_unix_new (fds[idx].fd);
+    GIOCondition events = G_IO_ERR | G_IO_HUP;
+
+    if (fds[idx].events & POLLIN)
+      events |= G_IO_IN;
+
+    if (fds[idx].events & POLLPRI)
+      events |= G_IO_PRI;
+
+    local_.watches[local_.nwatches] = g_io_add_watch (channel, events,
+                                mixer_alsa_event, GINT_TO_POINTER(local_.nwatches));
+    local_.nwatches++;
+    g_io_channel_unref (channel);
+  }
+  g_free (fds);
+
+  vdebug (2, "mixer_alsa_watch %d poll descriptor(s)\n", local_.nwatches);
+} /* </mixer_alsa_watch> */
+
+/*
+ * (private) mixer_alsa_close
+ */
+static void
+mixer_alsa_close (void)
+{
+  gint idx;
+
+  for (idx = 0; idx < local_.nwatches; idx++)
+    if (local_.watches[idx])
+      g_source_remove (local_.watches[idx]);
+
+  g_free (local_.watches);
+  local_.watches  = NULL;
+  local_.nwatches = 0;
+
+  alsamixer_close (&local_.alsa);
+  local_.prepared = FALSE;
+} /* </mixer_alsa_close> */
 
 /*
  * mixer_default_device_name
@@ -316,6 +413,9 @@ volume_adjust (GtkAdjustment *adjust, Modulus *applet)
   gboolean done = FALSE;
   gint volume = (gint)adjust->value;
 
+  if (local_.syncing)		/* see, mixer_alsa_sync */
+    return TRUE;
+
   if (local_.device > 0) {
     volume += (gint)adjust->value << 8;
 
@@ -620,6 +720,15 @@ module_init (Modulus *applet)
                        -1);
 } /* </module_init> */
 
+/*
+ * module_prepare - open the ALSA mixer, off the main thread
+ */
+void
+module_prepare (Modulus *applet)
+{
+  mixer_alsa_open ();
+} /* </module_prepare> */
+
 /*
  * module_open - construct user interface
  *
@@ -645,7 +754,12 @@ module_open (Modulus *applet)
   gtk_button_set_relief (GTK_BUTTON(layout), GTK_RELIEF_NONE);
 
   /* Construct volume control slider widget. */
+  if (!local_.prepared)		/* host without module_prepare support */
+    mixer_alsa_open ();
+
   applet->widget = volume_button_new (applet);
+  mixer_alsa_watch ();
+  mixer_alsa_sync ();		/* the slider starts at the hardware volume */
 
   /* FIXME!
   if (access_mixer_device (applet) < 0) {
@@ -659,5 +773,8 @@ void
 module_close (Modulus *applet)
 {
   if(local_.device > 0) close(local_.device);
+  mixer_alsa_close ();
+
   gtk_widget_destroy (applet->widget);
+  local_.slider = NULL;
 } /* </module_close> */
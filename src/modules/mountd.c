@@ -21,6 +21,11 @@
 #include "gpanel.h"
 #include "module.h"
 
+#include <fcntl.h>
+#include <sys/socket.h>
+
+#define MOUNTINFO "/proc/self/mountinfo"
+
 extern const char *Program;	/* see, gpanel.c */
 const char *Release = "1.2.1";
 
@@ -33,7 +38,7 @@ typedef struct _MountdPrivate MountdPrivate;
 struct _MountdConfig
 {
   gboolean automount;
-  guint interval;		/* update interval in seconds */
+  guint interval;		/* poll interval, without MOUNTINFO events */
 };
 
 struct _MountdPrivate
@@ -51,7 +56,13 @@ struct _MountdPrivate
 
   GtkTooltips *tooltips;	/* applet tooltips widget */
   GList *internal;		/* internal disk partitions list */
-  GList *mtab;			/* removable devices mount list */
+  gboolean prepared;		/* internal is known, see module_prepare */
+  MountTable *table;		/* mounts => menu items, see sysevent.c */
+  guint removables;		/* menu items in local_.menu */
+
+  int mountinfo;		/* MOUNTINFO, POLLPRI on (u)mount */
+  int uevents;			/* kernel uevent netlink socket */
+  guint watches[2];		/* GLib sources watching them */
 
   const gchar *icon_cdrom;	/* frequently used icons */
   const gchar *icon_usbdrive;
@@ -104,77 +115,108 @@ mountd_configuration_read (Modulus *applet, MountdConfig *config)
 } /* </mountd_configuration_read> */
 
 /*
- *
+ * (private) mountd_read - contents of MOUNTINFO
  */
-static gboolean
-check_removable_mounts (GlobalPanel *panel)
+static gchar *
+mountd_read (void)
 {
-  DeviceInfo *dev;
-  GList *iter, *list;
+  GString *text = g_string_sized_new (4096);
+  char buffer[4096];
+  ssize_t count;
+  int fd = local_.mountinfo;
 
-  if (local_.menu) { 		/* check presence of removables menu */
-    if (GTK_WIDGET_VISIBLE (local_.menu))
-      return TRUE;
+  if (fd < 0)			/* no persistent descriptor */
+    fd = open(MOUNTINFO, O_RDONLY | O_CLOEXEC);
+  else
+    lseek(fd, 0, SEEK_SET);
 
-    gtk_widget_destroy (local_.menu); /* free previously made menu */
-    local_.menu = NULL;
-  }
+  if (fd >= 0)
+    while ((count = read(fd, buffer, sizeof(buffer))) > 0)
+      g_string_append_len (text, buffer, count);
 
-  if (local_.mtab) {		/* free previously allocated mtab */
-    for (iter = local_.mtab; iter; iter = iter->next) {
-      dev = iter->data;
-      free (dev->fsname);
-      free (dev->mntdir);
-      free (dev);
-    }
+  if (fd >= 0 && fd != local_.mountinfo)
+    close(fd);
 
-    g_list_free (local_.mtab);
-    local_.mtab = NULL;
-  }
+  return g_string_free (text, FALSE);
+} /* </mountd_read> */
 
-  /* get_mounted_devices (exclude => local_.internal) */
-  list = get_mounted_devices (local_.internal);
+/*
+ * (private) mountd_probe - MountProbe, get_device_capability() or 0
+ */
+static guint
+mountd_probe (const char *fsname)
+{
+  int word = get_device_capability (fsname);
 
-  if (list) { 			/* mounted removable devices */
-    GtkWidget *item, *image;
-    PanelIcons  *icons = panel->icons;
-    guint iconsize = panel->taskbar->iconsize;
-    const gchar *icon;
-    unsigned short word;
+  return (word > 0) ? word : 0;
+} /* </mountd_probe> */
 
-    /* Construct the menu of mounted removable devices. */
-    local_.menu = gtk_menu_new();
+/*
+ * (private) mountd_added - MountAdded, menu item of a removable mount
+ */
+static gpointer
+mountd_added (MountTable *table, const char *fsname, const char *mntdir,
+              GlobalPanel *panel)
+{
+  PanelIcons *icons = panel->icons;
+  guint iconsize = panel->taskbar->iconsize;
+  GtkWidget *item, *image;
+  const gchar *icon;
+  guint word;
 
-    for (iter = list; iter; iter = iter->next) {
-      dev  = iter->data;
-      item = gtk_image_menu_item_new_with_label (dev->mntdir);
-      word = dev->capability;
+  if (strncmp(fsname, "/dev/", 5) != 0 || glist_find (local_.internal,
+                                                      &fsname[5]))
+    return NULL;
 
-      if (word > 0 && (word & DEV_REMOVABLE)) {
-        local_.mtab = g_list_append (local_.mtab, dev);
+  vdebug (2, "%s mounted %s on %s\n", __func__, fsname, mntdir);
 
-        if (word & DEV_DRIVERFS)
-          icon = icon_path_finder (icons, local_.icon_cdrom);
-        else
-          icon = icon_path_finder (icons, local_.icon_usbdrive);
+  if ((word = mount_table_capability (table, fsname)) == 0 ||
+      !(word & DEV_REMOVABLE))
+    return NULL;
 
-        image = image_new_from_file_scaled (icon, iconsize, iconsize);
-        gtk_image_menu_item_set_image (GTK_IMAGE_MENU_ITEM (item), image);
+  item = gtk_image_menu_item_new_with_label (mntdir);
 
-        gtk_menu_shell_append (GTK_MENU_SHELL(local_.menu), item);
-        gtk_widget_show (item);
-      }
-      else {
-        free (dev->fsname);  /* free elements that we do not use */
-        free (dev->mntdir);
-        free (dev);
-      }
-    }
-    g_list_free (list);
-  }
+  if (word & DEV_DRIVERFS)
+    icon = icon_path_finder (icons, local_.icon_cdrom);
+  else
+    icon = icon_path_finder (icons, local_.icon_usbdrive);
+
+  image = image_new_from_file_scaled (icon, iconsize, iconsize);
+  gtk_image_menu_item_set_image (GTK_IMAGE_MENU_ITEM (item), image);
+
+  gtk_menu_shell_append (GTK_MENU_SHELL(local_.menu), item);
+  gtk_widget_show (item);
+  local_.removables++;
+
+  return item;
+} /* </mountd_added> */
+
+/*
+ * (private) mountd_removed - MountRemoved, the item of a mount gone
+ */
+static void
+mountd_removed (GtkWidget *item, GlobalPanel *panel)
+{
+  vdebug (2, "%s unmounted %s\n", __func__,
+              gtk_menu_item_get_label (GTK_MENU_ITEM (item)));
+  gtk_widget_destroy (item);
+  local_.removables--;
+} /* </mountd_removed> */
 
-  return (local_.mtab != NULL);
-} /* </check_removable_mounts> */
+/*
+ * (private) mountd_reconcile - apply mount table changes to the menu
+ */
+static gboolean
+mountd_reconcile (GlobalPanel *panel)
+{
+  gchar *text = mountd_read ();
+  guint changes = mount_table_update (local_.table, text);
+
+  vdebug (3, "%s %u menu item(s) changed\n", __func__, changes);
+  g_free (text);
+
+  return (local_.removables > 0);
+} /* </mountd_reconcile> */
 
 /*
  * (private) monitor_removable_devices
@@ -183,7 +225,7 @@ static gboolean
 monitor_removable_devices (Modulus *applet)
 {
   if (local_.enable) {
-    if (check_removable_mounts (applet->data)) /* TRUE => mounted removables */
+    if (mountd_reconcile (applet->data)) /* TRUE => mounted removables */
       gtk_widget_show (applet->widget);
     else
       gtk_widget_hide (applet->widget);
@@ -192,6 +234,70 @@ monitor_removable_devices (Modulus *applet)
   return TRUE;
 } /* </monitor_removable_devices> */
 
+/*
+ * (private) mountd_mountinfo - the kernel flags MOUNTINFO on (u)mount
+ */
+static gboolean
+mountd_mountinfo (GIOChannel *channel, GIOCondition condition,
+                  Modulus *applet)
+{
+  return monitor_removable_devices (applet);
+} /* </mountd_mountinfo> */
+
+/*
+ * (private) mountd_uevent - block device added, changed or removed
+ */
+static gboolean
+mountd_uevent (GIOChannel *channel, GIOCondition condition, Modulus *applet)
+{
+  char buffer[8192];
+  ssize_t length;
+  bool rescan = false;		/* some packet was about a block device */
+
+  while ((length = recv(local_.uevents, buffer, sizeof(buffer) - 1, 0)) > 0) {
+    buffer[length] = (char)0;
+
+    if (mount_table_uevent (local_.table, buffer, length)) {
+      vdebug (2, "%s %s\n", __func__, buffer);
+      rescan = true;
+    }
+  }
+
+  if (rescan)			/* mounts of a removed device are stale */
+    monitor_removable_devices (applet);
+
+  return TRUE;
+} /* </mountd_uevent> */
+
+/*
+ * (private) mountd_watch - event sources, the ticker only as fallback
+ */
+static void
+mountd_watch (Modulus *applet)
+{
+  GIOChannel *channel;
+
+  local_.mountinfo = open(MOUNTINFO, O_RDONLY | O_CLOEXEC);
+
+  if (local_.mountinfo >= 0) {
+    channel = g_io_channel_unix_new (local_.mountinfo);
+    local_.watches[0] = g_io_add_watch (channel, G_IO_PRI | G_IO_ERR,
+                                        (GIOFunc)mountd_mountinfo, applet);
+    g_io_channel_unref (channel);
+  }
+  else {
+    ticker_add (MAX(local_.interval, 1),
+                (GSourceFunc)monitor_removable_devices, applet);
+  }
+
+  if ((local_.uevents = uevent_socket ()) >= 0) {
+    channel = g_io_channel_unix_new (local_.uevents);
+    local_.watches[1] = g_io_add_watch (channel, G_IO_IN,
+                                        (GIOFunc)mountd_uevent, applet);
+    g_io_channel_unref (channel);
+  }
+} /* </mountd_watch> */
+
 /*
  * (private) show_mounted
  */
@@ -402,13 +508,13 @@ module_init (Modulus *applet)
 
   /* Initialize private data structure singleton. */
   memset(&local_, 0, sizeof (MountdPrivate));
+  local_.mountinfo = local_.uevents = -1;
 
   local_.config = config;
   local_.enable = applet->enable;
   local_.automount = config->automount;
   local_.interval = config->interval;
 
-  local_.internal = get_internal_partitions();
   local_.tooltips = gtk_tooltips_new();
 
   /* Initialize the frequently used icons. */
@@ -429,6 +535,16 @@ module_init (Modulus *applet)
 #endif
 } /* </module_init> */
 
+/*
+ * module_prepare - scan internal partitions, off the main thread
+ */
+void
+module_prepare (Modulus *applet)
+{
+  local_.internal = get_internal_partitions();
+  local_.prepared = TRUE;
+} /* module_prepare */
+
 void
 module_open (Modulus *applet)
 {
@@ -438,6 +554,9 @@ module_open (Modulus *applet)
   unsigned int iconsize = icons->size;
   const gchar *icon;
 
+  if (!local_.prepared)		/* host without module_prepare support */
+    module_prepare (applet);
+
   /* Construct the user interface. */
   applet->widget = layout = gtk_toggle_button_new();
   gtk_button_set_relief (GTK_BUTTON(layout), GTK_RELIEF_NONE);
@@ -449,11 +568,14 @@ module_open (Modulus *applet)
   g_signal_connect (G_OBJECT(layout), "button-press-event",
                     G_CALLBACK (activate), panel);
 
-  /* Timer to monitor mounted removable devices every <interval> seconds. */
-  applet->enable = check_removable_mounts (panel);
+  /* Menu of mounted removable devices, updated as mounts change. */
+  local_.menu = gtk_menu_new();
+  local_.table = mount_table_new (mountd_probe,
+                                  (MountAdded)mountd_added,
+                                  (MountRemoved)mountd_removed, panel);
 
-  g_timeout_add (local_.interval * 1000,
-                 (GSourceFunc)monitor_removable_devices, applet);
+  applet->enable = mountd_reconcile (panel);
+  mountd_watch (applet);
 
 #if 0
   /* Update local_.enable_toggle on the settings page. */
@@ -466,5 +588,13 @@ module_open (Modulus *applet)
 void
 module_close (Modulus *applet)
 {
+  if (local_.watches[0]) g_source_remove (local_.watches[0]);
+  if (local_.watches[1]) g_source_remove (local_.watches[1]);
+
+  if (local_.uevents >= 0) close(local_.uevents);
+  if (local_.mountinfo >= 0) close(local_.mountinfo);
+
+  mount_table_free (local_.table);
+  local_.table = NULL;
   gtk_widget_destroy (applet->widget);
 } /* module_close */
@@ -21,8 +21,15 @@
 #include "gpanel.h"
 #include "module.h"
 
+#define SENSOR_SYSFS    "/sys"	/* sysfs root, settings root="..." in tests */
+#define SENSOR_INTERVAL 2	/* default seconds between samples */
+#define SENSOR_WARNING  80	/* default degrees Celsius drawn as warning */
+
+#define SENSOR_TEMP_LOW  20	/* sparkline scale for temperatures */
+#define SENSOR_TEMP_HIGH 100
+
 extern const char *Program;     /* see, gpanel.c */
-const char *Release = "1.0.1";
+const char *Release = "1.1.0";
 
 
 /*
@@ -33,7 +40,10 @@ typedef struct _SensorPrivate SensorPrivate;
 
 struct _SensorConfig
 {
-  GtkWidget *display;		/* display drawing area */
+  const gchar *root;		/* sysfs mount point */
+  const gchar *primary;		/* label of the sensor drawn, NULL => first */
+  guint interval;		/* seconds between samples */
+  guint warning;		/* temperature drawn in the warning color */
 };
 
 struct _SensorPrivate
@@ -41,6 +51,20 @@ struct _SensorPrivate
   SensorConfig *sensor;		/* applet configuration data */
   GtkTooltips *tooltips;
   gboolean enable;
+
+  GList *inputs;		/* SensorInput list, see sensor_discover() */
+  SensorInput *primary;		/* input drawn on the panel */
+  gboolean prepared;		/* inputs are known, see module_prepare */
+
+  GtkWidget *canvas;		/* sparkline drawing area */
+  GtkWidget *label;		/* primary value next to the sparkline */
+  GtkWidget *layout;		/* applet->widget layout */
+
+  gint row;			/* sparkline row of the latest sample */
+  guint flat;			/* consecutive samples on the same row */
+  gboolean hot;			/* primary over the warning temperature */
+
+  guint ticker;			/* sensor_sample, see ticker_add() */
 };
 
 static SensorPrivate local_;	/* private global structure singleton */
@@ -59,9 +83,14 @@ sensor_configuration_read (Modulus *applet, SensorConfig *sensor)
   const gchar *attrib;
 
 
-  /* Configuration for the clock applet. */
+  /* Configuration for the sensor applet. */
   applet->enable  = TRUE;
 
+  sensor->root     = SENSOR_SYSFS;
+  sensor->primary  = NULL;
+  sensor->interval = SENSOR_INTERVAL;
+  sensor->warning  = SENSOR_WARNING;
+
   while ((item = configuration_find (chain, "applet")) != NULL) {
     attrib = configuration_attrib (item, "name");
 
@@ -74,6 +103,18 @@ sensor_configuration_read (Modulus *applet, SensorConfig *sensor)
           applet->enable = FALSE;
 
       if ((item = configuration_find (item, "settings")) != NULL) {
+        if ((attrib = configuration_attrib (item, "root")) != NULL)
+          sensor->root = attrib;
+
+        if ((attrib = configuration_attrib (item, "sensor")) != NULL)
+          sensor->primary = attrib;
+
+        if ((attrib = configuration_attrib (item, "interval")) != NULL)
+          if (atoi(attrib) > 0)
+            sensor->interval = atoi(attrib);
+
+        if ((attrib = configuration_attrib (item, "warning")) != NULL)
+          sensor->warning = atoi(attrib);
       }
       break;
     }
@@ -81,6 +122,165 @@ sensor_configuration_read (Modulus *applet, SensorConfig *sensor)
   }
 } /* </sensor_configuration_read> */
 
+/*
+ * (private) sensor_row - sparkline row of value, 0 at the bottom
+ */
+static gint
+sensor_row (SensorInput *input, gint value, gint height)
+{
+  gint low = 0, high = MAX(input->peak, 1);
+  gint row;
+
+  if (input->kind == SENSOR_TEMPERATURE) {
+    low  = SENSOR_TEMP_LOW;
+    high = SENSOR_TEMP_HIGH;
+  }
+  row = (value - low) * (height - 1) / (high - low);
+
+  return CLAMP(row, 0, height - 1);
+} /* </sensor_row> */
+
+/*
+ * (private) sensor_tooltip - every input, one per line
+ */
+static void
+sensor_tooltip (void)
+{
+  GString *text = g_string_new (NULL);
+  GList *iter;
+
+  for (iter = local_.inputs; iter != NULL; iter = iter->next) {
+    SensorInput *input = iter->data;
+
+    g_string_append_printf (text, "%s%s: %d %s", (text->len) ? "\n" : "",
+                            input->label, input->value,
+                            sensor_unit (input->kind));
+  }
+  gtk_tooltips_set_tip (local_.tooltips, local_.layout, text->str, NULL);
+  g_string_free (text, TRUE);
+} /* </sensor_tooltip> */
+
+/*
+ * (private) sensor_label - primary value next to the sparkline
+ */
+static void
+sensor_label (void)
+{
+  SensorInput *input = local_.primary;
+  gchar *text;
+
+  if (input == NULL)
+    return;
+
+  if (input->kind == SENSOR_TEMPERATURE)
+    text = g_strdup_printf ("%d\302\260", input->value);
+  else
+    text = g_strdup_printf ("%d", input->value);
+
+  gtk_label_set_text (GTK_LABEL(local_.label), text);
+  g_free (text);
+} /* </sensor_label> */
+
+/*
+ * sensor_refresh - draw the sparkline of the primary input
+ */
+static gboolean
+sensor_refresh (GtkWidget *canvas, GdkEventExpose *event, gpointer data)
+{
+  SensorInput *input = local_.primary;
+  gint width  = canvas->allocation.width;
+  gint height = canvas->allocation.height;
+  gint step, xpos;
+  guint idx;
+  cairo_t *cr;
+
+  if (input == NULL || input->count == 0)
+    return FALSE;
+
+  step = MAX(width / SENSOR_SAMPLES, 1);
+  xpos = width - step * input->count;	/* newest sample on the right */
+
+  cr = gdk_cairo_create (canvas->window);
+  cairo_set_line_width (cr, 1.0);
+
+  if (local_.hot)
+    cairo_set_source_rgb (cr, 0.9, 0.1, 0.1);
+  else
+    gdk_cairo_set_source_color (cr, &canvas->style->fg[GTK_STATE_NORMAL]);
+
+  for (idx = 0; idx < input->count; idx++) {
+    gint value = input->ring[(input->head + idx) % SENSOR_SAMPLES];
+    double ypos = height - 0.5 - sensor_row (input, value, height);
+
+    if (idx == 0)
+      cairo_move_to (cr, xpos + 0.5, ypos);
+    else
+      cairo_line_to (cr, xpos + step * idx + 0.5, ypos);
+  }
+  cairo_stroke (cr);
+  cairo_destroy (cr);
+
+  return FALSE;
+} /* </sensor_refresh> */
+
+/*
+ * (private) sensor_sample - read every input, on the shared panel tick
+ *
+ * The view is touched only when something visible changes: the tooltip
+ * and label when a reading crosses a display step, the sparkline unless
+ * it has been flat on the same row for the whole ring.
+ */
+static gboolean
+sensor_sample (gpointer data)
+{
+  SensorInput *primary = local_.primary;
+  gboolean changed = FALSE;
+  GList *iter;
+
+  for (iter = local_.inputs; iter != NULL; iter = iter->next) {
+    SensorInput *input = iter->data;
+    gint band, peak = input->peak;
+
+    if (!sensor_read (input))
+      continue;
+
+    band = input->value / sensor_step (input->kind);
+
+    if (band != input->band) {
+      input->band = band;
+      changed = TRUE;
+
+      if (input == primary)
+        sensor_label ();
+    }
+
+    if (input == primary && input->peak != peak)
+      local_.flat = 0;		/* scale changed, redraw everything */
+  }
+
+  if (changed)
+    sensor_tooltip ();
+
+  if (primary) {
+    gint row = sensor_row (primary, primary->value,
+                           local_.canvas->allocation.height);
+    gboolean hot = primary->kind == SENSOR_TEMPERATURE &&
+                   primary->value >= local_.sensor->warning;
+
+    if (row == local_.row && hot == local_.hot)
+      local_.flat++;
+    else
+      local_.flat = 1;
+
+    local_.row = row;
+    local_.hot = hot;
+
+    if (local_.flat <= SENSOR_SAMPLES)
+      gtk_widget_queue_draw (local_.canvas);
+  }
+  return TRUE;
+} /* </sensor_sample> */
+
 /*
  * module_settings provides configuration pages
  */
@@ -88,7 +288,6 @@ GtkWidget *
 module_settings (Modulus *applet, GlobalPanel *panel)
 {
   GtkWidget *layout = NULL;
-  gchar *caption = g_strdup_printf ("%s [%s]", _(applet->label), _("plugin"));
   return layout;
 } /* </module_settings> */
 
@@ -109,7 +308,7 @@ module_init (Modulus *applet)
   applet->release = Release;
   applet->authors = Authors;
 
-  /* Read configuration data for the splash screen. */
+  /* Read configuration data for the sensor applet. */
   sensor_configuration_read (applet, sensor);
 
   /* Initialize private data structure singleton. */
@@ -121,7 +320,7 @@ module_init (Modulus *applet)
   /* Construct the settings pages. */
   applet->label       = "Sensor";
   applet->description = _(
-"Sensors for temperature, etc."
+"Sensors for temperature, fan speed and processor frequency."
 );
   applet->settings = settings_notebook_new (applet, panel,
                        _("Settings"), module_settings (applet, panel),
@@ -129,17 +328,74 @@ module_init (Modulus *applet)
                        -1);
 } /* </module_init> */
 
+/*
+ * module_prepare - discover the sensor inputs, off the main thread
+ */
+void
+module_prepare (Modulus *applet)
+{
+  local_.inputs   = sensor_discover (local_.sensor->root);
+  local_.prepared = TRUE;
+} /* module_prepare */
+
 void
 module_open (Modulus *applet)
 {
+  SensorConfig *sensor = local_.sensor;
   GlobalPanel *panel = applet->data;
+  guint size = panel->icons->size;
+  GList *iter;
+
+  if (!local_.prepared)		/* host without module_prepare support */
+    module_prepare (applet);
+
+  /* The configured primary sensor, else the first temperature. */
+  for (iter = local_.inputs; iter != NULL; iter = iter->next) {
+    SensorInput *input = iter->data;
+
+    if (sensor->primary ? strcmp(input->label, sensor->primary) == 0
+                        : input->kind == SENSOR_TEMPERATURE) {
+      local_.primary = input;
+      break;
+    }
+  }
+  if (local_.primary == NULL && local_.inputs)
+    local_.primary = local_.inputs->data;
 
   /* Construct the user interface. */
-  applet->widget = NULL;
+  local_.layout = gtk_hbox_new (FALSE, 2);
+  local_.canvas = gtk_drawing_area_new ();
+  local_.label  = gtk_label_new (NULL);
+
+  gtk_widget_set_size_request (GTK_WIDGET (local_.canvas), 2 * size, size);
+  gtk_box_pack_start (GTK_BOX(local_.layout), local_.canvas, FALSE, FALSE, 0);
+  gtk_box_pack_start (GTK_BOX(local_.layout), local_.label, FALSE, FALSE, 0);
+  gtk_widget_show (local_.canvas);
+  gtk_widget_show (local_.label);
+
+  g_signal_connect (G_OBJECT (local_.canvas), "expose_event",
+                    G_CALLBACK (sensor_refresh), NULL);
+
+  applet->widget = local_.layout;
+
+  sensor_label ();
+  sensor_tooltip ();
+
+  if (local_.inputs)
+    local_.ticker = ticker_add (sensor->interval, sensor_sample, NULL);
 } /* module_open */
 
 void
 module_close (Modulus *applet)
 {
-  /* gtk_widget_destroy (applet->widget); */
+  ticker_remove (local_.ticker);
+  local_.ticker = 0;
+
+  g_list_foreach (local_.inputs, (GFunc)sensor_input_free, NULL);
+  g_list_free (local_.inputs);
+  local_.inputs   = NULL;
+  local_.primary  = NULL;
+  local_.prepared = FALSE;
+
+  gtk_widget_destroy (applet->widget);
 } /* module_close */
@@ -0,0 +1,489 @@
+/**
+ * Copyright (C) Generations Linux <bugs@softcraft.org>
+ * All Rights Reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sysexits.h>	/* exit status codes for system programs */
+#include <unistd.h>
+#include <gtk/gtk.h>
+
+#include "iconpack.h"
+
+#define DEFAULT_SIZES "16,22,24,32,48"	/* sizes the panel asks for */
+#define BENCH_RUNS    5			/* cold starts timed per method */
+
+const char *Program = "giconpack";  /* (public) published program name */
+const char *Release = "1.0";	    /* (public) published program version */
+
+const char *Description =
+"pre-renders icons into a bundle the panel maps at startup.\n"
+"\n"
+"  PNG icons are scaled to each size given with -s, XPM glyphs are kept\n"
+"  at their natural size and scaled to each size as well. The bundle is\n"
+"  looked up by file basename for files in the folder given with -d\n"
+"  (the installed icons folder).\n"
+"\n"
+"  The program is developed for Generations Linux and distributed\n"
+"  under the terms and condition of the GNU Public License. It is\n"
+"  part of gould (http://www.softcraft.org/gould).";
+
+const char *Usage =
+"usage: %s [-d folder] [-s sizes] -o bundle icon ...\n"
+"       %s -b bundle [-d folder]\n"
+"\n"
+"\t-b time process start to first paint, decoding versus the bundle\n"
+"\t-d folder of the installed icons\n"
+"\t-o write the bundle to this file\n"
+"\t-s comma separated sizes (default: " DEFAULT_SIZES ")\n"
+"\t-v print version information\n"
+"\t-h print help usage (what you are reading)\n"
+"\n";
+
+typedef struct _PackItem PackItem;
+
+struct _PackItem
+{
+  IconPackEntry entry;		/* must be first, see iconpack_compare */
+  GdkPixbuf *pixbuf;		/* RGBA pixels */
+};
+
+/*
+* (private) pack_align - round up to ICONPACK_ALIGN
+*/
+static guint32
+pack_align (guint32 offset)
+{
+  return (offset + ICONPACK_ALIGN - 1) & ~(ICONPACK_ALIGN - 1);
+} /* </pack_align> */
+
+/*
+* (private) pack_add - append an entry for pixbuf
+*/
+static void
+pack_add (GArray *items, const char *name, guint size, GdkPixbuf *pixbuf,
+          off_t bytes)
+{
+  PackItem item;
+
+  memset(&item, 0, sizeof(item));
+  strcpy(item.entry.name, name);
+
+  item.entry.size      = size;
+  item.entry.width     = gdk_pixbuf_get_width (pixbuf);
+  item.entry.height    = gdk_pixbuf_get_height (pixbuf);
+  item.entry.rowstride = item.entry.width * 4;
+  item.entry.bytes     = bytes;
+
+  /* Always RGBA so iconpack_pixbuf() wraps every entry the same way. */
+  if (gdk_pixbuf_get_has_alpha (pixbuf))
+    item.pixbuf = g_object_ref (pixbuf);
+  else
+    item.pixbuf = gdk_pixbuf_add_alpha (pixbuf, FALSE, 0, 0, 0);
+
+  g_array_append_val (items, item);
+} /* </pack_add> */
+
+/*
+* (private) pack_write - write header, index and pixels, atomically
+*/
+static bool
+pack_write (const char *bundle, const char *folder, GArray *items)
+{
+  static const guchar padding[ICONPACK_ALIGN];
+  IconPackHeader header;
+  gchar *partial = g_strdup_printf ("%s.%d", bundle, getpid());
+  guint32 offset;
+  bool vote = true;
+  FILE *stream;
+  guint idx;
+
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, ICONPACK_MAGIC, 4);
+  header.version = ICONPACK_VERSION;
+  header.count   = items->len;
+  g_strlcpy (header.folder, folder, sizeof(header.folder));
+
+  offset = pack_align (sizeof(IconPackHeader) +
+                       items->len * sizeof(IconPackEntry));
+
+  for (idx = 0; idx < items->len; idx++) {
+    PackItem *item = &g_array_index (items, PackItem, idx);
+
+    item->entry.offset = offset;
+    offset = pack_align (offset + item->entry.rowstride * item->entry.height);
+  }
+
+  if ((stream = fopen(partial, "w")) == NULL) {
+    perror(partial);
+    g_free (partial);
+    return false;
+  }
+
+  vote = fwrite(&header, sizeof(header), 1, stream) == 1;
+
+  for (idx = 0; vote && idx < items->len; idx++)
+    vote = fwrite(&g_array_index (items, PackItem, idx).entry,
+                  sizeof(IconPackEntry), 1, stream) == 1;
+
+  for (idx = 0; vote && idx < items->len; idx++) {
+    PackItem *item = &g_array_index (items, PackItem, idx);
+    guchar *pixels = gdk_pixbuf_get_pixels (item->pixbuf);
+    gint stride = gdk_pixbuf_get_rowstride (item->pixbuf);
+    long gap = item->entry.offset - ftell(stream);
+
+    if (gap > 0)
+      vote = fwrite(padding, gap, 1, stream) == 1;
+
+    for (guint row = 0; vote && row < item->entry.height; row++)
+      vote = fwrite(pixels + row * stride, item->entry.rowstride,
+                    1, stream) == 1;
+  }
+
+  if (fclose(stream) != 0)
+    vote = false;
+
+  if (vote)
+    vote = rename(partial, bundle) == 0;
+
+  if (!vote) {
+    perror(bundle);
+    unlink(partial);
+  }
+  g_free (partial);
+
+  return vote;
+} /* </pack_write> */
+
+/*
+* (private) paint_expose - first paint done, report when and quit
+*/
+static bool
+paint_expose (GtkWidget *widget, GdkEventExpose *event, GPtrArray *icons)
+{
+  GdkScreen *screen = gtk_widget_get_screen (widget);
+  gint width = gdk_screen_get_width (screen);
+  gint xpos = 0, ypos = 0, line = 0;
+
+  for (guint idx = 0; idx < icons->len; idx++) {
+    GdkPixbuf *pixbuf = g_ptr_array_index (icons, idx);
+    gint size = gdk_pixbuf_get_width (pixbuf);
+
+    if (xpos + size > width) {
+      xpos = 0;
+      ypos += line;
+      line = 0;
+    }
+    gdk_draw_pixbuf (widget->window, NULL, pixbuf, 0, 0, xpos, ypos,
+                     -1, -1, GDK_RGB_DITHER_NONE, 0, 0);
+    xpos += size;
+    line = MAX(line, gdk_pixbuf_get_height (pixbuf));
+  }
+  gdk_display_sync (gtk_widget_get_display (widget));
+
+  printf("%" G_GINT64_FORMAT "\n", g_get_monotonic_time ());
+  gtk_main_quit ();
+
+  return true;
+} /* </paint_expose> */
+
+/*
+* (private) pack_paint - one cold start: load every icon, paint, exit
+*
+* Run by pack_benchmark() as a process of its own, the way the panel
+* starts: icons are decoded and scaled from folder or, when bundled,
+* wrapped from the mapped bundle. Prints the monotonic time of the
+* first paint.
+*/
+static int
+pack_paint (const char *bundle, const char *folder, bool bundled)
+{
+  GPtrArray *icons = g_ptr_array_new_with_free_func (g_object_unref);
+  IconPackHeader header;
+  IconPackEntry entry;
+  GtkWidget *window, *canvas;
+  FILE *stream;
+
+  if ((stream = fopen(bundle, "r")) == NULL)
+    return EX_NOINPUT;
+
+  if (fread(&header, sizeof(header), 1, stream) != 1) {
+    fclose(stream);
+    return EX_DATAERR;
+  }
+
+  if (folder == NULL)
+    folder = header.folder;
+
+  if (bundled && !iconpack_open (bundle)) {
+    fclose(stream);
+    return EX_DATAERR;
+  }
+
+  for (guint idx = 0; idx < header.count; idx++) {
+    GdkPixbuf *pixbuf = NULL;
+
+    if (fread(&entry, sizeof(entry), 1, stream) != 1)
+      break;
+
+    if (entry.size == 0 || g_str_has_suffix (entry.name, ".xpm"))
+      continue;			/* glyphs are compiled in, not files */
+
+    if (bundled) {
+      pixbuf = iconpack_pixbuf (entry.name, entry.size);
+    }
+    else {
+      gchar *file = g_build_filename (folder, entry.name, NULL);
+      GdkPixbuf *image = gdk_pixbuf_new_from_file (file, NULL);
+
+      if (image != NULL) {
+        pixbuf = gdk_pixbuf_scale_simple (image, entry.size, entry.size,
+                                          GDK_INTERP_BILINEAR);
+        g_object_unref (image);
+      }
+      g_free (file);
+    }
+
+    if (pixbuf != NULL)
+      g_ptr_array_add (icons, pixbuf);
+  }
+  fclose(stream);
+
+  window = gtk_window_new (GTK_WINDOW_TOPLEVEL);
+  canvas = gtk_drawing_area_new ();
+  gtk_widget_set_size_request (canvas, 640, 480);
+  gtk_container_add (GTK_CONTAINER (window), canvas);
+
+  g_signal_connect (G_OBJECT (canvas), "expose-event",
+                    G_CALLBACK (paint_expose), icons);
+
+  gtk_widget_show_all (window);
+  gtk_main ();
+
+  g_ptr_array_free (icons, TRUE);
+  return EX_OK;
+} /* </pack_paint> */
+
+/*
+* (private) pack_start - time one pack_paint() process, -1 on failure
+*/
+static gint64
+pack_start (const char *bundle, const char *folder, bool bundled)
+{
+  gchar *argv[] = { "/proc/self/exe", "-p", (bundled) ? "bundle" : "decode",
+                    "-b", (gchar *)bundle,
+                    (folder) ? "-d" : NULL, (gchar *)folder, NULL };
+  gchar *output = NULL;
+  gint64 start, paint;
+  gint status;
+
+  start = g_get_monotonic_time ();
+
+  if (!g_spawn_sync (NULL, argv, NULL, G_SPAWN_STDERR_TO_DEV_NULL, NULL,
+                     NULL, &output, NULL, &status, NULL) || status != 0) {
+    g_free (output);
+    return -1;
+  }
+
+  paint = g_ascii_strtoll (output, NULL, 10);
+  g_free (output);
+
+  return (paint > start) ? paint - start : -1;
+} /* </pack_start> */
+
+/*
+* (private) pack_benchmark - process start to first paint, decode vs bundle
+*
+* Each run is a new process, as the panel starting up. The page cache is
+* warm after the first run for both methods: drop it (as root, echo 3 >
+* /proc/sys/vm/drop_caches) between runs for a truly cold disk.
+*/
+static int
+pack_benchmark (const char *bundle, const char *folder)
+{
+  gint64 decode = G_MAXINT64, mapped = G_MAXINT64;
+
+  if (!iconpack_open (bundle)) {
+    fprintf(stderr, "%s: cannot open %s\n", Program, bundle);
+    return EX_NOINPUT;
+  }
+
+  if (!gtk_init_check (NULL, NULL)) {
+    fprintf(stderr, "%s: no display, benchmark skipped\n", Program);
+    return EX_UNAVAILABLE;
+  }
+
+  /* Best of BENCH_RUNS, interleaved so both see the same system load. */
+  for (int run = 0; run < BENCH_RUNS; run++) {
+    gint64 one = pack_start (bundle, folder, false);
+    gint64 two = pack_start (bundle, folder, true);
+
+    if (one < 0 || two < 0) {
+      fprintf(stderr, "%s: paint run failed\n", Program);
+      return EX_SOFTWARE;
+    }
+    decode = MIN(decode, one);
+    mapped = MIN(mapped, two);
+  }
+
+  printf("%s: start to first paint, decode and scale %.1f ms, "
+         "bundle %.1f ms (best of %d)\n", Program,
+         (double)decode / 1000, (double)mapped / 1000, BENCH_RUNS);
+
+  return EX_OK;
+} /* </pack_benchmark> */
+
+/*
+* main - giconpack main program
+*/
+int
+main(int argc, char *argv[])
+{
+  const char *bench = NULL;
+  const char *bundle = NULL;
+  const char *folder = NULL;
+  const char *paint = NULL;
+  const char *sizes = DEFAULT_SIZES;
+  GArray *items, *scales;
+  gchar **list;
+  int opt;
+
+  /* disable invalid option messages */
+  opterr = 0;
+
+  while ((opt = getopt (argc, argv, "b:d:ho:p:s:v")) != -1) {
+    switch (opt) {
+      case 'b':
+        bench = optarg;
+        break;
+
+      case 'd':
+        folder = optarg;
+        break;
+
+      case 'h':
+        printf(Usage, Program, Program);
+        return EX_OK;
+
+      case 'o':
+        bundle = optarg;
+        break;
+
+      case 'p':			/* one pack_benchmark() run */
+        paint = optarg;
+        break;
+
+      case 's':
+        sizes = optarg;
+        break;
+
+      case 'v':
+        printf("<!-- %s %s %s\n -->\n", Program, Release, Description);
+        return EX_OK;
+
+      default:
+        printf("%s: invalid option, use -h for help usage.\n", Program);
+        return EX_USAGE;
+    }
+  }
+
+#if !GLIB_CHECK_VERSION(2,36,0)
+  g_type_init ();
+#endif
+
+  if (bench != NULL && paint != NULL) {
+    if (!gtk_init_check (&argc, &argv))
+      return EX_UNAVAILABLE;
+
+    return pack_paint (bench, folder, strcmp(paint, "bundle") == 0);
+  }
+
+  if (bench != NULL)
+    return pack_benchmark (bench, folder);
+
+  if (bundle == NULL || folder == NULL || optind >= argc) {
+    printf(Usage, Program, Program);
+    return EX_USAGE;
+  }
+
+  items  = g_array_new (FALSE, TRUE, sizeof(PackItem));
+  scales = g_array_new (FALSE, FALSE, sizeof(gint));
+  list   = g_strsplit (sizes, ",", -1);
+
+  /* Each size once, the list may repeat the configured ones. */
+  for (int idx = 0; list[idx] != NULL; idx++) {
+    gint size = atoi(list[idx]);
+    guint known;
+
+    for (known = 0; known < scales->len; known++)
+      if (g_array_index (scales, gint, known) == size)
+        break;
+
+    if (size > 0 && known == scales->len)
+      g_array_append_val (scales, size);
+  }
+  g_strfreev (list);
+
+  for (int arg = optind; arg < argc; arg++) {
+    gchar *name = g_path_get_basename (argv[arg]);
+    GError *error = NULL;
+    GdkPixbuf *image;
+    struct stat info;
+
+    if (strlen(name) >= ICONPACK_NAMELEN) {
+      fprintf(stderr, "%s: %s: name too long, skipped\n", Program, name);
+      g_free (name);
+      continue;
+    }
+
+    if (stat(argv[arg], &info) != 0 ||
+        (image = gdk_pixbuf_new_from_file (argv[arg], &error)) == NULL) {
+      if (error) {
+        fprintf(stderr, "%s: %s\n", Program, error->message);
+        g_error_free (error);
+      }
+      else {
+        perror(argv[arg]);
+      }
+      g_free (name);
+      continue;
+    }
+
+    if (g_str_has_suffix (name, ".xpm"))	/* glyph, natural size too */
+      pack_add (items, name, 0, image, info.st_size);
+
+    for (guint idx = 0; idx < scales->len; idx++) {
+      gint size = g_array_index (scales, gint, idx);
+      GdkPixbuf *pixbuf = gdk_pixbuf_scale_simple (image, size, size,
+                                                   GDK_INTERP_BILINEAR);
+
+      pack_add (items, name, size, pixbuf, info.st_size);
+      g_object_unref (pixbuf);
+    }
+    g_object_unref (image);
+    g_free (name);
+  }
+  g_array_free (scales, TRUE);
+
+  /* Sorted by (name, size), iconpack_pixbuf() uses bsearch(3). */
+  g_array_sort (items, iconpack_compare);
+
+  return pack_write (bundle, folder, items) ? EX_OK : EX_CANTCREAT;
+} /* </main> */
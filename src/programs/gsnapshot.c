@@ -688,7 +688,10 @@ main(int argc, char *argv[])
   gtk_disable_setlocale();
 #endif
 
-  /* Initialization of the GTK */
+  /* Initialization of the GTK (threads are used by the grabber) */
+#if GLIB_CHECK_VERSION(2,32,0) == 0
+  if (!g_thread_supported ()) g_thread_init (NULL);
+#endif
   gtk_init (&argc, &argv);
   gtk_set_locale ();
 
@@ -68,6 +68,7 @@
 
 #include "gould.h"
 #include "util.h"
+#include "bgcache.h"
 
 #ifndef RUNDIR
 #define RUNDIR "/var/run/gould"
@@ -89,6 +90,7 @@ const char *Usage =
 "\n";
 
 const char *Program;            /* published program name */
+unsigned short debug = 0;       /* (protected) libgould vdebug() level */
 const char *Release;            /* program release version */
 
 const key_t AUTOLOGIN = 0xbade; /* named semaphore (key_t)arg */
@@ -1102,6 +1104,11 @@ showtime()
   stty_sane();
   startx();		/* start X and check that we got started */
 
+#if GLIB_CHECK_VERSION(2,32,0) == 0
+  if (!g_thread_supported()) g_thread_init(NULL);  /* see interface_setbg */
+#endif
+  bgcache_set_folder(BGCACHE_SYSTEM);              /* see interface_setbg */
+
   for (idx = 0; idx < maxtry; idx++) {
     if(gdk_init_check(0, 0)) break;
     g_usleep(50 * 1000);
@@ -34,6 +34,7 @@
 
 #include "gould.h"
 #include "util.h"
+#include "bgcache.h"
 
 #define MAX_INPUT_CHARS     32
 #define MAX_VISIBLE_CHARS   14
@@ -53,6 +54,21 @@ static int session_select = -1;
 
 static char *message;
 
+/*
+ * Greeter background render, see interface_setbg. The stretched theme is
+ * kept by the libgould background cache (bgcache.c) in BGCACHE_SYSTEM.
+ */
+typedef struct _BgRender BgRender;
+
+struct _BgRender
+{
+  char      *source;                /* display bg (theme file) */
+  GdkPixbuf *image;                 /* decoded theme, unscaled */
+  GdkPixbuf *pixbuf;                /* render at screen resolution */
+  GdkWindow *window;
+  gint       width, height;
+};
+
 static pid_t greeter = -1;
 static guint greeter_watch = 0;
 static int greeter_pipe[2];
@@ -366,6 +382,62 @@ interface_add_cursor(void)
   gdk_cursor_unref(cur);
 }
 
+
+/*
+ * (private) interface_setpixbuf - make pixbuf the window background
+ */
+static void
+interface_setpixbuf(GdkWindow *window, GdkPixbuf *pixbuf)
+{
+  GdkPixmap *pix = NULL;
+
+  gdk_pixbuf_render_pixmap_and_mask(pixbuf, &pix, NULL, 0);
+
+  /* call x directly, because gdk will ref the pixmap */
+  XSetWindowBackgroundPixmap(GDK_WINDOW_XDISPLAY(window),
+                             GDK_WINDOW_XID(window), GDK_PIXMAP_XID(pix));
+  g_object_unref (pix);
+
+  gdk_window_clear (window);
+}
+
+/*
+ * (private) bgcache_apply - main loop side of the background pass
+ * (private) bgcache_worker - render GDK_INTERP_HYPER and refresh the cache
+ */
+static gboolean
+bgcache_apply(BgRender *job)
+{
+  if (gould_cur_session() <= 0 && root == job->window)
+    interface_setpixbuf(job->window, job->pixbuf);
+
+  g_object_unref (job->pixbuf);
+  g_free (job->source);
+  g_free (job);
+
+  return FALSE;
+}
+
+static gpointer
+bgcache_worker(BgRender *job)
+{
+  GTimer *timer = g_timer_new();
+
+  job->pixbuf = gdk_pixbuf_scale_simple(job->image, job->width, job->height,
+                                        GDK_INTERP_HYPER);
+  g_object_unref (job->image);
+
+  if (!bgcache_save(job->source, job->pixbuf, BACKGROUND_SCALED))
+    log_print("cannot cache %s\n", job->source);
+
+  log_print("greeter background rendered in %.3fs\n",
+            g_timer_elapsed(timer, NULL));
+  g_timer_destroy (timer);
+
+  g_idle_add((GSourceFunc)bgcache_apply, job);
+  return NULL;
+}
+
 GError *
 interface_setbg(GdkWindow *window)
 {
@@ -383,33 +455,73 @@ interface_setbg(GdkWindow *window)
       gdk_window_clear (window);  /* clear window to effect change */
     }
     else {
-      GdkPixbuf *bgimg = gdk_pixbuf_new_from_file (bg, &error);
-
-      if (bgimg) {
-        GdkPixmap *pix = NULL;
-        char *style = g_key_file_get_string(config, "display", "bg_style", 0);
+      char *style = g_key_file_get_string(config, "display", "bg_style", 0);
+      gboolean stretch = (!style || !strcmp(style, "stretch"));
+      GTimer *timer = g_timer_new();
+      GdkPixbuf *bgimg = NULL;
+
+      // FIXME! get the window dimensions not the screen display
+      gint width  = gdk_screen_width();
+      gint height = gdk_screen_height();
+
+      if (stretch &&
+          (bgimg = bgcache_lookup(bg, width, height, BACKGROUND_SCALED))) {
+        interface_setpixbuf(window, bgimg);
+        g_object_unref (bgimg);
 
-        if (!style || !strcmp(style, "stretch")) {
-          // FIXME! get the window dimensions not the screen display
-          GdkPixbuf *pb = gdk_pixbuf_scale_simple(bgimg,
-                                                  gdk_screen_width(),
-                                                  gdk_screen_height(),
+        log_print("greeter background cache hit in %.3fs\n",
+                  g_timer_elapsed(timer, NULL));
+      }
+      else if ((bgimg = gdk_pixbuf_new_from_file (bg, &error)) != NULL) {
+        if (stretch) {
+          BgRender *job = g_new0 (BgRender, 1);
+          GThread *worker;
+
+          job->source = g_strdup(bg);
+          job->image  = g_object_ref (bgimg);	/* the worker's own */
+          job->window = window;
+          job->width  = width;
+          job->height = height;
+
+          /* final quality render and cache refresh off the main loop */
+#if GLIB_CHECK_VERSION(2,32,0)
+          worker = g_thread_try_new("bgcache", (GThreadFunc)bgcache_worker,
+                                    job, NULL);
+          if (worker) g_thread_unref(worker);
+#else
+          worker = (g_thread_supported()) ?
+                   g_thread_create((GThreadFunc)bgcache_worker,
+                                   job, FALSE, NULL) : NULL;
+#endif
+          if (worker) {		/* quick preview meanwhile */
+            GdkPixbuf *pb = gdk_pixbuf_scale_simple(bgimg, width, height,
+                                                    GDK_INTERP_BILINEAR);
+            interface_setpixbuf(window, pb);
+            g_object_unref (pb);
+          }
+          else {
+            job->pixbuf = gdk_pixbuf_scale_simple(bgimg, width, height,
                                                   GDK_INTERP_HYPER);
+            g_object_unref (job->image);
+
+            bgcache_save(bg, job->pixbuf, BACKGROUND_SCALED);
+            bgcache_apply(job);
+          }
+          g_object_unref (bgimg);
+        }
+        else {		/* tiled unscaled, nothing worth caching */
+          interface_setpixbuf(window, bgimg);
           g_object_unref (bgimg);
-          bgimg = pb;
         }
 
-        gdk_pixbuf_render_pixmap_and_mask(bgimg, &pix, NULL, 0);
-        g_object_unref (bgimg);
-
-        /* call x directly, because gdk will ref the pixmap */
-        XSetWindowBackgroundPixmap(GDK_WINDOW_XDISPLAY(window),
-                                   GDK_WINDOW_XID(window), GDK_PIXMAP_XID(pix));
-        g_object_unref (pix);
+        log_print("greeter background cache miss in %.3fs\n",
+                  g_timer_elapsed(timer, NULL));
       }
       else {
         log_print("%s\n", error->message);
       }
+      g_timer_destroy (timer);
+      g_free (style);
     }
   }
 
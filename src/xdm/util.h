@@ -27,6 +27,10 @@
 #define CONFIG_CACHE "/var/run/gould/cache"
 #endif
 
+#ifndef BGCACHE_SYSTEM
+#define BGCACHE_SYSTEM "/var/cache/gould/backgrounds"
+#endif
+
 #ifndef MAX_PATHNAME
 #define MAX_PATHNAME 128
 #endif
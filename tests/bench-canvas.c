@@ -0,0 +1,179 @@
+/**
+ * Copyright (C) Generations Linux <bugs@softcraft.org>
+ * All Rights Reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <stdlib.h>
+#include <gdk/gdkx.h>
+
+#include "gould.h"
+#include "docklet.h"
+#include "check.h"
+
+/*
+* Desktop shortcuts as one window each against one shared canvas window.
+* Reports the time until all are mapped and drawn, the top level windows
+* they add and the X server resident size they add (read through the
+* server lock file, so only for a local server such as xvfb-run). Needs
+* a display, skipped otherwise.
+*/
+#define BENCH_SHORTCUTS 64	/* shortcuts on the desktop */
+
+/*
+* (private) server_rss - resident KiB of the local X server, 0 if unknown
+*/
+static glong
+server_rss (void)
+{
+  const gchar *name = gdk_display_get_name (gdk_display_get_default ());
+  const gchar *colon = strrchr (name, ':');
+  gchar *lockfile, *content, *status;
+  glong rss = 0;
+
+  if (colon == NULL)
+    return 0;
+
+  lockfile = g_strdup_printf ("/tmp/.X%d-lock", atoi (colon + 1));
+
+  if (g_file_get_contents (lockfile, &content, NULL, NULL)) {
+    gchar *procfile = g_strdup_printf ("/proc/%d/status", atoi (content));
+
+    if (g_file_get_contents (procfile, &status, NULL, NULL)) {
+      gchar *line = strstr (status, "VmRSS:");
+      if (line != NULL) rss = atol (line + strlen ("VmRSS:"));
+      g_free (status);
+    }
+    g_free (procfile);
+    g_free (content);
+  }
+  g_free (lockfile);
+
+  return rss;
+} /* </server_rss> */
+
+/*
+* (private) toplevels - number of children of the root window
+*/
+static guint
+toplevels (Display *display)
+{
+  Window root, parent, *children = NULL;
+  unsigned int count = 0;
+
+  XQueryTree (display, DefaultRootWindow (display), &root, &parent,
+              &children, &count);
+  if (children) XFree (children);
+
+  return count;
+} /* </toplevels> */
+
+/*
+* (private) settle - wait until the server has processed everything
+*/
+static void
+settle (Display *display)
+{
+  XSync (display, False);
+  while (gtk_events_pending ())
+    gtk_main_iteration ();
+  XSync (display, False);
+} /* </settle> */
+
+/*
+* (private) measure - map BENCH_SHORTCUTS shortcuts, shared canvas or not
+*/
+static void
+measure (const char *icon, bool shared)
+{
+  Display *display = GDK_DISPLAY_XDISPLAY (gdk_display_get_default ());
+  GdkColor fg = { 0, 0xffff, 0xffff, 0xffff };
+  DockletCanvas *canvas = NULL;
+  Docklet *docklets[BENCH_SHORTCUTS];
+  guint windows;
+  glong rss;
+  gint64 elapsed;
+  int idx;
+
+  settle (display);
+  windows = toplevels (display);
+  rss = server_rss ();
+  elapsed = g_get_monotonic_time ();
+
+  if (shared)
+    canvas = docklet_canvas_new ();
+
+  for (idx = 0; idx < BENCH_SHORTCUTS; idx++) {
+    gint xpos = (idx % 8) * 96, ypos = (idx / 8) * 96;
+
+    if (shared)
+      docklets[idx] = docklet_canvas_add (canvas, 48, 48, xpos, ypos,
+                                          GTK_ORIENTATION_VERTICAL, icon,
+                                          "Shortcut", NULL, NULL, &fg, true);
+    else
+      docklets[idx] = docklet_new (GDK_WINDOW_TYPE_HINT_NORMAL, 48, 48,
+                                   xpos, ypos, GTK_ORIENTATION_VERTICAL,
+                                   GTK_VISIBILITY_NONE, icon,
+                                   "Shortcut", NULL, NULL, &fg, true);
+    CHECK(docklets[idx] != NULL);
+    docklet_show (docklets[idx]);
+  }
+  settle (display);
+
+  elapsed = g_get_monotonic_time () - elapsed;
+  windows = toplevels (display) - windows;
+  rss = (rss > 0) ? server_rss () - rss : 0;
+
+  printf("%-8s %d shortcuts: %.1f ms to map, %u windows, %ld KiB server\n",
+         (shared) ? "canvas" : "windows", BENCH_SHORTCUTS,
+         (double)elapsed / 1000, windows, rss);
+
+  if (shared)
+    CHECK(windows == 1);
+
+  if (canvas != NULL)
+    docklet_canvas_destroy (canvas);	/* and the docklets on it */
+  else
+    for (idx = 0; idx < BENCH_SHORTCUTS; idx++)
+      docklet_destroy (docklets[idx]);
+  settle (display);
+} /* </measure> */
+
+int
+main (int argc, char *argv[])
+{
+  gchar *icon = g_build_filename (g_get_tmp_dir (), "bench-canvas.png", NULL);
+  GdkPixbuf *pixbuf;
+
+  if (gtk_init_check (&argc, &argv) == FALSE) {
+    printf("%s: no display, skipped\n", argv[0]);
+    return CHECK_SKIP;
+  }
+
+  pixbuf = gdk_pixbuf_new (GDK_COLORSPACE_RGB, TRUE, 8, 48, 48);
+  gdk_pixbuf_fill (pixbuf, 0x80c0e0ff);
+  gdk_pixbuf_save (pixbuf, icon, "png", NULL, NULL);
+  g_object_unref (pixbuf);
+
+  /* Canvas first: the server seldom returns memory once grown. */
+  measure (icon, true);
+  measure (icon, false);
+
+  unlink (icon);
+  g_free (icon);
+
+  return CHECK_EXIT();
+} /* </main> */
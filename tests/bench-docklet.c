@@ -0,0 +1,243 @@
+/**
+ * Copyright (C) Generations Linux <bugs@softcraft.org>
+ * All Rights Reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <stdlib.h>
+#include <dlfcn.h>		/* RTLD_NEXT, _GNU_SOURCE */
+#include <gdk/gdkx.h>
+#include <X11/Xlibint.h>	/* _XReply */
+
+#include "gould.h"
+#include "gpanel.h"
+#include "check.h"
+
+/*
+* Docklet and desktop shortcut images, composed client side with cairo
+* (docklet_render, gpanel_shortcut_render) against the server pixmap and
+* readback they replaced. Reports the round trips, X requests and wall
+* time per image. Every Xlib call waiting on a reply goes through
+* _XReply, interposed to count them. Needs a display, run it as
+* `xvfb-run make check'; skipped otherwise.
+*/
+#define BENCH_IMAGES 200	/* images composed per method */
+#define BENCH_FONT   "Sans 12"	/* one of DesktopFont, see desktop.c */
+
+static gulong replies_ = 0;	/* _XReply calls, one per round trip */
+
+Status
+_XReply (Display *display, xReply *reply, int extra, Bool discard)
+{
+  static Status (*next) (Display *, xReply *, int, Bool) = NULL;
+
+  if (next == NULL)
+    next = dlsym (RTLD_NEXT, "_XReply");
+
+  replies_++;
+  return next (display, reply, extra, discard);
+} /* </_XReply> */
+
+/*
+* (private) server_render - the former pixmap, draw and readback path
+*/
+static GdkPixbuf *
+server_render (Docklet *instance, GdkPixbuf *pixbuf)
+{
+  GdkWindow *window = gdk_get_default_root_window ();
+  GdkColormap *colormap = gdk_colormap_get_system ();
+  PangoLayout *layout;
+  GdkPixmap *pixmap;
+  GdkPixbuf *render;
+  GdkGC *gc;
+
+  gint width  = instance->width * 1.25;
+  gint height = instance->height * 2;
+
+  layout = gtk_widget_create_pango_layout (instance->window, instance->text);
+  pango_layout_set_width (layout, 2 * width * PANGO_SCALE);
+
+  gc = gdk_gc_new (window);
+  gdk_gc_set_foreground (gc, instance->bg);
+  pixmap = gdk_pixmap_new (window, width, height, -1);
+  gdk_draw_rectangle (pixmap, gc, TRUE, 0, 0, width, height);
+  gdk_draw_pixbuf (pixmap, gc, pixbuf, 0, 0, 0, 0, -1, -1,
+                   GDK_RGB_DITHER_NONE, 0, 0);
+  gdk_draw_layout_with_colors (pixmap, gc, 0, instance->height, layout,
+                               instance->fg, instance->bg);
+
+  render = gdk_pixbuf_get_from_drawable (NULL, pixmap, colormap,
+                                         0, 0, 0, 0, width, height);
+  g_object_unref (pixmap);
+  g_object_unref (layout);
+  g_object_unref (gc);
+
+  return render;
+} /* </server_render> */
+
+/*
+* (private) server_shortcut - the former desktop_shortcut_render path
+*/
+static GdkPixbuf *
+server_shortcut (GtkWidget *canvas, const char *font,
+                 GdkPixbuf *piximg, const char *label)
+{
+  GdkWindow *window = gdk_get_default_root_window ();
+  GdkColormap *colormap = gdk_colormap_get_system ();
+  GdkGC *gc = gdk_gc_new (window);
+
+  PangoFontDescription *fontdesc = pango_font_description_from_string (font);
+  PangoLayout *layout = gtk_widget_create_pango_layout (canvas, label);
+
+  GdkColor white = { 0, 0xffff, 0xffff, 0xffff };
+  GdkPixmap *pixmap;
+  GdkPixbuf *render;
+
+  gint iconsize = gdk_pixbuf_get_width (piximg);
+  gint width, height;
+  gint xsize, ysize;
+
+  pango_layout_set_font_description (layout, fontdesc);
+  pango_font_description_free (fontdesc);
+  pango_layout_get_pixel_size (layout, &xsize, &ysize);
+  pango_layout_set_width (layout, 3 * iconsize / 2 * PANGO_SCALE);
+  pango_layout_set_wrap (layout, PANGO_WRAP_WORD_CHAR);
+
+  width = (xsize > iconsize) ? xsize : iconsize;
+  height = iconsize + ysize;
+
+  /* Blank pixmap, icon and label drawn by the server, then read back. */
+  render = gdk_pixbuf_new (GDK_COLORSPACE_RGB, TRUE, 8, width, height);
+  gdk_pixbuf_fill (render, 0);
+  gdk_pixbuf_render_pixmap_and_mask (render, &pixmap, NULL, 255);
+  g_object_unref (render);
+
+  gdk_draw_pixbuf (pixmap, gc, piximg, 0, 0,
+                   (xsize > iconsize) ? (xsize - iconsize) / 2 : -1, 0,
+                   -1, -1, GDK_RGB_DITHER_NORMAL, 0, 0);
+  gdk_draw_layout_with_colors (pixmap, gc,
+                               (iconsize > xsize) ? (iconsize - xsize) / 2 : -1,
+                               iconsize, layout, &white, NULL);
+
+  render = gdk_pixbuf_get_from_drawable (NULL, pixmap, colormap,
+                                         0, 0, 0, 0, -1, -1);
+  g_object_unref (pixmap);
+  g_object_unref (layout);
+  g_object_unref (gc);
+
+  return render;
+} /* </server_shortcut> */
+
+/*
+* (private) shortcut_server, shortcut_cairo - the desktop shortcut ways
+*/
+static GdkPixbuf *
+shortcut_server (Docklet *instance, GdkPixbuf *pixbuf)
+{
+  return server_shortcut (instance->window, BENCH_FONT, pixbuf,
+                          instance->text);
+} /* </shortcut_server> */
+
+static GdkPixbuf *
+shortcut_cairo (Docklet *instance, GdkPixbuf *pixbuf)
+{
+  return gpanel_shortcut_render (instance->window, BENCH_FONT, pixbuf,
+                                 instance->text);
+} /* </shortcut_cairo> */
+
+/*
+* (private) measure - compose BENCH_IMAGES images, report round trips,
+* requests and time
+*/
+static gulong
+measure (const char *caption, Docklet *instance, GdkPixbuf *pixbuf,
+         GdkPixbuf *(*render)(Docklet *, GdkPixbuf *))
+{
+  Display *display = GDK_DISPLAY_XDISPLAY (gdk_display_get_default ());
+  unsigned long requests;
+  gulong trips;
+  gint64 elapsed;
+  int idx;
+
+  /* The first image loads the font, not counted. */
+  g_object_unref (render (instance, pixbuf));
+
+  XSync (display, False);
+  requests = XNextRequest (display);
+  trips = replies_;
+  elapsed = g_get_monotonic_time ();
+
+  for (idx = 0; idx < BENCH_IMAGES; idx++) {
+    GdkPixbuf *image = render (instance, pixbuf);
+    CHECK(image != NULL);
+    if (image) g_object_unref (image);
+  }
+
+  XSync (display, False);
+  elapsed = g_get_monotonic_time () - elapsed;
+  requests = XNextRequest (display) - requests - 1;	/* less the XSync */
+  trips = replies_ - trips - 1;
+
+  printf("%-16s %d images: %lu round trips, %lu X requests, %.1f us/image\n",
+         caption, BENCH_IMAGES, trips, requests,
+         (double)elapsed / BENCH_IMAGES);
+
+  return trips;
+} /* </measure> */
+
+int
+main (int argc, char *argv[])
+{
+  GdkColor bg = { 0, 0x3000, 0x5000, 0x7000 };
+  GdkColor fg = { 0, 0xffff, 0xffff, 0xffff };
+  gchar *icon = g_build_filename (g_get_tmp_dir (), "bench-docklet.png", NULL);
+  GdkPixbuf *pixbuf;
+  Docklet *instance;
+
+  if (gtk_init_check (&argc, &argv) == FALSE) {
+    printf("%s: no display, skipped\n", argv[0]);
+    return CHECK_SKIP;
+  }
+
+  pixbuf = gdk_pixbuf_new (GDK_COLORSPACE_RGB, TRUE, 8, 48, 48);
+  gdk_pixbuf_fill (pixbuf, 0x80c0e0ff);
+  gdk_pixbuf_save (pixbuf, icon, "png", NULL, NULL);
+
+  instance = docklet_new (GDK_WINDOW_TYPE_HINT_DESKTOP, 48, 48, 0, 0,
+                          GTK_ORIENTATION_VERTICAL, GTK_VISIBILITY_NONE,
+                          icon, "Shortcut label", NULL, &bg, &fg, true);
+  CHECK(instance != NULL);
+
+  if (instance != NULL) {
+    instance->width  = gdk_pixbuf_get_width (pixbuf);
+    instance->height = gdk_pixbuf_get_height (pixbuf);
+
+    /* The readback waits on the server once per image, cairo never. */
+    CHECK(measure ("docklet server", instance, pixbuf, server_render)
+          >= BENCH_IMAGES);
+    CHECK(measure ("docklet cairo", instance, pixbuf, docklet_render) == 0);
+    CHECK(measure ("shortcut server", instance, pixbuf, shortcut_server)
+          >= BENCH_IMAGES);
+    CHECK(measure ("shortcut cairo", instance, pixbuf, shortcut_cairo) == 0);
+    docklet_destroy (instance);
+  }
+
+  g_object_unref (pixbuf);
+  unlink (icon);
+  g_free (icon);
+
+  return CHECK_EXIT();
+} /* </main> */
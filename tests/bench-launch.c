@@ -0,0 +1,147 @@
+/**
+ * Copyright (C) Generations Linux <bugs@softcraft.org>
+ * All Rights Reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/wait.h>
+
+#include "gould.h"
+#include "util.h"
+#include "check.h"
+
+/*
+* Launch latency against resident size: spawn() (posix_spawn) and the
+* fork() and exec it replaced, timed in the parent, with heaps of a few
+* sizes touched so they are resident. fork() copies the page tables of
+* the heap, posix_spawn() does not.
+*/
+#define BENCH_ROUNDS  20	/* launches of each kind per heap size */
+#define BENCH_COMMAND "exit 0"
+
+static const gsize heaps_[] = { 0, 64, 256, 1024 };	/* MiB */
+
+/*
+* (private) clock_us - monotonic microseconds
+*/
+static glong
+clock_us (void)
+{
+  struct timespec now;
+
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return now.tv_sec * 1000000 + now.tv_nsec / 1000;
+} /* </clock_us> */
+
+/*
+* (private) resident - VmRSS of this process in MiB
+*/
+static glong
+resident (void)
+{
+  gchar *status, *line;
+  glong rss = 0;
+
+  if (g_file_get_contents ("/proc/self/status", &status, NULL, NULL)) {
+    if ((line = strstr (status, "VmRSS:")) != NULL)
+      rss = atol (line + strlen ("VmRSS:")) / 1024;
+    g_free (status);
+  }
+  return rss;
+} /* </resident> */
+
+/*
+* (private) forked - the launch spawn() replaced, fork() then exec
+*/
+static pid_t
+forked (const char *command)
+{
+  pid_t pid = fork();
+
+  if (pid == 0) {
+    execl("/bin/sh", "/bin/sh", "-f", "-c", command, (char *)NULL);
+    _exit (127);
+  }
+  return pid;
+} /* </forked> */
+
+/*
+* (private) measure - mean microseconds launch takes to return
+*/
+static glong
+measure (pid_t (*launch) (const char *))
+{
+  glong spent = 0;
+  int round;
+
+  for (round = 0; round < BENCH_ROUNDS; round++) {
+    glong start = clock_us ();
+    pid_t pid = launch (BENCH_COMMAND);
+
+    spent += clock_us () - start;
+
+    if (pid > 0)
+      waitpid(pid, NULL, 0);
+    else
+      CHECK(pid > 0);
+  }
+  return spent / BENCH_ROUNDS;
+} /* </measure> */
+
+int
+main (int argc, char *argv[])
+{
+  glong available = sysconf(_SC_AVPHYS_PAGES) / 1024 * sysconf(_SC_PAGESIZE)
+                    / 1024;				/* MiB */
+  glong spawned = 0, fork_us = 0;
+  gsize measured = 0;
+  int idx;
+
+  printf("%8s %12s %12s\n", "VmRSS", "spawn()", "fork()");
+
+  for (idx = 0; idx < G_N_ELEMENTS (heaps_); idx++) {
+    gsize size = heaps_[idx] << 20;
+    gchar *heap;
+
+    if (heaps_[idx] > available / 2) {	/* leave the machine some room */
+      printf("%5zu MiB skipped, %ld MiB available\n", heaps_[idx], available);
+      continue;
+    }
+
+    heap = g_malloc (size + 1);
+    memset(heap, 1, size + 1);			/* resident, not just mapped */
+
+    spawned = measure (spawn);
+    fork_us = measure (forked);
+
+    printf("%5ld MiB %9ld us %9ld us\n", resident (), spawned, fork_us);
+    measured = heaps_[idx];
+    g_free (heap);
+  }
+
+  /* with small heaps fork() may well win, only the largest one tells */
+  if (measured < heaps_[G_N_ELEMENTS (heaps_) - 1]) {
+    printf("%s: largest heap not measured, skipped\n", argv[0]);
+    return CHECK_SKIP;
+  }
+  CHECK(spawned <= fork_us);	/* posix_spawn() must not be the slower */
+
+  return CHECK_EXIT();
+} /* </main> */
@@ -0,0 +1,400 @@
+/**
+ * Copyright (C) Generations Linux <bugs@softcraft.org>
+ * All Rights Reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <time.h>
+#include <sys/wait.h>
+
+#include "gould.h"
+#include "gsession.h"
+#include "util.h"
+#include "check.h"
+
+/*
+* Load generator for the gsession backend: clients keep a number of
+* framed requests in flight for a while, the report gives requests per
+* second and the p50 and p99 latency. A second run makes every
+* BENCH_MIXED-th request a _GSESSION_SERVICE one, answered by the monitor
+* process: the _GET_SESSION_PID requests around it must not wait on the
+* monitor (the backend used to block on it). Then one client queues replies up
+* to _GSESSION_BACKLOG_MAX without reading them and half-closes, the
+* backend must stay idle meanwhile (it used to spin on EPOLLRDHUP).
+*/
+#ifndef GSESSION
+#define GSESSION "../src/desktop/gsession"
+#endif
+
+#define BENCH_CLIENTS   32	/* connections */
+#define BENCH_DEPTH     8	/* requests in flight on each */
+#define BENCH_RUN       2000	/* milliseconds of load */
+#define BENCH_IDLE      1000	/* milliseconds the half-closed client waits */
+#define BENCH_MIXED     4	/* every 4th request of the mixed run is a service */
+
+typedef struct _BenchClient BenchClient;
+
+struct _BenchClient
+{
+  int fd;
+  long sent[BENCH_DEPTH];	/* microseconds, by slot (frame id % depth) */
+  bool service[BENCH_DEPTH];	/* a _GSESSION_SERVICE request, by slot */
+  uint32_t next;		/* requests sent */
+  char input[sizeof(SessionFrame) + _GSESSION_MESSAGE_MAX];
+  size_t inlen;
+};
+
+typedef struct _BenchLatency BenchLatency;
+
+struct _BenchLatency
+{
+  long *value;			/* microseconds */
+  size_t count;
+  size_t size;
+};
+
+static char service_[MAX_COMMAND];	/* enables the running {WINDOWMANAGER} */
+
+/*
+* (private) clock_us - monotonic microseconds
+*/
+static long
+clock_us (void)
+{
+  struct timespec now;
+
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return now.tv_sec * 1000000 + now.tv_nsec / 1000;
+} /* </clock_us> */
+
+/*
+* (private) connect_session - stream socket to gsession, -1 if refused
+*/
+static int
+connect_session (void)
+{
+  struct sockaddr_un address = { .sun_family = AF_UNIX };
+  int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+
+  strcpy(address.sun_path, _GSESSION);
+
+  if (connect(fd, (struct sockaddr *)&address, sizeof(address)) != 0) {
+    close(fd);
+    return -1;
+  }
+  return fd;
+} /* </connect_session> */
+
+/*
+* (private) frame - one framed request, returns its size
+*/
+static size_t
+frame (char *buffer, uint32_t id, const char *request)
+{
+  SessionFrame header = { .id = id, .length = strlen(request) };
+
+  memcpy(header.magic, _GSESSION_MAGIC, sizeof(header.magic));
+  memcpy(buffer, &header, sizeof(header));
+  memcpy(buffer + sizeof(header), request, header.length);
+
+  return sizeof(header) + header.length;
+} /* </frame> */
+
+/*
+* (private) send_request - send a request in slot on client, time stamped
+*
+* Every mixed-th request is service_, 0 => none. Replies come out of
+* order once the monitor answers some, so the id names a free slot.
+*/
+static void
+send_request (BenchClient *client, int slot, int mixed)
+{
+  bool service = (mixed > 0 && client->next % mixed == 0);
+  char buffer[sizeof(SessionFrame) + MAX_COMMAND];
+  size_t size = frame (buffer, client->next * BENCH_DEPTH + slot,
+                       (service) ? service_ : _GET_SESSION_PID);
+
+  client->sent[slot] = clock_us ();
+  client->service[slot] = service;
+  client->next++;
+
+  if (write(client->fd, buffer, size) != size)
+    perror("bench-session: write");
+} /* </send_request> */
+
+/*
+* (private) compare - qsort() of latencies
+*/
+static int
+compare (const void *a, const void *b)
+{
+  long one = *(const long *)a, two = *(const long *)b;
+  return (one < two) ? -1 : (one > two);
+} /* </compare> */
+
+/*
+* (private) measured - add a latency
+* (private) report - sort and print p50 and p99, FALSE if none
+*/
+static void
+measured (BenchLatency *latency, long value)
+{
+  if (latency->count == latency->size) {
+    latency->size = (latency->size) ? 2 * latency->size : 1 << 16;
+    latency->value = realloc(latency->value, latency->size * sizeof(long));
+  }
+  latency->value[latency->count++] = value;
+} /* </measured> */
+
+static bool
+report (const char *label, BenchLatency *latency)
+{
+  size_t count = latency->count;
+
+  qsort(latency->value, count, sizeof(long), compare);
+
+  printf("  %s: %zu requests, p50 %ld us, p99 %ld us\n", label, count,
+         (count) ? latency->value[count / 2] : 0,
+         (count) ? latency->value[count * 99 / 100] : 0);
+
+  free(latency->value);
+  return (count > 0);
+} /* </report> */
+
+/*
+* (private) cpu_ticks - user and system clock ticks used by pid
+*/
+static long
+cpu_ticks (pid_t pid)
+{
+  char path[32], buffer[1024], *end;
+  long user = 0, system = 0;
+  FILE *stream;
+
+  snprintf(path, sizeof(path), "/proc/%d/stat", pid);
+
+  if ((stream = fopen(path, "r")) != NULL) {
+    if (fgets(buffer, sizeof(buffer), stream) &&
+        (end = strrchr(buffer, ')')) != NULL)
+      sscanf(end + 2, "%*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u %ld %ld",
+             &user, &system);
+    fclose(stream);
+  }
+  return user + system;
+} /* </cpu_ticks> */
+
+/*
+* (private) load - BENCH_CLIENTS each with BENCH_DEPTH requests in flight
+*
+* Every mixed-th request is a _GSESSION_SERVICE one, 0 => none.
+*/
+static void
+load (int mixed)
+{
+  BenchClient clients[BENCH_CLIENTS];
+  struct pollfd fds[BENCH_CLIENTS];
+
+  BenchLatency pid = { NULL }, service = { NULL };
+  long start, end;
+  int idx, depth;
+
+  memset(clients, 0, sizeof(clients));
+
+  for (idx = 0; idx < BENCH_CLIENTS; idx++) {
+    clients[idx].fd = fds[idx].fd = connect_session ();
+    fds[idx].events = POLLIN;
+
+    for (depth = 0; depth < BENCH_DEPTH && clients[idx].fd >= 0; depth++)
+      send_request (&clients[idx], depth, mixed);
+  }
+
+  start = clock_us ();
+  end = start + BENCH_RUN * 1000L;
+
+  while (clock_us () < end && poll(fds, BENCH_CLIENTS, 1000) > 0) {
+    for (idx = 0; idx < BENCH_CLIENTS; idx++) {
+      BenchClient *client = &clients[idx];
+      SessionFrame reply;
+      ssize_t nbytes;
+
+      if (!(fds[idx].revents & POLLIN))
+        continue;
+
+      nbytes = read(client->fd, client->input + client->inlen,
+                    sizeof(client->input) - client->inlen);
+      if (nbytes <= 0) {
+        fds[idx].fd = -1;
+        continue;
+      }
+      client->inlen += nbytes;
+
+      /* every complete reply frees a slot for another request */
+      while (client->inlen >= sizeof(reply)) {
+        int slot;
+
+        memcpy(&reply, client->input, sizeof(reply));
+
+        if (client->inlen < sizeof(reply) + reply.length)
+          break;
+
+        slot = reply.id % BENCH_DEPTH;
+        measured ((client->service[slot]) ? &service : &pid,
+                  clock_us () - client->sent[slot]);
+
+        client->inlen -= sizeof(reply) + reply.length;
+        memmove(client->input, client->input + sizeof(reply) + reply.length,
+                client->inlen);
+        send_request (client, slot, mixed);
+      }
+    }
+  }
+  end = clock_us ();
+
+  for (idx = 0; idx < BENCH_CLIENTS; idx++)
+    if(clients[idx].fd >= 0) close(clients[idx].fd);
+
+  printf("%d clients x %d in flight: %zu requests in %ld ms, %.0f rps\n",
+         BENCH_CLIENTS, BENCH_DEPTH, pid.count + service.count,
+         (end - start) / 1000,
+         (pid.count + service.count) * 1e6 / (end - start));
+
+  CHECK(report (_GET_SESSION_PID, &pid));
+
+  if (mixed > 0)
+    CHECK(report (_GSESSION_SERVICE, &service));
+  else
+    free(service.value);
+} /* </load> */
+
+/*
+* (private) throttle - fill the reply backlog, half-close, time the backend
+*/
+static void
+throttle (pid_t backend)
+{
+  char buffer[sizeof(SessionFrame) + MAX_COMMAND];
+  int fd = connect_session ();
+  long stalled, ticks, used;
+  uint32_t id = 0;
+
+  if (fd < 0) {
+    CHECK(fd >= 0);
+    return;
+  }
+  fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+
+  /* write until the backend stops reading for 200 ms */
+  for (stalled = 0; stalled < 200; ) {
+    size_t size = frame (buffer, id, _GET_SESSION_PID);
+
+    if (write(fd, buffer, size) == size) {
+      id++;
+      stalled = 0;
+    }
+    else if (errno == EAGAIN) {
+      usleep(1000);
+      stalled++;
+    }
+    else
+      break;
+  }
+  shutdown(fd, SHUT_WR);
+
+  ticks = cpu_ticks (backend);
+  usleep(BENCH_IDLE * 1000);
+  used = (cpu_ticks (backend) - ticks) * 1000 / sysconf(_SC_CLK_TCK);
+
+  printf("%u requests queued unread, backend used %ld ms cpu in %d ms "
+         "after the half-close\n", id, used, BENCH_IDLE);
+  CHECK(used < BENCH_IDLE / 10);
+
+  close(fd);
+} /* </throttle> */
+
+/*
+* (private) ask - one text request, the pid replied or 0
+*/
+static pid_t
+ask (const char *request)
+{
+  char reply[MAX_COMMAND];
+  ssize_t nbytes = 0;
+  int fd;
+
+  if ((fd = connect_session ()) < 0)
+    return 0;
+
+  if (write(fd, request, strlen(request)) > 0)
+    nbytes = read(fd, reply, sizeof(reply) - 1);
+
+  close(fd);
+  reply[(nbytes > 0) ? nbytes : 0] = (char)0;
+  return atoi(reply);
+} /* </ask> */
+
+int
+main (int argc, char *argv[])
+{
+  pid_t master, backend = 0, program;
+  int tries;
+
+  if (get_process_id (_GSESSION_MANAGER) > 0) {
+    printf("%s is running, skipped\n", _GSESSION_MANAGER);
+    return CHECK_SKIP;
+  }
+  setenv("WINDOWMANAGER", "exec sleep 600", 1);	/* nothing on display */
+  setenv("GOULD_RESPAWN", "no", 1);
+  unsetenv("LOGLEVEL");
+  unsetenv("SCREENSAVER");
+  unsetenv("LAUNCHER");
+
+  if ((master = fork()) == 0) {
+    execl(GSESSION, _GSESSION_MANAGER, (char *)NULL);
+    _exit (127);
+  }
+
+  /* the backend answers _GET_SESSION_PID with its own pid */
+  for (tries = 0; tries < 500 && backend <= 0; tries++) {
+    usleep(10000);
+    backend = ask (_GET_SESSION_PID);
+  }
+  CHECK(backend > 0);
+
+  /* enabling a running program answers its pid */
+  sprintf(service_, _GSESSION_SERVICE_ENABLE, _WINDOWMANAGER);
+  program = ask (service_);
+
+  if (backend > 0) {
+    load (0);
+    load (BENCH_MIXED);
+    throttle (backend);
+  }
+
+  kill(master, SIGINT);		/* master ends backend and monitor */
+  waitpid(master, NULL, 0);
+
+  if (program > 0)
+    kill(program, SIGTERM);
+
+  return CHECK_EXIT();
+} /* </main> */
@@ -0,0 +1,108 @@
+/**
+ * Copyright (C) Generations Linux <bugs@softcraft.org>
+ * All Rights Reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef CHECK_H
+#define CHECK_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <glib.h>
+#include <glib/gstdio.h>
+
+/* libgould expects every program to publish these */
+const char *Program = "check";	/* (public) published program name */
+unsigned short debug = 0;	/* (protected) must be present */
+
+/*
+* Minimal assertions for the `make check' programs: a failed CHECK() is
+* reported and counted, CHECK_EXIT() is the exit status of main().
+*/
+static int check_failures_ = 0;
+
+#define CHECK(expr) do {						\
+  if (!(expr)) {							\
+    fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #expr); \
+    check_failures_++;							\
+  }									\
+} while (0)
+
+#define CHECK_EXIT() (check_failures_ > 0)
+#define CHECK_SKIP   77		/* automake: test skipped */
+
+/*
+* Fixture trees under $TMPDIR standing in for /proc, /sys or $PATH:
+* check_tree_new() makes an empty one, check_tree_plant() creates or
+* rewrites (same inode) a file in it, check_tree_remove() removes it.
+*/
+static inline gchar *
+check_tree_new (const char *prefix)
+{
+  gchar *template = g_strdup_printf ("%s-XXXXXX", prefix);
+  gchar *root = g_build_filename (g_get_tmp_dir (), template, NULL);
+
+  g_free (template);
+
+  if (mkdtemp (root) == NULL) {
+    perror(root);
+    g_free (root);
+    return NULL;
+  }
+  return root;
+} /* </check_tree_new> */
+
+static inline void
+check_tree_plant (const char *root, const char *name, const char *content)
+{
+  gchar *pathname = g_build_filename (root, name, NULL);
+  gchar *folder = g_path_get_dirname (pathname);
+  FILE *stream;
+
+  g_mkdir_with_parents (folder, 0700);
+
+  if ((stream = fopen(pathname, "w")) != NULL) {
+    fputs(content, stream);
+    fclose(stream);
+  }
+  g_free (folder);
+  g_free (pathname);
+} /* </check_tree_plant> */
+
+static inline void
+check_tree_remove (const char *folder)
+{
+  GDir *dir = g_dir_open (folder, 0, NULL);
+  const gchar *name;
+
+  while (dir && (name = g_dir_read_name (dir))) {
+    gchar *pathname = g_build_filename (folder, name, NULL);
+
+    if (g_file_test (pathname, G_FILE_TEST_IS_DIR) &&
+        !g_file_test (pathname, G_FILE_TEST_IS_SYMLINK))
+      check_tree_remove (pathname);
+    else
+      g_unlink (pathname);
+    g_free (pathname);
+  }
+  if (dir)
+    g_dir_close (dir);
+
+  g_rmdir (folder);
+} /* </check_tree_remove> */
+
+#endif /* </CHECK_H> */
@@ -0,0 +1,174 @@
+/**
+ * Copyright (C) Generations Linux <bugs@softcraft.org>
+ * All Rights Reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+
+#include "gould.h"
+#include "gpanel.h"
+#include "gsession.h"
+#include "check.h"
+
+/*
+* gpanel_dispatch_async() against a fake gsession at the other end of a
+* socketpair: one that reads requests and never answers, answers late,
+* stops reading and goes away, and no gsession at all (the command is
+* then spawned here).
+*/
+#define SERVER_WAIT 100		/* milliseconds before requests expire */
+
+typedef struct _Answer Answer;
+
+struct _Answer
+{
+  guint calls;
+  pid_t pid;
+};
+
+/*
+* (private) answer - GpanelDispatchReply counting its calls
+* (private) quit - GSourceFunc ending the main loop
+* (private) run - main loop for milliseconds
+*/
+static void
+answer (pid_t pid, Answer *answer)
+{
+  answer->calls++;
+  answer->pid = pid;
+} /* </answer> */
+
+static gboolean
+quit (gpointer loop)
+{
+  g_main_loop_quit ((GMainLoop *)loop);
+  return FALSE;
+} /* </quit> */
+
+static void
+run (guint milliseconds)
+{
+  GMainLoop *loop = g_main_loop_new (NULL, FALSE);
+
+  g_timeout_add (milliseconds, quit, loop);
+  g_main_loop_run (loop);
+  g_main_loop_unref (loop);
+} /* </run> */
+
+/*
+* (private) serve - read one request frame, its id or 0
+*/
+static guint32
+serve (int server, char *command)
+{
+  SessionFrame frame;
+
+  if (read(server, &frame, sizeof(frame)) != sizeof(frame) ||
+      read(server, command, frame.length) != frame.length)
+    return 0;
+
+  command[frame.length] = (char)0;
+  return frame.id;
+} /* </serve> */
+
+/*
+* (private) reply - write the reply frame of id
+*/
+static void
+reply (int server, guint32 id, const char *text)
+{
+  SessionFrame frame = { .id = id, .length = strlen(text) };
+
+  memcpy(frame.magic, _GSESSION_MAGIC, sizeof(frame.magic));
+
+  if (write(server, &frame, sizeof(frame)) != sizeof(frame) ||
+      write(server, text, frame.length) != frame.length)
+    perror("test-dispatch: reply");
+} /* </reply> */
+
+int
+main (int argc, char *argv[])
+{
+  gchar *root, *marker, *touch;
+  char command[_GSESSION_MESSAGE_MAX + 1];
+  Answer slow = { 0 }, filled = { 0 }, absent = { 0 };
+  guint queued;
+  int pair[2], idx;
+  guint32 id;
+
+  if (g_file_test (_GSESSION, G_FILE_TEST_EXISTS)) {	/* would reconnect */
+    printf("%s exists, skipped\n", _GSESSION);
+    return CHECK_SKIP;
+  }
+  CHECK(socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, pair) == 0);
+
+  /* a slow gsession: expired once written, then dropped */
+  id = gpanel_dispatch_async (pair[0], "true", SERVER_WAIT,
+                              (GpanelDispatchReply)answer, &slow);
+  CHECK(serve (pair[1], command) == id && strcmp(command, "true") == 0);
+
+  run (2 * SERVER_WAIT);
+  CHECK(slow.calls == 1 && slow.pid == -1);
+  CHECK(gpanel_dispatch_queued () == 0);
+
+  /* its late reply is ignored */
+  reply (pair[1], id, "4242\n");
+  run (SERVER_WAIT);
+  CHECK(slow.calls == 1 && slow.pid == -1);
+
+  /* gsession stops reading: requests queue up unsent */
+  for (idx = 0; idx < 100000 && !gpanel_dispatch_blocked (); idx++)
+    gpanel_dispatch_async (pair[0], "true", 60000,
+                           (GpanelDispatchReply)answer, &filled);
+  CHECK(gpanel_dispatch_blocked ());
+  queued = gpanel_dispatch_queued ();
+
+  /* fire and forget, not yet written */
+  root = check_tree_new ("dispatch");
+  marker = g_build_filename (root, "touched", NULL);
+
+  touch = g_strdup_printf ("touch %s", marker);
+  gpanel_dispatch_async (pair[0], touch, 60000, NULL, NULL);
+  CHECK(gpanel_dispatch_queued () == queued + 1);
+
+  /* gsession goes away: requests written get -1, the others spawn here */
+  close(pair[1]);
+  run (SERVER_WAIT);
+
+  printf("%d requests queued, %u answered\n", idx, filled.calls);
+  CHECK(filled.calls == idx && gpanel_dispatch_queued () == 0);
+
+  for (idx = 0; idx < 100 && !g_file_test (marker, G_FILE_TEST_EXISTS); idx++)
+    usleep(10000);
+  CHECK(g_file_test (marker, G_FILE_TEST_EXISTS));
+
+  /* no gsession: spawned here, answered before returning */
+  gpanel_dispatch_async (-1, "true", SERVER_WAIT,
+                         (GpanelDispatchReply)answer, &absent);
+  CHECK(absent.calls == 1 && absent.pid > 0);
+
+  check_tree_remove (root);
+  g_free (marker);
+  g_free (touch);
+  g_free (root);
+
+  return CHECK_EXIT();
+} /* </main> */
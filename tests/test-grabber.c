@@ -0,0 +1,180 @@
+/**
+ * Copyright (C) Generations Linux <bugs@softcraft.org>
+ * All Rights Reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <X11/Xlib.h>
+#include <X11/Xutil.h>
+
+#include "gould.h"
+#include "grabber.h"
+#include "check.h"
+
+/*
+* Synthetic ZPixmap images, built without a display, run through
+* ximage_to_pixbuf() and compared against the pattern they were filled
+* with. Tall images make several row bands, see GRAB_BAND_ROWS.
+*/
+#define RED(x,y)   (((x) * 7 + (y)) & 0xff)
+#define GREEN(x,y) (((x) + (y) * 3) & 0xff)
+#define BLUE(x,y)  (((x) ^ (y)) & 0xff)
+
+/*
+* (private) image - XImage of the test pattern, pixels packed by the masks
+*/
+static XImage *
+image (int width, int height, int depth, int bpp, int order,
+       unsigned long rmask, unsigned long gmask, unsigned long bmask)
+{
+  XImage *ximage = calloc(1, sizeof(XImage));
+  int rshift = __builtin_ctzl(rmask), rbits = __builtin_popcountl(rmask);
+  int gshift = __builtin_ctzl(gmask), gbits = __builtin_popcountl(gmask);
+  int bshift = __builtin_ctzl(bmask), bbits = __builtin_popcountl(bmask);
+  int x, y;
+
+  ximage->width  = width;
+  ximage->height = height;
+  ximage->format = ZPixmap;
+  ximage->byte_order = order;
+  ximage->bitmap_unit = 32;
+  ximage->bitmap_bit_order = order;
+  ximage->bitmap_pad = 32;
+  ximage->depth = depth;
+  ximage->bits_per_pixel = bpp;
+  ximage->bytes_per_line = ((width * bpp + 31) / 32) * 4;
+  ximage->red_mask   = rmask;
+  ximage->green_mask = gmask;
+  ximage->blue_mask  = bmask;
+  ximage->data = calloc(ximage->bytes_per_line, height);
+
+  XInitImage (ximage);
+
+  for (y = 0; y < height; y++)
+    for (x = 0; x < width; x++)
+      XPutPixel (ximage, x, y,
+                 ((unsigned long)(RED(x,y) >> (8 - rbits)) << rshift) |
+                 ((unsigned long)(GREEN(x,y) >> (8 - gbits)) << gshift) |
+                 ((unsigned long)(BLUE(x,y) >> (8 - bbits)) << bshift));
+  return ximage;
+} /* </image> */
+
+/*
+* (private) expect - value of an 8 bit channel stored in nbits
+*/
+static int
+expect (int value, int nbits)
+{
+  value >>= (8 - nbits);
+  return (nbits == 8) ? value : (value * 255) / ((1 << nbits) - 1);
+} /* </expect> */
+
+/*
+* (private) compare - pixbuf against the pattern, true when identical
+*/
+static bool
+compare (GdkPixbuf *pixbuf, int rbits, int gbits, int bbits)
+{
+  guchar *pixels = gdk_pixbuf_get_pixels (pixbuf);
+  int rowstride = gdk_pixbuf_get_rowstride (pixbuf);
+  int x, y;
+
+  for (y = 0; y < gdk_pixbuf_get_height (pixbuf); y++)
+    for (x = 0; x < gdk_pixbuf_get_width (pixbuf); x++) {
+      guchar *pixel = pixels + y * rowstride + x * 3;
+
+      if (pixel[0] != expect (RED(x,y), rbits) ||
+          pixel[1] != expect (GREEN(x,y), gbits) ||
+          pixel[2] != expect (BLUE(x,y), bbits)) {
+        fprintf(stderr, "pixel (%d,%d) => %02x%02x%02x\n", x, y,
+                pixel[0], pixel[1], pixel[2]);
+        return false;
+      }
+    }
+  return true;
+} /* </compare> */
+
+/*
+* (private) convert - ximage_to_pixbuf() of a TrueColor image, compared
+*/
+static bool
+convert (XImage *ximage, int rbits, int gbits, int bbits)
+{
+  GdkPixbuf *pixbuf = ximage_to_pixbuf (ximage, NULL);
+  bool vote = false;
+
+  if (pixbuf != NULL) {
+    vote = gdk_pixbuf_get_width (pixbuf) == ximage->width &&
+           gdk_pixbuf_get_height (pixbuf) == ximage->height &&
+           compare (pixbuf, rbits, gbits, bbits);
+    g_object_unref (pixbuf);
+  }
+  XDestroyImage (ximage);
+
+  return vote;
+} /* </convert> */
+
+int
+main (int argc, char *argv[])
+{
+  GdkPixbuf *pixbuf;
+  Visual visual;
+  XImage *ximage;
+
+#if !GLIB_CHECK_VERSION(2,36,0)
+  g_type_init ();
+#endif
+
+  /* 32 bpp, both byte orders and a BGR layout */
+  CHECK(convert (image (333, 301, 24, 32, LSBFirst,
+                        0xff0000, 0x00ff00, 0x0000ff), 8, 8, 8));
+  CHECK(convert (image (333, 301, 24, 32, MSBFirst,
+                        0xff0000, 0x00ff00, 0x0000ff), 8, 8, 8));
+  CHECK(convert (image (64, 200, 24, 32, LSBFirst,
+                        0x0000ff, 0x00ff00, 0xff0000), 8, 8, 8));
+
+  /* packed 24 bpp */
+  CHECK(convert (image (257, 130, 24, 24, LSBFirst,
+                        0xff0000, 0x00ff00, 0x0000ff), 8, 8, 8));
+  CHECK(convert (image (257, 130, 24, 24, MSBFirst,
+                        0xff0000, 0x00ff00, 0x0000ff), 8, 8, 8));
+
+  /* 16 bpp RGB565, the XGetPixel() path */
+  CHECK(convert (image (199, 257, 16, 16, LSBFirst,
+                        0xf800, 0x07e0, 0x001f), 5, 6, 5));
+
+  /* unsupported visuals and formats fall back to GDK */
+  ximage = image (16, 16, 24, 32, LSBFirst, 0xff0000, 0x00ff00, 0x0000ff);
+  memset(&visual, 0, sizeof(Visual));
+  visual.class      = DirectColor;
+  visual.red_mask   = ximage->red_mask;
+  visual.green_mask = ximage->green_mask;
+  visual.blue_mask  = ximage->blue_mask;
+  CHECK(ximage_to_pixbuf (ximage, &visual) == NULL);
+
+  visual.class = TrueColor;
+  CHECK((pixbuf = ximage_to_pixbuf (ximage, &visual)) != NULL);
+  if (pixbuf) g_object_unref (pixbuf);
+
+  ximage->format = XYPixmap;
+  CHECK(ximage_to_pixbuf (ximage, NULL) == NULL);
+  ximage->format = ZPixmap;
+  XDestroyImage (ximage);
+
+  return CHECK_EXIT();
+} /* </main> */
@@ -0,0 +1,207 @@
+/**
+ * Copyright (C) Generations Linux <bugs@softcraft.org>
+ * All Rights Reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <gdk/gdkx.h>
+#include <X11/Xatom.h>
+
+#include "gould.h"
+#include "gpanel.h"
+#include "gsession.h"
+#include "launchstat.h"
+#include "check.h"
+
+/*
+* gpanel_launch() of a dummy client that maps its window after a delay,
+* on a display of its own (xvfb-run). Without a window manager the client
+* adds itself to _NET_CLIENT_LIST as one would. The latency recorded in
+* the launch store must cover the delay. Skipped without a display.
+*/
+#define CLIENT_DELAY  300	/* milliseconds before the window maps */
+#define CLIENT_LINGER 2		/* seconds the window stays */
+
+static const char *lists_[] = { "_NET_CLIENT_LIST", "_NET_CLIENT_LIST_STACKING" };
+
+/*
+* (private) managed - whether a window manager keeps the client lists
+*/
+static gboolean
+managed (Display *display, Window root)
+{
+  Atom check = XInternAtom (display, "_NET_SUPPORTING_WM_CHECK", False);
+  unsigned long count = 0, after;
+  unsigned char *data = NULL;
+  Atom type;
+  int format;
+
+  if (XGetWindowProperty (display, root, check, 0, 1, False, XA_WINDOW,
+                          &type, &format, &count, &after, &data) == Success &&
+      data != NULL)
+    XFree (data);
+
+  return count > 0;
+} /* </managed> */
+
+/*
+* (private) client - the delayed dummy client, run as "<self> --client"
+*/
+static int
+client (int delay)
+{
+  Display *display;
+  Window root, xid;
+  long pid = getpid ();
+  int idx;
+
+  usleep(delay * 1000);
+
+  if ((display = XOpenDisplay (NULL)) == NULL)
+    return 1;
+
+  root = DefaultRootWindow (display);
+  xid  = XCreateSimpleWindow (display, root, 0, 0, 64, 64, 0, 0, 0);
+
+  XChangeProperty (display, xid, XInternAtom (display, "_NET_WM_PID", False),
+                   XA_CARDINAL, 32, PropModeReplace, (unsigned char *)&pid, 1);
+  XMapWindow (display, xid);
+
+  if (!managed (display, root))
+    for (idx = 0; idx < G_N_ELEMENTS (lists_); idx++)
+      XChangeProperty (display, root, XInternAtom (display, lists_[idx], False),
+                       XA_WINDOW, 32, PropModeAppend, (unsigned char *)&xid, 1);
+
+  XSync (display, False);
+  sleep(CLIENT_LINGER);
+  XCloseDisplay (display);
+
+  return 0;
+} /* </client> */
+
+/*
+* (private) settled - GSourceFunc ending the main loop once nothing waits
+*/
+static gboolean
+settled (gpointer loop)
+{
+  if (gpanel_launch_pending () > 0)
+    return TRUE;
+
+  g_main_loop_quit ((GMainLoop *)loop);
+  return FALSE;
+} /* </settled> */
+
+/*
+* (private) expired - GSourceFunc ending the main loop, the window unseen
+*/
+static gboolean
+expired (gpointer loop)
+{
+  g_main_loop_quit ((GMainLoop *)loop);
+  return FALSE;
+} /* </expired> */
+
+int
+main (int argc, char *argv[])
+{
+  gchar *cache, *self, *command, *application, *store;
+  GlobalPanel *panel;
+  GKeyFile *stats;
+  GMainLoop *loop;
+  Display *display;
+  glong latency;
+  int idx;
+
+  if (argc > 2 && strcmp(argv[1], "--client") == 0)
+    return client (atoi(argv[2]));
+
+  if (getenv("DISPLAY") == NULL) {
+    printf("%s: no display, skipped\n", argv[0]);
+    return CHECK_SKIP;
+  }
+  if (g_file_test (_GSESSION, G_FILE_TEST_EXISTS)) {	/* would launch there */
+    printf("%s exists, skipped\n", _GSESSION);
+    return CHECK_SKIP;
+  }
+
+  /* before anything asks GLib for the user cache directory */
+  cache = check_tree_new ("launch");
+  CHECK(cache != NULL);
+  setenv("XDG_CACHE_HOME", cache, 1);
+
+  if (gtk_init_check (&argc, &argv) == FALSE) {
+    printf("%s: no display, skipped\n", argv[0]);
+    check_tree_remove (cache);
+    return CHECK_SKIP;
+  }
+  display = GDK_DISPLAY_XDISPLAY (gdk_display_get_default ());
+
+  panel = g_new0 (GlobalPanel, 1);
+  panel->session = -1;
+  panel->green = green_new (DefaultScreen (display));
+
+  /* the libtool wrapper sets up the environment the client inherits */
+  self = g_file_read_link ("/proc/self/exe", NULL);
+  command = g_strdup_printf ("%s --client %d", self, CLIENT_DELAY);
+  application = g_path_get_basename (self);	/* see, launchstat.c */
+
+  loop = g_main_loop_new (NULL, FALSE);
+  gpanel_launch (panel, command);
+  CHECK(gpanel_launch_pending () == 1);
+
+  g_timeout_add (50, settled, loop);
+  g_timeout_add (CLIENT_DELAY + 5000, expired, loop);
+  g_main_loop_run (loop);
+  CHECK(gpanel_launch_pending () == 0);
+
+  /* the store holds one launch, its latency past the delay */
+  CHECK(launchstat_flush ());
+  store = g_build_filename (cache, LAUNCHSTAT_FILE, NULL);
+  stats = g_key_file_new ();
+
+  CHECK(g_key_file_load_from_file (stats, store, G_KEY_FILE_NONE, NULL));
+  latency = g_key_file_get_integer (stats, application, "max", NULL);
+
+  printf("%s: window in %ld ms (client delay %d ms)\n",
+         application, latency, CLIENT_DELAY);
+  CHECK(latency >= CLIENT_DELAY && latency < CLIENT_DELAY + 5000);
+  CHECK(g_key_file_get_integer (stats, application, "lost", NULL) == 0);
+
+  while (waitpid(-1, NULL, 0) > 0) ;		/* the client lingers */
+
+  if (!managed (display, DefaultRootWindow (display)))
+    for (idx = 0; idx < G_N_ELEMENTS (lists_); idx++)
+      XDeleteProperty (display, DefaultRootWindow (display),
+                       XInternAtom (display, lists_[idx], False));
+  XSync (display, False);
+
+  g_key_file_free (stats);
+  g_free (store);
+
+  check_tree_remove (cache);
+  g_free (application);
+  g_free (command);
+  g_free (self);
+  g_free (cache);
+
+  return CHECK_EXIT();
+} /* </main> */
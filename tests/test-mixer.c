@@ -0,0 +1,130 @@
+/**
+ * Copyright (C) Generations Linux <bugs@softcraft.org>
+ * All Rights Reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <dlfcn.h>		/* RTLD_NEXT, _GNU_SOURCE */
+
+#include "gould.h"
+#include "alsamixer.h"
+#include "check.h"
+
+/*
+* alsamixer.c against ALSA's dummy driver (modprobe snd-dummy), whose
+* Master is a plain volume control. Skipped when the card is absent,
+* $GOULD_MIXER_CARD names another one.
+*
+* A slider drag is a run of value_changed positions, several to each
+* hardware step: the ALSA volume calls it makes are counted by
+* interposing them. A second mixer handle plays the other program.
+*/
+#define MIXER_CARD "hw:Dummy"
+#define MIXER_DRAG 400		/* value_changed positions from 0 to 100 */
+
+static guint writes_ = 0;	/* snd_mixer_selem_set_playback_volume_all */
+static guint reads_  = 0;	/* snd_mixer_selem_get_playback_volume */
+
+int
+snd_mixer_selem_set_playback_volume_all (snd_mixer_elem_t *elem, long value)
+{
+  static int (*next) (snd_mixer_elem_t *, long) = NULL;
+
+  if (next == NULL)
+    next = dlsym (RTLD_NEXT, "snd_mixer_selem_set_playback_volume_all");
+
+  writes_++;
+  return next (elem, value);
+} /* </snd_mixer_selem_set_playback_volume_all> */
+
+int
+snd_mixer_selem_get_playback_volume (snd_mixer_elem_t *elem,
+                                     snd_mixer_selem_channel_id_t channel,
+                                     long *value)
+{
+  static int (*next) (snd_mixer_elem_t *, snd_mixer_selem_channel_id_t,
+                      long *) = NULL;
+
+  if (next == NULL)
+    next = dlsym (RTLD_NEXT, "snd_mixer_selem_get_playback_volume");
+
+  reads_++;
+  return next (elem, channel, value);
+} /* </snd_mixer_selem_get_playback_volume> */
+
+/*
+* (private) settle - read the events the other handle caused
+*/
+static void
+settle (AlsaMixer *mixer)
+{
+  snd_mixer_wait (mixer->handle, 1000);
+  snd_mixer_handle_events (mixer->handle);
+} /* </settle> */
+
+int
+main (int argc, char *argv[])
+{
+  const char *card = getenv("GOULD_MIXER_CARD");
+  AlsaMixer panel, other;
+  gint initial, volume;
+  int idx;
+
+  if (card == NULL)
+    card = MIXER_CARD;
+
+  if (!alsamixer_open (&panel, card, ALSAMIXER_SELEM)) {
+    printf("%s: no %s %s, skipped\n", argv[0], card, ALSAMIXER_SELEM);
+    return CHECK_SKIP;
+  }
+  CHECK(alsamixer_open (&other, card, ALSAMIXER_SELEM));
+
+  /* once after opening, as module_open does: the hardware volume */
+  CHECK((initial = alsamixer_sync (&panel)) >= 0);
+  CHECK(alsamixer_sync (&panel) < 0);
+  CHECK(reads_ == 2 && writes_ == 0);
+
+  /* the drag writes each hardware step once and reads nothing */
+  reads_ = writes_ = 0;
+
+  for (idx = 0; idx < MIXER_DRAG; idx++)
+    CHECK(alsamixer_set (&panel, idx * 100 / (MIXER_DRAG - 1)));
+
+  printf("%d positions over %ld..%ld: %u writes, %u reads\n", MIXER_DRAG,
+         panel.min, panel.max, writes_, reads_);
+  CHECK(writes_ > 0 && writes_ <= 101);
+  CHECK(writes_ <= panel.max - panel.min + 1);
+  CHECK(reads_ == 0);
+
+  /* our own writes are not taken for another program's */
+  settle (&panel);
+  CHECK(alsamixer_sync (&panel) < 0);
+
+  /* the other program's is, once */
+  volume = (initial == 50) ? 25 : 50;
+  CHECK(alsamixer_set (&other, volume));
+  settle (&panel);
+  CHECK(alsamixer_sync (&panel) == volume);
+  CHECK(alsamixer_sync (&panel) < 0);
+
+  alsamixer_set (&other, initial);
+  alsamixer_close (&other);
+  alsamixer_close (&panel);
+
+  return CHECK_EXIT();
+} /* </main> */
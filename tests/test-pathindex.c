@@ -0,0 +1,134 @@
+/**
+ * Copyright (C) Generations Linux <bugs@softcraft.org>
+ * All Rights Reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <glib/gstdio.h>
+
+#include "gould.h"
+#include "pathindex.h"
+#include "util.h"
+#include "check.h"
+
+/*
+* A search path of temporary directories looked up with path_index_lookup()
+* and path_finder(): same answers, and the stat calls each one makes.
+*/
+#define LOOKUP_ROUNDS 1000	/* lookups of each name */
+
+static const char *names_[] = { "one", "two", "three", "none" };
+
+/*
+* (private) same - both lookups found the same pathname, or neither did
+*/
+static bool
+same (const char *indexed, const char *found)
+{
+  if (indexed == NULL || found == NULL)
+    return indexed == found;
+
+  return strcmp(indexed, found) == 0;
+} /* </same> */
+
+int
+main (int argc, char *argv[])
+{
+  gchar *root = check_tree_new ("pathindex");
+  gchar *cache, *command;
+  GList *dirs = NULL;
+  PathIndex *index;
+  gulong stats, probes, scans;
+  gint64 elapsed, indexed;
+  int idx, round;
+
+  CHECK(root != NULL);
+
+  /* a: one  b: one two  c: three  missing: does not exist */
+  for (idx = 0; idx < 3; idx++) {
+    gchar *folder = g_strdup_printf ("%s/%c", root, 'a' + idx);
+    g_mkdir (folder, 0700);
+    dirs = g_list_append (dirs, folder);
+  }
+  dirs = g_list_append (dirs, g_build_filename (root, "missing", NULL));
+
+  check_tree_plant (root, "a/one", "");
+  check_tree_plant (root, "b/one", "");
+  check_tree_plant (root, "b/two", "");
+  check_tree_plant (root, "c/three", "");
+
+  /* One scan, and so one stat call, per directory up front. */
+  index = path_index_new (dirs);
+  path_index_counts (index, &stats, &probes, &scans);
+  CHECK(scans == 4 && stats == 4);
+
+  indexed = g_get_monotonic_time ();
+  for (round = 0; round < LOOKUP_ROUNDS; round++)
+    for (idx = 0; idx < G_N_ELEMENTS (names_); idx++)
+      CHECK(same (path_index_lookup (index, names_[idx]),
+                  path_finder (dirs, names_[idx])));
+  indexed = g_get_monotonic_time () - indexed;
+
+  /* path_finder() probes 1, 2, 3 and 4 directories for the names. */
+  path_index_counts (index, &stats, &probes, NULL);
+  CHECK(probes == LOOKUP_ROUNDS * (1 + 2 + 3 + 4));
+  CHECK(stats <= 4 + 4 * (indexed / (PATH_INDEX_RECHECK * G_USEC_PER_SEC)));
+
+  elapsed = g_get_monotonic_time ();
+  for (round = 0; round < LOOKUP_ROUNDS; round++)
+    for (idx = 0; idx < G_N_ELEMENTS (names_); idx++)
+      path_finder (dirs, names_[idx]);
+  elapsed = g_get_monotonic_time () - elapsed;
+
+  printf("%d lookups: path_index %lu stat calls %.2f us/lookup, "
+         "path_finder %lu stat calls %.2f us/lookup\n",
+         LOOKUP_ROUNDS * (int)G_N_ELEMENTS (names_), stats,
+         (double)indexed / (LOOKUP_ROUNDS * G_N_ELEMENTS (names_)), probes,
+         (double)elapsed / (LOOKUP_ROUNDS * G_N_ELEMENTS (names_)));
+
+  /* A new command is seen once the main loop drained inotify, without
+     waiting for the mtime sweep. */
+  check_tree_plant (root, "c/four", "");
+  while (g_main_context_iteration (NULL, FALSE));
+  command = g_build_filename (root, "c", "four", NULL);
+  CHECK(same (path_index_lookup (index, "four"), command));
+  g_free (command);
+  path_index_free (index);
+
+  /* Cached: unchanged directories cost one stat call and no scan. */
+  cache = g_build_filename (root, "cache", NULL);
+  index = path_index_new_cached (dirs, cache);
+  path_index_free (index);
+
+  index = path_index_new_cached (dirs, cache);
+  path_index_counts (index, &stats, NULL, &scans);
+  CHECK(scans == 1 && stats == 4);	/* only "missing" is rescanned */
+  CHECK(same (path_index_lookup (index, "two"), path_finder (dirs, "two")));
+  path_index_free (index);
+
+  g_free (cache);
+
+  check_tree_remove (root);
+  g_free (root);
+
+  g_list_foreach (dirs, (GFunc)g_free, NULL);
+  g_list_free (dirs);
+
+  return CHECK_EXIT();
+} /* </main> */
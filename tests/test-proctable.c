@@ -0,0 +1,162 @@
+/**
+ * Copyright (C) Generations Linux <bugs@softcraft.org>
+ * All Rights Reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "gould.h"
+#include "proctable.h"
+#include "check.h"
+
+/*
+* A synthetic proc root read with proctable_new(): names with ')' and
+* names longer than comm, executables (one replaced on disk), sessions,
+* and entries that are not processes or do not read.
+*/
+static const struct { const char *pid, *stat, *exe; } procs_[] = {
+  { "1",    "1 (init) S 0 1 1 0 -1 4194560",	"/sbin/init" },
+  { "7",    "7 (averyveryverylo) S 1 7 7 0",	NULL },
+  { "42",   "42 (odd) name) R 1 42 42 34816",	NULL },
+  { "100",  "100 (gpanel) S 1 100 100 0",	"/usr/bin/gpanel" },
+  { "101",  "101 (gpanel) S 100 100 100 0",	"/usr/bin/gpanel (deleted)" },
+  { "1000", "1000 (gpanel) S 1 1000 1000 0",	"/opt/gould/gpanel" },
+  { "200",  "200 no comm",			NULL },	/* skipped */
+  { "300",  NULL,				NULL },	/* exited */
+};
+
+/*
+* (private) pids - the pid of every entry listed, space separated
+*/
+static const char *
+pids (GList *list)
+{
+  static char answer[MAX_COMMAND];
+  int length = 0;
+
+  for (answer[0] = (char)0; list != NULL; list = list->next)
+    length += snprintf(&answer[length], MAX_COMMAND - length, (length) ?
+                       " %d" : "%d", ((ProcessEntry *)list->data)->pid);
+
+  return answer;
+} /* </pids> */
+
+/*
+* (private) found - the pids a lookup returned, the list freed
+*/
+static bool
+found (GList *list, const char *expected)
+{
+  bool same = (strcmp(pids (list), expected) == 0);
+
+  if (!same)
+    fprintf(stderr, "found \"%s\", expected \"%s\"\n", pids (list), expected);
+
+  g_list_free (list);
+  return same;
+} /* </found> */
+
+int
+main (int argc, char *argv[])
+{
+  gchar *root = check_tree_new ("proc");
+  char path[MAX_PATHNAME];
+  const ProcessEntry *entry;
+  ProcessTable *table, *other;
+  int idx;
+
+  CHECK(root != NULL);
+
+  for (idx = 0; idx < G_N_ELEMENTS (procs_); idx++) {
+    snprintf(path, sizeof(path), "%s/%s", root, procs_[idx].pid);
+    mkdir(path, 0700);
+
+    if (procs_[idx].stat) {
+      gchar *content = g_strdup_printf ("%s\n", procs_[idx].stat);
+
+      snprintf(path, sizeof(path), "%s/stat", procs_[idx].pid);
+      check_tree_plant (root, path, content);
+      g_free (content);
+    }
+
+    snprintf(path, sizeof(path), "%s/%s/exe", root, procs_[idx].pid);
+    if (procs_[idx].exe)
+      symlink(procs_[idx].exe, path);
+  }
+  snprintf(path, sizeof(path), "%s/self", root);	/* not a process */
+  symlink("1", path);
+
+  table = proctable_new (root);
+
+  /* entries by pid, the unreadable ones left out */
+  CHECK((entry = proctable_lookup (table, 42)) != NULL);
+  if (entry) {
+    CHECK(strcmp(entry->name, "odd) name") == 0);
+    CHECK(entry->ppid == 1 && entry->session == 42);
+    CHECK(entry->uid == getuid ());
+  }
+  CHECK(proctable_lookup (table, 200) == NULL);
+  CHECK(proctable_lookup (table, 300) == NULL);
+  CHECK(proctable_lookup (table, 2) == NULL);
+
+  /* pidof rules: comm is the first PROCTABLE_COMM characters */
+  CHECK(found (proctable_find_name (table, "init"), "1"));
+  CHECK(found (proctable_find_name (table, "averyveryverylongname"), "7"));
+  CHECK(found (proctable_find_name (table, "averyveryvery"), ""));
+  CHECK(found (proctable_find_name (table, "gpanel"), "100 101 1000"));
+  CHECK(found (proctable_find_name (table, "gpane"), ""));
+
+  /* executables, " (deleted)" when replaced on disk */
+  CHECK(found (proctable_find_exe (table, "/usr/bin/gpanel"), "100 101"));
+  CHECK(found (proctable_find_name (table, "/opt/gould/gpanel"), "1000"));
+  CHECK((entry = proctable_lookup (table, 7)) != NULL);
+  if (entry) {
+    CHECK(proctable_exe (table, entry) == NULL && entry->resolved);
+  }
+
+  CHECK(found (proctable_find_session (table, 100), "100 101"));
+  CHECK(found (proctable_find_uid (table, getuid ()), "1 7 42 100 101 1000"));
+  proctable_unref (table);
+
+  /* a root that does not read is an empty table */
+  table = proctable_new ("/nonexistent");
+  CHECK(proctable_lookup (table, 1) == NULL);
+  CHECK(found (proctable_find_name (table, "init"), ""));
+  proctable_unref (table);
+
+  /* the live /proc snapshot is shared while fresh, and holds ourselves */
+  table = proctable_snapshot ();
+  other = proctable_snapshot ();
+  CHECK(table == other);
+
+  CHECK((entry = proctable_lookup (table, getpid ())) != NULL);
+  if (entry) {
+    CHECK(entry->ppid == getppid () && entry->uid == geteuid ());
+    CHECK(proctable_exe (table, entry) != NULL);
+  }
+  proctable_unref (other);
+  proctable_unref (table);
+
+  check_tree_remove (root);
+  g_free (root);
+
+  return CHECK_EXIT();
+} /* </main> */
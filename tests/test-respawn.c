@@ -0,0 +1,224 @@
+/**
+ * Copyright (C) Generations Linux <bugs@softcraft.org>
+ * All Rights Reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <time.h>
+#include <sys/wait.h>
+
+#include "gould.h"
+#include "gsession.h"
+#include "proctable.h"
+#include "util.h"
+#include "check.h"
+
+/*
+* Kill-and-respawn harness for the gsession monitor: gsession runs with a
+* stand-in {WINDOWMANAGER} that is killed until _RESPAWN_CRASH_LIMIT gives
+* up on it, timing each respawn against its backoff, then the program is
+* enabled again with a _GSESSION_SERVICE request and killed once more.
+*/
+#ifndef GSESSION
+#define GSESSION "../src/desktop/gsession"
+#endif
+
+#define STANDIN  "sleep"		/* comm of the {WINDOWMANAGER} */
+#define LATENCY  500			/* milliseconds allowed past backoff */
+
+/*
+* (private) clock_ms - monotonic milliseconds
+*/
+static long
+clock_ms (void)
+{
+  struct timespec now;
+
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return now.tv_sec * 1000 + now.tv_nsec / 1000000;
+} /* </clock_ms> */
+
+/*
+* (private) await - child of parent named name, other than old, or 0
+*/
+static pid_t
+await (pid_t parent, const char *name, pid_t old, long timeout)
+{
+  long due = clock_ms () + timeout;
+  pid_t pid = 0;
+
+  do {
+    ProcessTable *table = proctable_new (NULL);	/* not the shared one */
+    GList *iter, *list = proctable_find_name (table, name);
+
+    for (iter = list; iter != NULL; iter = iter->next) {
+      const ProcessEntry *entry = iter->data;
+
+      if (entry->ppid == parent && entry->pid != old)
+        pid = entry->pid;
+    }
+    g_list_free (list);
+    proctable_unref (table);
+
+    if (pid == 0)
+      usleep(2000);
+  } while (pid == 0 && clock_ms () < due);
+
+  return pid;
+} /* </await> */
+
+/*
+* (private) request - one text request to gsession, the reply as a pid
+*/
+static pid_t
+request (const char *text)
+{
+  struct sockaddr_un address = { .sun_family = AF_UNIX };
+  char reply[MAX_COMMAND];
+  int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  ssize_t nbytes = -1;
+
+  strcpy(address.sun_path, _GSESSION);
+
+  if (connect(fd, (struct sockaddr *)&address, sizeof(address)) == 0 &&
+      write(fd, text, strlen(text)) > 0)
+    nbytes = read(fd, reply, sizeof(reply) - 1);
+
+  close(fd);
+  reply[(nbytes > 0) ? nbytes : 0] = (char)0;
+  return atoi(reply);
+} /* </request> */
+
+/*
+* (private) logged - whether the gsession log holds text
+*/
+static bool
+logged (const char *logfile, const char *text)
+{
+  gchar *content = NULL;
+  bool found = false;
+
+  if (g_file_get_contents (logfile, &content, NULL, NULL))
+    found = (strstr(content, text) != NULL);
+
+  g_free (content);
+  return found;
+} /* </logged> */
+
+int
+main (int argc, char *argv[])
+{
+  gchar *home;
+  gchar *logfile;
+  char text[MAX_COMMAND];
+  pid_t master, monitor, program, next;
+  long backoff, start, elapsed;
+  int count;
+
+  if (get_process_id (_GSESSION_MANAGER) > 0) {
+    printf("%s is running, skipped\n", _GSESSION_MANAGER);
+    return CHECK_SKIP;
+  }
+  home = check_tree_new ("gsession");
+  CHECK(home != NULL);
+  logfile = g_strdup_printf ("%s/%s.log", home, _GSESSION_MANAGER);
+
+  setenv("HOME", home, 1);			/* gsession.log goes there */
+  setenv("LOGLEVEL", "1", 1);
+  setenv("WINDOWMANAGER", "exec " STANDIN " 600", 1);
+  setenv("GOULD_RESPAWN", "no", 1);		/* no {TASKBAR} */
+  unsetenv("GOULD_MONITOR");
+  unsetenv("SCREENSAVER");
+  unsetenv("LAUNCHER");
+  unsetenv("ERRORLOG");
+
+  if ((master = fork()) == 0) {
+    execl(GSESSION, _GSESSION_MANAGER, (char *)NULL);
+    _exit (127);
+  }
+
+  monitor = await (master, _GSESSION_MONITOR, 0, 5000);
+  program = (monitor > 0) ? await (monitor, STANDIN, 0, 5000) : 0;
+  CHECK(monitor > 0 && program > 0);
+
+  if (program == 0) {
+    kill(master, SIGINT);
+    waitpid(master, NULL, 0);
+    return CHECK_EXIT();
+  }
+
+  /* respawned at once, then after twice as long each time */
+  for (count = 1; count <= _RESPAWN_CRASH_LIMIT; count++) {
+    backoff = (count == 1) ? 0 : (long)_RESPAWN_BACKOFF << (count - 2);
+    if(backoff > _RESPAWN_BACKOFF_MAX) backoff = _RESPAWN_BACKOFF_MAX;
+
+    kill(program, SIGKILL);
+    start = clock_ms ();
+    next = await (monitor, STANDIN, program, backoff + LATENCY);
+    elapsed = clock_ms () - start;
+
+    printf("kill %d: respawned in %ld ms (backoff %ld ms)\n",
+           count, elapsed, backoff);
+    CHECK(next > 0 && elapsed >= backoff && elapsed < backoff + LATENCY);
+
+    if ((program = next) == 0)
+      break;
+  }
+  CHECK(program > 0);		/* nothing left to kill otherwise */
+
+  /* one exit more than _RESPAWN_CRASH_LIMIT disables the program */
+  if(program > 0) kill(program, SIGKILL);
+  start = clock_ms ();
+
+  while (!logged (logfile, "not respawned") && clock_ms () < start + LATENCY)
+    usleep(2000);
+
+  CHECK(logged (logfile, "not respawned"));
+  CHECK(await (monitor, STANDIN, program, LATENCY) == 0);
+
+  /* enabled by request: counters reset, spawned and watched again */
+  next = 0;
+  sprintf(text, _GSESSION_SERVICE_ENABLE, _WINDOWMANAGER);
+  program = request (text);
+  printf("enabled => %d\n", program);
+  CHECK(program > 0 && await (monitor, STANDIN, 0, LATENCY) == program);
+
+  if (program > 0) {
+    kill(program, SIGKILL);
+    start = clock_ms ();
+    next = await (monitor, STANDIN, program, LATENCY);
+    elapsed = clock_ms () - start;
+
+    printf("kill after enable: respawned in %ld ms\n", elapsed);
+    CHECK(next > 0);
+  }
+
+  kill(master, SIGINT);		/* master ends backend and monitor */
+  waitpid(master, NULL, 0);
+
+  if (next > 0)
+    kill(next, SIGKILL);
+
+  check_tree_remove (home);
+  g_free (logfile);
+  g_free (home);
+
+  return CHECK_EXIT();
+} /* </main> */
@@ -0,0 +1,126 @@
+/**
+ * Copyright (C) Generations Linux <bugs@softcraft.org>
+ * All Rights Reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <glib/gstdio.h>
+
+#include "gould.h"
+#include "sensors.h"
+#include "check.h"
+
+/*
+* sensor_discover() and sensor_read() against a fake sysfs root: hwmon
+* chips with and without labels, a thermal zone hwmon already lists and
+* one it does not, cpufreq clocks, and inputs that do not read.
+*/
+static const char *tree_[][2] = {
+  { "class/hwmon/hwmon0/name",              "coretemp\n" },
+  { "class/hwmon/hwmon0/temp1_input",       "45000\n" },
+  { "class/hwmon/hwmon0/temp1_label",       "Package id 0\n" },
+  { "class/hwmon/hwmon0/temp2_input",       "47500\n" },
+  { "class/hwmon/hwmon0/temp2_max",         "100000\n" },
+  { "class/hwmon/hwmon0/fan1_input",        "1210\n" },
+  { "class/hwmon/hwmon0/in0_input",         "1100\n" },	/* voltage */
+  { "class/hwmon/hwmon1/name",              "acpitz\n" },
+  { "class/hwmon/hwmon1/temp1_input",       "27800\n" },
+  { "class/hwmon/hwmon2/temp1_input",       "" },		/* EIO alike */
+  { "class/thermal/thermal_zone0/type",     "acpitz\n" },
+  { "class/thermal/thermal_zone0/temp",     "27800\n" },
+  { "class/thermal/thermal_zone1/type",     "x86_pkg_temp\n" },
+  { "class/thermal/thermal_zone1/temp",     "52000\n" },
+  { "class/thermal/cooling_device0/type",   "Processor\n" },
+  { "devices/system/cpu/cpu0/cpufreq/scaling_cur_freq", "2400000\n" },
+  { "devices/system/cpu/cpu1/cpufreq/scaling_cur_freq", "800000\n" },
+  { "devices/system/cpu/cpufreq/boost",     "1\n" },
+  { "devices/system/cpu/online",            "0-1\n" },
+};
+
+/* sensor_discover() order: by kind, then label */
+static const struct { SensorKind kind; const char *label; gint value; }
+inputs_[] = {
+  { SENSOR_TEMPERATURE, "acpitz temp1",          27 },
+  { SENSOR_TEMPERATURE, "coretemp Package id 0", 45 },
+  { SENSOR_TEMPERATURE, "coretemp temp2",        47 },
+  { SENSOR_TEMPERATURE, "x86_pkg_temp",          52 },
+  { SENSOR_FAN,         "coretemp fan1",       1210 },
+  { SENSOR_FREQUENCY,   "cpu0",                2400 },
+  { SENSOR_FREQUENCY,   "cpu1",                 800 },
+};
+
+int
+main (int argc, char *argv[])
+{
+  gchar *root = check_tree_new ("sysfs");
+  SensorInput *input;
+  GList *list, *iter;
+  int idx;
+
+  CHECK(root != NULL);
+
+  for (idx = 0; idx < G_N_ELEMENTS (tree_); idx++)
+    check_tree_plant (root, tree_[idx][0], tree_[idx][1]);
+
+  list = sensor_discover (root);
+  CHECK(g_list_length (list) == G_N_ELEMENTS (inputs_));
+
+  for (iter = list, idx = 0; iter && idx < G_N_ELEMENTS (inputs_);
+       iter = iter->next, idx++) {
+    input = iter->data;
+
+    if (input->kind != inputs_[idx].kind ||
+        strcmp(input->label, inputs_[idx].label) != 0 ||
+        input->value != inputs_[idx].value) {
+      fprintf(stderr, "input %d: %d \"%s\" %d\n", idx, input->kind,
+              input->label, input->value);
+      CHECK(FALSE);
+    }
+    CHECK(input->count == 1);
+  }
+
+  /* Inputs stay open: rewritten files are read in place. */
+  check_tree_plant (root, "class/hwmon/hwmon0/temp1_input", "61000\n");
+  check_tree_plant (root, "class/hwmon/hwmon0/temp1_input", "39000\n");
+
+  if ((input = g_list_nth_data (list, 1)) != NULL) {
+    CHECK(sensor_read (input) && input->value == 39 && input->count == 2);
+    CHECK(input->ring[input->head] == 45 && input->peak == 45);
+    CHECK(input->value / sensor_step (input->kind) == 39);
+  }
+
+  /* The ring keeps the latest SENSOR_SAMPLES readings. */
+  if ((input = g_list_nth_data (list, 5)) != NULL) {
+    for (idx = 0; idx < SENSOR_SAMPLES + 3; idx++)
+      sensor_read (input);
+    CHECK(input->count == SENSOR_SAMPLES && input->head == 4);
+    CHECK(strcmp(sensor_unit (input->kind), "MHz") == 0);
+  }
+
+  g_list_foreach (list, (GFunc)sensor_input_free, NULL);
+  g_list_free (list);
+
+  /* A root without sensors is not an error. */
+  check_tree_remove (root);
+  CHECK(sensor_discover (root) == NULL);
+  g_free (root);
+
+  return CHECK_EXIT();
+} /* </main> */
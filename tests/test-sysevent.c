@@ -0,0 +1,303 @@
+/**
+ * Copyright (C) Generations Linux <bugs@softcraft.org>
+ * All Rights Reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "gould.h"
+#include "sysevent.h"
+#include "util.h"
+#include "check.h"
+
+/*
+* Mock mountinfo lines and uevent packets, as mountd reads them, fed to
+* a MountTable the way mountd does, and a fake sysfs power supply read
+* by power_supply_read() as battery does, counting its read system calls
+* (/proc/self/io) from the uevent file and from one file per attribute.
+*/
+#define PACKET(text) text, sizeof(text) - 1	/* NUL separated, unterminated */
+#define READINGS 1000				/* battery readings compared */
+
+#define MOUNT_ROOT "22 1 8:1 / / rw,relatime - ext4 /dev/sda1 rw\n"	\
+                   "23 1 0:21 / /proc rw - proc proc rw\n"
+#define MOUNT_USB  "40 22 8:17 / /media/usb rw shared:5 - vfat /dev/sdb1 rw\n"
+#define MOUNT_DISC "41 22 11:0 / /media/cdrom ro - iso9660 /dev/sr0 ro\n"
+#define MOUNT_MOVE "40 22 8:17 / /media/stick rw - vfat /dev/sdb1 rw\n"
+
+static guint probes_ = 0;	/* mount_probe() calls */
+static guint added_ = 0;	/* items of mount_added() */
+static guint removed_ = 0;	/* mount_removed() calls */
+
+static const char *supply_ =
+  "POWER_SUPPLY_NAME=BAT0\n"
+  "POWER_SUPPLY_STATUS=Discharging\n"
+  "POWER_SUPPLY_PRESENT=1\n"
+  "POWER_SUPPLY_CHARGE_FULL=4200000\n"
+  "POWER_SUPPLY_CHARGE_NOW=1050000\n";
+
+/*
+* (private) parse - mountinfo_parse() of a copy, true when source and
+* mount point are as expected (NULL expected => line rejected)
+*/
+static bool
+parse (const char *line, const char *source, const char *mountpoint)
+{
+  char *copy = strdup(line);
+  char *found, *where;
+  bool vote;
+
+  if (mountinfo_parse (copy, &found, &where))
+    vote = source && strcmp(found, source) == 0 &&
+           strcmp(where, mountpoint) == 0;
+  else
+    vote = (source == NULL);
+
+  free(copy);
+  return vote;
+} /* </parse> */
+
+/*
+* (private) mount_probe - MountProbe, sd* and sr* are removable
+* (private) mount_added - MountAdded, an item for removables, as mountd
+* (private) mount_removed - MountRemoved
+*/
+static guint
+mount_probe (const char *fsname)
+{
+  probes_++;
+  return (strncmp(fsname, "/dev/sda", 8) == 0) ? 0 : DEV_REMOVABLE;
+} /* </mount_probe> */
+
+static gpointer
+mount_added (MountTable *table, const char *fsname, const char *mntdir,
+             gpointer data)
+{
+  if (strncmp(fsname, "/dev/", 5) != 0 ||
+      !(mount_table_capability (table, fsname) & DEV_REMOVABLE))
+    return NULL;
+
+  added_++;
+  return g_strdup (mntdir);
+} /* </mount_added> */
+
+static void
+mount_removed (gpointer item, gpointer data)
+{
+  removed_++;
+  g_free (item);
+} /* </mount_removed> */
+
+/*
+* (private) mount_table - MountTable updates from mock mountinfo texts
+*/
+static void
+mount_table (void)
+{
+  MountTable *table = mount_table_new (mount_probe, mount_added,
+                                       mount_removed, NULL);
+
+  /* internal and virtual mounts: probed once, no item */
+  CHECK(mount_table_update (table, MOUNT_ROOT) == 0);
+  CHECK(probes_ == 1 && added_ == 0);
+
+  /* a stick and a disc come, each probed once */
+  CHECK(mount_table_update (table, MOUNT_ROOT MOUNT_USB MOUNT_DISC) == 2);
+  CHECK(probes_ == 3 && added_ == 2 && removed_ == 0);
+
+  /* an unchanged table: no menu update, nothing probed */
+  CHECK(mount_table_update (table, MOUNT_DISC MOUNT_ROOT MOUNT_USB) == 0);
+  CHECK(probes_ == 3 && added_ == 2 && removed_ == 0);
+
+  /* uevents: not block, block for another device, block for the stick */
+  CHECK(!mount_table_uevent (table, PACKET("change@/devices/BAT0\0"
+                             "SUBSYSTEM=power_supply\0DEVNAME=sdb1")));
+  CHECK(mount_table_uevent (table, PACKET("add@/block/sdc\0"
+                            "SUBSYSTEM=block\0DEVNAME=sdc")));
+  CHECK(mount_table_capability (table, "/dev/sdb1") == DEV_REMOVABLE);
+  CHECK(probes_ == 3);
+
+  CHECK(mount_table_uevent (table, PACKET("change@/block/sdb/sdb1\0"
+                            "SUBSYSTEM=block\0DEVNAME=sdb1")));
+  CHECK(mount_table_capability (table, "/dev/sdb1") == DEV_REMOVABLE);
+  CHECK(probes_ == 4);
+
+  /* the stick moves: one item goes, one comes */
+  CHECK(mount_table_update (table, MOUNT_ROOT MOUNT_MOVE MOUNT_DISC) == 2);
+  CHECK(probes_ == 4 && added_ == 3 && removed_ == 1);
+
+  /* the disc is ejected */
+  CHECK(mount_table_update (table, MOUNT_ROOT MOUNT_MOVE) == 1);
+  CHECK(added_ == 3 && removed_ == 2);
+
+  /* an empty read forgets every mount, the next one probes nothing */
+  CHECK(mount_table_update (table, "") == 1);
+  CHECK(mount_table_update (table, MOUNT_ROOT MOUNT_MOVE) == 1);
+  CHECK(probes_ == 4 && added_ == 4 && removed_ == 3);
+
+  mount_table_free (table);
+  CHECK(removed_ == 4);
+} /* </mount_table> */
+
+/*
+* (private) syscalls - read system calls made so far, -1 if unknown
+*/
+static long
+syscalls (void)
+{
+  char line[80];
+  long count = -1;
+  FILE *stream = fopen("/proc/self/io", "r");
+
+  if (stream) {
+    while (fgets(line, sizeof(line), stream))
+      if (strncmp(line, "syscr:", 6) == 0)
+        count = atol(&line[6]);
+    fclose(stream);
+  }
+  return count;
+} /* </syscalls> */
+
+/*
+* (private) power_supply - fake sysfs supply, uevent read in place
+*/
+static void
+power_supply (void)
+{
+  gchar *folder = check_tree_new ("sysfs");
+  gchar *uevent;
+  PowerSupply supply = { false, 0, 0 };
+  long before, overhead, pread_calls, file_calls;
+  const char *names[] = { "status", "charge_now", "charge_full" };
+  int fd, idx;
+
+  CHECK(folder != NULL);
+  uevent = g_build_filename (folder, "uevent", NULL);
+  check_tree_plant (folder, "uevent", supply_);
+
+  for (idx = 0; idx < G_N_ELEMENTS (names); idx++)
+    check_tree_plant (folder, names[idx],
+                      (idx == 0) ? "Discharging\n" : "1050000\n");
+
+  fd = open(uevent, O_RDONLY | O_CLOEXEC);
+  CHECK(fd >= 0);
+  CHECK(power_supply_state (fd, &supply));
+  CHECK(supply.discharging && supply.remaining == 1050000 &&
+        supply.capacity == 4200000);
+
+  /* The descriptor stays open: a change is read with the next pread(). */
+  check_tree_plant (folder, "uevent", "POWER_SUPPLY_STATUS=Charging\n"
+                                      "POWER_SUPPLY_ENERGY_FULL=50000000\n"
+                                      "POWER_SUPPLY_ENERGY_NOW=49000000\n");
+  CHECK(power_supply_state (fd, &supply));
+  CHECK(!supply.discharging && supply.remaining == 49000000 &&
+        supply.capacity == 50000000);
+
+  /* No status line, no reading. */
+  check_tree_plant (folder, "uevent",
+                    "POWER_SUPPLY_NAME=AC\nPOWER_SUPPLY_ONLINE=1\n");
+  CHECK(!power_supply_state (fd, &supply));
+
+  /* Without the descriptor, or a status line in it: attribute files. */
+  memset(&supply, 0, sizeof(supply));
+  CHECK(power_supply_read (folder, -1, &supply));
+  CHECK(supply.discharging && supply.remaining == 1050000 &&
+        supply.capacity == 1050000);
+  CHECK(power_supply_read (folder, fd, &supply));	/* AC uevent above */
+  CHECK(!power_supply_read (uevent, -1, &supply));	/* not a folder */
+
+  /* Read system calls: one pread() against a file per attribute. */
+  check_tree_plant (folder, "uevent", supply_);
+  before = syscalls ();
+  overhead = syscalls () - before;	/* reads of /proc/self/io itself */
+
+  before = syscalls ();
+  for (idx = 0; idx < READINGS; idx++)
+    power_supply_read (folder, fd, &supply);
+  pread_calls = syscalls () - before - overhead;
+
+  before = syscalls ();
+  for (idx = 0; idx < READINGS; idx++)
+    power_supply_read (folder, -1, &supply);
+  file_calls = syscalls () - before - overhead;
+
+  if (before >= 0) {
+    printf("%d readings: %ld read calls from uevent, %ld from attribute "
+           "files (plus %d open and close pairs)\n", READINGS,
+           pread_calls, file_calls, 3 * READINGS);
+    CHECK(pread_calls >= READINGS && pread_calls <= READINGS + 2);
+    CHECK(file_calls >= 3 * READINGS);
+  }
+  close(fd);
+
+  check_tree_remove (folder);
+  g_free (uevent);
+  g_free (folder);
+} /* </power_supply> */
+
+int
+main (int argc, char *argv[])
+{
+  const char *value;
+
+  /* mountinfo: no optional tags, several, escapes, malformed */
+  CHECK(parse ("22 1 8:1 / / rw,relatime - ext4 /dev/sda1 rw",
+               "/dev/sda1", "/"));
+  CHECK(parse ("40 22 8:17 / /media/usb rw,nosuid shared:5 master:1 - vfat "
+               "/dev/sdb1 rw,uid=1000", "/dev/sdb1", "/media/usb"));
+  CHECK(parse ("41 22 8:33 / /media/My\\040Disk rw - vfat /dev/sdc1 rw",
+               "/dev/sdc1", "/media/My Disk"));
+  CHECK(parse ("42 22 0:5 / /media/tab\\011and\\134 rw - tmpfs "
+               "some\\040thing rw", "some thing", "/media/tab\tand\\"));
+  CHECK(parse ("23 1 0:21 / /proc rw - proc proc rw", "proc", "/proc"));
+  CHECK(parse ("24 1 0:22 / /sys rw shared:7 -", NULL, NULL));
+  CHECK(parse ("25 1 0:23 / - rw", NULL, NULL));
+  CHECK(parse ("", NULL, NULL));
+
+  /* uevent: block device added */
+  value = uevent_value (PACKET("add@/devices/pci0000:00/usb1/1-1/block/sdb\0"
+                               "ACTION=add\0DEVPATH=/devices/usb1/block/sdb\0"
+                               "SUBSYSTEM=block\0DEVNAME=sdb\0DEVTYPE=disk\0"
+                               "SEQNUM=2041"), "DEVNAME");
+  CHECK(value != NULL && strcmp(value, "sdb") == 0);
+
+  /* a power_supply packet: its DEVNAME-less pairs say nothing of block */
+  CHECK(uevent_value (PACKET("change@/devices/LNXSYSTM:00/BAT0\0"
+                             "ACTION=change\0SUBSYSTEM=power_supply\0"
+                             "POWER_SUPPLY_STATUS=Discharging"),
+                      "DEVNAME") == NULL);
+
+  /* keys match whole, values may hold '=' */
+  value = uevent_value (PACKET("add@/module/x\0SUBSYSTEMS=usb\0"
+                               "SUBSYSTEM=module\0PARAM=a=b"), "SUBSYSTEM");
+  CHECK(value != NULL && strcmp(value, "module") == 0);
+  value = uevent_value (PACKET("add@/module/x\0PARAM=a=b"), "PARAM");
+  CHECK(value != NULL && strcmp(value, "a=b") == 0);
+
+  /* the header is not a pair, a truncated last pair is still found */
+  CHECK(uevent_value (PACKET("SUBSYSTEM=block@/x"), "SUBSYSTEM") == NULL);
+  value = uevent_value (PACKET("remove@/block/sr0\0DEVNAME=sr0"), "DEVNAME");
+  CHECK(value != NULL && strncmp(value, "sr0", 3) == 0);
+
+  mount_table ();
+  power_supply ();
+
+  return CHECK_EXIT();
+} /* </main> */
@@ -0,0 +1,92 @@
+/**
+ * Copyright (C) Generations Linux <bugs@softcraft.org>
+ * All Rights Reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "gould.h"
+#include "ticker.h"
+#include "check.h"
+
+/*
+* Tickers of one and two seconds run on the main loop for a few seconds:
+* all of them must be served by the same wakeups, one per second.
+*/
+#define TICKER_RUN 4500		/* milliseconds on the main loop */
+
+static guint once_ = 0;		/* calls of the ticker removing itself */
+
+/*
+* (private) count - GSourceFunc counting its calls
+*/
+static gboolean
+count (gpointer data)
+{
+  (*(guint *)data)++;
+  return TRUE;
+} /* </count> */
+
+/*
+* (private) twice - GSourceFunc removing its ticker on the second call
+*/
+static gboolean
+twice (gpointer data)
+{
+  return ++once_ < 2;
+} /* </twice> */
+
+/*
+* (private) stop - GSourceFunc ending the main loop
+*/
+static gboolean
+stop (gpointer loop)
+{
+  g_main_loop_quit ((GMainLoop *)loop);
+  return FALSE;
+} /* </stop> */
+
+int
+main (int argc, char *argv[])
+{
+  GMainLoop *loop = g_main_loop_new (NULL, FALSE);
+  guint first = 0, second = 0, slower = 0;
+  guint wakeups;
+
+  CHECK(ticker_wakeups_per_minute () == 0);
+
+  ticker_add (1, count, &first);
+  ticker_add (1, count, &second);
+  ticker_add (2, count, &slower);
+  ticker_add (1, twice, NULL);
+
+  g_timeout_add (TICKER_RUN, stop, loop);
+  g_main_loop_run (loop);
+
+  wakeups = ticker_wakeups_per_minute ();
+  printf("%u wakeups in %d ms, tickers called %u, %u, %u and %u times\n",
+         wakeups, TICKER_RUN, first, second, slower, once_);
+
+  /* One wakeup per second serves every ticker due. */
+  CHECK(wakeups >= TICKER_RUN / 1000 - 1 && wakeups <= TICKER_RUN / 1000 + 1);
+  CHECK(wakeups == ticker_wakeups ());
+  CHECK(first == wakeups && second == wakeups);
+  CHECK(slower >= wakeups / 2 && slower <= (wakeups + 1) / 2);
+  CHECK(once_ == 2);
+
+  g_main_loop_unref (loop);
+
+  return CHECK_EXIT();
+} /* </main> */